@@ -2,3 +2,36 @@
 /* aout.cc - a.out support */
 
 #include <libalfheim/aout.hh>
+
+namespace Alfheim::aout {
+	std::optional<aout_any_t> open(const byte_span_t image) noexcept {
+		const auto* const header{image.as<Types::exec_t<Types::endian_t::little>>(0U)};
+		if (!header)
+			return std::nullopt;
+
+		const auto& midmag{header->a_midmag};
+		if (is_magic(std::uint16_t(midmag[0] | (midmag[1] << 8U)))) {
+			if (auto aout{aoutle_t::open(image)})
+				return aout_any_t{*aout};
+			return std::nullopt;
+		}
+		if (!is_magic(std::uint16_t((midmag[2] << 8U) | midmag[3])))
+			return std::nullopt;
+
+		const auto machine{midmag_machine((std::uint32_t(midmag[0]) << 24U) | (std::uint32_t(midmag[1]) << 16U))};
+		if (relocation_format(machine) == Types::relocation_format_t::extended) {
+			if (auto aout{aout_sparc_t::open(image)})
+				return aout_any_t{*aout};
+			return std::nullopt;
+		}
+		/* NetBSD on a little-endian machine, with only a_midmag in network byte order */
+		if (header_endian(machine) == Types::endian_t::little) {
+			if (auto aout{aoutle_t::open(image)})
+				return aout_any_t{*aout};
+			return std::nullopt;
+		}
+		if (auto aout{aoutbe_t::open(image)})
+			return aout_any_t{*aout};
+		return std::nullopt;
+	}
+}
@@ -4,10 +4,502 @@
 #if !defined(libalfheim_aout_hh)
 #define libalfheim_aout_hh
 
+#include <cstdint>
+#include <array>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/symbol_index.hh>
+
 #include <libalfheim/aout/types.hh>
 
 namespace Alfheim::aout {
+	using Internal::span_t;
+	using Internal::byte_span_t;
+	using Internal::narrow_size;
+
+	/* A relocation record with its packed fields unpacked, whichever format it came from */
+	struct relocation_info_t final {
+		/* The offset of the field being relocated from the start of its segment */
+		std::int32_t address;
+		/* The symbol number if external, otherwise the n_type of the segment the target is in */
+		std::uint32_t index;
+		/* Extended relocations only, standard ones take the addend from the field itself */
+		std::int32_t addend;
+		/* The log2 size of the field, standard relocations only */
+		std::uint8_t length;
+		/* Extended relocations only, which encode the size and PC relativity in this instead */
+		std::uint8_t type;
+		bool pcrel;
+		bool external;
+		bool baserel;
+		bool jmptable;
+		bool relative;
+		bool copy;
+	};
+
+	/*
+		Unpacks a relocation record
+
+		The bit fields were laid out from the most or least significant bit according to the
+		byte order of the compiler that wrote them, so the split differs between the two.
+	*/
+	template<Types::endian_t E>
+	[[nodiscard]]
+	inline relocation_info_t decode_relocation(const Types::relocation_t<E>& rel) noexcept {
+		const auto& bits{rel.r_info};
+		relocation_info_t info{rel.r_address, 0U, 0, 0U, 0U, false, false, false, false, false, false};
+		if constexpr (E == Types::endian_t::big) {
+			info.index = (std::uint32_t(bits[0]) << 16U) | (std::uint32_t(bits[1]) << 8U) | bits[2];
+			info.pcrel = bits[3] & 0x80U;
+			info.length = std::uint8_t((bits[3] >> 5U) & 0x03U);
+			info.external = bits[3] & 0x10U;
+			info.baserel = bits[3] & 0x08U;
+			info.jmptable = bits[3] & 0x04U;
+			info.relative = bits[3] & 0x02U;
+			info.copy = bits[3] & 0x01U;
+		} else {
+			info.index = std::uint32_t(bits[0]) | (std::uint32_t(bits[1]) << 8U) | (std::uint32_t(bits[2]) << 16U);
+			info.pcrel = bits[3] & 0x01U;
+			info.length = std::uint8_t((bits[3] >> 1U) & 0x03U);
+			info.external = bits[3] & 0x08U;
+			info.baserel = bits[3] & 0x10U;
+			info.jmptable = bits[3] & 0x20U;
+			info.relative = bits[3] & 0x40U;
+			info.copy = bits[3] & 0x80U;
+		}
+		return info;
+	}
+
+	template<Types::endian_t E>
+	[[nodiscard]]
+	inline relocation_info_t decode_relocation(const Types::extended_relocation_t<E>& rel) noexcept {
+		const auto& bits{rel.r_info};
+		relocation_info_t info{rel.r_address, 0U, rel.r_addend, 0U, 0U, false, false, false, false, false, false};
+		if constexpr (E == Types::endian_t::big) {
+			info.index = (std::uint32_t(bits[0]) << 16U) | (std::uint32_t(bits[1]) << 8U) | bits[2];
+			info.external = bits[3] & 0x80U;
+			info.type = bits[3] & 0x1FU;
+		} else {
+			info.index = std::uint32_t(bits[0]) | (std::uint32_t(bits[1]) << 8U) | (std::uint32_t(bits[2]) << 16U);
+			info.external = bits[3] & 0x01U;
+			info.type = std::uint8_t(bits[3] >> 3U);
+		}
+		return info;
+	}
+
+	/*
+		The relocation records of a segment, decoded as they're read
+
+		The record format and byte order are fixed by the type, so there's no per-record
+		dispatch, the records stay in the image and each is unpacked when dereferenced.
+	*/
+	template<typename R>
+	struct relocations_t final {
+		using record_t = R;
+
+		struct iterator final {
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = relocation_info_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = relocation_info_t;
+		private:
+			const R* _record{nullptr};
+		public:
+			constexpr iterator() noexcept = default;
+			constexpr iterator(const R* const record) noexcept : _record{record} { /* NOP */ }
+
+			[[nodiscard]]
+			relocation_info_t operator*() const noexcept { return decode_relocation(*_record); }
+
+			iterator& operator++() noexcept {
+				++_record;
+				return *this;
+			}
+
+			iterator operator++(int) noexcept {
+				auto prev{*this};
+				++_record;
+				return prev;
+			}
+
+			[[nodiscard]]
+			bool operator==(const iterator& other) const noexcept { return _record == other._record; }
+			[[nodiscard]]
+			bool operator!=(const iterator& other) const noexcept { return _record != other._record; }
+		};
+	private:
+		span_t<const R> _records{};
+	public:
+		constexpr relocations_t() noexcept = default;
+		constexpr relocations_t(const span_t<const R> records) noexcept : _records{records} { /* NOP */ }
+
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _records.size(); }
+		[[nodiscard]]
+		bool empty() const noexcept { return _records.empty(); }
+		[[nodiscard]]
+		span_t<const R> records() const noexcept { return _records; }
+		[[nodiscard]]
+		relocation_info_t operator[](const std::size_t idx) const noexcept { return decode_relocation(_records[idx]); }
+
+		[[nodiscard]]
+		iterator begin() const noexcept { return {_records.data()}; }
+		[[nodiscard]]
+		iterator end() const noexcept { return {_records.data() + _records.size()}; }
+	};
+
+	/* SunOS and NetBSD SPARC are the only ones with the extended format */
+	[[nodiscard]]
+	constexpr Types::relocation_format_t relocation_format(const Types::machine_t machine) noexcept {
+		switch (machine) {
+			case Types::machine_t::sparc:
+			case Types::machine_t::netbsd_sparc:
+			case Types::machine_t::netbsd_sparc64:
+				return Types::relocation_format_t::extended;
+			default:
+				return Types::relocation_format_t::standard;
+		}
+	}
+
+	/* Whether a MID is one of NetBSD's, whose a_midmag is laid out differently to the Linux and SunOS one */
+	[[nodiscard]]
+	constexpr bool is_netbsd(const Types::machine_t machine) noexcept {
+		switch (machine) {
+			case Types::machine_t::netbsd_i386:
+			case Types::machine_t::netbsd_m68k:
+			case Types::machine_t::netbsd_m68k4k:
+			case Types::machine_t::netbsd_ns32532:
+			case Types::machine_t::netbsd_sparc:
+			case Types::machine_t::netbsd_pmax:
+			case Types::machine_t::netbsd_vax1k:
+			case Types::machine_t::netbsd_alpha:
+			case Types::machine_t::netbsd_mips:
+			case Types::machine_t::netbsd_arm6:
+			case Types::machine_t::netbsd_sh3:
+			case Types::machine_t::netbsd_powerpc:
+			case Types::machine_t::netbsd_vax:
+			case Types::machine_t::mips1:
+			case Types::machine_t::mips2:
+			case Types::machine_t::netbsd_m88k:
+			case Types::machine_t::netbsd_hppa:
+			case Types::machine_t::netbsd_sparc64:
+			case Types::machine_t::netbsd_x86_64:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	/* The MID of a decoded a_midmag, the 10 bits from bit 16 for NetBSD and the 8 from bit 16 otherwise */
+	[[nodiscard]]
+	constexpr Types::machine_t midmag_machine(const std::uint32_t midmag) noexcept {
+		const auto netbsd{static_cast<Types::machine_t>((midmag >> 16U) & 0x3FFU)};
+		if (is_netbsd(netbsd))
+			return netbsd;
+		return static_cast<Types::machine_t>((midmag >> 16U) & 0xFFU);
+	}
+
+	/*
+		The byte order of the rest of the header when a_midmag is in network byte order
+
+		NetBSD writes a_midmag that way on every port, so only the MID says how to read
+		everything after it. The i386, x86_64, ns32532, VAX, Alpha, ARM, and DECstation (pmax)
+		ports are little-endian, and every other NetBSD port, as well as SunOS, big-endian.
+	*/
+	[[nodiscard]]
+	constexpr Types::endian_t header_endian(const Types::machine_t machine) noexcept {
+		switch (machine) {
+			case Types::machine_t::netbsd_i386:
+			case Types::machine_t::netbsd_ns32532:
+			case Types::machine_t::netbsd_pmax:
+			case Types::machine_t::netbsd_vax1k:
+			case Types::machine_t::netbsd_alpha:
+			case Types::machine_t::netbsd_arm6:
+			case Types::machine_t::netbsd_vax:
+			case Types::machine_t::netbsd_x86_64:
+				return Types::endian_t::little;
+			default:
+				return Types::endian_t::big;
+		}
+	}
+
+	[[nodiscard]]
+	constexpr bool is_magic(const std::uint16_t magic) noexcept {
+		switch (static_cast<Types::magic_t>(magic)) {
+			case Types::magic_t::omagic:
+			case Types::magic_t::nmagic:
+			case Types::magic_t::zmagic:
+			case Types::magic_t::qmagic:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	/*
+		A zero-copy reader for OMAGIC, NMAGIC, ZMAGIC, and QMAGIC images
+
+		The byte order and relocation format are template parameters, picked once from the
+		header by open(), so everything read through this decodes without branching on them.
+		Text, data, relocations, symbols, and strings are all views into the image.
+	*/
+	template<Types::endian_t E, Types::relocation_format_t R>
+	struct aout_t final {
+		using exec_t = Types::exec_t<E>;
+		using nlist_t = Types::nlist_t<E>;
+		using relocation_t = typename Types::relocation_layout_t<R, E>::type;
+		using relocations_t = aout::relocations_t<relocation_t>;
+
+		static constexpr Types::endian_t endian{E};
+		static constexpr Types::relocation_format_t reloc_format{R};
+	private:
+		byte_span_t _image{};
+		const exec_t* _header{nullptr};
+		std::uint32_t _midmag{0U};
+		std::uint64_t _text_offset{0U};
+
+		constexpr aout_t(const byte_span_t image, const exec_t* const header, const std::uint32_t midmag) noexcept :
+			_image{image}, _header{header}, _midmag{midmag} { /* NOP */ }
+
+		/*
+			Tries the byte order of the rest of the header first, then network byte order as NetBSD writes it
+
+			A network byte order a_midmag is only accepted if its MID is one whose header is in E.
+		*/
+		[[nodiscard]]
+		static std::optional<std::uint32_t> decode_midmag(const exec_t& header) noexcept {
+			const auto& bytes{header.a_midmag};
+			const std::uint32_t network{(std::uint32_t(bytes[0]) << 24U) | (std::uint32_t(bytes[1]) << 16U) |
+				(std::uint32_t(bytes[2]) << 8U) | bytes[3]};
+			if constexpr (E == Types::endian_t::little) {
+				const std::uint32_t native{std::uint32_t(bytes[0]) | (std::uint32_t(bytes[1]) << 8U) |
+					(std::uint32_t(bytes[2]) << 16U) | (std::uint32_t(bytes[3]) << 24U)};
+				if (is_magic(std::uint16_t(native)))
+					return native;
+			}
+			if (is_magic(std::uint16_t(network)) && header_endian(midmag_machine(network)) == E)
+				return network;
+			return std::nullopt;
+		}
+
+		/* Where the string table starts if the text starts at offset */
+		[[nodiscard]]
+		std::uint64_t strings_from(const std::uint64_t offset) const noexcept {
+			return offset + _header->a_text + _header->a_data + _header->a_trsize + _header->a_drsize + _header->a_syms;
+		}
+
+		/* Whether the image ends exactly where the string table says it does, or right after the symbols without one */
+		[[nodiscard]]
+		bool ends_at(const std::uint64_t strings) const noexcept {
+			if (strings == _image.size())
+				return true;
+			const auto* const size{_image.template as<Internal::endian_value_t<std::uint32_t, E>>(narrow_size(strings))};
+			return size && strings + size->value() == _image.size();
+		}
+
+		[[nodiscard]]
+		std::optional<std::uint64_t> find_text() const noexcept {
+			switch (magic()) {
+				case Types::magic_t::omagic:
+				case Types::magic_t::nmagic:
+					return sizeof(exec_t);
+				case Types::magic_t::qmagic:
+					return 0U;
+				default:
+					break;
+			}
+			/*
+				Where ZMAGIC puts the text depends on who wrote it
+
+				Linux and 4.3BSD start it 1024 bytes in, SunOS and NetBSD at the start of the
+				file with the header inside it, and FreeBSD a page in. The first of these the
+				rest of the image ends exactly after wins, then the first it fits after at all.
+			*/
+			constexpr std::array<std::uint64_t, 3> candidates{{1024U, 0U, 4096U}};
+			std::optional<std::uint64_t> fallback{};
+			for (const auto offset : candidates) {
+				const auto strings{strings_from(offset)};
+				if (strings > _image.size())
+					continue;
+				if (ends_at(strings))
+					return offset;
+				if (!fallback)
+					fallback = offset;
+			}
+			return fallback;
+		}
+
+		[[nodiscard]]
+		std::uint64_t text_relocations_offset() const noexcept { return data_offset() + _header->a_data; }
+		[[nodiscard]]
+		std::uint64_t data_relocations_offset() const noexcept { return text_relocations_offset() + _header->a_trsize; }
+		[[nodiscard]]
+		std::uint64_t symbols_offset() const noexcept { return data_relocations_offset() + _header->a_drsize; }
+		[[nodiscard]]
+		std::uint64_t strings_offset() const noexcept { return symbols_offset() + _header->a_syms; }
+
+		[[nodiscard]]
+		relocations_t relocations(const std::uint64_t offset, const std::uint32_t size) const noexcept {
+			const std::size_t count{size / sizeof(relocation_t)};
+			const auto records{_image.template array<relocation_t>(narrow_size(offset), count)};
+			return records.size() == count ? relocations_t{records} : relocations_t{};
+		}
+	public:
+		constexpr aout_t() noexcept = default;
+
+		/* Fails unless the segments, relocations, and symbols all fit in the image */
+		[[nodiscard]]
+		static std::optional<aout_t> open(const byte_span_t image) noexcept {
+			const auto* const header{image.template as<exec_t>(0)};
+			if (!header)
+				return std::nullopt;
+			const auto info{decode_midmag(*header)};
+			if (!info)
+				return std::nullopt;
+
+			aout_t aout{image, header, *info};
+			if (relocation_format(aout.machine()) != R)
+				return std::nullopt;
+			const auto text{aout.find_text()};
+			if (!text)
+				return std::nullopt;
+			aout._text_offset = *text;
+			if (aout.strings_offset() > image.size())
+				return std::nullopt;
+			return aout;
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _header; }
+		[[nodiscard]]
+		byte_span_t image() const noexcept { return _image; }
+		[[nodiscard]]
+		const exec_t& header() const noexcept { return *_header; }
+		/* a_midmag, decoded in whichever byte order it was written in */
+		[[nodiscard]]
+		std::uint32_t midmag() const noexcept { return _midmag; }
+		[[nodiscard]]
+		Types::magic_t magic() const noexcept { return static_cast<Types::magic_t>(_midmag & 0xFFFFU); }
+		[[nodiscard]]
+		Types::machine_t machine() const noexcept { return midmag_machine(_midmag); }
+		/* The 6 bits from bit 26 for NetBSD, such as EX_DYNAMIC and EX_PIC, otherwise the top 8 bits as Linux and SunOS use them */
+		[[nodiscard]]
+		std::uint8_t flags() const noexcept {
+			if (is_netbsd(machine()))
+				return std::uint8_t((_midmag >> 26U) & 0x3FU);
+			return std::uint8_t(_midmag >> 24U);
+		}
+		[[nodiscard]]
+		std::uint32_t entry() const noexcept { return _header->a_entry; }
+
+		[[nodiscard]]
+		std::uint64_t text_offset() const noexcept { return _text_offset; }
+		[[nodiscard]]
+		std::uint64_t data_offset() const noexcept { return _text_offset + _header->a_text; }
+		/* For QMAGIC and SunOS style ZMAGIC images this includes the header */
+		[[nodiscard]]
+		byte_span_t text() const noexcept { return _image.subspan(narrow_size(_text_offset), _header->a_text); }
+		[[nodiscard]]
+		byte_span_t data() const noexcept { return _image.subspan(narrow_size(data_offset()), _header->a_data); }
+		/* The bss takes up no space in the image, so there's only its size */
+		[[nodiscard]]
+		std::uint32_t bss_size() const noexcept { return _header->a_bss; }
+
+		[[nodiscard]]
+		relocations_t text_relocations() const noexcept { return relocations(text_relocations_offset(), _header->a_trsize); }
+		[[nodiscard]]
+		relocations_t data_relocations() const noexcept { return relocations(data_relocations_offset(), _header->a_drsize); }
+
+		[[nodiscard]]
+		span_t<const nlist_t> symbols() const noexcept {
+			return _image.template array<nlist_t>(narrow_size(symbols_offset()), _header->a_syms / sizeof(nlist_t));
+		}
+
+		/* The string table, including its leading size, or empty if there's none or it doesn't fit */
+		[[nodiscard]]
+		byte_span_t strings() const noexcept {
+			const auto offset{narrow_size(strings_offset())};
+			const auto* const size{_image.template as<Internal::endian_value_t<std::uint32_t, E>>(offset)};
+			if (!size || size->value() < 4U)
+				return {};
+			return _image.subspan(offset, size->value());
+		}
+
+		[[nodiscard]]
+		std::string_view name(const nlist_t& sym) const noexcept {
+			const std::uint32_t strx{sym.n_strx};
+			return strx < 4U ? std::string_view{} : strings().string(strx);
+		}
+
+		[[nodiscard]]
+		static bool is_stab(const nlist_t& sym) noexcept { return sym.n_type & Types::symbol_stab_mask; }
+		[[nodiscard]]
+		static bool is_external(const nlist_t& sym) noexcept { return sym.n_type & Types::symbol_external; }
+
+		/* The type without N_EXT, which is meaningless for stabs */
+		[[nodiscard]]
+		static Types::symbol_type_t type(const nlist_t& sym) noexcept {
+			const std::uint8_t n_type{sym.n_type};
+			if ((n_type >= std::uint8_t(Types::symbol_type_t::weak_undefined) &&
+				n_type <= std::uint8_t(Types::symbol_type_t::weak_bss)) || n_type == std::uint8_t(Types::symbol_type_t::filename))
+				return static_cast<Types::symbol_type_t>(n_type);
+			return static_cast<Types::symbol_type_t>(n_type & Types::symbol_type_mask);
+		}
+
+		/* In the text, data, or bss, rather than undefined, absolute, or debug information */
+		[[nodiscard]]
+		static bool is_defined(const nlist_t& sym) noexcept {
+			if (is_stab(sym))
+				return false;
+			switch (type(sym)) {
+				case Types::symbol_type_t::text:
+				case Types::symbol_type_t::data:
+				case Types::symbol_type_t::bss:
+				case Types::symbol_type_t::weak_text:
+				case Types::symbol_type_t::weak_data:
+				case Types::symbol_type_t::weak_bss:
+					return true;
+				default:
+					return false;
+			}
+		}
+	};
+
+	/*
+		Adds the symbols in the text, data, and bss of an image to an address index
+
+		a.out symbols carry no size, so each extends up to the next one.
+	*/
+	template<Types::endian_t E, Types::relocation_format_t R>
+	void index_symbols(const aout_t<E, R>& aout, symbol_index_t::builder_t& builder, const std::uint64_t bias = 0U) {
+		const auto symbols{aout.symbols()};
+		builder.reserve(builder.size() + symbols.size());
+		for (const auto& sym : symbols) {
+			if (!aout.is_defined(sym))
+				continue;
+			const auto name{aout.name(sym)};
+			if (!name.empty())
+				builder.add(sym.n_value + bias, 0U, name);
+		}
+	}
+
+	using aoutle_t = aout_t<Types::endian_t::little, Types::relocation_format_t::standard>;
+	using aoutbe_t = aout_t<Types::endian_t::big, Types::relocation_format_t::standard>;
+	using aout_sparc_t = aout_t<Types::endian_t::big, Types::relocation_format_t::extended>;
+
+	using aout_any_t = std::variant<aoutle_t, aoutbe_t, aout_sparc_t>;
 
+	/* Opens an image as whichever byte order and relocation format its header says it has */
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<aout_any_t> open(byte_span_t image) noexcept;
 }
 
 #endif /* libalfheim_aout_hh */
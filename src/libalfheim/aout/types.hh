@@ -4,8 +4,152 @@
 #if !defined(libalfheim_aout_types_hh)
 #define libalfheim_aout_types_hh
 
+#include <cstdint>
+#include <array>
+
+#include <libalfheim/internal/endian.hh>
+
 namespace Alfheim::aout::Types {
+	using Alfheim::Internal::endian_t;
+	using Alfheim::Internal::endian_value_t;
+
+	/* The low 16 bits of a_midmag, traditionally written in octal */
+	enum struct magic_t : std::uint16_t {
+		/* Impure, text and data are contiguous and writable, used for relocatable objects */
+		omagic = 0407U,
+		/* Pure, text is read-only and data starts on the next segment boundary */
+		nmagic = 0410U,
+		/* Demand paged, text and data start on page boundaries in the file */
+		zmagic = 0413U,
+		/* Demand paged, with the header at the start of the text, which is mapped a page in */
+		qmagic = 0314U,
+	};
+
+	/* Bits 16 to 23 of a_midmag, or 16 to 25 for NetBSD, Linux and SunOS values followed by the NetBSD ones */
+	enum struct machine_t : std::uint16_t {
+		unknown        = 0U,
+		m68010         = 1U,
+		m68020         = 2U,
+		sparc          = 3U,
+		i386           = 100U,
+		arm            = 103U,
+		netbsd_i386    = 134U,
+		netbsd_m68k    = 135U,
+		netbsd_m68k4k  = 136U,
+		netbsd_ns32532 = 137U,
+		netbsd_sparc   = 138U,
+		netbsd_pmax    = 139U,
+		netbsd_vax1k   = 140U,
+		netbsd_alpha   = 141U,
+		netbsd_mips    = 142U,
+		netbsd_arm6    = 143U,
+		netbsd_sh3     = 145U,
+		netbsd_powerpc = 149U,
+		netbsd_vax     = 150U,
+		mips1          = 151U,
+		mips2          = 152U,
+		netbsd_m88k    = 153U,
+		netbsd_hppa    = 154U,
+		netbsd_sparc64 = 156U,
+		netbsd_x86_64  = 157U,
+	};
+
+	/* SPARC uses 12 byte relocations with an addend and a type, everything else the 8 byte bit field ones */
+	enum struct relocation_format_t : std::uint8_t {
+		standard = 0x00U,
+		extended = 0x01U,
+	};
+
+	/* n_type with N_EXT masked off, other than for the GNU weak types and N_FN which are whole values */
+	enum struct symbol_type_t : std::uint8_t {
+		undefined      = 0x00U,
+		absolute       = 0x02U,
+		text           = 0x04U,
+		data           = 0x06U,
+		bss            = 0x08U,
+		indirect       = 0x0AU,
+		size           = 0x0CU,
+		weak_undefined = 0x0DU,
+		weak_absolute  = 0x0EU,
+		weak_text      = 0x0FU,
+		weak_data      = 0x10U,
+		weak_bss       = 0x11U,
+		set_absolute   = 0x14U,
+		set_text       = 0x16U,
+		set_data       = 0x18U,
+		set_bss        = 0x1AU,
+		set_vector     = 0x1CU,
+		warning        = 0x1EU,
+		filename       = 0x1FU,
+	};
+
+	constexpr std::uint8_t symbol_external{0x01U};
+	constexpr std::uint8_t symbol_type_mask{0x1EU};
+	/* Any of these set makes the symbol a debugger stab, whose type is the whole byte */
+	constexpr std::uint8_t symbol_stab_mask{0xE0U};
+
+	/*
+		The header, struct exec
+
+		NetBSD writes a_midmag in network byte order whatever the byte order of everything else,
+		so it isn't read through this but decoded when the image is opened. It also splits it
+		differently, with 6 bits of flags over a 10-bit MID where Linux and SunOS have 8 and 8.
+	*/
+	template<endian_t E>
+	struct exec_t final {
+		std::array<std::uint8_t, 4> a_midmag;
+		endian_value_t<std::uint32_t, E> a_text;
+		endian_value_t<std::uint32_t, E> a_data;
+		endian_value_t<std::uint32_t, E> a_bss;
+		/* The size in bytes of the symbol table, not a count */
+		endian_value_t<std::uint32_t, E> a_syms;
+		endian_value_t<std::uint32_t, E> a_entry;
+		endian_value_t<std::uint32_t, E> a_trsize;
+		endian_value_t<std::uint32_t, E> a_drsize;
+	};
+
+	template<endian_t E>
+	struct nlist_t final {
+		/* Offset into the string table, which counts its own 4 byte size */
+		endian_value_t<std::uint32_t, E> n_strx;
+		std::uint8_t n_type;
+		std::uint8_t n_other;
+		endian_value_t<std::uint16_t, E> n_desc;
+		endian_value_t<std::uint32_t, E> n_value;
+	};
+
+	/* struct relocation_info, r_info packs the symbol number and flags into bits by byte order */
+	template<endian_t E>
+	struct relocation_t final {
+		endian_value_t<std::int32_t, E> r_address;
+		std::array<std::uint8_t, 4> r_info;
+	};
+
+	/* struct reloc_info_sparc */
+	template<endian_t E>
+	struct extended_relocation_t final {
+		endian_value_t<std::int32_t, E> r_address;
+		std::array<std::uint8_t, 4> r_info;
+		endian_value_t<std::int32_t, E> r_addend;
+	};
+
+	template<relocation_format_t R, endian_t E>
+	struct relocation_layout_t;
+
+	template<endian_t E>
+	struct relocation_layout_t<relocation_format_t::standard, E> final {
+		using type = relocation_t<E>;
+	};
+
+	template<endian_t E>
+	struct relocation_layout_t<relocation_format_t::extended, E> final {
+		using type = extended_relocation_t<E>;
+	};
 
+	static_assert(sizeof(exec_t<endian_t::little>) == 32, "exec_t must be 32 bytes");
+	static_assert(sizeof(nlist_t<endian_t::little>) == 12, "nlist_t must be 12 bytes");
+	static_assert(sizeof(relocation_t<endian_t::little>) == 8, "relocation_t must be 8 bytes");
+	static_assert(sizeof(extended_relocation_t<endian_t::little>) == 12, "extended_relocation_t must be 12 bytes");
 }
 
 #endif /* libalfheim_aout_types_hh */
@@ -0,0 +1,384 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* archive.cc - ar(1) archive support */
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <numeric>
+
+#include <libalfheim/internal/endian.hh>
+
+#include <libalfheim/archive.hh>
+#include <libalfheim/coff.hh>
+#include <libalfheim/format.hh>
+
+namespace Alfheim::Archive {
+	namespace {
+		using Internal::endian_t;
+		using Internal::endian_value_t;
+
+		/* A symbol table entry before the member it refers to has been looked up */
+		struct entry_t final {
+			std::string_view name;
+			std::uint64_t offset;
+		};
+
+		/* The symbol table members, which are only parsed once every member header is known */
+		struct tables_t final {
+			byte_span_t gnu{};
+			byte_span_t gnu64{};
+			byte_span_t msvc{};
+			byte_span_t bsd{};
+			bool bsd64{false};
+			/* Microsoft archives have two members named "/", the second is the one we want */
+			std::size_t symtabs{0};
+		};
+
+		/* Header fields are padded out with spaces */
+		template<std::size_t N>
+		[[nodiscard]]
+		std::string_view field(const std::array<char, N>& value) noexcept {
+			std::string_view result{value.data(), value.size()};
+			const auto end{result.find_last_not_of(' ')};
+			return end == std::string_view::npos ? std::string_view{} : result.substr(0U, end + 1U);
+		}
+
+		[[nodiscard]]
+		std::optional<std::uint64_t> decimal(const std::string_view value) noexcept {
+			if (value.empty() || value.size() > 19U)
+				return std::nullopt;
+			std::uint64_t result{};
+			for (const auto chr : value) {
+				if (chr < '0' || chr > '9')
+					return std::nullopt;
+				result = (result * 10U) + std::uint64_t(chr - '0');
+			}
+			return result;
+		}
+
+		[[nodiscard]]
+		bool starts_with(const std::string_view value, const std::string_view prefix) noexcept {
+			return value.substr(0U, prefix.size()) == prefix;
+		}
+
+		/* GNU terminates long names with "/\n", Microsoft with a NUL */
+		[[nodiscard]]
+		std::string_view long_name(const byte_span_t names, const std::size_t offset) noexcept {
+			const auto rest{names.subspan(offset)};
+			std::string_view name{reinterpret_cast<const char*>(rest.data()), rest.size()};
+			name = name.substr(0U, name.find_first_of("\n\0"sv));
+			if (!name.empty() && name.back() == '/')
+				name.remove_suffix(1U);
+			return name;
+		}
+
+		template<typename T, endian_t E>
+		[[nodiscard]]
+		std::optional<T> read(const byte_span_t data, const std::size_t offset) noexcept {
+			const auto* const value{data.as<endian_value_t<T, E>>(offset)};
+			return value ? std::optional<T>{value->value()} : std::nullopt;
+		}
+
+		/* Reads count NUL terminated names back to back from offset, stopping short if they run out */
+		template<typename F>
+		void names(const byte_span_t data, std::size_t offset, const std::size_t count, F&& func) {
+			for (std::size_t idx{}; idx < count && offset < data.size(); ++idx) {
+				const auto name{data.string(offset)};
+				if (name.empty() && offset + 1U >= data.size())
+					return;
+				func(idx, name);
+				offset += name.size() + 1U;
+			}
+		}
+
+		/* A big-endian count, that many big-endian member offsets, then the names in the same order */
+		template<typename T>
+		void parse_gnu(const byte_span_t data, std::vector<entry_t>& entries) {
+			const auto count{read<T, endian_t::big>(data, 0U)};
+			if (!count || *count > (data.size() - sizeof(T)) / sizeof(T))
+				return;
+			const auto offsets{data.array<endian_value_t<T, endian_t::big>>(sizeof(T), std::size_t(*count))};
+			entries.reserve(offsets.size());
+			names(data, sizeof(T) * (offsets.size() + 1U), offsets.size(), [&](const std::size_t idx, const std::string_view name) {
+				entries.push_back({name, offsets[idx]});
+			});
+		}
+
+		/* The member offsets once each, then for each name in sorted order a 1-based index into those */
+		void parse_msvc(const byte_span_t data, std::vector<entry_t>& entries) {
+			using word_t = endian_value_t<std::uint32_t, endian_t::little>;
+			using half_t = endian_value_t<std::uint16_t, endian_t::little>;
+
+			const auto members{read<std::uint32_t, endian_t::little>(data, 0U)};
+			if (!members || *members > data.size() / sizeof(word_t))
+				return;
+			const auto offsets{data.array<word_t>(sizeof(word_t), *members)};
+			const auto count_offset{sizeof(word_t) * (offsets.size() + 1U)};
+			const auto count{read<std::uint32_t, endian_t::little>(data, count_offset)};
+			if (offsets.size() != *members || !count || *count > data.size() / sizeof(half_t))
+				return;
+			const auto indices{data.array<half_t>(count_offset + sizeof(word_t), *count)};
+			if (indices.size() != *count)
+				return;
+			entries.reserve(indices.size());
+			names(data, count_offset + sizeof(word_t) + (indices.size() * sizeof(half_t)), indices.size(),
+				[&](const std::size_t idx, const std::string_view name) {
+					const std::size_t member{indices[idx]};
+					if (member && member <= offsets.size())
+						entries.push_back({name, offsets[member - 1U]});
+				});
+		}
+
+		/*
+			The size in bytes of an array of (name offset, member offset) pairs, the array, then
+			the string table size and the strings. These are in the byte order of the target.
+		*/
+		template<typename T, endian_t E>
+		[[nodiscard]]
+		bool parse_bsd(const byte_span_t data, std::vector<entry_t>& entries) {
+			const auto size{read<T, E>(data, 0U)};
+			if (!size || *size % (2U * sizeof(T)) || *size > data.size() - sizeof(T))
+				return false;
+			const auto count{std::size_t(*size) / (2U * sizeof(T))};
+			const auto ranlib{data.array<endian_value_t<T, E>>(sizeof(T), count * 2U)};
+			const auto strings_offset{sizeof(T) + std::size_t(*size)};
+			const auto strings_size{read<T, E>(data, strings_offset)};
+			if (ranlib.size() != count * 2U || !strings_size || *strings_size > data.size() - strings_offset - sizeof(T))
+				return false;
+			const auto strings{data.subspan(strings_offset + sizeof(T), std::size_t(*strings_size))};
+			entries.reserve(count);
+			for (std::size_t idx{}; idx < count; ++idx) {
+				const auto name{strings.string(std::size_t(ranlib[idx * 2U].value()))};
+				if (!name.empty())
+					entries.push_back({name, ranlib[(idx * 2U) + 1U]});
+			}
+			return true;
+		}
+
+		template<typename T>
+		void parse_bsd(const byte_span_t data, std::vector<entry_t>& entries) {
+			/* There's no marker for the byte order, but only one of them will have the sizes add up */
+			if (!parse_bsd<T, endian_t::little>(data, entries))
+				static_cast<void>(parse_bsd<T, endian_t::big>(data, entries));
+		}
+	}
+
+	archive_t::archive_t(const archive_t&) = default;
+	archive_t::archive_t(archive_t&&) noexcept = default;
+	archive_t::~archive_t() noexcept = default;
+	archive_t& archive_t::operator=(const archive_t&) = default;
+	archive_t& archive_t::operator=(archive_t&&) noexcept = default;
+
+	std::optional<archive_t> archive_t::open(const byte_span_t data) {
+		const auto magic{data.first(Types::magic.size())};
+		const std::string_view signature{reinterpret_cast<const char*>(magic.data()), magic.size()};
+		if (signature != Types::magic && signature != Types::thin_magic)
+			return std::nullopt;
+
+		archive_t archive{};
+		archive._data = data;
+		archive._thin = signature == Types::thin_magic;
+
+		tables_t tables{};
+		byte_span_t long_names{};
+		for (std::size_t offset{Types::magic.size()}; offset + sizeof(Types::member_header_t) <= data.size();) {
+			const auto header_offset{offset};
+			const auto* const header{data.as<Types::member_header_t>(offset)};
+			if (std::string_view{header->end.data(), header->end.size()} != Types::header_end)
+				return std::nullopt;
+			const auto size{decimal(field(header->size))};
+			if (!size)
+				return std::nullopt;
+
+			auto name{field(header->name)};
+			/* The symbol tables and long names are always stored, even in a thin archive */
+			const bool special{name == Types::symtab_name || name == Types::symtab64_name ||
+				name == Types::long_names_name || starts_with(name, "/<"sv)};
+			const bool stored{special || !archive._thin};
+			const auto data_offset{offset + sizeof(Types::member_header_t)};
+			byte_span_t contents{};
+			if (stored) {
+				contents = data.subspan(data_offset, Internal::narrow_size(*size));
+				if (contents.size() != *size)
+					return std::nullopt;
+			}
+			/* Members are aligned to 2 bytes */
+			offset = data_offset + (stored ? contents.size() : 0U);
+			offset += offset & 1U;
+
+			if (special) {
+				if (name == Types::symtab_name)
+					(tables.symtabs++ ? tables.msvc : tables.gnu) = contents;
+				else if (name == Types::symtab64_name)
+					tables.gnu64 = contents;
+				else if (name == Types::long_names_name)
+					long_names = contents;
+				continue;
+			}
+
+			std::uint64_t member_size{*size};
+			if (starts_with(name, Types::bsd_long_name_prefix)) {
+				const auto length{decimal(name.substr(Types::bsd_long_name_prefix.size()))};
+				if (!length || *length > contents.size())
+					return std::nullopt;
+				const auto stored_name{contents.first(std::size_t(*length))};
+				name = {reinterpret_cast<const char*>(stored_name.data()), stored_name.size()};
+				name = name.substr(0U, name.find('\0'));
+				contents = contents.subspan(std::size_t(*length));
+				member_size -= *length;
+			} else if (name.size() > 1U && name[0] == '/') {
+				const auto index{decimal(name.substr(1U))};
+				if (!index || *index >= long_names.size())
+					return std::nullopt;
+				name = long_name(long_names, std::size_t(*index));
+			} else if (!name.empty() && name.back() == '/')
+				name.remove_suffix(1U);
+
+			if (name == Types::symdef_name || name == Types::symdef_sorted_name ||
+				name == Types::symdef64_name || name == Types::symdef64_sorted_name) {
+				tables.bsd = contents;
+				tables.bsd64 = name == Types::symdef64_name || name == Types::symdef64_sorted_name;
+				continue;
+			}
+			archive._members.push_back({name, header_offset, member_size, contents});
+		}
+
+		std::vector<entry_t> entries{};
+		if (!tables.msvc.empty()) {
+			parse_msvc(tables.msvc, entries);
+			archive._symtab_kind = Types::symtab_kind_t::msvc;
+		} else if (!tables.gnu64.empty()) {
+			parse_gnu<std::uint64_t>(tables.gnu64, entries);
+			archive._symtab_kind = Types::symtab_kind_t::gnu64;
+		} else if (!tables.gnu.empty()) {
+			parse_gnu<std::uint32_t>(tables.gnu, entries);
+			archive._symtab_kind = Types::symtab_kind_t::gnu;
+		} else if (!tables.bsd.empty()) {
+			if (tables.bsd64)
+				parse_bsd<std::uint64_t>(tables.bsd, entries);
+			else
+				parse_bsd<std::uint32_t>(tables.bsd, entries);
+			archive._symtab_kind = tables.bsd64 ? Types::symtab_kind_t::bsd64 : Types::symtab_kind_t::bsd;
+		}
+
+		archive._symbols.reserve(entries.size());
+		for (const auto& entry : entries) {
+			const auto member{entry.offset <= data.size() ? archive.member_at(std::size_t(entry.offset)) : npos};
+			if (member != npos)
+				archive._symbols.push_back({entry.name, static_cast<std::uint32_t>(member)});
+		}
+
+		const auto& symbols{archive._symbols};
+		archive._by_name.resize(symbols.size());
+		std::iota(archive._by_name.begin(), archive._by_name.end(), 0U);
+		std::stable_sort(archive._by_name.begin(), archive._by_name.end(),
+			[&](const std::uint32_t lhs, const std::uint32_t rhs) noexcept { return symbols[lhs].name < symbols[rhs].name; });
+		return archive;
+	}
+
+	std::size_t archive_t::member_at(const std::size_t offset) const noexcept {
+		const auto iter{std::lower_bound(_members.begin(), _members.end(), offset,
+			[](const member_t& member, const std::size_t value) noexcept { return member.header_offset < value; })};
+		if (iter == _members.end() || iter->header_offset != offset)
+			return npos;
+		return std::size_t(iter - _members.begin());
+	}
+
+	std::size_t archive_t::find(const std::string_view name) const noexcept {
+		const auto iter{std::lower_bound(_by_name.begin(), _by_name.end(), name,
+			[&](const std::uint32_t idx, const std::string_view value) noexcept { return _symbols[idx].name < value; })};
+		if (iter == _by_name.end() || _symbols[*iter].name != name)
+			return npos;
+		return _symbols[*iter].member;
+	}
+
+	namespace {
+		template<typename T>
+		void defined_elf(const T& elf, std::vector<std::string_view>& names) {
+			using symtab_t = typename T::symtab_t;
+			using ELF::Types::symbol_binding_t;
+
+			const auto symtab{elf.symbols()};
+			for (const auto& sym : symtab) {
+				const auto binding{symtab_t::binding(sym)};
+				if (binding != symbol_binding_t::global && binding != symbol_binding_t::weak &&
+					binding != symbol_binding_t::gnu_unique)
+					continue;
+				if (std::uint16_t{sym.st_shndx} == std::uint16_t(ELF::Types::section_index_t::undef))
+					continue;
+				if (const auto name{symtab.name(sym)}; !name.empty())
+					names.push_back(name);
+			}
+		}
+
+		template<typename T>
+		void defined_macho(const T& macho, std::vector<std::string_view>& names) {
+			using symtab_t = typename T::symtab_t;
+
+			const auto symtab{macho.symbols()};
+			for (const auto& sym : symtab) {
+				if (symtab_t::is_debug(sym) || !symtab_t::is_external(sym) || symtab_t::type(sym) == MachO::Types::nlist_type_t::undf)
+					continue;
+				if (const auto name{symtab.name(sym)}; !name.empty())
+					names.push_back(name);
+			}
+		}
+
+		template<typename T>
+		void defined_coff(const T& coff, std::vector<std::string_view>& names) {
+			using symtab_t = typename T::symtab_t;
+
+			const auto symtab{coff.symbols()};
+			symtab.for_each([&](const std::size_t, const typename T::symbol_t& sym) {
+				if (!symtab_t::is_external(sym) || !(symtab_t::is_defined(sym) || symtab_t::is_common(sym)))
+					return;
+				if (const auto name{symtab.name(sym)}; !name.empty())
+					names.push_back(name);
+			});
+		}
+
+		void defined_member(const byte_span_t data, std::vector<std::string_view>& names) {
+			if (const auto import{COFF::import_object_t::open(data)}) {
+				names.push_back(import->symbol);
+				return;
+			}
+
+			const auto image{Alfheim::open(data)};
+			if (!image)
+				return;
+			if (const auto* const elf{image->as<ELF::elf_any_t>()})
+				std::visit([&](const auto& inner) { defined_elf(inner, names); }, *elf);
+			else if (const auto* const macho{image->as<MachO::macho_any_t>()})
+				std::visit([&](const auto& inner) { defined_macho(inner, names); }, *macho);
+			else if (const auto* const coff{image->as<COFF::coff_any_t>()})
+				std::visit([&](const auto& inner) { defined_coff(inner, names); }, *coff);
+		}
+	}
+
+	std::vector<symbol_t> defined_symbols(const archive_t& archive, Internal::thread_pool_t& pool) {
+		/* Each member gets its own list so the workers never share anything, they're joined in order after */
+		std::vector<std::vector<std::string_view>> per_member(archive.size());
+		/* Running out of memory can't escape a worker, so it's noted and rethrown here once they're all done */
+		std::atomic<bool> exhausted{false};
+		for_each_member(archive, pool, [&](const std::size_t, const std::size_t idx, const member_t& member) noexcept {
+			try {
+				defined_member(member.data, per_member[idx]);
+			} catch (const std::bad_alloc&) {
+				exhausted.store(true, std::memory_order_relaxed);
+			}
+		});
+		if (exhausted.load(std::memory_order_relaxed))
+			throw std::bad_alloc{};
+
+		std::size_t total{};
+		for (const auto& names : per_member)
+			total += names.size();
+		std::vector<symbol_t> symbols{};
+		symbols.reserve(total);
+		for (std::size_t idx{}; idx < per_member.size(); ++idx) {
+			for (const auto name : per_member[idx])
+				symbols.push_back({name, static_cast<std::uint32_t>(idx)});
+		}
+		return symbols;
+	}
+}
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* archive.hh - ar(1) archive support */
+#pragma once
+#if !defined(libalfheim_archive_hh)
+#define libalfheim_archive_hh
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/span.hh>
+#include <libalfheim/internal/thread_pool.hh>
+
+#include <libalfheim/archive/types.hh>
+
+namespace Alfheim::Archive {
+	using Internal::span_t;
+	using Internal::byte_span_t;
+
+	struct member_t final {
+		/* With any long name resolved, for thin archives this is the path of the member */
+		std::string_view name;
+		/* The offset of the member's header, which is how symbol tables refer to it */
+		std::size_t header_offset;
+		/* The size of the member's contents, which for a thin archive aren't in the archive */
+		std::uint64_t size;
+		/* A view of the contents, empty for thin archives */
+		byte_span_t data;
+	};
+
+	/* A symbol from the archive's symbol table and the index of the member defining it */
+	struct symbol_t final {
+		std::string_view name;
+		std::uint32_t member;
+	};
+
+	/*
+		An ar(1) archive, as used for static libraries by every Unix and by Windows
+
+		The member headers and the symbol table are indexed once when the archive is opened,
+		with long names resolved and the special members (symbol tables and the long name
+		table) kept out of the member list. GNU and System V, their 64-bit variant, BSD
+		__.SYMDEF, and Microsoft linker members are all understood, with the Microsoft second
+		linker member preferred as it covers the same symbols more compactly.
+
+		Symbols are indexed by name for find(), so looking up which member defines a symbol
+		is a binary search no matter which flavour of table it came from. Every member is
+		handed out as a view into the archive, with nothing copied.
+	*/
+	struct LIBALFHEIM_CLS_API archive_t final {
+		static constexpr std::size_t npos{std::numeric_limits<std::size_t>::max()};
+	private:
+		byte_span_t _data{};
+		bool _thin{false};
+		Types::symtab_kind_t _symtab_kind{Types::symtab_kind_t::none};
+		std::vector<member_t> _members{};
+		/* In the order of the archive's symbol table */
+		std::vector<symbol_t> _symbols{};
+		std::vector<std::uint32_t> _by_name{};
+	public:
+		archive_t() noexcept = default;
+		archive_t(const archive_t&);
+		archive_t(archive_t&&) noexcept;
+		~archive_t() noexcept;
+		archive_t& operator=(const archive_t&);
+		archive_t& operator=(archive_t&&) noexcept;
+
+		[[nodiscard]]
+		static std::optional<archive_t> open(byte_span_t data);
+
+		[[nodiscard]]
+		byte_span_t data() const noexcept { return _data; }
+		[[nodiscard]]
+		bool thin() const noexcept { return _thin; }
+		[[nodiscard]]
+		Types::symtab_kind_t symtab_kind() const noexcept { return _symtab_kind; }
+
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _members.size(); }
+		[[nodiscard]]
+		span_t<const member_t> members() const noexcept { return {_members.data(), _members.size()}; }
+		[[nodiscard]]
+		const member_t& member(const std::size_t idx) const noexcept { return _members[idx]; }
+
+		[[nodiscard]]
+		span_t<const symbol_t> symbols() const noexcept { return {_symbols.data(), _symbols.size()}; }
+
+		/* The index of the member whose header is at offset, or npos */
+		[[nodiscard]]
+		std::size_t member_at(std::size_t offset) const noexcept;
+
+		/* The index of the member the symbol table says defines name, or npos */
+		[[nodiscard]]
+		std::size_t find(std::string_view name) const noexcept;
+	};
+
+	/*
+		Calls func(worker, idx, member) for every member across a thread pool
+
+		As with thread_pool_t::parallel_for(), func must not throw, and worker can be used to
+		index per-thread state.
+	*/
+	template<typename F>
+	void for_each_member(const archive_t& archive, Internal::thread_pool_t& pool, F&& func) {
+		pool.parallel_for(archive.size(), [&](const std::size_t worker, const std::size_t idx) noexcept {
+			func(worker, idx, archive.member(idx));
+		});
+	}
+
+	/*
+		Parses every member and collects the global symbols each one defines
+
+		The members are parsed in parallel on pool, each being opened as whatever object
+		format it is, ELF, Mach-O, or COFF, along with Microsoft short import members. The
+		result is in member order, and is what the archive's symbol table would hold, so it
+		works for archives without one, or where it can't be trusted. The exception is short
+		import members, which give the name they import without the __imp_ pointer symbol the
+		linker derives from it, as the names are views into the archive. Members of thin
+		archives aren't stored in the archive, so there is nothing to extract from them.
+
+		Running out of memory while parsing a member throws std::bad_alloc on the calling
+		thread once every worker has finished.
+	*/
+	[[nodiscard]]
+	LIBALFHEIM_API std::vector<symbol_t> defined_symbols(const archive_t& archive, Internal::thread_pool_t& pool);
+}
+
+#endif /* libalfheim_archive_hh */
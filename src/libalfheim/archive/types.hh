@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* archive/types.hh - ar(1) archive types */
+#pragma once
+#if !defined(libalfheim_archive_types_hh)
+#define libalfheim_archive_types_hh
+
+#include <cstdint>
+#include <array>
+#include <string_view>
+
+#include <libalfheim/config.hh>
+
+namespace Alfheim::Archive::Types {
+	constexpr std::string_view magic{"!<arch>\n"sv};
+	/* GNU thin archives, where members are only referenced by path and not stored */
+	constexpr std::string_view thin_magic{"!<thin>\n"sv};
+	/* Every member header ends with this */
+	constexpr std::string_view header_end{"`\n"sv};
+
+	/* The GNU, System V, and Microsoft symbol table member, the first of the two in Microsoft archives */
+	constexpr std::string_view symtab_name{"/"sv};
+	constexpr std::string_view symtab64_name{"/SYM64/"sv};
+	/* The GNU and Microsoft long name table */
+	constexpr std::string_view long_names_name{"//"sv};
+	/* BSD symbol tables, with the names sorted or not */
+	constexpr std::string_view symdef_name{"__.SYMDEF"sv};
+	constexpr std::string_view symdef_sorted_name{"__.SYMDEF SORTED"sv};
+	constexpr std::string_view symdef64_name{"__.SYMDEF_64"sv};
+	constexpr std::string_view symdef64_sorted_name{"__.SYMDEF_64 SORTED"sv};
+	/* BSD long names, the name is stored at the start of the member data and counted in its size */
+	constexpr std::string_view bsd_long_name_prefix{"#1/"sv};
+
+	/* Which flavour of symbol table an archive has, if any */
+	enum struct symtab_kind_t : std::uint8_t {
+		none  = 0x00U,
+		gnu   = 0x01U,
+		gnu64 = 0x02U,
+		/* The sorted second linker member of a Microsoft .lib */
+		msvc  = 0x03U,
+		bsd   = 0x04U,
+		bsd64 = 0x05U,
+	};
+
+	/* All fields are left-justified ASCII, padded with spaces */
+	struct member_header_t final {
+		std::array<char, 16> name;
+		std::array<char, 12> date;
+		std::array<char, 6> uid;
+		std::array<char, 6> gid;
+		std::array<char, 8> mode;
+		std::array<char, 10> size;
+		std::array<char, 2> end;
+	};
+
+	static_assert(sizeof(member_header_t) == 60, "member_header_t must be 60 bytes");
+}
+
+#endif /* libalfheim_archive_types_hh */
@@ -2,3 +2,25 @@
 /* coff.cc - COFF support */
 
 #include <libalfheim/coff.hh>
+
+namespace Alfheim::COFF {
+	std::optional<coff_any_t> open(const byte_span_t image) noexcept {
+		const auto sigs{image.array<Internal::le_t<std::uint16_t>>(0U, 2U)};
+		if (sigs.size() != 2U)
+			return std::nullopt;
+
+		if (sigs[0] == Types::anon_sig1 && sigs[1] == Types::anon_sig2) {
+			if (auto coff{bigobj_t::open(image)})
+				return coff_any_t{*coff};
+			return std::nullopt;
+		}
+		if (image[0] == 0x01U) {
+			if (auto coff{coff_be_t::open(image)})
+				return coff_any_t{*coff};
+			return std::nullopt;
+		}
+		if (auto coff{coff_le_t::open(image)})
+			return coff_any_t{*coff};
+		return std::nullopt;
+	}
+}
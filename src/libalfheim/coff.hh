@@ -4,10 +4,288 @@
 #if !defined(libalfheim_coff_hh)
 #define libalfheim_coff_hh
 
+#include <cstdint>
+#include <algorithm>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/span.hh>
+
 #include <libalfheim/coff/types.hh>
 
 namespace Alfheim::COFF {
+	using Internal::span_t;
+	using Internal::byte_span_t;
+
+	/* Turns a fixed size, possibly unterminated, section or symbol name into a string */
+	[[nodiscard]]
+	inline std::string_view fixed_name(const std::array<char, 8>& name) noexcept {
+		std::size_t len{0};
+		while (len < name.size() && name[len])
+			++len;
+		return {name.data(), len};
+	}
+
+	/*
+		The symbol table along with the string table that follows it
+
+		Entries are followed by their auxiliary records in the same array, so walking the
+		table goes by next() rather than one entry at a time.
+	*/
+	template<typename L>
+	struct symtab_t final {
+		using symbol_t = typename L::symbol_t;
+	private:
+		span_t<const symbol_t> _symbols{};
+		byte_span_t _strings{};
+	public:
+		constexpr symtab_t() noexcept = default;
+		constexpr symtab_t(const span_t<const symbol_t> symbols, const byte_span_t strings) noexcept :
+			_symbols{symbols}, _strings{strings} { /* NOP */ }
+
+		[[nodiscard]]
+		bool valid() const noexcept { return !_symbols.empty(); }
+		/* The number of records, auxiliary ones included */
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _symbols.size(); }
+		[[nodiscard]]
+		byte_span_t strings() const noexcept { return _strings; }
+		[[nodiscard]]
+		const symbol_t& operator[](const std::size_t idx) const noexcept { return _symbols[idx]; }
+
+		/* The index of the symbol after the one at idx, skipping its auxiliary records */
+		[[nodiscard]]
+		std::size_t next(const std::size_t idx) const noexcept {
+			return std::min(_symbols.size(), idx + 1U + _symbols[idx].number_of_aux_symbols);
+		}
+
+		/* The auxiliary records of the symbol at idx, these need reinterpreting according to the symbol */
+		[[nodiscard]]
+		span_t<const symbol_t> aux(const std::size_t idx) const noexcept {
+			return _symbols.subspan(idx + 1U, next(idx) - idx - 1U);
+		}
+
+		/* Calls func(idx, symbol) for every symbol, skipping auxiliary records */
+		template<typename F>
+		void for_each(F&& func) const {
+			for (std::size_t idx{}; idx < _symbols.size(); idx = next(idx))
+				func(idx, _symbols[idx]);
+		}
+
+		[[nodiscard]]
+		std::string_view name(const symbol_t& sym) const noexcept {
+			/* Long names have the first 4 bytes zeroed, the rest is their offset in the string table */
+			if (sym.name[0] || sym.name[1] || sym.name[2] || sym.name[3])
+				return fixed_name(sym.name);
+			const auto* const offset{byte_span_t{
+				reinterpret_cast<const std::uint8_t*>(sym.name.data()), sym.name.size()
+			}.template as<Internal::endian_value_t<std::uint32_t, L::endian>>(4U)};
+			return _strings.string(std::size_t{offset->value()});
+		}
+
+		[[nodiscard]]
+		static std::int32_t section_number(const symbol_t& sym) noexcept { return sym.section_number; }
+		[[nodiscard]]
+		static bool is_external(const symbol_t& sym) noexcept {
+			return sym.storage_class == Types::storage_class_t::external ||
+				sym.storage_class == Types::storage_class_t::weak_external;
+		}
+		/* Defined in a section of this object, or absolute */
+		[[nodiscard]]
+		static bool is_defined(const symbol_t& sym) noexcept {
+			return section_number(sym) > 0 || section_number(sym) == std::int32_t(Types::section_number_t::absolute);
+		}
+		/* Undefined externals with a value are common symbols, the value being their size */
+		[[nodiscard]]
+		static bool is_common(const symbol_t& sym) noexcept {
+			return sym.storage_class == Types::storage_class_t::external &&
+				section_number(sym) == std::int32_t(Types::section_number_t::undefined) && sym.value;
+		}
+	};
+
+	/*
+		A lazy, zero-copy reader for a COFF relocatable object
+
+		Covers both Microsoft objects, standard and /bigobj, and the big-endian System V
+		flavour. As with the other readers only the header is validated up front, the section
+		table and symbol table are views into the image that are bounds checked on access.
+	*/
+	template<Types::kind_t K, Types::endian_t E>
+	struct coff_t final {
+		using layout = Types::layout_t<K, E>;
+		using header_t = typename layout::header_t;
+		using section_t = typename layout::section_t;
+		using symbol_t = typename layout::symbol_t;
+		using symtab_t = COFF::symtab_t<layout>;
+
+		static constexpr Types::kind_t kind{K};
+		static constexpr Types::endian_t endian{E};
+	private:
+		byte_span_t _image{};
+		const header_t* _header{nullptr};
+		span_t<const section_t> _sections{};
+
+		constexpr coff_t(const byte_span_t image, const header_t* const header) noexcept :
+			_image{image}, _header{header} { /* NOP */ }
+
+		[[nodiscard]]
+		static std::size_t optional_header_size(const header_t& header) noexcept {
+			if constexpr (K == Types::kind_t::bigobj) {
+				static_cast<void>(header);
+				return 0U;
+			} else
+				return header.size_of_optional_header;
+		}
+	public:
+		constexpr coff_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<coff_t> open(const byte_span_t image) noexcept {
+			const auto* const header{image.template as<header_t>(0)};
+			if (!header)
+				return std::nullopt;
+			if constexpr (K == Types::kind_t::bigobj) {
+				if (header->sig1 != Types::anon_sig1 || header->sig2 != Types::anon_sig2 || header->version < 2U ||
+					header->class_id != Types::bigobj_class_id)
+					return std::nullopt;
+			}
+
+			coff_t coff{image, header};
+			const std::size_t count{header->number_of_sections};
+			coff._sections = image.template array<section_t>(sizeof(header_t) + optional_header_size(*header), count);
+			if (coff._sections.size() != count)
+				return std::nullopt;
+			return coff;
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _header; }
+		[[nodiscard]]
+		byte_span_t image() const noexcept { return _image; }
+		[[nodiscard]]
+		const header_t& header() const noexcept { return *_header; }
+		[[nodiscard]]
+		std::uint16_t machine() const noexcept { return _header->machine; }
+
+		[[nodiscard]]
+		span_t<const section_t> sections() const noexcept { return _sections; }
+
+		/* A section by its 1-based number, as symbols refer to them */
+		[[nodiscard]]
+		const section_t* section(const std::int32_t number) const noexcept {
+			if (number <= 0 || std::size_t(number) > _sections.size())
+				return nullptr;
+			return &_sections[std::size_t(number) - 1U];
+		}
+
+		[[nodiscard]]
+		byte_span_t section_data(const section_t& section) const noexcept {
+			if (section.characteristics & std::uint32_t(Types::section_flags_t::uninitialized_data))
+				return {};
+			return _image.subspan(std::size_t{section.pointer_to_raw_data}, std::size_t{section.size_of_raw_data});
+		}
+
+		[[nodiscard]]
+		symtab_t symbols() const noexcept {
+			const std::size_t offset{_header->pointer_to_symbol_table};
+			const std::size_t count{_header->number_of_symbols};
+			if (!offset || !count)
+				return {};
+			const auto symbols{_image.template array<symbol_t>(offset, count)};
+			if (symbols.size() != count)
+				return {};
+			/* The string table's leading size counts itself, so offsets into it can be used as is */
+			const auto strings_offset{offset + (count * sizeof(symbol_t))};
+			const auto* const size{_image.template as<Internal::endian_value_t<std::uint32_t, E>>(strings_offset)};
+			return {symbols, size ? _image.subspan(strings_offset, std::size_t{size->value()}) : byte_span_t{}};
+		}
+
+		/*
+			The name of a section, looking up long names in the string table
+
+			Those are "/" and a decimal offset, or with /bigobj "//" and a base64 offset for
+			string tables too big for 7 digits.
+		*/
+		[[nodiscard]]
+		std::string_view section_name(const section_t& section) const noexcept {
+			const auto name{fixed_name(section.name)};
+			if (name.size() < 2U || name[0] != '/')
+				return name;
+
+			std::size_t offset{};
+			if (name[1] == '/') {
+				for (const auto chr : name.substr(2U)) {
+					std::size_t digit{};
+					if (chr >= 'A' && chr <= 'Z')
+						digit = std::size_t(chr - 'A');
+					else if (chr >= 'a' && chr <= 'z')
+						digit = std::size_t(chr - 'a') + 26U;
+					else if (chr >= '0' && chr <= '9')
+						digit = std::size_t(chr - '0') + 52U;
+					else if (chr == '+' || chr == '/')
+						digit = chr == '+' ? 62U : 63U;
+					else
+						return name;
+					offset = (offset * 64U) + digit;
+				}
+			} else {
+				for (const auto chr : name.substr(1U)) {
+					if (chr < '0' || chr > '9')
+						return name;
+					offset = (offset * 10U) + std::size_t(chr - '0');
+				}
+			}
+			const auto strings{symbols().strings()};
+			return strings.empty() ? name : strings.string(offset);
+		}
+	};
+
+	/* A short import library member, which stands in for a whole object defining one imported symbol */
+	struct import_object_t final {
+		const Types::import_header_t* header;
+		std::string_view symbol;
+		std::string_view dll;
+
+		[[nodiscard]]
+		Types::import_type_t type() const noexcept { return static_cast<Types::import_type_t>(header->type & 0x0003U); }
+		[[nodiscard]]
+		Types::import_name_type_t name_type() const noexcept {
+			return static_cast<Types::import_name_type_t>((header->type >> 2U) & 0x0007U);
+		}
+		[[nodiscard]]
+		bool by_ordinal() const noexcept { return name_type() == Types::import_name_type_t::ordinal; }
+
+		[[nodiscard]]
+		static std::optional<import_object_t> open(const byte_span_t image) noexcept {
+			const auto* const header{image.as<Types::import_header_t>(0)};
+			if (!header || header->sig1 != Types::anon_sig1 || header->sig2 != Types::anon_sig2 || header->version)
+				return std::nullopt;
+			const auto data{image.subspan(sizeof(Types::import_header_t), std::size_t{header->size_of_data})};
+			const auto symbol{data.string(0U)};
+			if (symbol.empty())
+				return std::nullopt;
+			return import_object_t{header, symbol, data.string(symbol.size() + 1U)};
+		}
+	};
+
+	using coff_le_t = coff_t<Types::kind_t::standard, Types::endian_t::little>;
+	using coff_be_t = coff_t<Types::kind_t::standard, Types::endian_t::big>;
+	using bigobj_t = coff_t<Types::kind_t::bigobj, Types::endian_t::little>;
+
+	using coff_any_t = std::variant<coff_le_t, coff_be_t, bigobj_t>;
+
+	/*
+		Opens a relocatable object as whichever flavour it is
 
+		Big-endian System V objects are told apart by their leading byte, every big-endian
+		machine number starts with 0x01 while no little-endian Microsoft one does. Import
+		library members and other anonymous objects that aren't /bigobj aren't opened.
+	*/
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<coff_any_t> open(byte_span_t image) noexcept;
 }
 
 #endif /* libalfheim_coff_hh */
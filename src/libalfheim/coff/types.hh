@@ -4,8 +4,212 @@
 #if !defined(libalfheim_coff_types_hh)
 #define libalfheim_coff_types_hh
 
+#include <cstdint>
+#include <array>
+
+#include <libalfheim/internal/endian.hh>
+
 namespace Alfheim::COFF::Types {
+	using Alfheim::Internal::endian_t;
+	using Alfheim::Internal::endian_value_t;
+	using Alfheim::Internal::le_t;
+
+	/* Objects built with /bigobj have a different header and wider section numbers in their symbols */
+	enum struct kind_t : std::uint8_t {
+		standard = 0x00U,
+		bigobj   = 0x01U,
+	};
+
+	/* Anonymous objects, bigobj and import library members among them, start with these in place of a machine */
+	constexpr std::uint16_t anon_sig1{0x0000U};
+	constexpr std::uint16_t anon_sig2{0xFFFFU};
+
+	/* {D1BAA1C7-BAEE-4BA9-AF20-FAF66AA4DCB8} */
+	constexpr std::array<std::uint8_t, 16> bigobj_class_id{{
+		0xC7U, 0xA1U, 0xBAU, 0xD1U, 0xEEU, 0xBAU, 0xA9U, 0x4BU, 0xAFU, 0x20U, 0xFAU, 0xF6U, 0x6AU, 0xA4U, 0xDCU, 0xB8U
+	}};
+
+	/* Special section numbers, anything above 0 is a 1-based index into the section table */
+	enum struct section_number_t : std::int32_t {
+		undefined = 0,
+		absolute  = -1,
+		debug     = -2,
+	};
+
+	enum struct storage_class_t : std::uint8_t {
+		end_of_function  = 0xFFU,
+		null             = 0U,
+		automatic        = 1U,
+		external         = 2U,
+		static_          = 3U,
+		register_        = 4U,
+		external_def     = 5U,
+		label            = 6U,
+		undefined_label  = 7U,
+		member_of_struct = 8U,
+		argument         = 9U,
+		struct_tag       = 10U,
+		member_of_union  = 11U,
+		union_tag        = 12U,
+		type_definition  = 13U,
+		undefined_static = 14U,
+		enum_tag         = 15U,
+		member_of_enum   = 16U,
+		register_param   = 17U,
+		bit_field        = 18U,
+		block            = 100U,
+		function         = 101U,
+		end_of_struct    = 102U,
+		file             = 103U,
+		section          = 104U,
+		weak_external    = 105U,
+		clr_token        = 107U,
+	};
+
+	enum struct section_flags_t : std::uint32_t {
+		no_pad             = 0x00000008U,
+		code               = 0x00000020U,
+		initialized_data   = 0x00000040U,
+		uninitialized_data = 0x00000080U,
+		lnk_info           = 0x00000200U,
+		lnk_remove         = 0x00000800U,
+		lnk_comdat         = 0x00001000U,
+		align_mask         = 0x00F00000U,
+		lnk_nreloc_ovfl    = 0x01000000U,
+		mem_discardable    = 0x02000000U,
+		mem_execute        = 0x20000000U,
+		mem_read           = 0x40000000U,
+		mem_write          = 0x80000000U,
+	};
+
+	/* What a short import library member stands in for */
+	enum struct import_type_t : std::uint8_t {
+		code   = 0U,
+		data   = 1U,
+		const_ = 2U,
+	};
+
+	/* How the name a short import member binds to is derived from its symbol name */
+	enum struct import_name_type_t : std::uint8_t {
+		ordinal         = 0U,
+		name            = 1U,
+		name_noprefix   = 2U,
+		name_undecorate = 3U,
+		name_exportas   = 4U,
+	};
+
+	template<endian_t E>
+	struct file_header_t final {
+		endian_value_t<std::uint16_t, E> machine;
+		endian_value_t<std::uint16_t, E> number_of_sections;
+		endian_value_t<std::uint32_t, E> time_date_stamp;
+		endian_value_t<std::uint32_t, E> pointer_to_symbol_table;
+		endian_value_t<std::uint32_t, E> number_of_symbols;
+		endian_value_t<std::uint16_t, E> size_of_optional_header;
+		endian_value_t<std::uint16_t, E> characteristics;
+	};
+
+	/* The /bigobj header, there is never an optional header and the counts are all 32-bit */
+	struct bigobj_header_t final {
+		le_t<std::uint16_t> sig1;
+		le_t<std::uint16_t> sig2;
+		le_t<std::uint16_t> version;
+		le_t<std::uint16_t> machine;
+		le_t<std::uint32_t> time_date_stamp;
+		std::array<std::uint8_t, 16> class_id;
+		le_t<std::uint32_t> size_of_data;
+		le_t<std::uint32_t> flags;
+		le_t<std::uint32_t> meta_data_size;
+		le_t<std::uint32_t> meta_data_offset;
+		le_t<std::uint32_t> number_of_sections;
+		le_t<std::uint32_t> pointer_to_symbol_table;
+		le_t<std::uint32_t> number_of_symbols;
+	};
+
+	/* The header of a short import library member, followed by the symbol name and DLL name */
+	struct import_header_t final {
+		le_t<std::uint16_t> sig1;
+		le_t<std::uint16_t> sig2;
+		le_t<std::uint16_t> version;
+		le_t<std::uint16_t> machine;
+		le_t<std::uint32_t> time_date_stamp;
+		le_t<std::uint32_t> size_of_data;
+		le_t<std::uint16_t> ordinal_or_hint;
+		/* The import type in bits 0-1 and the name type in bits 2-4 */
+		le_t<std::uint16_t> type;
+	};
+
+	template<endian_t E>
+	struct section_header_t final {
+		/* Long names are "/" followed by the decimal offset of the name in the string table */
+		std::array<char, 8> name;
+		endian_value_t<std::uint32_t, E> virtual_size;
+		endian_value_t<std::uint32_t, E> virtual_address;
+		endian_value_t<std::uint32_t, E> size_of_raw_data;
+		endian_value_t<std::uint32_t, E> pointer_to_raw_data;
+		endian_value_t<std::uint32_t, E> pointer_to_relocations;
+		endian_value_t<std::uint32_t, E> pointer_to_linenumbers;
+		endian_value_t<std::uint16_t, E> number_of_relocations;
+		endian_value_t<std::uint16_t, E> number_of_linenumbers;
+		endian_value_t<std::uint32_t, E> characteristics;
+	};
+
+	/*
+		A symbol table entry, followed by number_of_aux_symbols auxiliary records of the same size
+
+		A name of 8 characters or less is stored inline, a longer one has the first 4 bytes
+		zeroed and the offset of the name in the string table in the last 4.
+	*/
+	template<endian_t E>
+	struct symbol_t final {
+		std::array<char, 8> name;
+		endian_value_t<std::uint32_t, E> value;
+		endian_value_t<std::int16_t, E> section_number;
+		endian_value_t<std::uint16_t, E> type;
+		storage_class_t storage_class;
+		std::uint8_t number_of_aux_symbols;
+	};
+
+	struct bigobj_symbol_t final {
+		std::array<char, 8> name;
+		le_t<std::uint32_t> value;
+		le_t<std::int32_t> section_number;
+		le_t<std::uint16_t> type;
+		storage_class_t storage_class;
+		std::uint8_t number_of_aux_symbols;
+	};
+
+	/* Maps an object kind and byte order to the concrete on-disk structures */
+	template<kind_t K, endian_t E>
+	struct layout_t;
+
+	template<endian_t E>
+	struct layout_t<kind_t::standard, E> final {
+		static constexpr kind_t kind{kind_t::standard};
+		static constexpr endian_t endian{E};
+
+		using header_t  = file_header_t<E>;
+		using section_t = section_header_t<E>;
+		using symbol_t  = Types::symbol_t<E>;
+	};
+
+	/* bigobj is a Microsoft extension, so only ever little endian */
+	template<>
+	struct layout_t<kind_t::bigobj, endian_t::little> final {
+		static constexpr kind_t kind{kind_t::bigobj};
+		static constexpr endian_t endian{endian_t::little};
+
+		using header_t  = bigobj_header_t;
+		using section_t = section_header_t<endian_t::little>;
+		using symbol_t  = bigobj_symbol_t;
+	};
 
+	static_assert(sizeof(file_header_t<endian_t::little>) == 20, "file_header_t must be 20 bytes");
+	static_assert(sizeof(bigobj_header_t) == 56, "bigobj_header_t must be 56 bytes");
+	static_assert(sizeof(import_header_t) == 20, "import_header_t must be 20 bytes");
+	static_assert(sizeof(section_header_t<endian_t::little>) == 40, "section_header_t must be 40 bytes");
+	static_assert(sizeof(symbol_t<endian_t::little>) == 18, "symbol_t must be 18 bytes");
+	static_assert(sizeof(bigobj_symbol_t) == 20, "bigobj_symbol_t must be 20 bytes");
 }
 
 #endif /* libalfheim_coff_types_hh */
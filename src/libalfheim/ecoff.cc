@@ -2,3 +2,31 @@
 /* ecoff.cc - ECOFF support */
 
 #include <libalfheim/ecoff.hh>
+
+namespace Alfheim::ECOFF {
+	std::optional<ecoff_any_t> open(const byte_span_t image) noexcept {
+		const auto* const magic{image.as<Types::endian_value_t<std::uint16_t, Types::endian_t::little>>(0U)};
+		if (!magic)
+			return std::nullopt;
+
+		/* Alpha is only ever little-endian, and a MIPS magic read the wrong way round matches nothing */
+		switch (static_cast<Types::magic_t>(magic->value())) {
+			case Types::magic_t::alpha:
+			case Types::magic_t::alpha_bsd:
+				if (auto ecoff{ecoff64le_t::open(image)})
+					return ecoff_any_t{*ecoff};
+				return std::nullopt;
+			case Types::magic_t::mips_el:
+			case Types::magic_t::mips_el_2:
+			case Types::magic_t::mips_el_3:
+				if (auto ecoff{ecoff32le_t::open(image)})
+					return ecoff_any_t{*ecoff};
+				return std::nullopt;
+			default:
+				break;
+		}
+		if (auto ecoff{ecoff32be_t::open(image)})
+			return ecoff_any_t{*ecoff};
+		return std::nullopt;
+	}
+}
@@ -4,10 +4,440 @@
 #if !defined(libalfheim_ecoff_hh)
 #define libalfheim_ecoff_hh
 
+#include <cstdint>
+#include <array>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/symbol_index.hh>
+
 #include <libalfheim/ecoff/types.hh>
 
 namespace Alfheim::ECOFF {
+	using Internal::span_t;
+	using Internal::byte_span_t;
+	using Internal::narrow_size;
+
+	/* Turns a fixed size, possibly unterminated, section name into a string */
+	[[nodiscard]]
+	inline std::string_view fixed_name(const std::array<char, 8>& name) noexcept {
+		std::size_t len{0};
+		while (len < name.size() && name[len])
+			++len;
+		return {name.data(), len};
+	}
+
+	/* A symbol with its packed type, storage class, and index unpacked */
+	struct symbol_info_t final {
+		std::uint64_t value;
+		/* The name's offset in the local string space relative to the file, or in the external one */
+		std::int32_t iss;
+		Types::symbol_type_t type;
+		Types::storage_class_t storage_class;
+		/* What this means depends on the type, often an index into the auxiliary table */
+		std::uint32_t index;
+
+		/* In an address in the image, rather than undefined, common, absolute, or debug information */
+		[[nodiscard]]
+		bool is_defined() const noexcept {
+			switch (storage_class) {
+				case Types::storage_class_t::text:
+				case Types::storage_class_t::data:
+				case Types::storage_class_t::bss:
+				case Types::storage_class_t::sdata:
+				case Types::storage_class_t::sbss:
+				case Types::storage_class_t::rdata:
+				case Types::storage_class_t::init:
+				case Types::storage_class_t::fini:
+				case Types::storage_class_t::xdata:
+				case Types::storage_class_t::pdata:
+				case Types::storage_class_t::rconst:
+					return true;
+				default:
+					return false;
+			}
+		}
+	};
+
+	struct external_info_t final {
+		symbol_info_t symbol;
+		/* The file descriptor of the file defining it, or -1 */
+		std::int32_t ifd;
+		bool weak;
+	};
+
+	/*
+		Unpacks the type, storage class, and index of a symbol
+
+		These are bit fields, which the compilers that wrote them laid out from the most or
+		least significant bit according to the byte order, so the split differs between the two.
+	*/
+	template<Types::endian_t E>
+	[[nodiscard]]
+	inline symbol_info_t decode_symbol(const std::uint64_t value, const std::int32_t iss, const std::array<std::uint8_t, 4>& bits) noexcept {
+		symbol_info_t info{value, iss, {}, {}, 0U};
+		if constexpr (E == Types::endian_t::big) {
+			info.type = static_cast<Types::symbol_type_t>(bits[0] >> 2U);
+			info.storage_class = static_cast<Types::storage_class_t>(((bits[0] & 0x03U) << 3U) | (bits[1] >> 5U));
+			info.index = (std::uint32_t(bits[1] & 0x0FU) << 16U) | (std::uint32_t(bits[2]) << 8U) | bits[3];
+		} else {
+			info.type = static_cast<Types::symbol_type_t>(bits[0] & 0x3FU);
+			info.storage_class = static_cast<Types::storage_class_t>((bits[0] >> 6U) | ((bits[1] & 0x07U) << 2U));
+			info.index = std::uint32_t(bits[1] >> 4U) | (std::uint32_t(bits[2]) << 4U) | (std::uint32_t(bits[3]) << 12U);
+		}
+		return info;
+	}
+
+	/*
+		The symbolic header and the tables it locates
+
+		This is where ECOFF keeps everything, local and external symbols, procedures, line
+		numbers, and their string spaces, with one file descriptor per source file holding
+		its slice of each. Nothing is read when this is created, each table is located from
+		the header when it's asked for and its records are decoded as they're read. Listing
+		the external symbols only ever touches the external table and external string space,
+		however large the local tables are.
+	*/
+	template<typename L>
+	struct symbolic_t final {
+		using header_t = typename L::symbolic_header_t;
+		using fdr_t = typename L::fdr_t;
+		using pdr_t = typename L::pdr_t;
+		using symbol_t = typename L::symbol_t;
+		using external_t = typename L::external_t;
+		using addr_t = typename L::addr_t;
+	private:
+		byte_span_t _image{};
+		const header_t* _header{nullptr};
+
+		template<typename T>
+		[[nodiscard]]
+		span_t<const T> table(const std::uint64_t offset, const std::uint32_t count) const noexcept {
+			if (!count)
+				return {};
+			const auto result{_image.template array<T>(narrow_size(offset), count)};
+			return result.size() == count ? result : span_t<const T>{};
+		}
+
+		[[nodiscard]]
+		byte_span_t bytes(const std::uint64_t offset, const std::uint64_t size) const noexcept {
+			return _image.subspan(narrow_size(offset), narrow_size(size));
+		}
+
+		/* A slice of one of the global tables, as a file descriptor has for each of them */
+		template<typename T, typename B, typename C>
+		[[nodiscard]]
+		static span_t<const T> slice(const span_t<const T> table, const B base, const C count) noexcept {
+			if (base < 0 || count < 0)
+				return {};
+			const auto result{table.subspan(std::size_t(base), std::size_t(count))};
+			return result.size() == std::size_t(count) ? result : span_t<const T>{};
+		}
+
+		constexpr symbolic_t(const byte_span_t image, const header_t* const header) noexcept :
+			_image{image}, _header{header} { /* NOP */ }
+	public:
+		constexpr symbolic_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<symbolic_t> open(const byte_span_t image, const std::size_t offset) noexcept {
+			const auto* const header{image.template as<header_t>(offset)};
+			if (!header || header->magic != L::symbolic_magic)
+				return std::nullopt;
+			return symbolic_t{image, header};
+		}
+
+		[[nodiscard]]
+		const header_t& header() const noexcept { return *_header; }
+
+		[[nodiscard]]
+		span_t<const fdr_t> files() const noexcept { return table<fdr_t>(_header->cb_fd_offset, _header->ifd_max); }
+		[[nodiscard]]
+		span_t<const pdr_t> procedures() const noexcept { return table<pdr_t>(_header->cb_pd_offset, _header->ipd_max); }
+		[[nodiscard]]
+		span_t<const symbol_t> local_symbols() const noexcept { return table<symbol_t>(_header->cb_sym_offset, _header->isym_max); }
+		[[nodiscard]]
+		span_t<const external_t> external_symbols() const noexcept {
+			return table<external_t>(_header->cb_ext_offset, _header->iext_max);
+		}
+		/* The auxiliary type information that symbol indices point into */
+		[[nodiscard]]
+		Internal::endian_span_t<std::uint32_t, L::endian> aux() const noexcept {
+			return {bytes(_header->cb_aux_offset, std::uint64_t{_header->iaux_max} * sizeof(std::uint32_t))};
+		}
+		/* Maps each file's relative file indices to file descriptors */
+		[[nodiscard]]
+		Internal::endian_span_t<std::uint32_t, L::endian> relative_files() const noexcept {
+			return {bytes(_header->cb_rfd_offset, std::uint64_t{_header->crfd} * sizeof(std::uint32_t))};
+		}
+		[[nodiscard]]
+		byte_span_t local_strings() const noexcept { return bytes(_header->cb_ss_offset, _header->iss_max); }
+		[[nodiscard]]
+		byte_span_t external_strings() const noexcept { return bytes(_header->cb_ss_ext_offset, _header->iss_ext_max); }
+		/* The packed line number program of every file */
+		[[nodiscard]]
+		byte_span_t lines() const noexcept { return bytes(_header->cb_line_offset, _header->cb_line); }
+
+		[[nodiscard]]
+		static symbol_info_t decode(const symbol_t& sym) noexcept {
+			return decode_symbol<L::endian>(sym.value, sym.iss, sym.bits);
+		}
+
+		[[nodiscard]]
+		static external_info_t decode(const external_t& ext) noexcept {
+			if constexpr (L::endian == Types::endian_t::big)
+				return {decode(ext.asym), ext.ifd, (ext.bits1 & 0x20U) != 0U};
+			else
+				return {decode(ext.asym), ext.ifd, (ext.bits1 & 0x04U) != 0U};
+		}
+
+		[[nodiscard]]
+		span_t<const symbol_t> file_symbols(const fdr_t& fdr) const noexcept {
+			return slice(local_symbols(), std::int32_t{fdr.isym_base}, std::int32_t{fdr.csym});
+		}
+		[[nodiscard]]
+		span_t<const pdr_t> file_procedures(const fdr_t& fdr) const noexcept {
+			return slice(procedures(), std::int64_t{fdr.ipd_first}, std::int64_t{fdr.cpd});
+		}
+		/* The file's own string space, which its local symbol names are relative to */
+		[[nodiscard]]
+		byte_span_t file_strings(const fdr_t& fdr) const noexcept {
+			if (std::int32_t{fdr.iss_base} < 0)
+				return {};
+			return local_strings().subspan(std::size_t(std::int32_t{fdr.iss_base}), narrow_size(addr_t(fdr.cb_ss)));
+		}
+
+		[[nodiscard]]
+		std::string_view file_name(const fdr_t& fdr) const noexcept {
+			const std::int32_t rss{fdr.rss};
+			return rss < 0 ? std::string_view{} : file_strings(fdr).string(std::size_t(rss));
+		}
+
+		/* The name of a local symbol belonging to fdr */
+		[[nodiscard]]
+		std::string_view name(const fdr_t& fdr, const symbol_info_t& sym) const noexcept {
+			return sym.iss < 0 ? std::string_view{} : file_strings(fdr).string(std::size_t(sym.iss));
+		}
+
+		[[nodiscard]]
+		std::string_view name(const external_info_t& ext) const noexcept {
+			return ext.symbol.iss < 0 ? std::string_view{} : external_strings().string(std::size_t(ext.symbol.iss));
+		}
+
+		/* The local symbol a procedure descriptor belongs to, its name and address */
+		[[nodiscard]]
+		std::optional<symbol_info_t> procedure_symbol(const fdr_t& fdr, const pdr_t& pdr) const noexcept {
+			const std::int32_t isym{pdr.isym};
+			const auto symbols{file_symbols(fdr)};
+			if (isym < 0 || std::size_t(isym) >= symbols.size())
+				return std::nullopt;
+			return decode(symbols[std::size_t(isym)]);
+		}
+
+		/* Calls func(external, name) for every external symbol, without touching any of the local tables */
+		template<typename F>
+		void for_each_external(F&& func) const {
+			const auto strings{external_strings()};
+			for (const auto& ext : external_symbols()) {
+				const auto info{decode(ext)};
+				func(info, info.symbol.iss < 0 ? std::string_view{} : strings.string(std::size_t(info.symbol.iss)));
+			}
+		}
+
+		/*
+			Calls func(offset, line) for each instruction of the procedure at idx in fdr's procedures
+
+			Offsets are in bytes from the start of the procedure. Each byte of the line program
+			covers 1 to 16 instructions with a line delta of -7 to 7, a delta of -8 meaning the
+			real one follows as a big-endian 16-bit value. The program runs until the next
+			procedure's, and is capped at the number of lines the file descriptor gives it.
+		*/
+		template<typename F>
+		void for_each_line(const fdr_t& fdr, const std::size_t idx, F&& func) const {
+			const auto procs{file_procedures(fdr)};
+			if (idx >= procs.size())
+				return;
+			const auto& pdr{procs[idx]};
+			const std::int64_t start{pdr.cb_line_offset};
+			const std::int32_t first_line{pdr.iline};
+			if (start < 0 || first_line < 0)
+				return;
+
+			/* The next procedure with line numbers bounds this one, otherwise the end of the file does */
+			std::uint64_t end{typename L::addr_t(fdr.cb_line)};
+			std::int64_t last_line{std::int32_t{fdr.cline}};
+			for (std::size_t next{idx + 1U}; next < procs.size(); ++next) {
+				if (std::int32_t{procs[next].iline} >= 0) {
+					end = std::uint64_t(std::int64_t{procs[next].cb_line_offset});
+					last_line = std::int32_t{procs[next].iline};
+					break;
+				}
+			}
+			const auto file{lines().subspan(narrow_size(typename L::addr_t(fdr.cb_line_offset)))};
+			const auto program{file.subspan(std::size_t(start), end > std::uint64_t(start) ? narrow_size(end - std::uint64_t(start)) : 0U)};
+
+			auto remaining{last_line > first_line ? std::uint64_t(last_line - first_line) : 0U};
+			std::int64_t line{std::int32_t{pdr.ln_low}};
+			std::uint64_t offset{};
+			for (std::size_t pos{}; pos < program.size() && remaining;) {
+				const auto byte{program[pos++]};
+				std::int32_t delta{std::int32_t(byte >> 4U)};
+				if (delta >= 8)
+					delta -= 16;
+				if (delta == -8) {
+					if (pos + 2U > program.size())
+						return;
+					delta = std::int16_t(std::uint16_t((program[pos] << 8U) | program[pos + 1U]));
+					pos += 2U;
+				}
+				line += delta;
+				for (std::uint32_t count{(byte & 0x0FU) + 1U}; count && remaining; --count, --remaining) {
+					func(offset, line);
+					offset += 4U;
+				}
+			}
+		}
+	};
+
+	/*
+		A lazy, zero-copy reader for MIPS and Alpha ECOFF images
+
+		Only the file header and section table are validated up front. The symbolic header is
+		only located when symbolic() is called, and the tables behind it only when they're
+		asked for. Compressed Alpha images can be identified, but not opened.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	struct ecoff_t final {
+		using layout = Types::layout_t<C, E>;
+		using header_t = typename layout::header_t;
+		using aux_header_t = typename layout::aux_header_t;
+		using section_t = typename layout::section_t;
+		using symbolic_t = ECOFF::symbolic_t<layout>;
+
+		static constexpr Types::class_t ecoff_class{C};
+		static constexpr Types::endian_t endian{E};
+	private:
+		byte_span_t _image{};
+		const header_t* _header{nullptr};
+		span_t<const section_t> _sections{};
+
+		constexpr ecoff_t(const byte_span_t image, const header_t* const header) noexcept :
+			_image{image}, _header{header} { /* NOP */ }
+
+		/* The MIPS magics name the byte order, so only those matching E are accepted */
+		[[nodiscard]]
+		static bool valid_magic(const Types::magic_t magic) noexcept {
+			if constexpr (C == Types::class_t::ecoff64)
+				return magic == Types::magic_t::alpha || magic == Types::magic_t::alpha_bsd;
+			else if constexpr (E == Types::endian_t::big)
+				return magic == Types::magic_t::mips_eb || magic == Types::magic_t::mips_eb_2 ||
+					magic == Types::magic_t::mips_eb_3;
+			else
+				return magic == Types::magic_t::mips_el || magic == Types::magic_t::mips_el_2 ||
+					magic == Types::magic_t::mips_el_3;
+		}
+	public:
+		constexpr ecoff_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<ecoff_t> open(const byte_span_t image) noexcept {
+			const auto* const header{image.template as<header_t>(0)};
+			if (!header || !valid_magic(static_cast<Types::magic_t>(header->f_magic.value())))
+				return std::nullopt;
+
+			ecoff_t ecoff{image, header};
+			const std::size_t count{header->f_nscns};
+			ecoff._sections = image.template array<section_t>(sizeof(header_t) + header->f_opthdr, count);
+			if (ecoff._sections.size() != count)
+				return std::nullopt;
+			return ecoff;
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _header; }
+		[[nodiscard]]
+		byte_span_t image() const noexcept { return _image; }
+		[[nodiscard]]
+		const header_t& header() const noexcept { return *_header; }
+		[[nodiscard]]
+		Types::magic_t magic() const noexcept { return static_cast<Types::magic_t>(_header->f_magic.value()); }
+
+		/* Relocatable objects may not have one, in which case this is nullptr */
+		[[nodiscard]]
+		const aux_header_t* aux_header() const noexcept {
+			if (_header->f_opthdr < sizeof(aux_header_t))
+				return nullptr;
+			return _image.template as<aux_header_t>(sizeof(header_t));
+		}
+
+		[[nodiscard]]
+		span_t<const section_t> sections() const noexcept { return _sections; }
+
+		/* A section by its 1-based number */
+		[[nodiscard]]
+		const section_t* section(const std::int32_t number) const noexcept {
+			if (number <= 0 || std::size_t(number) > _sections.size())
+				return nullptr;
+			return &_sections[std::size_t(number) - 1U];
+		}
+
+		[[nodiscard]]
+		static std::string_view section_name(const section_t& section) noexcept { return fixed_name(section.s_name); }
+
+		[[nodiscard]]
+		byte_span_t section_data(const section_t& section) const noexcept {
+			const std::uint32_t flags{section.s_flags};
+			if (flags == std::uint32_t(Types::section_flags_t::bss) || flags == std::uint32_t(Types::section_flags_t::sbss))
+				return {};
+			return _image.subspan(narrow_size(typename layout::addr_t{section.s_scnptr}),
+				narrow_size(typename layout::addr_t{section.s_size}));
+		}
+
+		[[nodiscard]]
+		std::optional<symbolic_t> symbolic() const noexcept {
+			const auto offset{narrow_size(typename layout::addr_t{_header->f_symptr})};
+			if (!offset)
+				return std::nullopt;
+			return symbolic_t::open(_image, offset);
+		}
+	};
+
+	/*
+		Adds the defined external symbols of an image to an address index
+
+		Only the external table is read, local symbols are left alone. ECOFF symbols carry no
+		size, so each extends up to the next one.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	void index_symbols(const ecoff_t<C, E>& ecoff, symbol_index_t::builder_t& builder, const std::uint64_t bias = 0U) {
+		const auto symbolic{ecoff.symbolic()};
+		if (!symbolic)
+			return;
+		builder.reserve(builder.size() + symbolic->external_symbols().size());
+		symbolic->for_each_external([&](const external_info_t& ext, const std::string_view name) {
+			const auto type{ext.symbol.type};
+			if (name.empty() || !ext.symbol.is_defined() || (type != Types::symbol_type_t::global &&
+				type != Types::symbol_type_t::proc && type != Types::symbol_type_t::static_proc &&
+				type != Types::symbol_type_t::label))
+				return;
+			builder.add(ext.symbol.value + bias, 0U, name);
+		});
+	}
+
+	using ecoff32le_t = ecoff_t<Types::class_t::ecoff32, Types::endian_t::little>;
+	using ecoff32be_t = ecoff_t<Types::class_t::ecoff32, Types::endian_t::big>;
+	using ecoff64le_t = ecoff_t<Types::class_t::ecoff64, Types::endian_t::little>;
+
+	using ecoff_any_t = std::variant<ecoff32le_t, ecoff32be_t, ecoff64le_t>;
 
+	/* Opens an image as whichever flavour its magic says it is */
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<ecoff_any_t> open(byte_span_t image) noexcept;
 }
 
 #endif /* libalfheim_ecoff_hh */
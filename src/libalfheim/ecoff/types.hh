@@ -1,11 +1,448 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* ecoff/types.hh - COFF types */
+/* ecoff/types.hh - ECOFF types */
 #pragma once
 #if !defined(libalfheim_ecoff_types_hh)
 #define libalfheim_ecoff_types_hh
 
+#include <cstdint>
+#include <array>
+
+#include <libalfheim/internal/endian.hh>
+
 namespace Alfheim::ECOFF::Types {
+	using Alfheim::Internal::endian_t;
+	using Alfheim::Internal::endian_value_t;
+
+	/* ecoff32 is MIPS, in either byte order, ecoff64 is Alpha, which is always little-endian */
+	enum struct class_t : std::uint8_t {
+		ecoff32 = 0x01U,
+		ecoff64 = 0x02U,
+	};
+
+	enum struct magic_t : std::uint16_t {
+		mips_eb   = 0x0160U,
+		mips_el   = 0x0162U,
+		mips_eb_2 = 0x0163U,
+		mips_el_2 = 0x0166U,
+		mips_eb_3 = 0x0140U,
+		mips_el_3 = 0x0142U,
+		alpha     = 0x0183U,
+		alpha_bsd = 0x0185U,
+		/* Everything past the file header is compressed, so this can only be identified */
+		alpha_compressed = 0x0188U,
+	};
+
+	/* The magic of the symbolic header, which differs between MIPS and Alpha as the layouts do */
+	constexpr std::uint16_t symbolic_magic32{0x7009U};
+	constexpr std::uint16_t symbolic_magic64{0x1992U};
+
+	/* These are the section type rather than independent flags, with the low bits being the common ones */
+	enum struct section_flags_t : std::uint32_t {
+		text  = 0x00000020U,
+		data  = 0x00000040U,
+		bss   = 0x00000080U,
+		rdata = 0x00000100U,
+		sdata = 0x00000200U,
+		sbss  = 0x00000400U,
+		fini  = 0x01000000U,
+		lita  = 0x04000000U,
+		lit8  = 0x08000000U,
+		lit4  = 0x10000000U,
+		init  = 0x80000000U,
+	};
+
+	/* st, what a symbol is */
+	enum struct symbol_type_t : std::uint8_t {
+		nil         = 0U,
+		global      = 1U,
+		static_     = 2U,
+		param       = 3U,
+		local       = 4U,
+		label       = 5U,
+		proc        = 6U,
+		block       = 7U,
+		end         = 8U,
+		member      = 9U,
+		typedef_    = 10U,
+		file        = 11U,
+		reg_reloc   = 12U,
+		forward     = 13U,
+		static_proc = 14U,
+		constant    = 15U,
+		sta_param   = 16U,
+		struct_     = 26U,
+		union_      = 27U,
+		enum_       = 28U,
+		indirect    = 34U,
+		str         = 60U,
+		number      = 61U,
+		expr        = 62U,
+		type        = 63U,
+	};
+
+	/* sc, where a symbol lives */
+	enum struct storage_class_t : std::uint8_t {
+		nil           = 0U,
+		text          = 1U,
+		data          = 2U,
+		bss           = 3U,
+		register_     = 4U,
+		abs           = 5U,
+		undefined     = 6U,
+		cdb_local     = 7U,
+		bits          = 8U,
+		cdb_system    = 9U,
+		reg_image     = 10U,
+		info          = 11U,
+		user_struct   = 12U,
+		sdata         = 13U,
+		sbss          = 14U,
+		rdata         = 15U,
+		var           = 16U,
+		common        = 17U,
+		scommon       = 18U,
+		var_register  = 19U,
+		variant       = 20U,
+		sundefined    = 21U,
+		init          = 22U,
+		based_var     = 23U,
+		xdata         = 24U,
+		pdata         = 25U,
+		fini          = 26U,
+		rconst        = 27U,
+	};
+
+	template<endian_t E>
+	struct file_header32_t final {
+		endian_value_t<std::uint16_t, E> f_magic;
+		endian_value_t<std::uint16_t, E> f_nscns;
+		endian_value_t<std::uint32_t, E> f_timdat;
+		endian_value_t<std::uint32_t, E> f_symptr;
+		/* The size of the symbolic header, not a symbol count */
+		endian_value_t<std::uint32_t, E> f_nsyms;
+		endian_value_t<std::uint16_t, E> f_opthdr;
+		endian_value_t<std::uint16_t, E> f_flags;
+	};
+
+	template<endian_t E>
+	struct file_header64_t final {
+		endian_value_t<std::uint16_t, E> f_magic;
+		endian_value_t<std::uint16_t, E> f_nscns;
+		endian_value_t<std::uint32_t, E> f_timdat;
+		endian_value_t<std::uint64_t, E> f_symptr;
+		endian_value_t<std::uint32_t, E> f_nsyms;
+		endian_value_t<std::uint16_t, E> f_opthdr;
+		endian_value_t<std::uint16_t, E> f_flags;
+	};
+
+	template<endian_t E>
+	struct aux_header32_t final {
+		endian_value_t<std::uint16_t, E> magic;
+		endian_value_t<std::uint16_t, E> vstamp;
+		endian_value_t<std::uint32_t, E> tsize;
+		endian_value_t<std::uint32_t, E> dsize;
+		endian_value_t<std::uint32_t, E> bsize;
+		endian_value_t<std::uint32_t, E> entry;
+		endian_value_t<std::uint32_t, E> text_start;
+		endian_value_t<std::uint32_t, E> data_start;
+		endian_value_t<std::uint32_t, E> bss_start;
+		endian_value_t<std::uint32_t, E> gprmask;
+		std::array<endian_value_t<std::uint32_t, E>, 4> cprmask;
+		endian_value_t<std::uint32_t, E> gp_value;
+	};
+
+	template<endian_t E>
+	struct aux_header64_t final {
+		endian_value_t<std::uint16_t, E> magic;
+		endian_value_t<std::uint16_t, E> vstamp;
+		endian_value_t<std::uint16_t, E> bldrev;
+		endian_value_t<std::uint16_t, E> padding;
+		endian_value_t<std::uint64_t, E> tsize;
+		endian_value_t<std::uint64_t, E> dsize;
+		endian_value_t<std::uint64_t, E> bsize;
+		endian_value_t<std::uint64_t, E> entry;
+		endian_value_t<std::uint64_t, E> text_start;
+		endian_value_t<std::uint64_t, E> data_start;
+		endian_value_t<std::uint64_t, E> bss_start;
+		endian_value_t<std::uint32_t, E> gprmask;
+		endian_value_t<std::uint32_t, E> fprmask;
+		endian_value_t<std::uint64_t, E> gp_value;
+	};
+
+	template<endian_t E>
+	struct section_header32_t final {
+		std::array<char, 8> s_name;
+		endian_value_t<std::uint32_t, E> s_paddr;
+		endian_value_t<std::uint32_t, E> s_vaddr;
+		endian_value_t<std::uint32_t, E> s_size;
+		endian_value_t<std::uint32_t, E> s_scnptr;
+		endian_value_t<std::uint32_t, E> s_relptr;
+		endian_value_t<std::uint32_t, E> s_lnnoptr;
+		endian_value_t<std::uint16_t, E> s_nreloc;
+		endian_value_t<std::uint16_t, E> s_nlnno;
+		endian_value_t<std::uint32_t, E> s_flags;
+	};
+
+	template<endian_t E>
+	struct section_header64_t final {
+		std::array<char, 8> s_name;
+		endian_value_t<std::uint64_t, E> s_paddr;
+		endian_value_t<std::uint64_t, E> s_vaddr;
+		endian_value_t<std::uint64_t, E> s_size;
+		endian_value_t<std::uint64_t, E> s_scnptr;
+		endian_value_t<std::uint64_t, E> s_relptr;
+		endian_value_t<std::uint64_t, E> s_lnnoptr;
+		endian_value_t<std::uint16_t, E> s_nreloc;
+		endian_value_t<std::uint16_t, E> s_nlnno;
+		endian_value_t<std::uint32_t, E> s_flags;
+	};
+
+	/*
+		The symbolic header (HDRR), which locates every table of debugging and symbol information
+
+		Each table is a count or byte size and a file offset. The offsets are to the start of
+		the file, not the header.
+	*/
+	template<endian_t E>
+	struct symbolic_header32_t final {
+		endian_value_t<std::uint16_t, E> magic;
+		endian_value_t<std::uint16_t, E> vstamp;
+		endian_value_t<std::uint32_t, E> iline_max;
+		endian_value_t<std::uint32_t, E> cb_line;
+		endian_value_t<std::uint32_t, E> cb_line_offset;
+		endian_value_t<std::uint32_t, E> idn_max;
+		endian_value_t<std::uint32_t, E> cb_dn_offset;
+		endian_value_t<std::uint32_t, E> ipd_max;
+		endian_value_t<std::uint32_t, E> cb_pd_offset;
+		endian_value_t<std::uint32_t, E> isym_max;
+		endian_value_t<std::uint32_t, E> cb_sym_offset;
+		endian_value_t<std::uint32_t, E> iopt_max;
+		endian_value_t<std::uint32_t, E> cb_opt_offset;
+		endian_value_t<std::uint32_t, E> iaux_max;
+		endian_value_t<std::uint32_t, E> cb_aux_offset;
+		endian_value_t<std::uint32_t, E> iss_max;
+		endian_value_t<std::uint32_t, E> cb_ss_offset;
+		endian_value_t<std::uint32_t, E> iss_ext_max;
+		endian_value_t<std::uint32_t, E> cb_ss_ext_offset;
+		endian_value_t<std::uint32_t, E> ifd_max;
+		endian_value_t<std::uint32_t, E> cb_fd_offset;
+		endian_value_t<std::uint32_t, E> crfd;
+		endian_value_t<std::uint32_t, E> cb_rfd_offset;
+		endian_value_t<std::uint32_t, E> iext_max;
+		endian_value_t<std::uint32_t, E> cb_ext_offset;
+	};
+
+	/* Alpha groups the counts first, then widens the sizes and offsets */
+	template<endian_t E>
+	struct symbolic_header64_t final {
+		endian_value_t<std::uint16_t, E> magic;
+		endian_value_t<std::uint16_t, E> vstamp;
+		endian_value_t<std::uint32_t, E> iline_max;
+		endian_value_t<std::uint32_t, E> idn_max;
+		endian_value_t<std::uint32_t, E> ipd_max;
+		endian_value_t<std::uint32_t, E> isym_max;
+		endian_value_t<std::uint32_t, E> iopt_max;
+		endian_value_t<std::uint32_t, E> iaux_max;
+		endian_value_t<std::uint32_t, E> iss_max;
+		endian_value_t<std::uint32_t, E> iss_ext_max;
+		endian_value_t<std::uint32_t, E> ifd_max;
+		endian_value_t<std::uint32_t, E> crfd;
+		endian_value_t<std::uint32_t, E> iext_max;
+		endian_value_t<std::uint64_t, E> cb_line;
+		endian_value_t<std::uint64_t, E> cb_line_offset;
+		endian_value_t<std::uint64_t, E> cb_dn_offset;
+		endian_value_t<std::uint64_t, E> cb_pd_offset;
+		endian_value_t<std::uint64_t, E> cb_sym_offset;
+		endian_value_t<std::uint64_t, E> cb_opt_offset;
+		endian_value_t<std::uint64_t, E> cb_aux_offset;
+		endian_value_t<std::uint64_t, E> cb_ss_offset;
+		endian_value_t<std::uint64_t, E> cb_ss_ext_offset;
+		endian_value_t<std::uint64_t, E> cb_fd_offset;
+		endian_value_t<std::uint64_t, E> cb_rfd_offset;
+		endian_value_t<std::uint64_t, E> cb_ext_offset;
+	};
+
+	/*
+		A file descriptor (FDR), one per source file
+
+		Its symbols, procedures, line numbers, and strings are slices of the global tables, the
+		*_base fields being where they start. The language and flags are packed into bits
+		whose layout depends on the byte order.
+	*/
+	template<endian_t E>
+	struct file_descriptor32_t final {
+		endian_value_t<std::uint32_t, E> adr;
+		/* The file name, relative to iss_base */
+		endian_value_t<std::int32_t, E> rss;
+		endian_value_t<std::int32_t, E> iss_base;
+		endian_value_t<std::int32_t, E> cb_ss;
+		endian_value_t<std::int32_t, E> isym_base;
+		endian_value_t<std::int32_t, E> csym;
+		endian_value_t<std::int32_t, E> iline_base;
+		endian_value_t<std::int32_t, E> cline;
+		endian_value_t<std::int32_t, E> iopt_base;
+		endian_value_t<std::int32_t, E> copt;
+		endian_value_t<std::uint16_t, E> ipd_first;
+		endian_value_t<std::uint16_t, E> cpd;
+		endian_value_t<std::int32_t, E> iaux_base;
+		endian_value_t<std::int32_t, E> caux;
+		endian_value_t<std::int32_t, E> rfd_base;
+		endian_value_t<std::int32_t, E> crfd;
+		std::array<std::uint8_t, 4> bits;
+		endian_value_t<std::int32_t, E> cb_line_offset;
+		endian_value_t<std::int32_t, E> cb_line;
+	};
+
+	template<endian_t E>
+	struct file_descriptor64_t final {
+		endian_value_t<std::uint64_t, E> adr;
+		endian_value_t<std::uint64_t, E> cb_line_offset;
+		endian_value_t<std::uint64_t, E> cb_line;
+		endian_value_t<std::uint64_t, E> cb_ss;
+		endian_value_t<std::int32_t, E> rss;
+		endian_value_t<std::int32_t, E> iss_base;
+		endian_value_t<std::int32_t, E> isym_base;
+		endian_value_t<std::int32_t, E> csym;
+		endian_value_t<std::int32_t, E> iline_base;
+		endian_value_t<std::int32_t, E> cline;
+		endian_value_t<std::int32_t, E> iopt_base;
+		endian_value_t<std::int32_t, E> copt;
+		endian_value_t<std::uint32_t, E> ipd_first;
+		endian_value_t<std::uint32_t, E> cpd;
+		endian_value_t<std::int32_t, E> iaux_base;
+		endian_value_t<std::int32_t, E> caux;
+		endian_value_t<std::int32_t, E> rfd_base;
+		endian_value_t<std::int32_t, E> crfd;
+		std::array<std::uint8_t, 4> bits;
+		std::array<std::uint8_t, 4> padding;
+	};
+
+	/* A procedure descriptor (PDR), isym is relative to its file's isym_base and cb_line_offset to its line numbers */
+	template<endian_t E>
+	struct procedure_descriptor32_t final {
+		endian_value_t<std::uint32_t, E> adr;
+		endian_value_t<std::int32_t, E> isym;
+		endian_value_t<std::int32_t, E> iline;
+		endian_value_t<std::int32_t, E> regmask;
+		endian_value_t<std::int32_t, E> regoffset;
+		endian_value_t<std::int32_t, E> iopt;
+		endian_value_t<std::int32_t, E> fregmask;
+		endian_value_t<std::int32_t, E> fregoffset;
+		endian_value_t<std::int32_t, E> frameoffset;
+		endian_value_t<std::uint16_t, E> framereg;
+		endian_value_t<std::uint16_t, E> pcreg;
+		endian_value_t<std::int32_t, E> ln_low;
+		endian_value_t<std::int32_t, E> ln_high;
+		endian_value_t<std::int32_t, E> cb_line_offset;
+	};
+
+	template<endian_t E>
+	struct procedure_descriptor64_t final {
+		endian_value_t<std::uint64_t, E> adr;
+		endian_value_t<std::int64_t, E> cb_line_offset;
+		endian_value_t<std::int32_t, E> isym;
+		endian_value_t<std::int32_t, E> iline;
+		endian_value_t<std::int32_t, E> regmask;
+		endian_value_t<std::int32_t, E> regoffset;
+		endian_value_t<std::int32_t, E> iopt;
+		endian_value_t<std::int32_t, E> fregmask;
+		endian_value_t<std::int32_t, E> fregoffset;
+		endian_value_t<std::int32_t, E> frameoffset;
+		endian_value_t<std::int32_t, E> ln_low;
+		endian_value_t<std::int32_t, E> ln_high;
+		std::uint8_t gp_prologue;
+		std::uint8_t bits1;
+		std::uint8_t bits2;
+		std::uint8_t localoff;
+		endian_value_t<std::uint16_t, E> framereg;
+		endian_value_t<std::uint16_t, E> pcreg;
+	};
+
+	/* A local symbol (SYMR), the type, storage class, and index are packed into bits by byte order */
+	template<endian_t E>
+	struct symbol32_t final {
+		endian_value_t<std::int32_t, E> iss;
+		endian_value_t<std::uint32_t, E> value;
+		std::array<std::uint8_t, 4> bits;
+	};
+
+	template<endian_t E>
+	struct symbol64_t final {
+		endian_value_t<std::uint64_t, E> value;
+		endian_value_t<std::int32_t, E> iss;
+		std::array<std::uint8_t, 4> bits;
+	};
+
+	/* An external symbol (EXTR), a symbol along with the file that defines it */
+	template<endian_t E>
+	struct external32_t final {
+		std::uint8_t bits1;
+		std::uint8_t bits2;
+		endian_value_t<std::int16_t, E> ifd;
+		symbol32_t<E> asym;
+	};
+
+	template<endian_t E>
+	struct external64_t final {
+		std::uint8_t bits1;
+		std::array<std::uint8_t, 3> bits2;
+		endian_value_t<std::int32_t, E> ifd;
+		symbol64_t<E> asym;
+	};
+
+	template<class_t C, endian_t E>
+	struct layout_t;
+
+	template<endian_t E>
+	struct layout_t<class_t::ecoff32, E> final {
+		static constexpr class_t ecoff_class{class_t::ecoff32};
+		static constexpr endian_t endian{E};
+		static constexpr std::uint16_t symbolic_magic{symbolic_magic32};
+
+		using header_t          = file_header32_t<E>;
+		using aux_header_t      = aux_header32_t<E>;
+		using section_t         = section_header32_t<E>;
+		using symbolic_header_t = symbolic_header32_t<E>;
+		using fdr_t             = file_descriptor32_t<E>;
+		using pdr_t             = procedure_descriptor32_t<E>;
+		using symbol_t          = symbol32_t<E>;
+		using external_t        = external32_t<E>;
+		using addr_t            = std::uint32_t;
+	};
+
+	template<endian_t E>
+	struct layout_t<class_t::ecoff64, E> final {
+		static constexpr class_t ecoff_class{class_t::ecoff64};
+		static constexpr endian_t endian{E};
+		static constexpr std::uint16_t symbolic_magic{symbolic_magic64};
+
+		using header_t          = file_header64_t<E>;
+		using aux_header_t      = aux_header64_t<E>;
+		using section_t         = section_header64_t<E>;
+		using symbolic_header_t = symbolic_header64_t<E>;
+		using fdr_t             = file_descriptor64_t<E>;
+		using pdr_t             = procedure_descriptor64_t<E>;
+		using symbol_t          = symbol64_t<E>;
+		using external_t        = external64_t<E>;
+		using addr_t            = std::uint64_t;
+	};
 
+	static_assert(sizeof(file_header32_t<endian_t::little>) == 20, "file_header32_t must be 20 bytes");
+	static_assert(sizeof(file_header64_t<endian_t::little>) == 24, "file_header64_t must be 24 bytes");
+	static_assert(sizeof(aux_header32_t<endian_t::little>) == 56, "aux_header32_t must be 56 bytes");
+	static_assert(sizeof(aux_header64_t<endian_t::little>) == 80, "aux_header64_t must be 80 bytes");
+	static_assert(sizeof(section_header32_t<endian_t::little>) == 40, "section_header32_t must be 40 bytes");
+	static_assert(sizeof(section_header64_t<endian_t::little>) == 64, "section_header64_t must be 64 bytes");
+	static_assert(sizeof(symbolic_header32_t<endian_t::little>) == 96, "symbolic_header32_t must be 96 bytes");
+	static_assert(sizeof(symbolic_header64_t<endian_t::little>) == 144, "symbolic_header64_t must be 144 bytes");
+	static_assert(sizeof(file_descriptor32_t<endian_t::little>) == 72, "file_descriptor32_t must be 72 bytes");
+	static_assert(sizeof(file_descriptor64_t<endian_t::little>) == 96, "file_descriptor64_t must be 96 bytes");
+	static_assert(sizeof(procedure_descriptor32_t<endian_t::little>) == 52, "procedure_descriptor32_t must be 52 bytes");
+	static_assert(sizeof(procedure_descriptor64_t<endian_t::little>) == 64, "procedure_descriptor64_t must be 64 bytes");
+	static_assert(sizeof(symbol32_t<endian_t::little>) == 12, "symbol32_t must be 12 bytes");
+	static_assert(sizeof(symbol64_t<endian_t::little>) == 16, "symbol64_t must be 16 bytes");
+	static_assert(sizeof(external32_t<endian_t::little>) == 16, "external32_t must be 16 bytes");
+	static_assert(sizeof(external64_t<endian_t::little>) == 24, "external64_t must be 24 bytes");
 }
 
 #endif /* libalfheim_ecoff_types_hh */
@@ -1,4 +1,125 @@
 // SPDX-License-Identifier: BSD-3-Clause
 /* elf.cc - ELF/ELF64 support */
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+
 #include <libalfheim/elf.hh>
+#include <libalfheim/elf/compressed.hh>
+
+namespace Alfheim::ELF {
+	const Types::ident_t* identify(const byte_span_t image) noexcept {
+		const auto* const ident{image.as<Types::ident_t>(0)};
+		if (!ident || ident->magic != Types::magic)
+			return nullptr;
+		return ident;
+	}
+
+	std::optional<elf_any_t> open(const byte_span_t image) noexcept {
+		const auto* const ident{identify(image)};
+		if (!ident)
+			return std::nullopt;
+
+		const auto wrap = [](auto&& elf) -> std::optional<elf_any_t> {
+			if (!elf)
+				return std::nullopt;
+			return elf_any_t{*elf};
+		};
+
+		switch (ident->elf_class) {
+			case Types::class_t::elf32:
+				if (ident->data == Types::data_t::lsb)
+					return wrap(elf32le_t::open(image));
+				else if (ident->data == Types::data_t::msb)
+					return wrap(elf32be_t::open(image));
+				break;
+			case Types::class_t::elf64:
+				if (ident->data == Types::data_t::lsb)
+					return wrap(elf64le_t::open(image));
+				else if (ident->data == Types::data_t::msb)
+					return wrap(elf64be_t::open(image));
+				break;
+			case Types::class_t::none:
+				break;
+		}
+		return std::nullopt;
+	}
+
+	namespace {
+		/* Sections are placed on at least a 16 byte boundary, or their own alignment up to a page */
+		[[nodiscard]]
+		std::size_t arena_alignment(const compressed_section_t& section) noexcept {
+			const auto align{section.alignment};
+			if (align <= 16U || align > 4096U || (align & (align - 1U)))
+				return 16U;
+			return static_cast<std::size_t>(align);
+		}
+
+		[[nodiscard]]
+		std::size_t align_up(const std::size_t value, const std::size_t align) noexcept {
+			return (value + align - 1U) & ~(align - 1U);
+		}
+	}
+
+	std::size_t arena_size(const span_t<const compressed_section_t> sections) noexcept {
+		std::size_t size{};
+		for (const auto& section : sections) {
+			const auto len{narrow_size(section.size)};
+			const auto offset{align_up(size, arena_alignment(section))};
+			if (offset < size || len > std::numeric_limits<std::size_t>::max() - offset)
+				return 0U;
+			size = offset + len;
+		}
+		return size;
+	}
+
+	std::size_t decompress(const span_t<const compressed_section_t> sections, const span_t<std::uint8_t> arena,
+		const span_t<byte_span_t> results, Internal::thread_pool_t& pool) {
+		if (results.size() < sections.size())
+			return sections.size();
+
+		std::vector<std::size_t> offsets(sections.size());
+		std::size_t size{};
+		for (std::size_t idx{}; idx < sections.size(); ++idx) {
+			offsets[idx] = align_up(size, arena_alignment(sections[idx]));
+			size = offsets[idx] + narrow_size(sections[idx].size);
+			results[idx] = {};
+		}
+		if (size > arena.size() || (!sections.empty() && !arena_size(sections)))
+			return sections.size();
+
+		/* Biggest first, so one huge section isn't left running alone at the end */
+		std::vector<std::size_t> order(sections.size());
+		std::iota(order.begin(), order.end(), std::size_t{});
+		std::sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b) noexcept {
+			return sections[a].size > sections[b].size;
+		});
+
+		const std::unique_ptr<Internal::inflater_t[]> inflaters{new Internal::inflater_t[pool.concurrency()]};
+		std::atomic<std::size_t> failed{0U};
+
+		pool.parallel_for(order.size(), [&](const std::size_t worker, const std::size_t job) noexcept {
+			const auto idx{order[job]};
+			const auto out{arena.subspan(offsets[idx], narrow_size(sections[idx].size))};
+			if (decompress(sections[idx], inflaters[worker], out))
+				results[idx] = out;
+			else
+				failed.fetch_add(1U, std::memory_order_relaxed);
+		});
+		return failed.load();
+	}
+
+	inflated_sections_t decompress(const span_t<const compressed_section_t> sections, Internal::thread_pool_t& pool) {
+		inflated_sections_t inflated{{}, arena_size(sections), std::vector<byte_span_t>(sections.size()), 0U};
+		if (!inflated.arena_size && !sections.empty()) {
+			inflated.failed = sections.size();
+			return inflated;
+		}
+		/* Default initialized, there's no point zeroing memory that's about to be overwritten */
+		inflated.arena.reset(new std::uint8_t[inflated.arena_size]);
+		inflated.failed = decompress(sections, {inflated.arena.get(), inflated.arena_size}, inflated.sections, pool);
+		return inflated;
+	}
+}
@@ -4,10 +4,577 @@
 #if !defined(libalfheim_elf_hh)
 #define libalfheim_elf_hh
 
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/symbol_index.hh>
+
 #include <libalfheim/elf/types.hh>
 
 namespace Alfheim::ELF {
+	using Internal::span_t;
+	using Internal::byte_span_t;
+	using Internal::narrow_size;
+
+	/* A view over a NUL separated string table */
+	struct strtab_t final {
+	private:
+		byte_span_t _data{};
+	public:
+		constexpr strtab_t() noexcept = default;
+		constexpr strtab_t(const byte_span_t data) noexcept : _data{data} { /* NOP */ }
+
+		[[nodiscard]]
+		bool valid() const noexcept { return !_data.empty(); }
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _data.size(); }
+		[[nodiscard]]
+		byte_span_t data() const noexcept { return _data; }
+
+		[[nodiscard]]
+		std::string_view operator[](const std::size_t offset) const noexcept { return _data.string(offset); }
+		[[nodiscard]]
+		std::string_view at(const std::size_t offset) const noexcept { return _data.string(offset); }
+	};
+
+	/* A symbol table along with the string table that its names live in */
+	template<typename L>
+	struct symtab_t final {
+		using sym_t = typename L::sym_t;
+		using iterator = typename span_t<const sym_t>::iterator;
+	private:
+		span_t<const sym_t> _symbols{};
+		strtab_t _strings{};
+	public:
+		constexpr symtab_t() noexcept = default;
+		constexpr symtab_t(const span_t<const sym_t> symbols, const strtab_t strings) noexcept :
+			_symbols{symbols}, _strings{strings} { /* NOP */ }
+
+		[[nodiscard]]
+		bool valid() const noexcept { return !_symbols.empty(); }
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _symbols.size(); }
+		[[nodiscard]]
+		span_t<const sym_t> symbols() const noexcept { return _symbols; }
+		[[nodiscard]]
+		const strtab_t& strings() const noexcept { return _strings; }
+
+		[[nodiscard]]
+		iterator begin() const noexcept { return _symbols.begin(); }
+		[[nodiscard]]
+		iterator end() const noexcept { return _symbols.end(); }
+		[[nodiscard]]
+		const sym_t& operator[](const std::size_t idx) const noexcept { return _symbols[idx]; }
+
+		[[nodiscard]]
+		std::string_view name(const sym_t& sym) const noexcept { return _strings[sym.st_name]; }
+
+		[[nodiscard]]
+		static Types::symbol_type_t type(const sym_t& sym) noexcept {
+			return static_cast<Types::symbol_type_t>(Types::st_info_t::get<0>(sym.st_info));
+		}
+
+		[[nodiscard]]
+		static Types::symbol_binding_t binding(const sym_t& sym) noexcept {
+			return static_cast<Types::symbol_binding_t>(Types::st_info_t::get<1>(sym.st_info));
+		}
+
+		[[nodiscard]]
+		static Types::symbol_visibility_t visibility(const sym_t& sym) noexcept {
+			return static_cast<Types::symbol_visibility_t>(sym.st_other & 0x03U);
+		}
+	};
+
+	/* A single note entry, the name and descriptor are views into the image */
+	struct note_t final {
+		std::string_view name;
+		byte_span_t desc;
+		std::uint32_t type;
+	};
+
+	/*
+		The entries of a PT_NOTE segment or SHT_NOTE section
+
+		Entries are padded out to the alignment of the segment or section, which is 4 bytes
+		for nearly everything but is 8 for some, such as .note.gnu.property on 64-bit targets.
+		Iteration stops at the first entry that doesn't fit in the data.
+	*/
+	template<Types::endian_t E>
+	struct notes_t final {
+		using nhdr_t = Types::nhdr_t<E>;
+
+		struct iterator final {
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = note_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const note_t*;
+			using reference = const note_t&;
+		private:
+			byte_span_t _data{};
+			std::size_t _align{4U};
+			std::size_t _offset{0};
+			std::size_t _next{0};
+			note_t _note{};
+
+			[[nodiscard]]
+			std::size_t align_up(const std::size_t value) const noexcept { return (value + _align - 1U) & ~(_align - 1U); }
+
+			void decode() noexcept {
+				const auto* const nhdr{_data.template as<nhdr_t>(_offset)};
+				if (!nhdr) {
+					_offset = _data.size();
+					return;
+				}
+				const std::size_t name_len{nhdr->n_namesz};
+				const std::size_t desc_len{nhdr->n_descsz};
+				const auto name_offset{_offset + sizeof(nhdr_t)};
+				const auto desc_offset{align_up(name_offset + name_len)};
+				const auto name{_data.subspan(name_offset, name_len)};
+				const auto desc{_data.subspan(desc_offset, desc_len)};
+				if (name.size() != name_len || desc.size() != desc_len || desc_offset > _data.size()) {
+					_offset = _data.size();
+					return;
+				}
+				/* The name length counts the terminating NUL */
+				_note = note_t{
+					{reinterpret_cast<const char*>(name.data()), name_len ? name_len - 1U : 0U},
+					desc, nhdr->n_type
+				};
+				_next = std::min(align_up(desc_offset + desc_len), _data.size());
+			}
+		public:
+			constexpr iterator() noexcept = default;
+			iterator(const byte_span_t data, const std::size_t align, const std::size_t offset) noexcept :
+				_data{data}, _align{align}, _offset{offset} {
+				if (_offset < _data.size())
+					decode();
+			}
+
+			[[nodiscard]]
+			reference operator*() const noexcept { return _note; }
+			[[nodiscard]]
+			pointer operator->() const noexcept { return &_note; }
+
+			iterator& operator++() noexcept {
+				_offset = _next;
+				if (_offset < _data.size())
+					decode();
+				return *this;
+			}
+
+			iterator operator++(int) noexcept {
+				auto prev{*this};
+				++*this;
+				return prev;
+			}
+
+			[[nodiscard]]
+			bool operator==(const iterator& other) const noexcept { return _offset == other._offset; }
+			[[nodiscard]]
+			bool operator!=(const iterator& other) const noexcept { return _offset != other._offset; }
+		};
+	private:
+		byte_span_t _data{};
+		std::size_t _align{4U};
+	public:
+		constexpr notes_t() noexcept = default;
+		constexpr notes_t(const byte_span_t data, const std::size_t align) noexcept :
+			_data{data}, _align{align == 8U ? 8U : 4U} { /* NOP */ }
+
+		[[nodiscard]]
+		bool valid() const noexcept { return !_data.empty(); }
+		[[nodiscard]]
+		byte_span_t data() const noexcept { return _data; }
+
+		[[nodiscard]]
+		iterator begin() const noexcept { return {_data, _align, 0U}; }
+		[[nodiscard]]
+		iterator end() const noexcept { return {_data, _align, _data.size()}; }
+
+		/* Finds the first note with the given owner and type */
+		[[nodiscard]]
+		std::optional<note_t> find(const std::string_view name, const std::uint32_t type) const noexcept {
+			for (const auto& note : *this) {
+				if (note.type == type && note.name == name)
+					return note;
+			}
+			return std::nullopt;
+		}
+	};
+
+	/* The location and parameters of a compressed section's payload */
+	struct compressed_section_t final {
+		/* Size and alignment of the section once it's been decompressed */
+		std::uint64_t size;
+		std::uint64_t alignment;
+		byte_span_t data;
+		Types::compression_t type;
+	};
+
+	/*
+		A lazy, zero-copy ELF reader
+
+		Opening an image only validates the identification and the file header, everything
+		else is located and bounds checked on access and is handed back as a view into the
+		underlying image. Nothing is copied and nothing but the header is touched up front,
+		so only the pages backing the tables actually used are ever faulted in.
+
+		The image is only borrowed, it must outlive the elf_t and anything obtained from it.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	struct elf_t final {
+		using layout = Types::layout_t<C, E>;
+		using addr_t = typename layout::addr_t;
+		using ehdr_t = typename layout::ehdr_t;
+		using shdr_t = typename layout::shdr_t;
+		using phdr_t = typename layout::phdr_t;
+		using sym_t  = typename layout::sym_t;
+		using dyn_t  = typename layout::dyn_t;
+		using symtab_t = ELF::symtab_t<layout>;
+
+		static constexpr Types::class_t elf_class{C};
+		static constexpr Types::endian_t endian{E};
+	private:
+		byte_span_t _image{};
+		const ehdr_t* _header{nullptr};
+
+		constexpr elf_t(const byte_span_t image, const ehdr_t* const header) noexcept :
+			_image{image}, _header{header} { /* NOP */ }
+
+		/* The first section header holds the real counts when they overflow the ELF header fields */
+		[[nodiscard]]
+		const shdr_t* initial_section() const noexcept {
+			const auto offset{narrow_size(addr_t{_header->e_shoff})};
+			if (!offset || _header->e_shentsize != sizeof(shdr_t))
+				return nullptr;
+			return _image.template as<shdr_t>(offset);
+		}
+	public:
+		constexpr elf_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<elf_t> open(const byte_span_t image) noexcept {
+			const auto* const ident{image.template as<Types::ident_t>(0)};
+			if (!ident || ident->magic != Types::magic || ident->elf_class != C)
+				return std::nullopt;
+			if (ident->data != ((E == Types::endian_t::little) ? Types::data_t::lsb : Types::data_t::msb))
+				return std::nullopt;
+
+			const auto* const header{image.template as<ehdr_t>(0)};
+			if (!header)
+				return std::nullopt;
+			return elf_t{image, header};
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _header; }
+		[[nodiscard]]
+		byte_span_t image() const noexcept { return _image; }
+		[[nodiscard]]
+		const ehdr_t& header() const noexcept { return *_header; }
+
+		[[nodiscard]]
+		std::size_t section_count() const noexcept {
+			const std::size_t count{_header->e_shnum};
+			if (count || !_header->e_shoff)
+				return count;
+			const auto* const initial{initial_section()};
+			return initial ? narrow_size(addr_t{initial->sh_size}) : 0U;
+		}
+
+		[[nodiscard]]
+		span_t<const shdr_t> sections() const noexcept {
+			const auto count{section_count()};
+			if (!count || _header->e_shentsize != sizeof(shdr_t))
+				return {};
+			return _image.template array<shdr_t>(narrow_size(addr_t{_header->e_shoff}), count);
+		}
+
+		[[nodiscard]]
+		const shdr_t* section(const std::size_t idx) const noexcept { return sections().at(idx); }
+
+		[[nodiscard]]
+		std::size_t section_index(const shdr_t& shdr) const noexcept {
+			return static_cast<std::size_t>(&shdr - sections().data());
+		}
+
+		[[nodiscard]]
+		std::size_t shstrndx() const noexcept {
+			const std::size_t idx{_header->e_shstrndx};
+			if (idx != std::size_t(Types::section_index_t::xindex))
+				return idx;
+			const auto* const initial{initial_section()};
+			return initial ? std::size_t{initial->sh_link} : 0U;
+		}
+
+		[[nodiscard]]
+		byte_span_t section_data(const shdr_t& shdr) const noexcept {
+			if (shdr.sh_type == Types::section_type_t::nobits)
+				return {};
+			return _image.subspan(narrow_size(addr_t{shdr.sh_offset}), narrow_size(addr_t{shdr.sh_size}));
+		}
+
+		/* Handles both SHF_COMPRESSED sections and the older GNU .zdebug_* sections */
+		[[nodiscard]]
+		std::optional<compressed_section_t> compression(const shdr_t& shdr) const noexcept {
+			using chdr_t = typename layout::chdr_t;
+			const auto data{section_data(shdr)};
+
+			if (addr_t{shdr.sh_flags} & addr_t(Types::section_flags_t::compressed)) {
+				const auto* const chdr{data.template as<chdr_t>(0)};
+				if (!chdr)
+					return std::nullopt;
+				return compressed_section_t{
+					chdr->ch_size, chdr->ch_addralign, data.subspan(sizeof(chdr_t)), chdr->ch_type
+				};
+			}
+
+			if (section_name(shdr).substr(0, 8) == ".zdebug_") {
+				const auto* const zhdr{data.template as<Types::zdebug_hdr_t>(0)};
+				if (!zhdr || zhdr->magic != Types::zdebug_magic)
+					return std::nullopt;
+				return compressed_section_t{
+					zhdr->size, addr_t{shdr.sh_addralign}, data.subspan(sizeof(Types::zdebug_hdr_t)),
+					Types::compression_t::zlib
+				};
+			}
+			return std::nullopt;
+		}
+
+		[[nodiscard]]
+		strtab_t string_table(const shdr_t& shdr) const noexcept {
+			if (shdr.sh_type != Types::section_type_t::strtab)
+				return {};
+			return {section_data(shdr)};
+		}
+
+		[[nodiscard]]
+		strtab_t string_table(const std::size_t idx) const noexcept {
+			const auto* const shdr{section(idx)};
+			return shdr ? string_table(*shdr) : strtab_t{};
+		}
+
+		[[nodiscard]]
+		strtab_t section_names() const noexcept { return string_table(shstrndx()); }
+
+		[[nodiscard]]
+		std::string_view section_name(const shdr_t& shdr) const noexcept { return section_names()[shdr.sh_name]; }
+
+		[[nodiscard]]
+		const shdr_t* section(const std::string_view name) const noexcept {
+			const auto names{section_names()};
+			for (const auto& shdr : sections()) {
+				if (names[shdr.sh_name] == name)
+					return &shdr;
+			}
+			return nullptr;
+		}
+
+		[[nodiscard]]
+		const shdr_t* section(const Types::section_type_t type) const noexcept {
+			for (const auto& shdr : sections()) {
+				if (shdr.sh_type == type)
+					return &shdr;
+			}
+			return nullptr;
+		}
+
+		[[nodiscard]]
+		std::size_t segment_count() const noexcept {
+			const std::size_t count{_header->e_phnum};
+			/* PN_XNUM */
+			if (count != 0xFFFFU)
+				return count;
+			const auto* const initial{initial_section()};
+			return initial ? std::size_t{initial->sh_info} : 0U;
+		}
+
+		[[nodiscard]]
+		span_t<const phdr_t> segments() const noexcept {
+			const auto count{segment_count()};
+			if (!count || _header->e_phentsize != sizeof(phdr_t))
+				return {};
+			return _image.template array<phdr_t>(narrow_size(addr_t{_header->e_phoff}), count);
+		}
+
+		[[nodiscard]]
+		byte_span_t segment_data(const phdr_t& phdr) const noexcept {
+			return _image.subspan(narrow_size(addr_t{phdr.p_offset}), narrow_size(addr_t{phdr.p_filesz}));
+		}
+
+		[[nodiscard]]
+		symtab_t symbols(const shdr_t& shdr) const noexcept {
+			if (shdr.sh_type != Types::section_type_t::symtab && shdr.sh_type != Types::section_type_t::dynsym)
+				return {};
+			if (shdr.sh_entsize != sizeof(sym_t))
+				return {};
+			return {
+				_image.template array<sym_t>(
+					narrow_size(addr_t{shdr.sh_offset}), narrow_size(addr_t{shdr.sh_size}) / sizeof(sym_t)
+				),
+				string_table(shdr.sh_link)
+			};
+		}
+
+		/* .symtab */
+		[[nodiscard]]
+		symtab_t symbols() const noexcept {
+			const auto* const shdr{section(Types::section_type_t::symtab)};
+			return shdr ? symbols(*shdr) : symtab_t{};
+		}
+
+		/* .dynsym */
+		[[nodiscard]]
+		symtab_t dynamic_symbols() const noexcept {
+			const auto* const shdr{section(Types::section_type_t::dynsym)};
+			return shdr ? symbols(*shdr) : symtab_t{};
+		}
+
+		[[nodiscard]]
+		const phdr_t* segment(const Types::segment_type_t type) const noexcept {
+			for (const auto& phdr : segments()) {
+				if (phdr.p_type == type)
+					return &phdr;
+			}
+			return nullptr;
+		}
+
+		/* Translates a virtual address into a file offset by way of the PT_LOAD segments */
+		[[nodiscard]]
+		std::optional<std::size_t> offset_of(const addr_t vaddr) const noexcept {
+			for (const auto& phdr : segments()) {
+				if (phdr.p_type != Types::segment_type_t::load)
+					continue;
+				const addr_t base{phdr.p_vaddr};
+				if (vaddr >= base && vaddr - base < addr_t{phdr.p_filesz})
+					return narrow_size(addr_t(addr_t{phdr.p_offset} + (vaddr - base)));
+			}
+			return std::nullopt;
+		}
+
+		[[nodiscard]]
+		byte_span_t address_data(const addr_t vaddr, const std::size_t len) const noexcept {
+			const auto offset{offset_of(vaddr)};
+			if (!offset)
+				return {};
+			return _image.subspan(*offset, len);
+		}
+
+		[[nodiscard]]
+		notes_t<E> notes(const phdr_t& phdr) const noexcept {
+			if (phdr.p_type != Types::segment_type_t::note)
+				return {};
+			return {segment_data(phdr), narrow_size(addr_t{phdr.p_align})};
+		}
+
+		[[nodiscard]]
+		notes_t<E> notes(const shdr_t& shdr) const noexcept {
+			if (shdr.sh_type != Types::section_type_t::note)
+				return {};
+			return {section_data(shdr), narrow_size(addr_t{shdr.sh_addralign})};
+		}
+
+		/*
+			The contents of the NT_GNU_BUILD_ID note, or an empty span if there is none
+
+			The PT_NOTE segments are checked first as they're all a loaded image is guaranteed
+			to have, relocatable objects have no program headers so the sections are checked too.
+		*/
+		[[nodiscard]]
+		byte_span_t build_id() const noexcept {
+			constexpr auto build_id_type{std::uint32_t(Types::gnu_note_type_t::build_id)};
+			for (const auto& phdr : segments()) {
+				if (const auto note{notes(phdr).find("GNU"sv, build_id_type)})
+					return note->desc;
+			}
+			for (const auto& shdr : sections()) {
+				if (const auto note{notes(shdr).find("GNU"sv, build_id_type)})
+					return note->desc;
+			}
+			return {};
+		}
+
+		/* Falls back to PT_DYNAMIC if the section headers have been stripped */
+		[[nodiscard]]
+		span_t<const dyn_t> dynamic() const noexcept {
+			byte_span_t data{};
+			if (const auto* const shdr{section(Types::section_type_t::dynamic)})
+				data = section_data(*shdr);
+			else if (const auto* const phdr{segment(Types::segment_type_t::dynamic)})
+				data = segment_data(*phdr);
+			return data.template array<dyn_t>(0, data.size() / sizeof(dyn_t));
+		}
+
+		[[nodiscard]]
+		std::optional<addr_t> dynamic_value(const Types::dynamic_tag_t tag) const noexcept {
+			for (const auto& dyn : dynamic()) {
+				const auto dyn_tag{static_cast<Types::dynamic_tag_t>(dyn.d_tag.value())};
+				if (dyn_tag == tag)
+					return addr_t{dyn.d_val};
+				if (dyn_tag == Types::dynamic_tag_t::null_)
+					break;
+			}
+			return std::nullopt;
+		}
+	};
+
+	/*
+		Adds the defined code and data symbols to an address index
+
+		.symtab is used if present as it's a superset of .dynsym, the bias is added to every
+		address so the index can be built against where the image was actually loaded.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	void index_symbols(const elf_t<C, E>& elf, symbol_index_t::builder_t& builder, const std::uint64_t bias = 0U) {
+		using symtab_t = typename elf_t<C, E>::symtab_t;
+		using Types::symbol_type_t;
+
+		auto symtab{elf.symbols()};
+		if (!symtab.valid())
+			symtab = elf.dynamic_symbols();
+
+		builder.reserve(builder.size() + symtab.size());
+		for (const auto& sym : symtab) {
+			const std::uint16_t shndx{sym.st_shndx};
+			if (shndx == std::uint16_t(Types::section_index_t::undef) || shndx == std::uint16_t(Types::section_index_t::abs))
+				continue;
+
+			const auto type{symtab_t::type(sym)};
+			if (type != symbol_type_t::func && type != symbol_type_t::object &&
+				type != symbol_type_t::notype && type != symbol_type_t::gnu_ifunc)
+				continue;
+
+			const auto name{symtab.name(sym)};
+			/* Skip unnamed symbols and ARM/AArch64 mapping symbols */
+			if (name.empty() || name[0] == '$')
+				continue;
+			builder.add(std::uint64_t{sym.st_value} + bias, std::uint64_t{sym.st_size}, name);
+		}
+	}
+
+	using elf32le_t = elf_t<Types::class_t::elf32, Types::endian_t::little>;
+	using elf32be_t = elf_t<Types::class_t::elf32, Types::endian_t::big>;
+	using elf64le_t = elf_t<Types::class_t::elf64, Types::endian_t::little>;
+	using elf64be_t = elf_t<Types::class_t::elf64, Types::endian_t::big>;
+
+	using elf_any_t = std::variant<elf32le_t, elf32be_t, elf64le_t, elf64be_t>;
+
+	/* Returns the identification block if the image starts with a valid ELF magic */
+	[[nodiscard]]
+	LIBALFHEIM_API const Types::ident_t* identify(byte_span_t image) noexcept;
 
+	/* Opens the image as whichever class and byte order its identification says it is */
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<elf_any_t> open(byte_span_t image) noexcept;
 }
 
 #endif /* libalfheim_elf_hh */
@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* elf/compressed.hh - ELF compressed section support */
+#pragma once
+#if !defined(libalfheim_elf_compressed_hh)
+#define libalfheim_elf_compressed_hh
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/span.hh>
+#include <libalfheim/internal/thread_pool.hh>
+#include <libalfheim/internal/zlib.hh>
+
+#include <libalfheim/elf.hh>
+
+namespace Alfheim::ELF {
+	/*
+		Inflates a compressed section straight into out, which must be exactly section.size bytes
+
+		The size is known up front from the compression header, so this is a single pass
+		with no intermediate buffers. Only zlib compressed sections are supported.
+	*/
+	[[nodiscard]]
+	inline bool decompress(const compressed_section_t& section, Internal::inflater_t& inflater, const span_t<std::uint8_t> out) noexcept {
+		if (section.type != Types::compression_t::zlib || out.size() != section.size)
+			return false;
+		return inflater.inflate_all(section.data, out);
+	}
+
+	[[nodiscard]]
+	inline bool decompress(const compressed_section_t& section, const span_t<std::uint8_t> out) noexcept {
+		Internal::inflater_t inflater{};
+		return decompress(section, inflater, out);
+	}
+
+	/* As above but allocates the output, once, at its final size */
+	[[nodiscard]]
+	inline std::optional<std::vector<std::uint8_t>> decompress(const compressed_section_t& section) {
+		if (section.size > narrow_size(section.size) || section.type != Types::compression_t::zlib)
+			return std::nullopt;
+		std::vector<std::uint8_t> out(narrow_size(section.size));
+		if (!decompress(section, out))
+			return std::nullopt;
+		return out;
+	}
+
+	/*
+		Incrementally inflates a compressed section
+
+		Each call to read() fills as much of the given buffer as it can, which allows huge
+		sections to be processed in bounded memory, or consumed while they're inflated.
+	*/
+	struct section_reader_t final {
+	private:
+		Internal::inflater_t _inflater{};
+		byte_span_t _input{};
+		std::uint64_t _size{};
+		bool _failed{false};
+	public:
+		section_reader_t(const compressed_section_t& section) noexcept :
+			_input{section.data}, _size{section.size},
+			_failed{section.type != Types::compression_t::zlib} { /* NOP */ }
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _inflater.valid() && !_failed; }
+		[[nodiscard]]
+		bool finished() const noexcept { return _inflater.finished(); }
+		/* The uncompressed size of the whole section */
+		[[nodiscard]]
+		std::uint64_t size() const noexcept { return _size; }
+		[[nodiscard]]
+		std::uint64_t produced() const noexcept { return _inflater.total_out(); }
+
+		/* Returns how many bytes were written into out, or nullopt if the stream is corrupt */
+		[[nodiscard]]
+		std::optional<std::size_t> read(const span_t<std::uint8_t> out) noexcept {
+			if (!valid())
+				return std::nullopt;
+
+			auto remaining{out};
+			if (_inflater.inflate(_input, remaining) == Internal::zstatus_t::error) {
+				_failed = true;
+				return std::nullopt;
+			}
+			/* Ran out of input before the end of the stream, or produced more or less than promised */
+			if ((!finished() && _input.empty() && !remaining.empty()) || produced() > _size ||
+				(finished() && produced() != _size)) {
+				_failed = true;
+				return std::nullopt;
+			}
+			return out.size() - remaining.size();
+		}
+	};
+
+	/* A batch of sections inflated into a single shared allocation */
+	struct inflated_sections_t final {
+		std::unique_ptr<std::uint8_t[]> arena;
+		std::size_t arena_size;
+		/* In the same order as requested, failed sections are left empty */
+		std::vector<byte_span_t> sections;
+		std::size_t failed;
+
+		[[nodiscard]]
+		bool complete() const noexcept { return !failed; }
+	};
+
+	/* The arena size needed to hold all of the given sections once inflated, or 0 if it can't be addressed */
+	[[nodiscard]]
+	LIBALFHEIM_API std::size_t arena_size(span_t<const compressed_section_t> sections) noexcept;
+
+	/*
+		Inflates all of the given sections concurrently into a caller provided arena
+
+		Each worker in the pool owns its own inflate context and the largest sections are
+		dispatched first to keep the workers evenly loaded. results must have an entry for
+		every section, each is set to the section's slice of the arena, or left empty if
+		that section failed to inflate. Returns the number of sections that failed.
+	*/
+	[[nodiscard]]
+	LIBALFHEIM_API std::size_t decompress(span_t<const compressed_section_t> sections, span_t<std::uint8_t> arena,
+		span_t<byte_span_t> results, Internal::thread_pool_t& pool);
+
+	/* As above, but allocates the arena, once, at its final size */
+	[[nodiscard]]
+	LIBALFHEIM_API inflated_sections_t decompress(span_t<const compressed_section_t> sections, Internal::thread_pool_t& pool);
+
+	/* All of the sections in the image that are compressed */
+	template<Types::class_t C, Types::endian_t E>
+	[[nodiscard]]
+	std::vector<const typename elf_t<C, E>::shdr_t*> compressed_sections(const elf_t<C, E>& elf) {
+		std::vector<const typename elf_t<C, E>::shdr_t*> sections{};
+		for (const auto& shdr : elf.sections()) {
+			if (elf.compression(shdr))
+				sections.push_back(&shdr);
+		}
+		return sections;
+	}
+
+	/*
+		Inflates the requested sections of an image concurrently
+
+		Any requested section that isn't compressed is handed back as a view of the image
+		itself rather than being copied into the arena.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	[[nodiscard]]
+	inflated_sections_t decompress(const elf_t<C, E>& elf, const span_t<const typename elf_t<C, E>::shdr_t* const> requested,
+		Internal::thread_pool_t& pool) {
+		std::vector<compressed_section_t> compressed{};
+		std::vector<std::size_t> slots{};
+		compressed.reserve(requested.size());
+		slots.reserve(requested.size());
+
+		for (std::size_t idx{}; idx < requested.size(); ++idx) {
+			if (const auto section{elf.compression(*requested[idx])}) {
+				compressed.push_back(*section);
+				slots.push_back(idx);
+			}
+		}
+
+		auto inflated{decompress(compressed, pool)};
+		std::vector<byte_span_t> sections(requested.size());
+		for (std::size_t idx{}; idx < requested.size(); ++idx)
+			sections[idx] = elf.section_data(*requested[idx]);
+		for (std::size_t idx{}; idx < slots.size(); ++idx)
+			sections[slots[idx]] = inflated.sections[idx];
+		inflated.sections.swap(sections);
+		return inflated;
+	}
+
+	template<Types::class_t C, Types::endian_t E>
+	[[nodiscard]]
+	bool decompress(const elf_t<C, E>& elf, const typename elf_t<C, E>::shdr_t& shdr, const span_t<std::uint8_t> out) noexcept {
+		const auto section{elf.compression(shdr)};
+		return section && decompress(*section, out);
+	}
+
+	template<Types::class_t C, Types::endian_t E>
+	[[nodiscard]]
+	std::optional<std::vector<std::uint8_t>> decompress(const elf_t<C, E>& elf, const typename elf_t<C, E>::shdr_t& shdr) {
+		const auto section{elf.compression(shdr)};
+		if (!section)
+			return std::nullopt;
+		return decompress(*section);
+	}
+
+	/*
+		Compresses data as the contents of an SHF_COMPRESSED section written at offset in fd
+
+		The compressed payload is streamed out directly behind where the compression header
+		goes, and the header is filled in once the payload is complete, so the section never
+		has to be held in memory in its compressed form. Returns the on-disk size of the
+		section, which is what its sh_size should be set to. ELF32 can't describe a section
+		or alignment past 4GiB, so those are rejected before anything is written.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	[[nodiscard]]
+	std::optional<std::uint64_t> write_compressed(const Internal::fd_t& fd, const Internal::Types::off_t offset, const byte_span_t data,
+		const std::uint64_t alignment, const std::int32_t level = Z_DEFAULT_COMPRESSION) noexcept {
+		using chdr_t = typename Types::layout_t<C, E>::chdr_t;
+		using ch_size_t = typename Types::layout_t<C, E>::off_t;
+		using ch_align_t = typename Types::layout_t<C, E>::addr_t;
+
+		if (std::uint64_t{data.size()} > std::numeric_limits<ch_size_t>::max() || alignment > std::numeric_limits<ch_align_t>::max())
+			return std::nullopt;
+
+		Internal::deflater_t deflater{fd, offset + Internal::Types::off_t(sizeof(chdr_t)), level};
+		if (!deflater.valid() || !deflater.write(data) || !deflater.finish())
+			return std::nullopt;
+
+		chdr_t header{};
+		header.ch_type = Types::compression_t::zlib;
+		header.ch_size = static_cast<ch_size_t>(data.size());
+		header.ch_addralign = static_cast<ch_align_t>(alignment);
+		if (!fd.write_at(&header, sizeof(chdr_t), offset))
+			return std::nullopt;
+		return sizeof(chdr_t) + deflater.total_out();
+	}
+}
+
+#endif /* libalfheim_elf_compressed_hh */
@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* elf/hash.hh - ELF DT_GNU_HASH/DT_HASH symbol lookup */
+#pragma once
+#if !defined(libalfheim_elf_hash_hh)
+#define libalfheim_elf_hash_hh
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <libalfheim/elf.hh>
+
+namespace Alfheim::ELF {
+	[[nodiscard]]
+	inline constexpr std::uint32_t gnu_hash(const std::string_view name) noexcept {
+		std::uint32_t hash{5381U};
+		for (const auto chr : name)
+			hash = (hash << 5U) + hash + static_cast<std::uint8_t>(chr);
+		return hash;
+	}
+
+	[[nodiscard]]
+	inline constexpr std::uint32_t sysv_hash(const std::string_view name) noexcept {
+		std::uint32_t hash{0U};
+		for (const auto chr : name) {
+			hash = (hash << 4U) + static_cast<std::uint8_t>(chr);
+			const auto high{hash & 0xF0000000U};
+			if (high)
+				hash ^= high >> 24U;
+			hash &= ~high;
+		}
+		return hash;
+	}
+
+	/*
+		A view over a .gnu.hash section
+
+		The bloom filter rejects most misses without touching the buckets, chains, or the
+		symbol table at all, hits then only walk a single bucket's chain.
+	*/
+	template<typename L>
+	struct gnu_hash_t final {
+		using sym_t = typename L::sym_t;
+		using word_t = Internal::endian_value_t<std::uint32_t, L::endian>;
+		using bloom_t = Internal::endian_value_t<typename L::addr_t, L::endian>;
+
+		static constexpr std::uint32_t bloom_bits{sizeof(typename L::addr_t) * 8U};
+	private:
+		struct header_t final {
+			word_t nbuckets;
+			word_t symoffset;
+			word_t bloom_size;
+			word_t bloom_shift;
+		};
+
+		span_t<const bloom_t> _bloom{};
+		span_t<const word_t> _buckets{};
+		span_t<const word_t> _chains{};
+		std::uint32_t _symoffset{};
+		std::uint32_t _bloom_shift{};
+	public:
+		constexpr gnu_hash_t() noexcept = default;
+
+		/*
+			The chain array has no stored length, so sym_count bounds it; pass 0 if
+			the symbol count isn't known yet and use symbol_count() to recover it.
+		*/
+		[[nodiscard]]
+		static std::optional<gnu_hash_t> open(const byte_span_t data, const std::size_t sym_count) noexcept {
+			const auto* const header{data.template as<header_t>(0)};
+			if (!header)
+				return std::nullopt;
+
+			const std::uint32_t nbuckets{header->nbuckets};
+			const std::uint32_t bloom_size{header->bloom_size};
+			/* The bloom filter must be a power of two in size */
+			if (!nbuckets || !bloom_size || (bloom_size & (bloom_size - 1U)))
+				return std::nullopt;
+
+			gnu_hash_t table{};
+			table._symoffset = header->symoffset;
+			table._bloom_shift = header->bloom_shift;
+
+			auto offset{sizeof(header_t)};
+			table._bloom = data.template array<bloom_t>(offset, bloom_size);
+			offset += table._bloom.size_bytes();
+			table._buckets = data.template array<word_t>(offset, nbuckets);
+			offset += table._buckets.size_bytes();
+			if (table._bloom.empty() || table._buckets.empty())
+				return std::nullopt;
+
+			const auto remaining{(data.size() - offset) / sizeof(word_t)};
+			const auto chains{(sym_count > table._symoffset) ? sym_count - table._symoffset : remaining};
+			table._chains = data.template array<word_t>(offset, std::min(chains, remaining));
+			return table;
+		}
+
+		/* Recovers the number of symbols covered by the table by walking the last chain */
+		[[nodiscard]]
+		std::size_t symbol_count() const noexcept {
+			std::uint32_t last{0U};
+			for (const auto& bucket : _buckets)
+				last = std::max(last, bucket.value());
+			if (last < _symoffset)
+				return _symoffset;
+
+			for (auto idx{std::size_t{last} - _symoffset}; idx < _chains.size(); ++idx) {
+				if (_chains[idx] & 1U)
+					return idx + _symoffset + 1U;
+			}
+			return _chains.size() + _symoffset;
+		}
+
+		[[nodiscard]]
+		bool may_contain(const std::uint32_t hash) const noexcept {
+			const auto word{typename L::addr_t{_bloom[(hash / bloom_bits) & (_bloom.size() - 1U)]}};
+			const auto mask{
+				(typename L::addr_t{1U} << (hash % bloom_bits)) |
+				(typename L::addr_t{1U} << ((hash >> _bloom_shift) % bloom_bits))
+			};
+			return (word & mask) == mask;
+		}
+
+		[[nodiscard]]
+		std::optional<std::size_t> lookup(const std::string_view name, const std::uint32_t hash, const symtab_t<L>& symtab) const noexcept {
+			if (!may_contain(hash))
+				return std::nullopt;
+
+			std::size_t idx{_buckets[hash % _buckets.size()]};
+			if (idx < _symoffset)
+				return std::nullopt;
+
+			for (; idx - _symoffset < _chains.size() && idx < symtab.size(); ++idx) {
+				const std::uint32_t chain_hash{_chains[idx - _symoffset]};
+				if ((chain_hash | 1U) == (hash | 1U) && symtab.name(symtab[idx]) == name)
+					return idx;
+				if (chain_hash & 1U)
+					break;
+			}
+			return std::nullopt;
+		}
+
+		[[nodiscard]]
+		std::optional<std::size_t> lookup(const std::string_view name, const symtab_t<L>& symtab) const noexcept {
+			return lookup(name, gnu_hash(name), symtab);
+		}
+	};
+
+	/* A view over a SysV .hash section */
+	template<typename L>
+	struct sysv_hash_t final {
+		using sym_t = typename L::sym_t;
+		using word_t = Internal::endian_value_t<std::uint32_t, L::endian>;
+	private:
+		span_t<const word_t> _buckets{};
+		span_t<const word_t> _chains{};
+	public:
+		constexpr sysv_hash_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<sysv_hash_t> open(const byte_span_t data) noexcept {
+			const auto counts{data.template array<word_t>(0, 2)};
+			if (counts.empty() || !counts[0])
+				return std::nullopt;
+
+			sysv_hash_t table{};
+			table._buckets = data.template array<word_t>(sizeof(word_t) * 2U, counts[0]);
+			table._chains = data.template array<word_t>(sizeof(word_t) * (2U + counts[0]), counts[1]);
+			if (table._buckets.empty() || table._chains.empty())
+				return std::nullopt;
+			return table;
+		}
+
+		/* nchain is always the number of entries in the symbol table */
+		[[nodiscard]]
+		std::size_t symbol_count() const noexcept { return _chains.size(); }
+
+		[[nodiscard]]
+		std::optional<std::size_t> lookup(const std::string_view name, const std::uint32_t hash, const symtab_t<L>& symtab) const noexcept {
+			std::size_t idx{_buckets[hash % _buckets.size()]};
+			/* Bound the walk so a corrupt table with a cycle can't spin forever */
+			for (std::size_t steps{}; idx && idx < _chains.size() && idx < symtab.size() && steps < _chains.size(); ++steps) {
+				if (symtab.name(symtab[idx]) == name)
+					return idx;
+				idx = _chains[idx];
+			}
+			return std::nullopt;
+		}
+
+		[[nodiscard]]
+		std::optional<std::size_t> lookup(const std::string_view name, const symtab_t<L>& symtab) const noexcept {
+			return lookup(name, sysv_hash(name), symtab);
+		}
+	};
+
+	/*
+		Name to symbol lookup over the dynamic symbol table
+
+		Uses .gnu.hash when present, then .hash, and only falls back to a linear scan of the
+		symbols when the object carries neither. Nothing is allocated, neither when the
+		table is opened nor per query.
+	*/
+	template<typename L>
+	struct hashed_symtab_t final {
+		using sym_t = typename L::sym_t;
+	private:
+		symtab_t<L> _symtab{};
+		std::optional<gnu_hash_t<L>> _gnu{};
+		std::optional<sysv_hash_t<L>> _sysv{};
+	public:
+		constexpr hashed_symtab_t() noexcept = default;
+		hashed_symtab_t(const symtab_t<L>& symtab, const std::optional<gnu_hash_t<L>>& gnu,
+			const std::optional<sysv_hash_t<L>>& sysv) noexcept :
+			_symtab{symtab}, _gnu{gnu}, _sysv{sysv} { /* NOP */ }
+
+		[[nodiscard]]
+		const symtab_t<L>& symbols() const noexcept { return _symtab; }
+		[[nodiscard]]
+		bool has_gnu_hash() const noexcept { return _gnu.has_value(); }
+		[[nodiscard]]
+		bool has_sysv_hash() const noexcept { return _sysv.has_value(); }
+
+		[[nodiscard]]
+		std::optional<std::size_t> index(const std::string_view name) const noexcept {
+			if (_gnu)
+				return _gnu->lookup(name, _symtab);
+			if (_sysv)
+				return _sysv->lookup(name, _symtab);
+
+			for (std::size_t idx{1U}; idx < _symtab.size(); ++idx) {
+				if (_symtab.name(_symtab[idx]) == name)
+					return idx;
+			}
+			return std::nullopt;
+		}
+
+		/* Skips the undefined symbols a name may resolve to in an importing object */
+		[[nodiscard]]
+		const sym_t* lookup(const std::string_view name) const noexcept {
+			const auto idx{index(name)};
+			if (!idx)
+				return nullptr;
+			const auto& sym{_symtab[*idx]};
+			if (sym.st_shndx == std::uint16_t(Types::section_index_t::undef))
+				return nullptr;
+			return &sym;
+		}
+	};
+
+	namespace {
+		template<typename L>
+		[[nodiscard]]
+		std::optional<gnu_hash_t<L>> gnu_hash_table(const byte_span_t data, const std::size_t sym_count) noexcept {
+			if (data.empty())
+				return std::nullopt;
+			return gnu_hash_t<L>::open(data, sym_count);
+		}
+
+		template<typename L>
+		[[nodiscard]]
+		std::optional<sysv_hash_t<L>> sysv_hash_table(const byte_span_t data) noexcept {
+			if (data.empty())
+				return std::nullopt;
+			return sysv_hash_t<L>::open(data);
+		}
+	}
+
+	/*
+		Locates the hash tables for the dynamic symbol table
+
+		This goes via the section headers if there are any, otherwise DT_GNU_HASH, DT_HASH,
+		DT_SYMTAB, and DT_STRTAB are resolved through the PT_LOAD segments.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	[[nodiscard]]
+	std::optional<hashed_symtab_t<Types::layout_t<C, E>>> hashed_symbols(const elf_t<C, E>& elf) noexcept {
+		using L = Types::layout_t<C, E>;
+		using sym_t = typename L::sym_t;
+		using dynamic_tag_t = Types::dynamic_tag_t;
+
+		if (const auto* const dynsym{elf.section(Types::section_type_t::dynsym)}) {
+			const auto symtab{elf.symbols(*dynsym)};
+			if (!symtab.valid())
+				return std::nullopt;
+
+			std::optional<gnu_hash_t<L>> gnu{};
+			std::optional<sysv_hash_t<L>> sysv{};
+			for (const auto& shdr : elf.sections()) {
+				if (shdr.sh_link != elf.section_index(*dynsym))
+					continue;
+				if (shdr.sh_type == Types::section_type_t::gnu_hash && !gnu)
+					gnu = gnu_hash_table<L>(elf.section_data(shdr), symtab.size());
+				else if (shdr.sh_type == Types::section_type_t::hash && !sysv)
+					sysv = sysv_hash_table<L>(elf.section_data(shdr));
+			}
+			return hashed_symtab_t<L>{symtab, gnu, sysv};
+		}
+
+		const auto symtab_addr{elf.dynamic_value(dynamic_tag_t::symtab)};
+		const auto strtab_addr{elf.dynamic_value(dynamic_tag_t::strtab)};
+		const auto strtab_size{elf.dynamic_value(dynamic_tag_t::strsz)};
+		if (!symtab_addr || !strtab_addr || !strtab_size)
+			return std::nullopt;
+
+		/* Hash tables have no length in the dynamic section, so view up to the end of their segment */
+		const auto table_data = [&](const dynamic_tag_t tag) -> byte_span_t {
+			const auto addr{elf.dynamic_value(tag)};
+			if (!addr)
+				return {};
+			const auto offset{elf.offset_of(*addr)};
+			return offset ? elf.image().subspan(*offset) : byte_span_t{};
+		};
+
+		auto gnu{gnu_hash_table<L>(table_data(dynamic_tag_t::gnu_hash), 0U)};
+		auto sysv{sysv_hash_table<L>(table_data(dynamic_tag_t::hash))};
+
+		std::size_t sym_count{};
+		if (sysv)
+			sym_count = sysv->symbol_count();
+		else if (gnu)
+			sym_count = gnu->symbol_count();
+		else
+			return std::nullopt;
+
+		if (gnu)
+			gnu = gnu_hash_table<L>(table_data(dynamic_tag_t::gnu_hash), sym_count);
+
+		const auto sym_offset{elf.offset_of(*symtab_addr)};
+		if (!sym_offset)
+			return std::nullopt;
+
+		const symtab_t<L> symtab{
+			elf.image().template array<sym_t>(*sym_offset, sym_count),
+			strtab_t{elf.address_data(*strtab_addr, narrow_size(*strtab_size))}
+		};
+		if (!symtab.valid())
+			return std::nullopt;
+		return hashed_symtab_t<L>{symtab, gnu, sysv};
+	}
+}
+
+#endif /* libalfheim_elf_hash_hh */
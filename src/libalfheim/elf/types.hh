@@ -4,8 +4,515 @@
 #if !defined(libalfheim_elf_types_hh)
 #define libalfheim_elf_types_hh
 
+#include <cstdint>
+#include <array>
+
+#include <libalfheim/internal/bits.hh>
+#include <libalfheim/internal/endian.hh>
+
 namespace Alfheim::ELF::Types {
+	using Alfheim::Internal::endian_t;
+	using Alfheim::Internal::endian_value_t;
+
+	constexpr std::array<std::uint8_t, 4> magic{{0x7FU, 'E', 'L', 'F'}};
+
+	enum struct class_t : std::uint8_t {
+		none  = 0x00U,
+		elf32 = 0x01U,
+		elf64 = 0x02U,
+	};
+
+	enum struct data_t : std::uint8_t {
+		none = 0x00U,
+		lsb  = 0x01U,
+		msb  = 0x02U,
+	};
+
+	enum struct osabi_t : std::uint8_t {
+		sysv       = 0x00U,
+		hpux       = 0x01U,
+		netbsd     = 0x02U,
+		gnu        = 0x03U,
+		solaris    = 0x06U,
+		aix        = 0x07U,
+		irix       = 0x08U,
+		freebsd    = 0x09U,
+		tru64      = 0x0AU,
+		modesto    = 0x0BU,
+		openbsd    = 0x0CU,
+		arm_aeabi  = 0x40U,
+		arm        = 0x61U,
+		standalone = 0xFFU,
+	};
+
+	enum struct type_t : std::uint16_t {
+		none   = 0x0000U,
+		rel    = 0x0001U,
+		exec   = 0x0002U,
+		dyn    = 0x0003U,
+		core   = 0x0004U,
+		loos   = 0xFE00U,
+		hios   = 0xFEFFU,
+		loproc = 0xFF00U,
+		hiproc = 0xFFFFU,
+	};
+
+	enum struct machine_t : std::uint16_t {
+		none      = 0x0000U,
+		m32       = 0x0001U,
+		sparc     = 0x0002U,
+		i386      = 0x0003U,
+		m68k      = 0x0004U,
+		m88k      = 0x0005U,
+		i860      = 0x0007U,
+		mips      = 0x0008U,
+		s370      = 0x0009U,
+		mips_rs3  = 0x000AU,
+		parisc    = 0x000FU,
+		sparc32p  = 0x0012U,
+		i960      = 0x0013U,
+		ppc       = 0x0014U,
+		ppc64     = 0x0015U,
+		s390      = 0x0016U,
+		v800      = 0x0024U,
+		fr20      = 0x0025U,
+		rh32      = 0x0026U,
+		rce       = 0x0027U,
+		arm       = 0x0028U,
+		alpha     = 0x0029U,
+		sh        = 0x002AU,
+		sparcv9   = 0x002BU,
+		tricore   = 0x002CU,
+		h8_300    = 0x002EU,
+		ia64      = 0x0032U,
+		x86_64    = 0x003EU,
+		avr       = 0x0053U,
+		xtensa    = 0x005EU,
+		msp430    = 0x0069U,
+		blackfin  = 0x006AU,
+		aarch64   = 0x00B7U,
+		tilegx    = 0x00BFU,
+		cuda      = 0x00BEU,
+		riscv     = 0x00F3U,
+		bpf       = 0x00F7U,
+		loongarch = 0x0102U,
+	};
+
+	enum struct version_t : std::uint32_t {
+		none    = 0x00000000U,
+		current = 0x00000001U,
+	};
+
+	/* Special section indices */
+	enum struct section_index_t : std::uint16_t {
+		undef     = 0x0000U,
+		loreserve = 0xFF00U,
+		loproc    = 0xFF00U,
+		hiproc    = 0xFF1FU,
+		loos      = 0xFF20U,
+		hios      = 0xFF3FU,
+		abs       = 0xFFF1U,
+		common    = 0xFFF2U,
+		xindex    = 0xFFFFU,
+		hireserve = 0xFFFFU,
+	};
+
+	enum struct section_type_t : std::uint32_t {
+		null_          = 0x00000000U,
+		progbits       = 0x00000001U,
+		symtab         = 0x00000002U,
+		strtab         = 0x00000003U,
+		rela           = 0x00000004U,
+		hash           = 0x00000005U,
+		dynamic        = 0x00000006U,
+		note           = 0x00000007U,
+		nobits         = 0x00000008U,
+		rel            = 0x00000009U,
+		shlib          = 0x0000000AU,
+		dynsym         = 0x0000000BU,
+		init_array     = 0x0000000EU,
+		fini_array     = 0x0000000FU,
+		preinit_array  = 0x00000010U,
+		group          = 0x00000011U,
+		symtab_shndx   = 0x00000012U,
+		relr           = 0x00000013U,
+		loos           = 0x60000000U,
+		gnu_attributes = 0x6FFFFFF5U,
+		gnu_hash       = 0x6FFFFFF6U,
+		gnu_liblist    = 0x6FFFFFF7U,
+		checksum       = 0x6FFFFFF8U,
+		gnu_verdef     = 0x6FFFFFFDU,
+		gnu_verneed    = 0x6FFFFFFEU,
+		gnu_versym     = 0x6FFFFFFFU,
+		hios           = 0x6FFFFFFFU,
+		loproc         = 0x70000000U,
+		hiproc         = 0x7FFFFFFFU,
+		louser         = 0x80000000U,
+		hiuser         = 0x8FFFFFFFU,
+	};
+
+	enum struct section_flags_t : std::uint64_t {
+		none             = 0x0000000000000000U,
+		write            = 0x0000000000000001U,
+		alloc            = 0x0000000000000002U,
+		execinstr        = 0x0000000000000004U,
+		merge            = 0x0000000000000010U,
+		strings          = 0x0000000000000020U,
+		info_link        = 0x0000000000000040U,
+		link_order       = 0x0000000000000080U,
+		os_nonconforming = 0x0000000000000100U,
+		group            = 0x0000000000000200U,
+		tls              = 0x0000000000000400U,
+		compressed       = 0x0000000000000800U,
+		maskos           = 0x000000000FF00000U,
+		maskproc         = 0x00000000F0000000U,
+	};
+
+	enum struct segment_type_t : std::uint32_t {
+		null_        = 0x00000000U,
+		load         = 0x00000001U,
+		dynamic      = 0x00000002U,
+		interp       = 0x00000003U,
+		note         = 0x00000004U,
+		shlib        = 0x00000005U,
+		phdr         = 0x00000006U,
+		tls          = 0x00000007U,
+		loos         = 0x60000000U,
+		gnu_eh_frame = 0x6474E550U,
+		gnu_stack    = 0x6474E551U,
+		gnu_relro    = 0x6474E552U,
+		gnu_property = 0x6474E553U,
+		hios         = 0x6FFFFFFFU,
+		loproc       = 0x70000000U,
+		hiproc       = 0x7FFFFFFFU,
+	};
+
+	enum struct segment_flags_t : std::uint32_t {
+		none     = 0x00000000U,
+		x        = 0x00000001U,
+		w        = 0x00000002U,
+		r        = 0x00000004U,
+		maskos   = 0x0FF00000U,
+		maskproc = 0xF0000000U,
+	};
+
+	enum struct symbol_binding_t : std::uint8_t {
+		local      = 0x00U,
+		global     = 0x01U,
+		weak       = 0x02U,
+		gnu_unique = 0x0AU,
+		loos       = 0x0AU,
+		hios       = 0x0CU,
+		loproc     = 0x0DU,
+		hiproc     = 0x0FU,
+	};
+
+	enum struct symbol_type_t : std::uint8_t {
+		notype     = 0x00U,
+		object     = 0x01U,
+		func       = 0x02U,
+		section    = 0x03U,
+		file       = 0x04U,
+		common     = 0x05U,
+		tls        = 0x06U,
+		gnu_ifunc  = 0x0AU,
+		loos       = 0x0AU,
+		hios       = 0x0CU,
+		loproc     = 0x0DU,
+		hiproc     = 0x0FU,
+	};
+
+	enum struct symbol_visibility_t : std::uint8_t {
+		default_  = 0x00U,
+		internal  = 0x01U,
+		hidden    = 0x02U,
+		protected_ = 0x03U,
+	};
+
+	enum struct dynamic_tag_t : std::uint64_t {
+		null_           = 0x0000000000000000U,
+		needed          = 0x0000000000000001U,
+		pltrelsz        = 0x0000000000000002U,
+		pltgot          = 0x0000000000000003U,
+		hash            = 0x0000000000000004U,
+		strtab          = 0x0000000000000005U,
+		symtab          = 0x0000000000000006U,
+		rela            = 0x0000000000000007U,
+		relasz          = 0x0000000000000008U,
+		relaent         = 0x0000000000000009U,
+		strsz           = 0x000000000000000AU,
+		syment          = 0x000000000000000BU,
+		init            = 0x000000000000000CU,
+		fini            = 0x000000000000000DU,
+		soname          = 0x000000000000000EU,
+		rpath           = 0x000000000000000FU,
+		symbolic        = 0x0000000000000010U,
+		rel             = 0x0000000000000011U,
+		relsz           = 0x0000000000000012U,
+		relent          = 0x0000000000000013U,
+		pltrel          = 0x0000000000000014U,
+		debug           = 0x0000000000000015U,
+		textrel         = 0x0000000000000016U,
+		jmprel          = 0x0000000000000017U,
+		bind_now        = 0x0000000000000018U,
+		init_array      = 0x0000000000000019U,
+		fini_array      = 0x000000000000001AU,
+		init_arraysz    = 0x000000000000001BU,
+		fini_arraysz    = 0x000000000000001CU,
+		runpath         = 0x000000000000001DU,
+		flags           = 0x000000000000001EU,
+		preinit_array   = 0x0000000000000020U,
+		preinit_arraysz = 0x0000000000000021U,
+		symtab_shndx    = 0x0000000000000022U,
+		relrsz          = 0x0000000000000023U,
+		relr            = 0x0000000000000024U,
+		relrent         = 0x0000000000000025U,
+		gnu_hash        = 0x000000006FFFFEF5U,
+		versym          = 0x000000006FFFFFF0U,
+		relacount       = 0x000000006FFFFFF9U,
+		relcount        = 0x000000006FFFFFFAU,
+		flags_1         = 0x000000006FFFFFFBU,
+		verdef          = 0x000000006FFFFFFCU,
+		verdefnum       = 0x000000006FFFFFFDU,
+		verneed         = 0x000000006FFFFFFEU,
+		verneednum      = 0x000000006FFFFFFFU,
+	};
+
+	enum struct compression_t : std::uint32_t {
+		zlib   = 0x00000001U,
+		zstd   = 0x00000002U,
+		loos   = 0x60000000U,
+		hios   = 0x6FFFFFFFU,
+		loproc = 0x70000000U,
+		hiproc = 0x7FFFFFFFU,
+	};
+
+	/* e_ident[], this is the same for both ELF32 and ELF64 and has no byte order */
+	struct ident_t final {
+		std::array<std::uint8_t, 4> magic;
+		class_t  elf_class;
+		data_t   data;
+		std::uint8_t version;
+		osabi_t  osabi;
+		std::uint8_t abi_version;
+		std::array<std::uint8_t, 7> pad;
+	};
+	static_assert(sizeof(ident_t) == 16, "ident_t must be 16 bytes");
+
+	/* st_info is split into a 4 bit type and a 4 bit binding */
+	using st_info_t = Internal::bitfield_t<std::uint8_t,
+		Internal::bitspan_t<0, 3>,
+		Internal::bitspan_t<4, 7>
+	>;
+
+	template<endian_t E>
+	struct elf32_ehdr_t final {
+		ident_t e_ident;
+		endian_value_t<type_t, E> e_type;
+		endian_value_t<machine_t, E> e_machine;
+		endian_value_t<version_t, E> e_version;
+		endian_value_t<std::uint32_t, E> e_entry;
+		endian_value_t<std::uint32_t, E> e_phoff;
+		endian_value_t<std::uint32_t, E> e_shoff;
+		endian_value_t<std::uint32_t, E> e_flags;
+		endian_value_t<std::uint16_t, E> e_ehsize;
+		endian_value_t<std::uint16_t, E> e_phentsize;
+		endian_value_t<std::uint16_t, E> e_phnum;
+		endian_value_t<std::uint16_t, E> e_shentsize;
+		endian_value_t<std::uint16_t, E> e_shnum;
+		endian_value_t<std::uint16_t, E> e_shstrndx;
+	};
+
+	template<endian_t E>
+	struct elf64_ehdr_t final {
+		ident_t e_ident;
+		endian_value_t<type_t, E> e_type;
+		endian_value_t<machine_t, E> e_machine;
+		endian_value_t<version_t, E> e_version;
+		endian_value_t<std::uint64_t, E> e_entry;
+		endian_value_t<std::uint64_t, E> e_phoff;
+		endian_value_t<std::uint64_t, E> e_shoff;
+		endian_value_t<std::uint32_t, E> e_flags;
+		endian_value_t<std::uint16_t, E> e_ehsize;
+		endian_value_t<std::uint16_t, E> e_phentsize;
+		endian_value_t<std::uint16_t, E> e_phnum;
+		endian_value_t<std::uint16_t, E> e_shentsize;
+		endian_value_t<std::uint16_t, E> e_shnum;
+		endian_value_t<std::uint16_t, E> e_shstrndx;
+	};
+
+	template<endian_t E>
+	struct elf32_shdr_t final {
+		endian_value_t<std::uint32_t, E> sh_name;
+		endian_value_t<section_type_t, E> sh_type;
+		endian_value_t<std::uint32_t, E> sh_flags;
+		endian_value_t<std::uint32_t, E> sh_addr;
+		endian_value_t<std::uint32_t, E> sh_offset;
+		endian_value_t<std::uint32_t, E> sh_size;
+		endian_value_t<std::uint32_t, E> sh_link;
+		endian_value_t<std::uint32_t, E> sh_info;
+		endian_value_t<std::uint32_t, E> sh_addralign;
+		endian_value_t<std::uint32_t, E> sh_entsize;
+	};
+
+	template<endian_t E>
+	struct elf64_shdr_t final {
+		endian_value_t<std::uint32_t, E> sh_name;
+		endian_value_t<section_type_t, E> sh_type;
+		endian_value_t<std::uint64_t, E> sh_flags;
+		endian_value_t<std::uint64_t, E> sh_addr;
+		endian_value_t<std::uint64_t, E> sh_offset;
+		endian_value_t<std::uint64_t, E> sh_size;
+		endian_value_t<std::uint32_t, E> sh_link;
+		endian_value_t<std::uint32_t, E> sh_info;
+		endian_value_t<std::uint64_t, E> sh_addralign;
+		endian_value_t<std::uint64_t, E> sh_entsize;
+	};
+
+	template<endian_t E>
+	struct elf32_phdr_t final {
+		endian_value_t<segment_type_t, E> p_type;
+		endian_value_t<std::uint32_t, E> p_offset;
+		endian_value_t<std::uint32_t, E> p_vaddr;
+		endian_value_t<std::uint32_t, E> p_paddr;
+		endian_value_t<std::uint32_t, E> p_filesz;
+		endian_value_t<std::uint32_t, E> p_memsz;
+		endian_value_t<std::uint32_t, E> p_flags;
+		endian_value_t<std::uint32_t, E> p_align;
+	};
+
+	template<endian_t E>
+	struct elf64_phdr_t final {
+		endian_value_t<segment_type_t, E> p_type;
+		endian_value_t<std::uint32_t, E> p_flags;
+		endian_value_t<std::uint64_t, E> p_offset;
+		endian_value_t<std::uint64_t, E> p_vaddr;
+		endian_value_t<std::uint64_t, E> p_paddr;
+		endian_value_t<std::uint64_t, E> p_filesz;
+		endian_value_t<std::uint64_t, E> p_memsz;
+		endian_value_t<std::uint64_t, E> p_align;
+	};
+
+	template<endian_t E>
+	struct elf32_sym_t final {
+		endian_value_t<std::uint32_t, E> st_name;
+		endian_value_t<std::uint32_t, E> st_value;
+		endian_value_t<std::uint32_t, E> st_size;
+		std::uint8_t st_info;
+		std::uint8_t st_other;
+		endian_value_t<std::uint16_t, E> st_shndx;
+	};
+
+	template<endian_t E>
+	struct elf64_sym_t final {
+		endian_value_t<std::uint32_t, E> st_name;
+		std::uint8_t st_info;
+		std::uint8_t st_other;
+		endian_value_t<std::uint16_t, E> st_shndx;
+		endian_value_t<std::uint64_t, E> st_value;
+		endian_value_t<std::uint64_t, E> st_size;
+	};
+
+	template<endian_t E>
+	struct elf32_dyn_t final {
+		endian_value_t<std::int32_t, E> d_tag;
+		endian_value_t<std::uint32_t, E> d_val;
+	};
+
+	template<endian_t E>
+	struct elf64_dyn_t final {
+		endian_value_t<std::int64_t, E> d_tag;
+		endian_value_t<std::uint64_t, E> d_val;
+	};
+
+	/* Prefixes the contents of an SHF_COMPRESSED section */
+	template<endian_t E>
+	struct elf32_chdr_t final {
+		endian_value_t<compression_t, E> ch_type;
+		endian_value_t<std::uint32_t, E> ch_size;
+		endian_value_t<std::uint32_t, E> ch_addralign;
+	};
+
+	template<endian_t E>
+	struct elf64_chdr_t final {
+		endian_value_t<compression_t, E> ch_type;
+		endian_value_t<std::uint32_t, E> ch_reserved;
+		endian_value_t<std::uint64_t, E> ch_size;
+		endian_value_t<std::uint64_t, E> ch_addralign;
+	};
+
+	/* The legacy GNU .zdebug_* header, "ZLIB" followed by the big-endian uncompressed size */
+	struct zdebug_hdr_t final {
+		std::array<std::uint8_t, 4> magic;
+		Internal::be_t<std::uint64_t> size;
+	};
+
+	constexpr std::array<std::uint8_t, 4> zdebug_magic{{'Z', 'L', 'I', 'B'}};
+
+	/* The header of each entry in a PT_NOTE segment or SHT_NOTE section, the same for both classes */
+	template<endian_t E>
+	struct nhdr_t final {
+		endian_value_t<std::uint32_t, E> n_namesz;
+		endian_value_t<std::uint32_t, E> n_descsz;
+		endian_value_t<std::uint32_t, E> n_type;
+	};
+
+	/* Note types for notes owned by "GNU" */
+	enum struct gnu_note_type_t : std::uint32_t {
+		abi_tag          = 0x00000001U,
+		hwcap            = 0x00000002U,
+		build_id         = 0x00000003U,
+		gold_version     = 0x00000004U,
+		property_type_0  = 0x00000005U,
+	};
+
+	/* Maps an ELF class and byte order to the concrete on-disk structures */
+	template<class_t C, endian_t E>
+	struct layout_t;
+
+	template<endian_t E>
+	struct layout_t<class_t::elf32, E> final {
+		static constexpr class_t elf_class{class_t::elf32};
+		static constexpr endian_t endian{E};
+
+		using addr_t = std::uint32_t;
+		using off_t  = std::uint32_t;
+		using ehdr_t = elf32_ehdr_t<E>;
+		using shdr_t = elf32_shdr_t<E>;
+		using phdr_t = elf32_phdr_t<E>;
+		using sym_t  = elf32_sym_t<E>;
+		using dyn_t  = elf32_dyn_t<E>;
+		using chdr_t = elf32_chdr_t<E>;
+	};
+
+	template<endian_t E>
+	struct layout_t<class_t::elf64, E> final {
+		static constexpr class_t elf_class{class_t::elf64};
+		static constexpr endian_t endian{E};
+
+		using addr_t = std::uint64_t;
+		using off_t  = std::uint64_t;
+		using ehdr_t = elf64_ehdr_t<E>;
+		using shdr_t = elf64_shdr_t<E>;
+		using phdr_t = elf64_phdr_t<E>;
+		using sym_t  = elf64_sym_t<E>;
+		using dyn_t  = elf64_dyn_t<E>;
+		using chdr_t = elf64_chdr_t<E>;
+	};
 
+	static_assert(sizeof(elf32_ehdr_t<endian_t::little>) == 52, "elf32_ehdr_t must be 52 bytes");
+	static_assert(sizeof(elf64_ehdr_t<endian_t::little>) == 64, "elf64_ehdr_t must be 64 bytes");
+	static_assert(sizeof(elf32_shdr_t<endian_t::little>) == 40, "elf32_shdr_t must be 40 bytes");
+	static_assert(sizeof(elf64_shdr_t<endian_t::little>) == 64, "elf64_shdr_t must be 64 bytes");
+	static_assert(sizeof(elf32_phdr_t<endian_t::little>) == 32, "elf32_phdr_t must be 32 bytes");
+	static_assert(sizeof(elf64_phdr_t<endian_t::little>) == 56, "elf64_phdr_t must be 56 bytes");
+	static_assert(sizeof(elf32_sym_t<endian_t::little>) == 16, "elf32_sym_t must be 16 bytes");
+	static_assert(sizeof(elf64_sym_t<endian_t::little>) == 24, "elf64_sym_t must be 24 bytes");
+	static_assert(sizeof(elf32_dyn_t<endian_t::little>) == 8, "elf32_dyn_t must be 8 bytes");
+	static_assert(sizeof(elf64_dyn_t<endian_t::little>) == 16, "elf64_dyn_t must be 16 bytes");
+	static_assert(sizeof(elf32_chdr_t<endian_t::little>) == 12, "elf32_chdr_t must be 12 bytes");
+	static_assert(sizeof(elf64_chdr_t<endian_t::little>) == 24, "elf64_chdr_t must be 24 bytes");
+	static_assert(sizeof(zdebug_hdr_t) == 12, "zdebug_hdr_t must be 12 bytes");
 }
 
 #endif /* libalfheim_elf_types_hh */
@@ -0,0 +1,372 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* format.cc - Object format detection and dispatch */
+
+#include <array>
+#include <cstring>
+
+#include <libalfheim/internal/bits.hh>
+#include <libalfheim/internal/endian.hh>
+
+#include <libalfheim/format.hh>
+
+namespace Alfheim {
+	namespace {
+		using Internal::le_t;
+		using Internal::be_t;
+
+		/* Refines the info from the table or rejects the match, given the whole image */
+		using validator_t = bool (*)(byte_span_t image, format_info_t& info) noexcept;
+
+		struct signature_t final {
+			std::size_t offset;
+			std::size_t length;
+			std::array<std::uint8_t, 8> magic;
+			format_info_t info;
+			validator_t validate;
+		};
+
+		template<typename T>
+		[[nodiscard]]
+		std::optional<T> read(const byte_span_t image, const std::size_t offset, const endian_t endian) noexcept {
+			if (endian == endian_t::little) {
+				const auto* const value{image.as<le_t<T>>(offset)};
+				return value ? std::optional<T>{value->value()} : std::nullopt;
+			}
+			const auto* const value{image.as<be_t<T>>(offset)};
+			return value ? std::optional<T>{value->value()} : std::nullopt;
+		}
+
+		[[nodiscard]]
+		bool validate_elf(const byte_span_t image, format_info_t& info) noexcept {
+			const auto* const ident{ELF::identify(image)};
+			if (!ident)
+				return false;
+			if (ident->elf_class == ELF::Types::class_t::elf32)
+				info.bits = 32U;
+			else if (ident->elf_class == ELF::Types::class_t::elf64)
+				info.bits = 64U;
+			else
+				return false;
+
+			if (ident->data == ELF::Types::data_t::lsb)
+				info.endian = endian_t::little;
+			else if (ident->data == ELF::Types::data_t::msb)
+				info.endian = endian_t::big;
+			else
+				return false;
+			return true;
+		}
+
+		/* 0xCAFEBABE is shared with Java class files, which have a major version of at least 45 there */
+		[[nodiscard]]
+		bool validate_fat(const byte_span_t image, format_info_t&) noexcept {
+			const auto count{read<std::uint32_t>(image, 4U, endian_t::big)};
+			return count && *count && *count < 45U;
+		}
+
+		[[nodiscard]]
+		bool validate_pe(const byte_span_t image, format_info_t& info) noexcept {
+			const auto lfanew{read<std::uint32_t>(image, 0x3CU, endian_t::little)};
+			if (!lfanew)
+				return false;
+			const auto signature{image.subspan(*lfanew, 4U)};
+			if (signature.size() != 4U || std::memcmp(signature.data(), "PE\0\0", 4U))
+				return false;
+			/* The optional header follows the 20 byte COFF header after the signature */
+			const auto magic{read<std::uint16_t>(image, std::size_t{*lfanew} + 24U, endian_t::little)};
+			if (!magic)
+				return false;
+			if (*magic == 0x010BU || *magic == 0x0107U)
+				info.bits = 32U;
+			else if (*magic == 0x020BU)
+				info.bits = 64U;
+			else
+				return false;
+			return true;
+		}
+
+		/* Checks the section table described by a COFF style file header actually fits in the image */
+		[[nodiscard]]
+		bool section_table_fits(const byte_span_t image, const endian_t endian, const std::size_t header_size,
+			const std::size_t opthdr_offset, const std::size_t section_size) noexcept {
+			const auto sections{read<std::uint16_t>(image, 2U, endian)};
+			const auto opthdr{read<std::uint16_t>(image, opthdr_offset, endian)};
+			if (!sections || !opthdr || *opthdr > 4096U)
+				return false;
+			return header_size + *opthdr + (std::size_t{*sections} * section_size) <= image.size();
+		}
+
+		[[nodiscard]]
+		bool validate_coff(const byte_span_t image, format_info_t& info) noexcept {
+			return section_table_fits(image, info.endian, 20U, 16U, 40U);
+		}
+
+		/* Anonymous and /bigobj objects, Sig1 is 0 and Sig2 is 0xFFFF, followed by a version and the machine */
+		[[nodiscard]]
+		bool validate_bigobj(const byte_span_t image, format_info_t& info) noexcept {
+			const auto version{read<std::uint16_t>(image, 4U, endian_t::little)};
+			const auto machine{read<std::uint16_t>(image, 6U, endian_t::little)};
+			if (!version || !machine || !*version)
+				return false;
+			info.bits = (*machine == 0x8664U || *machine == 0xAA64U || *machine == 0x0200U) ? 64U : 32U;
+			return true;
+		}
+
+		[[nodiscard]]
+		bool validate_xcoff(const byte_span_t image, format_info_t& info) noexcept {
+			if (info.bits == 64U)
+				return section_table_fits(image, endian_t::big, 24U, 16U, 72U);
+			return section_table_fits(image, endian_t::big, 20U, 16U, 40U);
+		}
+
+		[[nodiscard]]
+		bool validate_ecoff(const byte_span_t image, format_info_t& info) noexcept {
+			/* Alpha has a 64-bit symbol table pointer, which pushes f_opthdr along, and bigger section headers */
+			if (info.bits == 64U)
+				return section_table_fits(image, info.endian, 24U, 20U, 64U);
+			return section_table_fits(image, info.endian, 20U, 16U, 40U);
+		}
+
+		[[nodiscard]]
+		bool aout_fits(const byte_span_t image, const endian_t endian) noexcept {
+			const auto text{read<std::uint32_t>(image, 4U, endian)};
+			const auto data{read<std::uint32_t>(image, 8U, endian)};
+			if (!text || !data || image.size() < 32U)
+				return false;
+			return std::uint64_t{*text} + *data <= image.size();
+		}
+
+		[[nodiscard]]
+		bool validate_aout(const byte_span_t image, format_info_t& info) noexcept {
+			/* NetBSD writes a_midmag in network byte order even when the rest of the header is little-endian */
+			if (info.endian == endian_t::big) {
+				const auto midmag{read<std::uint32_t>(image, 0U, endian_t::big)};
+				if (!midmag)
+					return false;
+				info.endian = aout::header_endian(aout::midmag_machine(*midmag));
+			}
+			return aout_fits(image, info.endian);
+		}
+
+		/* Object decks are a sequence of 80 column card images */
+		[[nodiscard]]
+		bool validate_os360(const byte_span_t image, format_info_t&) noexcept {
+			return image.size() >= 80U;
+		}
+
+		constexpr auto little{endian_t::little};
+		constexpr auto big{endian_t::big};
+
+		/* Everything with a fixed magic at offset 0 comes before the a.out variants with theirs at offset 2 */
+		constexpr std::array<signature_t, 50> signatures{{
+			{0U, 4U, {{0x7FU, 'E', 'L', 'F'}}, {format_t::elf, little, 0U}, validate_elf},
+
+			{0U, 4U, {{0xCEU, 0xFAU, 0xEDU, 0xFEU}}, {format_t::macho, little, 32U}, nullptr},
+			{0U, 4U, {{0xCFU, 0xFAU, 0xEDU, 0xFEU}}, {format_t::macho, little, 64U}, nullptr},
+			{0U, 4U, {{0xFEU, 0xEDU, 0xFAU, 0xCEU}}, {format_t::macho, big, 32U}, nullptr},
+			{0U, 4U, {{0xFEU, 0xEDU, 0xFAU, 0xCFU}}, {format_t::macho, big, 64U}, nullptr},
+			{0U, 4U, {{0xCAU, 0xFEU, 0xBAU, 0xBEU}}, {format_t::fat, big, 32U}, validate_fat},
+			{0U, 4U, {{0xCAU, 0xFEU, 0xBAU, 0xBFU}}, {format_t::fat, big, 64U}, validate_fat},
+
+			{0U, 2U, {{'M', 'Z'}}, {format_t::pe32, little, 0U}, validate_pe},
+
+			{0U, 8U, {{'!', '<', 'a', 'r', 'c', 'h', '>', '\n'}}, {format_t::archive, little, 0U}, nullptr},
+			{0U, 8U, {{'!', '<', 't', 'h', 'i', 'n', '>', '\n'}}, {format_t::archive, little, 0U}, nullptr},
+
+			{0U, 7U, {{'d', 'y', 'l', 'd', '_', 'v', '1'}}, {format_t::dyld_cache, little, 0U}, nullptr},
+
+			{0U, 2U, {{0x01U, 0xDFU}}, {format_t::xcoff, big, 32U}, validate_xcoff},
+			{0U, 2U, {{0x01U, 0xEFU}}, {format_t::xcoff, big, 64U}, validate_xcoff},
+			{0U, 2U, {{0x01U, 0xF7U}}, {format_t::xcoff, big, 64U}, validate_xcoff},
+
+			/* MIPS and Alpha ECOFF, stored in the byte order of the target */
+			{0U, 2U, {{0x01U, 0x60U}}, {format_t::ecoff, big, 32U}, validate_ecoff},
+			{0U, 2U, {{0x01U, 0x63U}}, {format_t::ecoff, big, 32U}, validate_ecoff},
+			{0U, 2U, {{0x01U, 0x40U}}, {format_t::ecoff, big, 32U}, validate_ecoff},
+			{0U, 2U, {{0x62U, 0x01U}}, {format_t::ecoff, little, 32U}, validate_ecoff},
+			{0U, 2U, {{0x66U, 0x01U}}, {format_t::ecoff, little, 32U}, validate_ecoff},
+			{0U, 2U, {{0x42U, 0x01U}}, {format_t::ecoff, little, 32U}, validate_ecoff},
+			{0U, 2U, {{0x83U, 0x01U}}, {format_t::ecoff, little, 64U}, validate_ecoff},
+			{0U, 2U, {{0x85U, 0x01U}}, {format_t::ecoff, little, 64U}, validate_ecoff},
+			{0U, 2U, {{0x88U, 0x01U}}, {format_t::ecoff, little, 64U}, validate_ecoff},
+
+			/* Microsoft COFF objects, where the magic is the target machine */
+			{0U, 4U, {{0x00U, 0x00U, 0xFFU, 0xFFU}}, {format_t::coff, little, 32U}, validate_bigobj},
+			{0U, 2U, {{0x4CU, 0x01U}}, {format_t::coff, little, 32U}, validate_coff},
+			{0U, 2U, {{0x64U, 0x86U}}, {format_t::coff, little, 64U}, validate_coff},
+			{0U, 2U, {{0xC0U, 0x01U}}, {format_t::coff, little, 32U}, validate_coff},
+			{0U, 2U, {{0xC2U, 0x01U}}, {format_t::coff, little, 32U}, validate_coff},
+			{0U, 2U, {{0xC4U, 0x01U}}, {format_t::coff, little, 32U}, validate_coff},
+			{0U, 2U, {{0x64U, 0xAAU}}, {format_t::coff, little, 64U}, validate_coff},
+			{0U, 2U, {{0x41U, 0xA6U}}, {format_t::coff, little, 64U}, validate_coff},
+			{0U, 2U, {{0x00U, 0x02U}}, {format_t::coff, little, 64U}, validate_coff},
+			{0U, 2U, {{0x32U, 0x50U}}, {format_t::coff, little, 32U}, validate_coff},
+			{0U, 2U, {{0x64U, 0x50U}}, {format_t::coff, little, 64U}, validate_coff},
+			{0U, 2U, {{0x32U, 0x62U}}, {format_t::coff, little, 32U}, validate_coff},
+			{0U, 2U, {{0x64U, 0x62U}}, {format_t::coff, little, 64U}, validate_coff},
+			/* System V COFF, m68k and WE32000 */
+			{0U, 2U, {{0x01U, 0x50U}}, {format_t::coff, big, 32U}, validate_coff},
+			{0U, 2U, {{0x01U, 0x70U}}, {format_t::coff, big, 32U}, validate_coff},
+			{0U, 2U, {{0x01U, 0x71U}}, {format_t::coff, big, 32U}, validate_coff},
+
+			/* OS/360 object decks, a 0x02 followed by the card type in EBCDIC */
+			{0U, 4U, {{0x02U, 0xC5U, 0xE2U, 0xC4U}}, {format_t::os360, big, 32U}, validate_os360},
+			{0U, 4U, {{0x02U, 0xE2U, 0xE8U, 0xD4U}}, {format_t::os360, big, 32U}, validate_os360},
+			{0U, 4U, {{0x02U, 0xE3U, 0xE7U, 0xE3U}}, {format_t::os360, big, 32U}, validate_os360},
+
+			/* a.out, OMAGIC, NMAGIC, ZMAGIC, and QMAGIC, little endian with the magic in the low half */
+			{0U, 2U, {{0x07U, 0x01U}}, {format_t::aout, little, 32U}, validate_aout},
+			{0U, 2U, {{0x08U, 0x01U}}, {format_t::aout, little, 32U}, validate_aout},
+			{0U, 2U, {{0x0BU, 0x01U}}, {format_t::aout, little, 32U}, validate_aout},
+			{0U, 2U, {{0xCCU, 0x00U}}, {format_t::aout, little, 32U}, validate_aout},
+			/* And big endian, with the flags and machine ID ahead of the magic */
+			{2U, 2U, {{0x01U, 0x07U}}, {format_t::aout, big, 32U}, validate_aout},
+			{2U, 2U, {{0x01U, 0x08U}}, {format_t::aout, big, 32U}, validate_aout},
+			{2U, 2U, {{0x01U, 0x0BU}}, {format_t::aout, big, 32U}, validate_aout},
+			{2U, 2U, {{0x00U, 0xCCU}}, {format_t::aout, big, 32U}, validate_aout},
+		}};
+		static_assert(signatures.size() <= 64U, "candidate masks hold one bit per signature");
+
+		/*
+			The signatures worth trying for each possible first byte, as masks of table indices
+
+			Those with their magic further in can't be ruled out by the first byte, so they're
+			in every mask. Trying the lowest set bit first keeps the table's precedence.
+		*/
+		constexpr auto candidates{[]() noexcept {
+			std::array<std::uint64_t, 256> masks{};
+			for (std::size_t idx{}; idx < signatures.size(); ++idx) {
+				for (std::size_t byte{}; byte < masks.size(); ++byte) {
+					if (signatures[idx].offset || signatures[idx].magic[0] == byte)
+						masks[byte] |= std::uint64_t{1U} << idx;
+				}
+			}
+			return masks;
+		}()};
+
+		[[nodiscard]]
+		std::optional<format_info_t> match(const byte_span_t image, const signature_t& signature) noexcept {
+			const auto magic{image.subspan(signature.offset, signature.length)};
+			if (magic.size() != signature.length || std::memcmp(magic.data(), signature.magic.data(), signature.length))
+				return std::nullopt;
+			auto info{signature.info};
+			if (signature.validate && !signature.validate(image, info))
+				return std::nullopt;
+			return info;
+		}
+
+		/* Hands an identified image to its backend, indexed by format_t */
+		using opener_t = handle_t (*)(byte_span_t image) noexcept;
+
+		[[nodiscard]]
+		handle_t open_unparsed(const byte_span_t) noexcept { return {}; }
+
+		[[nodiscard]]
+		handle_t open_elf(const byte_span_t image) noexcept {
+			if (auto elf{ELF::open(image)})
+				return {std::move(*elf)};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_macho(const byte_span_t image) noexcept {
+			if (auto macho{MachO::open(image)})
+				return {std::move(*macho)};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_fat(const byte_span_t image) noexcept {
+			if (const auto fat{MachO::fat_t::open(image)})
+				return {*fat};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_dyld_cache(const byte_span_t image) noexcept {
+			if (auto cache{MachO::dyld_cache_t::open(image)})
+				return {std::move(*cache)};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_pe(const byte_span_t image) noexcept {
+			if (auto pe{PE32::open(image)})
+				return {std::move(*pe)};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_aout(const byte_span_t image) noexcept {
+			if (auto aout{aout::open(image)})
+				return {std::move(*aout)};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_coff(const byte_span_t image) noexcept {
+			if (auto coff{COFF::open(image)})
+				return {std::move(*coff)};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_archive(const byte_span_t image) noexcept {
+			if (auto archive{Archive::archive_t::open(image)})
+				return {std::move(*archive)};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_ecoff(const byte_span_t image) noexcept {
+			if (auto ecoff{ECOFF::open(image)})
+				return {std::move(*ecoff)};
+			return {};
+		}
+
+		[[nodiscard]]
+		handle_t open_xcoff(const byte_span_t image) noexcept {
+			if (auto xcoff{XCOFF::open(image)})
+				return {std::move(*xcoff)};
+			return {};
+		}
+
+		constexpr std::array<opener_t, 12> openers{{
+			open_unparsed,   /* unknown */
+			open_aout,       /* aout */
+			open_coff,       /* coff */
+			open_ecoff,      /* ecoff */
+			open_elf,        /* elf */
+			open_macho,      /* macho */
+			open_fat,        /* fat */
+			open_unparsed,   /* os360 */
+			open_pe,         /* pe32 */
+			open_xcoff,      /* xcoff */
+			open_archive,    /* archive */
+			open_dyld_cache, /* dyld_cache */
+		}};
+		static_assert(openers.size() == static_cast<std::size_t>(format_t::dyld_cache) + 1U, "every format needs an opener");
+	}
+
+	std::optional<format_info_t> identify(const byte_span_t image) noexcept {
+		if (image.empty())
+			return std::nullopt;
+		for (auto mask{candidates[image[0]]}; mask; mask &= mask - 1U) {
+			if (const auto info{match(image, signatures[Internal::countr_zero(mask)])})
+				return info;
+		}
+		return std::nullopt;
+	}
+
+	std::optional<image_t> open(const byte_span_t image) noexcept {
+		const auto info{identify(image)};
+		if (!info)
+			return std::nullopt;
+
+		auto handle{openers[static_cast<std::size_t>(info->format)](image)};
+		/* The backend exists but didn't like what it was given */
+		if (std::holds_alternative<std::monostate>(handle) && openers[static_cast<std::size_t>(info->format)] != open_unparsed)
+			return std::nullopt;
+		return image_t{*info, image, std::move(handle)};
+	}
+}
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* format.hh - Object format detection and dispatch */
+#pragma once
+#if !defined(libalfheim_format_hh)
+#define libalfheim_format_hh
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include <libalfheim/config.hh>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/mmap.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/aout.hh>
+#include <libalfheim/archive.hh>
+#include <libalfheim/coff.hh>
+#include <libalfheim/ecoff.hh>
+#include <libalfheim/elf.hh>
+#include <libalfheim/macho.hh>
+#include <libalfheim/macho/dyld_cache.hh>
+#include <libalfheim/pe32.hh>
+#include <libalfheim/xcoff.hh>
+
+namespace Alfheim {
+	using Alfheim::Config::endian_t;
+	using Internal::byte_span_t;
+
+	enum struct format_t : std::uint8_t {
+		unknown    = 0x00U,
+		aout       = 0x01U,
+		coff       = 0x02U,
+		ecoff      = 0x03U,
+		elf        = 0x04U,
+		macho      = 0x05U,
+		/* A Mach-O universal binary holding one or more slices */
+		fat        = 0x06U,
+		os360      = 0x07U,
+		pe32       = 0x08U,
+		xcoff      = 0x09U,
+		/* A Unix ar(1) archive */
+		archive    = 0x0AU,
+		/* A dyld shared cache of Mach-O dylibs */
+		dyld_cache = 0x0BU,
+	};
+
+	[[nodiscard]]
+	constexpr std::string_view format_name(const format_t format) noexcept {
+		switch (format) {
+			case format_t::aout:       return "a.out"sv;
+			case format_t::coff:       return "COFF"sv;
+			case format_t::ecoff:      return "ECOFF"sv;
+			case format_t::elf:        return "ELF"sv;
+			case format_t::macho:      return "Mach-O"sv;
+			case format_t::fat:        return "Mach-O universal"sv;
+			case format_t::os360:      return "OS/360"sv;
+			case format_t::pe32:       return "PE32"sv;
+			case format_t::xcoff:      return "XCOFF"sv;
+			case format_t::archive:    return "ar archive"sv;
+			case format_t::dyld_cache: return "dyld shared cache"sv;
+			case format_t::unknown:    break;
+		}
+		return "unknown"sv;
+	}
+
+	/* What identify() could tell from the magic alone */
+	struct format_info_t final {
+		format_t format;
+		endian_t endian;
+		/* 32 or 64, or 0 where the format has no fixed width, such as archives */
+		std::uint8_t bits;
+	};
+
+	/*
+		Classifies an image by its magic bytes
+
+		Every supported magic lives in a single table, and the first byte of the image picks
+		out the few entries it could match, so this is a handful of compares rather than a
+		scan of the whole table or a series of parse attempts. Formats with weak magic
+		numbers, such as COFF and a.out, have their headers sanity checked before they're
+		accepted. Only the header is ever touched, which for a mapped file means the first page.
+	*/
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<format_info_t> identify(byte_span_t image) noexcept;
+
+	/* A parsed image, the alternative is std::monostate for formats that are identified but not yet parsed */
+	using handle_t = std::variant<
+		std::monostate, ELF::elf_any_t, MachO::macho_any_t, MachO::fat_t, MachO::dyld_cache_t, PE32::pe_any_t,
+		COFF::coff_any_t, Archive::archive_t, XCOFF::xcoff_any_t, ECOFF::ecoff_any_t, aout::aout_any_t
+	>;
+
+	struct image_t final {
+		format_info_t info;
+		/* The whole image, this is not owned */
+		byte_span_t data;
+		handle_t handle;
+
+		[[nodiscard]]
+		format_t format() const noexcept { return info.format; }
+		[[nodiscard]]
+		bool parsed() const noexcept { return !std::holds_alternative<std::monostate>(handle); }
+
+		template<typename T>
+		[[nodiscard]]
+		const T* as() const noexcept { return std::get_if<T>(&handle); }
+	};
+
+	/*
+		Identifies an image and hands it to the matching backend
+
+		Returns nullopt only if the format isn't recognised, or the backend rejected it. The
+		image must outlive the returned handle, as everything in it is a view into the image.
+	*/
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<image_t> open(byte_span_t image) noexcept;
+
+	[[nodiscard]]
+	inline std::optional<image_t> open(const Internal::mmap_t& map) noexcept {
+		return open(map.view());
+	}
+}
+
+#endif /* libalfheim_format_hh */
@@ -137,6 +137,24 @@ namespace Alfheim::Internal {
 		return (x >> k) | (x << (bits - k));
 	}
 
+	template<typename T>
+	[[nodiscard]]
+	inline constexpr typename std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T>, std::size_t>
+	countr_zero(const T x) noexcept {
+		if (!x)
+			return std::numeric_limits<T>::digits;
+	#if defined(__GNUC__)
+		if constexpr (sizeof(T) <= sizeof(unsigned int))
+			return std::size_t(__builtin_ctz(x));
+		else
+			return std::size_t(__builtin_ctzll(x));
+	#else
+		std::size_t count{};
+		for (T v{x}; !(v & T{1U}); v >>= 1U)
+			++count;
+		return count;
+	#endif
+	}
 
 	template<std::size_t _lsb, std::size_t _msb>
 	struct bitspan_t final {
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* internal/endian.cc - Bulk byte-swapping kernels */
+
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(_MSC_VER)
+#	include <immintrin.h>
+#	define LIBALFHEIM_BSWAP_X86 1
+#endif
+
+#include <libalfheim/internal/endian.hh>
+
+namespace Alfheim::Internal {
+	namespace {
+		template<typename T>
+		void bswap_scalar(const std::uint8_t* src, std::uint8_t* dst, std::size_t count) noexcept {
+			for (; count; --count, src += sizeof(T), dst += sizeof(T)) {
+				T value{};
+				std::memcpy(&value, src, sizeof(T));
+				value = bswap(value);
+				std::memcpy(dst, &value, sizeof(T));
+			}
+		}
+
+		void bswap_scalar(const std::uint8_t* const src, std::uint8_t* const dst, const std::size_t count,
+			const std::size_t width) noexcept {
+			if (width == 2U)
+				bswap_scalar<std::uint16_t>(src, dst, count);
+			else if (width == 4U)
+				bswap_scalar<std::uint32_t>(src, dst, count);
+			else if (width == 8U)
+				bswap_scalar<std::uint64_t>(src, dst, count);
+		}
+
+	#if defined(LIBALFHEIM_BSWAP_X86)
+		/* pshufb control bytes reversing each 2, 4, or 8 byte lane of a 16 byte block */
+		alignas(16) constexpr std::uint8_t shuffle_masks[3][16]{
+			{1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+			{3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+			{7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8},
+		};
+
+		[[nodiscard]]
+		const std::uint8_t* shuffle_mask(const std::size_t width) noexcept {
+			return shuffle_masks[width == 2U ? 0 : width == 4U ? 1 : 2];
+		}
+
+		/* The unaligned load/store intrinsics still take vector pointers, go via void to say that's intended */
+		template<typename V>
+		[[nodiscard]]
+		const V* vector_ptr(const std::uint8_t* const ptr) noexcept { return static_cast<const V*>(static_cast<const void*>(ptr)); }
+		template<typename V>
+		[[nodiscard]]
+		V* vector_ptr(std::uint8_t* const ptr) noexcept { return static_cast<V*>(static_cast<void*>(ptr)); }
+
+		/* Both kernels return how many bytes they processed, the tail is left for the scalar loop */
+		__attribute__((target("ssse3")))
+		std::size_t bswap_ssse3(const std::uint8_t* const src, std::uint8_t* const dst, const std::size_t len,
+			const std::size_t width) noexcept {
+			const auto mask{_mm_load_si128(vector_ptr<__m128i>(shuffle_mask(width)))};
+			std::size_t offset{0};
+			for (; offset + 16U <= len; offset += 16U) {
+				const auto block{_mm_loadu_si128(vector_ptr<__m128i>(src + offset))};
+				_mm_storeu_si128(vector_ptr<__m128i>(dst + offset), _mm_shuffle_epi8(block, mask));
+			}
+			return offset;
+		}
+
+		__attribute__((target("avx2")))
+		std::size_t bswap_avx2(const std::uint8_t* const src, std::uint8_t* const dst, const std::size_t len,
+			const std::size_t width) noexcept {
+			/* vpshufb works within each 128-bit lane, so the same mask is used for both */
+			const auto mask{_mm256_broadcastsi128_si256(_mm_load_si128(vector_ptr<__m128i>(shuffle_mask(width))))};
+			std::size_t offset{0};
+			/* Two blocks per iteration keeps both load ports busy */
+			for (; offset + 64U <= len; offset += 64U) {
+				const auto lo{_mm256_loadu_si256(vector_ptr<__m256i>(src + offset))};
+				const auto hi{_mm256_loadu_si256(vector_ptr<__m256i>(src + offset + 32U))};
+				_mm256_storeu_si256(vector_ptr<__m256i>(dst + offset), _mm256_shuffle_epi8(lo, mask));
+				_mm256_storeu_si256(vector_ptr<__m256i>(dst + offset + 32U), _mm256_shuffle_epi8(hi, mask));
+			}
+			for (; offset + 32U <= len; offset += 32U) {
+				const auto block{_mm256_loadu_si256(vector_ptr<__m256i>(src + offset))};
+				_mm256_storeu_si256(vector_ptr<__m256i>(dst + offset), _mm256_shuffle_epi8(block, mask));
+			}
+			return offset;
+		}
+
+		using kernel_t = std::size_t (*)(const std::uint8_t*, std::uint8_t*, std::size_t, std::size_t) noexcept;
+
+		[[nodiscard]]
+		kernel_t select_kernel() noexcept {
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2"))
+				return bswap_avx2;
+			if (__builtin_cpu_supports("ssse3"))
+				return bswap_ssse3;
+			return nullptr;
+		}
+	#endif
+	}
+
+	void bswap_copy(const void* const src, void* const dst, const std::size_t count, const std::size_t width) noexcept {
+		if (width != 2U && width != 4U && width != 8U)
+			return;
+		const auto* input{static_cast<const std::uint8_t*>(src)};
+		auto* output{static_cast<std::uint8_t*>(dst)};
+		auto remaining{count};
+
+	#if defined(LIBALFHEIM_BSWAP_X86)
+		static const kernel_t kernel{select_kernel()};
+		if (kernel) {
+			/* Every kernel step is a multiple of 16 bytes, so it always ends on an element boundary */
+			const auto done{kernel(input, output, count * width, width)};
+			input += done;
+			output += done;
+			remaining -= done / width;
+		}
+	#endif
+		bswap_scalar(input, output, remaining, width);
+	}
+}
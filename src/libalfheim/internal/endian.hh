@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* internal/endian.hh - Endian-tagged on-disk integer types and views */
+#pragma once
+#if !defined(libalfheim_internal_endian_hh)
+#define libalfheim_internal_endian_hh
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <array>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#include <libalfheim/config.hh>
+
+#include <libalfheim/internal/bits.hh>
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/span.hh>
+#include <libalfheim/internal/utility.hh>
+
+namespace Alfheim::Internal {
+	using Alfheim::Config::endian_t;
+
+	[[nodiscard]]
+	inline constexpr endian_t host_endian() noexcept {
+		return is_le() ? endian_t::little : endian_t::big;
+	}
+
+	template<typename T>
+	[[nodiscard]]
+	inline constexpr std::enable_if_t<std::is_integral_v<T>, T> bswap(const T value) noexcept {
+		using U = std::make_unsigned_t<T>;
+		if constexpr (sizeof(T) == 1)
+			return value;
+		else if constexpr (sizeof(T) == 2)
+			return static_cast<T>(swap16(static_cast<U>(value)));
+		else if constexpr (sizeof(T) == 4)
+			return static_cast<T>(swap32(static_cast<U>(value)));
+		else
+			return static_cast<T>(swap64(static_cast<U>(value)));
+	}
+
+	/* Converts a value between the host byte order and E, this is its own inverse */
+	template<endian_t E, typename T>
+	[[nodiscard]]
+	inline constexpr std::enable_if_t<std::is_integral_v<T>, T> to_endian(const T value) noexcept {
+		if constexpr (E == host_endian())
+			return value;
+		else
+			return bswap(value);
+	}
+
+	/*
+		An integer stored in the given byte order
+
+		The storage is a plain byte array so the type has an alignment of 1, which means
+		on-disk structures built from these have no padding and can be overlaid on
+		arbitrary offsets in a mapping. The conversion happens on access, so a field
+		that is never read is never swapped.
+	*/
+	template<typename T, endian_t E>
+	struct endian_value_t final {
+		static_assert(std::is_integral_v<T> || std::is_enum_v<T>, "endian_value_t must wrap an integral or enum type");
+
+		using value_type = T;
+		static constexpr endian_t endian{E};
+	private:
+		template<typename V, bool = std::is_enum_v<V>>
+		struct storage { using type = std::underlying_type_t<V>; };
+		template<typename V>
+		struct storage<V, false> { using type = V; };
+		using storage_t = typename storage<T>::type;
+
+		std::array<std::uint8_t, sizeof(T)> _raw;
+	public:
+		[[nodiscard]]
+		T value() const noexcept {
+			storage_t res{};
+			std::memcpy(&res, _raw.data(), sizeof(T));
+			return static_cast<T>(to_endian<E>(res));
+		}
+
+		void value(const T val) noexcept {
+			const auto res{to_endian<E>(static_cast<storage_t>(val))};
+			std::memcpy(_raw.data(), &res, sizeof(T));
+		}
+
+		[[nodiscard]]
+		operator T() const noexcept { return value(); }
+
+		endian_value_t& operator=(const T val) noexcept {
+			value(val);
+			return *this;
+		}
+
+		[[nodiscard]]
+		const std::array<std::uint8_t, sizeof(T)>& raw() const noexcept { return _raw; }
+	};
+
+	template<typename T>
+	using le_t = endian_value_t<T, endian_t::little>;
+	template<typename T>
+	using be_t = endian_value_t<T, endian_t::big>;
+
+	/*
+		Copies count values, each width bytes wide, from src to dst reversing the byte order of each
+
+		width must be 2, 4, or 8. Neither pointer needs to be aligned, and src and dst may be
+		the same to swap in place, but must not otherwise overlap. On x86 this uses AVX2 or
+		SSSE3 shuffles when the CPU has them.
+	*/
+	LIBALFHEIM_API void bswap_copy(const void* src, void* dst, std::size_t count, std::size_t width) noexcept;
+
+	/*
+		A read-only view of a table of integers stored in the byte order E
+
+		Individual elements are converted as they're read, while copy() converts the whole
+		table into host order in one vectorized pass, which is the better choice whenever
+		most of an opposite-endian table is going to be used.
+	*/
+	template<typename T, endian_t E>
+	struct endian_span_t final {
+		static_assert(std::is_integral_v<T> || std::is_enum_v<T>, "endian_span_t must view an integral or enum type");
+		static_assert(sizeof(T) <= 8, "endian_span_t elements must be at most 8 bytes");
+
+		using value_type = T;
+		static constexpr endian_t endian{E};
+	private:
+		byte_span_t _data{};
+	public:
+		constexpr endian_span_t() noexcept = default;
+		/* Any trailing partial element is ignored */
+		constexpr endian_span_t(const byte_span_t data) noexcept :
+			_data{data.first(data.size() - (data.size() % sizeof(T)))} { /* NOP */ }
+
+		struct iterator final {
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = T;
+			using iterator_category = std::forward_iterator_tag;
+		private:
+			const std::uint8_t* _ptr;
+		public:
+			constexpr iterator(const std::uint8_t* const ptr) noexcept : _ptr{ptr} { /* NOP */ }
+			[[nodiscard]]
+			T operator*() const noexcept { return reinterpret_cast<const endian_value_t<T, E>*>(_ptr)->value(); }
+			iterator& operator++() noexcept {
+				_ptr += sizeof(T);
+				return *this;
+			}
+			iterator operator++(int) noexcept {
+				const auto res{*this};
+				_ptr += sizeof(T);
+				return res;
+			}
+			[[nodiscard]]
+			bool operator==(const iterator& other) const noexcept { return _ptr == other._ptr; }
+			[[nodiscard]]
+			bool operator!=(const iterator& other) const noexcept { return _ptr != other._ptr; }
+		};
+
+		[[nodiscard]]
+		constexpr std::size_t size() const noexcept { return _data.size() / sizeof(T); }
+		[[nodiscard]]
+		constexpr std::size_t size_bytes() const noexcept { return _data.size(); }
+		[[nodiscard]]
+		constexpr bool empty() const noexcept { return _data.empty(); }
+		/* The underlying bytes, as they are on disk */
+		[[nodiscard]]
+		constexpr byte_span_t raw() const noexcept { return _data; }
+
+		[[nodiscard]]
+		iterator begin() const noexcept { return {_data.begin()}; }
+		[[nodiscard]]
+		iterator end() const noexcept { return {_data.end()}; }
+
+		/* Unchecked */
+		[[nodiscard]]
+		T operator[](const std::size_t idx) const noexcept {
+			return reinterpret_cast<const endian_value_t<T, E>*>(_data.data() + (idx * sizeof(T)))->value();
+		}
+
+		[[nodiscard]]
+		std::optional<T> at(const std::size_t idx) const noexcept {
+			if (idx >= size())
+				return std::nullopt;
+			return (*this)[idx];
+		}
+
+		[[nodiscard]]
+		endian_span_t subspan(const std::size_t offset, const std::size_t count) const noexcept {
+			if (offset > size() || count > size() - offset)
+				return {};
+			return {_data.subspan(offset * sizeof(T), count * sizeof(T))};
+		}
+
+		/* Converts every element into host order in out, which must be at least size() long */
+		[[nodiscard]]
+		bool copy(const span_t<T> out) const noexcept {
+			if (out.size() < size())
+				return false;
+			if (empty())
+				return true;
+			if constexpr (E == host_endian() || sizeof(T) == 1)
+				std::memcpy(out.data(), _data.data(), _data.size());
+			else
+				bswap_copy(_data.data(), out.data(), size(), sizeof(T));
+			return true;
+		}
+
+		[[nodiscard]]
+		std::vector<T> to_vector() const {
+			std::vector<T> res(size());
+			[[maybe_unused]]
+			const auto _ = copy(res);
+			return res;
+		}
+	};
+
+	template<typename T>
+	using le_span_t = endian_span_t<T, endian_t::little>;
+	template<typename T>
+	using be_span_t = endian_span_t<T, endian_t::big>;
+}
+
+#endif /* libalfheim_internal_endian_hh */
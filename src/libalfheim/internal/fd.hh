@@ -62,6 +62,21 @@ namespace Alfheim::Internal {
 		inline std::int32_t fdtruncate(const std::int32_t fd, const Types::off_t size) noexcept {
 			return _chsize_s(fd, size);
 		}
+
+		/* There is no positional I/O on Windows CRT descriptors so this moves the file position */
+		[[nodiscard]]
+		inline Types::ssize_t fdpread(const std::int32_t fd, void* const buff, const std::size_t len, const Types::off_t offset) noexcept {
+			if (fdseek(fd, offset, SEEK_SET) != offset)
+				return -1;
+			return fdread(fd, buff, len);
+		}
+
+		[[nodiscard]]
+		inline Types::ssize_t fdpwrite(const std::int32_t fd, const void* const buff, const std::size_t len, const Types::off_t offset) noexcept {
+			if (fdseek(fd, offset, SEEK_SET) != offset)
+				return -1;
+			return fdwrite(fd, buff, len);
+		}
 	#else
 		using ::fstat;
 
@@ -89,6 +104,16 @@ namespace Alfheim::Internal {
 		inline std::int32_t fdtruncate(const std::int32_t fd, const Types::off_t size) noexcept {
 			return ::ftruncate(fd, size);
 		}
+
+		[[nodiscard]]
+		inline Types::ssize_t fdpread(const std::int32_t fd, void* const buff, const std::size_t len, const Types::off_t offset) noexcept {
+			return ::pread(fd, buff, len, offset);
+		}
+
+		[[nodiscard]]
+		inline Types::ssize_t fdpwrite(const std::int32_t fd, const void* const buff, const std::size_t len, const Types::off_t offset) noexcept {
+			return ::pwrite(fd, buff, len, offset);
+		}
 	#endif
 	}
 
@@ -230,6 +255,33 @@ namespace Alfheim::Internal {
 			return std::size_t(res) == len;
 		}
 
+		/* Positional reads and writes, these neither use nor move the file position */
+		[[nodiscard]]
+		bool read_at(void* const buff, const std::size_t len, const Types::off_t offset) const noexcept {
+			auto* const data{static_cast<std::uint8_t*>(buff)};
+			std::size_t done{0};
+			while (done < len) {
+				const auto res = fdpread(_fd, data + done, len - done, offset + Types::off_t(done));
+				if (res <= 0)
+					return false;
+				done += std::size_t(res);
+			}
+			return true;
+		}
+
+		[[nodiscard]]
+		bool write_at(const void* const buff, const std::size_t len, const Types::off_t offset) const noexcept {
+			const auto* const data{static_cast<const std::uint8_t*>(buff)};
+			std::size_t done{0};
+			while (done < len) {
+				const auto res = fdpwrite(_fd, data + done, len - done, offset + Types::off_t(done));
+				if (res <= 0)
+					return false;
+				done += std::size_t(res);
+			}
+			return true;
+		}
+
 		template<typename T>
 		[[nodiscard]]
 		bool read(T& val) noexcept {
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* internal/leb128.cc - Bulk LEB128 decoding */
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(_MSC_VER)
+#	include <immintrin.h>
+#	define LIBALFHEIM_LEB128_X86 1
+#endif
+
+#include <libalfheim/internal/bits.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/leb128.hh>
+
+namespace Alfheim::Internal {
+	namespace {
+		struct decode_state_t final {
+			const std::uint8_t* src;
+			const std::uint8_t* end;
+			std::uint64_t* dst;
+			std::uint64_t* dst_end;
+		};
+
+		[[nodiscard]]
+		inline std::uint64_t load64(const std::uint8_t* const ptr) noexcept {
+			std::uint64_t value{};
+			std::memcpy(&value, ptr, sizeof(value));
+			return to_endian<endian_t::little>(value);
+		}
+
+		/* Packs the 7-bit groups of an encoding of at most 8 bytes together, without branching */
+		[[nodiscard]]
+		inline std::uint64_t decode_short(const std::uint8_t* const ptr, const std::size_t len) noexcept {
+			const auto keep{len == 8U ? ~std::uint64_t{} : (std::uint64_t{1U} << (len * 8U)) - 1U};
+			auto value{load64(ptr) & keep & 0x7F7F7F7F7F7F7F7FU};
+			value = (value & 0x007F007F007F007FU) | ((value & 0x7F007F007F007F00U) >> 1U);
+			value = (value & 0x00003FFF00003FFFU) | ((value & 0x3FFF00003FFF0000U) >> 2U);
+			value = (value & 0x000000000FFFFFFFU) | ((value & 0x0FFFFFFF00000000U) >> 4U);
+			return value;
+		}
+
+		/* Gathers the continuation bits of 16 bytes into a mask, one bit per byte */
+		[[nodiscard]]
+		inline std::uint32_t continuation_mask(const std::uint8_t* const ptr) noexcept {
+		#if defined(__SSE2__)
+			return std::uint32_t(_mm_movemask_epi8(_mm_loadu_si128(static_cast<const __m128i*>(static_cast<const void*>(ptr)))));
+		#else
+			const auto gather = [](const std::uint64_t word) noexcept {
+				return std::uint32_t(((word & 0x8080808080808080U) * 0x0002040810204081U) >> 56U);
+			};
+			return gather(load64(ptr)) | (gather(load64(ptr + 8U)) << 8U);
+		#endif
+		}
+
+		/*
+			Decodes every value that ends within the 16 byte block at state.src
+
+			cont is the continuation mask of the block, and at least 24 bytes must be readable
+			from the block start, as the short decode loads a whole word from each value.
+		*/
+		[[nodiscard]]
+		bool decode_block(decode_state_t& state, const std::uint32_t cont) noexcept {
+			/* The common case of a run of values under 128 */
+			if (!cont) {
+				const auto count{std::min<std::size_t>(16U, std::size_t(state.dst_end - state.dst))};
+				for (std::size_t idx{}; idx < count; ++idx)
+					state.dst[idx] = state.src[idx];
+				state.dst += count;
+				state.src += count;
+				return true;
+			}
+
+			auto terminators{~cont & 0xFFFFU};
+			std::size_t start{};
+			while (terminators && state.dst != state.dst_end) {
+				const auto stop{std::size_t(countr_zero(terminators))};
+				const auto len{stop - start + 1U};
+				if (len > 8U)
+					break;
+				*state.dst++ = decode_short(state.src + start, len);
+				start = stop + 1U;
+				terminators &= terminators - 1U;
+			}
+
+			if (start) {
+				state.src += start;
+				return true;
+			}
+			/* The first value is too long for the short path, or runs past the block */
+			auto* ptr{state.src};
+			std::uint64_t value{};
+			if (!uleb128_decode(ptr, state.end, value))
+				return false;
+			*state.dst++ = value;
+			state.src = ptr;
+			return true;
+		}
+
+		[[nodiscard]]
+		bool decode_tail(decode_state_t& state) noexcept {
+			while (state.dst != state.dst_end && state.src != state.end) {
+				auto* ptr{state.src};
+				if (!uleb128_decode(ptr, state.end, *state.dst))
+					return false;
+				++state.dst;
+				state.src = ptr;
+			}
+			return true;
+		}
+
+		void decode_generic(decode_state_t& state) noexcept {
+			while (state.dst != state.dst_end && state.end - state.src >= 24) {
+				if (!decode_block(state, continuation_mask(state.src)))
+					return;
+			}
+			[[maybe_unused]]
+			const auto _ = decode_tail(state);
+		}
+
+	#if defined(LIBALFHEIM_LEB128_X86)
+		__attribute__((target("avx2")))
+		void decode_avx2(decode_state_t& state) noexcept {
+			while (state.dst != state.dst_end && state.end - state.src >= 32) {
+				const auto block{_mm256_loadu_si256(static_cast<const __m256i*>(static_cast<const void*>(state.src)))};
+				const auto cont{std::uint32_t(_mm256_movemask_epi8(block))};
+				/* 32 single byte values at once, widened 4 at a time */
+				if (!cont && state.dst_end - state.dst >= 32) {
+					const auto lo{_mm256_castsi256_si128(block)};
+					const auto hi{_mm256_extracti128_si256(block, 1)};
+					auto* const dst{static_cast<__m256i*>(static_cast<void*>(state.dst))};
+					_mm256_storeu_si256(dst + 0, _mm256_cvtepu8_epi64(lo));
+					_mm256_storeu_si256(dst + 1, _mm256_cvtepu8_epi64(_mm_srli_si128(lo, 4)));
+					_mm256_storeu_si256(dst + 2, _mm256_cvtepu8_epi64(_mm_srli_si128(lo, 8)));
+					_mm256_storeu_si256(dst + 3, _mm256_cvtepu8_epi64(_mm_srli_si128(lo, 12)));
+					_mm256_storeu_si256(dst + 4, _mm256_cvtepu8_epi64(hi));
+					_mm256_storeu_si256(dst + 5, _mm256_cvtepu8_epi64(_mm_srli_si128(hi, 4)));
+					_mm256_storeu_si256(dst + 6, _mm256_cvtepu8_epi64(_mm_srli_si128(hi, 8)));
+					_mm256_storeu_si256(dst + 7, _mm256_cvtepu8_epi64(_mm_srli_si128(hi, 12)));
+					state.dst += 32;
+					state.src += 32;
+					continue;
+				}
+				if (!decode_block(state, cont & 0xFFFFU))
+					return;
+			}
+			decode_generic(state);
+		}
+
+		using decoder_t = void (*)(decode_state_t&) noexcept;
+
+		[[nodiscard]]
+		decoder_t select_decoder() noexcept {
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2"))
+				return decode_avx2;
+			return decode_generic;
+		}
+	#endif
+	}
+
+	std::size_t uleb128_decode(const byte_span_t input, const span_t<std::uint64_t> out, std::size_t& consumed) noexcept {
+		decode_state_t state{input.data(), input.end(), out.data(), out.end()};
+	#if defined(LIBALFHEIM_LEB128_X86)
+		static const decoder_t decoder{select_decoder()};
+		decoder(state);
+	#else
+		decode_generic(state);
+	#endif
+		consumed = std::size_t(state.src - input.data());
+		return std::size_t(state.dst - out.data());
+	}
+}
@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* internal/leb128.hh - Streaming LEB128 decoding and encoding */
+#pragma once
+#if !defined(libalfheim_internal_leb128_hh)
+#define libalfheim_internal_leb128_hh
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/span.hh>
+
+namespace Alfheim::Internal {
+	/* The longest encoding of a 64-bit value */
+	constexpr std::size_t leb128_max_size{10U};
+
+	/*
+		Decodes the ULEB128 at ptr, advancing it past the encoding
+
+		Fails on truncated input and on values that don't fit in a T. Padded encodings,
+		with redundant trailing 0x80 bytes, are accepted as long as the padding is zero.
+	*/
+	template<typename T>
+	[[nodiscard]]
+	std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T>, bool>
+	uleb128_decode(const std::uint8_t*& ptr, const std::uint8_t* const end, T& value) noexcept {
+		constexpr std::size_t bits{std::numeric_limits<T>::digits};
+		T result{};
+		std::size_t shift{};
+		for (auto* cur{ptr}; cur < end; shift += 7U) {
+			const auto byte{*cur++};
+			const T slice{static_cast<T>(byte & 0x7FU)};
+			if (shift >= bits) {
+				if (slice)
+					return false;
+			} else {
+				if (static_cast<T>(slice << shift) >> shift != slice)
+					return false;
+				result |= static_cast<T>(slice << shift);
+			}
+			if (!(byte & 0x80U)) {
+				ptr = cur;
+				value = result;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* As above, for SLEB128, the top bit of the final byte is sign extended */
+	template<typename T>
+	[[nodiscard]]
+	std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>, bool>
+	sleb128_decode(const std::uint8_t*& ptr, const std::uint8_t* const end, T& value) noexcept {
+		using U = std::make_unsigned_t<T>;
+		constexpr std::size_t bits{std::numeric_limits<U>::digits};
+		U result{};
+		std::size_t shift{};
+		std::uint8_t byte{};
+		auto* cur{ptr};
+		do {
+			if (cur == end)
+				return false;
+			byte = *cur++;
+			const auto slice{static_cast<std::uint8_t>(byte & 0x7FU)};
+			if (shift < bits) {
+				result |= static_cast<U>(U{slice} << shift);
+				/* Where a group straddles the top of T, the bits past it must all match the sign */
+				if (shift + 7U > bits) {
+					const auto kept{bits - shift};
+					const bool negative{((slice >> (kept - 1U)) & 1U) != 0U};
+					if ((slice >> kept) != (negative ? (0x7FU >> kept) : 0U))
+						return false;
+				}
+			} else if (slice != ((result >> (bits - 1U)) ? 0x7FU : 0U))
+				return false;
+			shift += 7U;
+		} while (byte & 0x80U);
+
+		if (shift < bits && (byte & 0x40U))
+			result |= static_cast<U>(~U{} << shift);
+		ptr = cur;
+		value = static_cast<T>(result);
+		return true;
+	}
+
+	/* The number of bytes needed to encode value */
+	template<typename T>
+	[[nodiscard]]
+	constexpr std::enable_if_t<std::is_integral_v<T>, std::size_t> leb128_size(const T value) noexcept {
+		std::size_t len{1U};
+		if constexpr (std::is_unsigned_v<T>) {
+			for (auto num{value}; num >>= 7U; )
+				++len;
+		} else {
+			auto num{static_cast<std::int64_t>(value)};
+			while (!((num >> 6) == 0 || (num >> 6) == -1)) {
+				num >>= 7;
+				++len;
+			}
+		}
+		return len;
+	}
+
+	/*
+		Encodes value into out, returning the number of bytes written
+
+		out must have room for at least leb128_size(value) bytes, or leb128_max_size bytes.
+		Unsigned types are encoded as ULEB128 and signed types as SLEB128.
+	*/
+	template<typename T>
+	std::enable_if_t<std::is_integral_v<T>, std::size_t> leb128_encode(const T value, std::uint8_t* const out) noexcept {
+		std::size_t len{};
+		if constexpr (std::is_unsigned_v<T>) {
+			auto num{static_cast<std::uint64_t>(value)};
+			while (num >= 0x80U) {
+				out[len++] = static_cast<std::uint8_t>(num | 0x80U);
+				num >>= 7U;
+			}
+			out[len++] = static_cast<std::uint8_t>(num);
+		} else {
+			auto num{static_cast<std::int64_t>(value)};
+			while (!((num >> 6) == 0 || (num >> 6) == -1)) {
+				out[len++] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(num) | 0x80U);
+				num >>= 7;
+			}
+			out[len++] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(num) & 0x7FU);
+		}
+		return len;
+	}
+
+	/* Encodes value into out, returning the number of bytes written, or 0 if it doesn't fit */
+	template<typename T>
+	[[nodiscard]]
+	std::enable_if_t<std::is_integral_v<T>, std::size_t> leb128_encode(const T value, const span_t<std::uint8_t> out) noexcept {
+		if (out.size() < leb128_size(value))
+			return 0U;
+		return leb128_encode(value, out.data());
+	}
+
+	/* Appends the encoding of value to the end of buff */
+	template<typename T>
+	std::enable_if_t<std::is_integral_v<T>> leb128_append(std::vector<std::uint8_t>& buff, const T value) {
+		const auto offset{buff.size()};
+		buff.resize(offset + leb128_max_size);
+		buff.resize(offset + leb128_encode(value, buff.data() + offset));
+	}
+
+	/*
+		Decodes ULEB128 values from input into out until either is exhausted
+
+		This is the bulk counterpart to leb128_cursor_t::read_uleb(), with a vectorized path
+		for runs of short encodings, which on x86 uses AVX2 where available. Returns the
+		number of values decoded, and sets consumed to the number of input bytes they took.
+		Decoding stops early at the first truncated or overlong value.
+	*/
+	[[nodiscard]]
+	LIBALFHEIM_API std::size_t uleb128_decode(byte_span_t input, span_t<std::uint64_t> out, std::size_t& consumed) noexcept;
+
+	/* A cursor that decodes a sequence of LEB128 values, bytes, and strings from a byte span */
+	struct leb128_cursor_t final {
+	private:
+		byte_span_t _data{};
+		std::size_t _offset{0};
+	public:
+		constexpr leb128_cursor_t() noexcept = default;
+		constexpr leb128_cursor_t(const byte_span_t data, const std::size_t offset = 0U) noexcept :
+			_data{data}, _offset{offset > data.size() ? data.size() : offset} { /* NOP */ }
+
+		[[nodiscard]]
+		constexpr std::size_t offset() const noexcept { return _offset; }
+		[[nodiscard]]
+		constexpr std::size_t remaining() const noexcept { return _data.size() - _offset; }
+		[[nodiscard]]
+		constexpr bool empty() const noexcept { return _offset == _data.size(); }
+		[[nodiscard]]
+		constexpr byte_span_t data() const noexcept { return _data; }
+
+		[[nodiscard]]
+		bool seek(const std::size_t offset) noexcept {
+			if (offset > _data.size())
+				return false;
+			_offset = offset;
+			return true;
+		}
+
+		[[nodiscard]]
+		bool skip(const std::size_t len) noexcept {
+			if (len > remaining())
+				return false;
+			_offset += len;
+			return true;
+		}
+
+		template<typename T = std::uint64_t>
+		[[nodiscard]]
+		std::optional<T> read_uleb() noexcept {
+			const auto* ptr{_data.data() + _offset};
+			T value{};
+			if (!uleb128_decode(ptr, _data.end(), value))
+				return std::nullopt;
+			_offset = std::size_t(ptr - _data.data());
+			return value;
+		}
+
+		template<typename T = std::int64_t>
+		[[nodiscard]]
+		std::optional<T> read_sleb() noexcept {
+			const auto* ptr{_data.data() + _offset};
+			T value{};
+			if (!sleb128_decode(ptr, _data.end(), value))
+				return std::nullopt;
+			_offset = std::size_t(ptr - _data.data());
+			return value;
+		}
+
+		/* Steps over a LEB128 value of either signedness without decoding it */
+		[[nodiscard]]
+		bool skip_leb() noexcept {
+			for (auto idx{_offset}; idx < _data.size(); ++idx) {
+				if (!(_data[idx] & 0x80U)) {
+					_offset = idx + 1U;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/* Decodes as many ULEB128 values as fit in out, returning how many were read */
+		[[nodiscard]]
+		std::size_t read_ulebs(const span_t<std::uint64_t> out) noexcept {
+			std::size_t consumed{};
+			const auto count{uleb128_decode(_data.subspan(_offset), out, consumed)};
+			_offset += consumed;
+			return count;
+		}
+
+		[[nodiscard]]
+		std::optional<std::uint8_t> read_byte() noexcept {
+			if (empty())
+				return std::nullopt;
+			return _data[_offset++];
+		}
+
+		/* Reads a NUL terminated string, leaving the cursor after the terminator */
+		[[nodiscard]]
+		std::optional<std::string_view> read_string() noexcept {
+			const auto str{_data.string(_offset)};
+			if (_offset + str.size() >= _data.size() || _data[_offset + str.size()] != 0U)
+				return std::nullopt;
+			_offset += str.size() + 1U;
+			return str;
+		}
+	};
+}
+
+#endif /* libalfheim_internal_leb128_hh */
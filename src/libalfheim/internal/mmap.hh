@@ -28,10 +28,13 @@
 #include <cstdint>
 #include <stdexcept>
 #include <cstring>
+#include <limits>
 
 #include <libalfheim/config.hh>
 
 #include <libalfheim/internal/bits.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/span.hh>
 #include <libalfheim/internal/utility.hh>
 
 
@@ -62,39 +65,25 @@ namespace Alfheim::Internal {
 		}()}, _fd{-1} { /* NOP */ }
 	#endif
 
+		/* Reinterprets the idx'th T in the mapping, this never writes to the mapped memory */
 		template<typename T>
 		[[nodiscard]]
-		std::enable_if_t<
-			std::is_pod_v<T> && !has_nullable_ctor_v<T> && !std::is_same_v<T, void*>,
-		T*>
+		std::enable_if_t<std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>, T*>
 		index(const std::size_t idx) const {
-			if (idx < _len) {
+			if (_addr && idx < _len / sizeof(T)) {
 				const auto addr = reinterpret_cast<std::uintptr_t>(_addr);
-				return new (reinterpret_cast<void*>(addr + (idx * sizeof(T)))) T{};
+				return reinterpret_cast<T*>(addr + (idx * sizeof(T)));
 			}
 			throw std::out_of_range("mmap_t index out of range");
 		}
 
 		template<typename T>
 		[[nodiscard]]
-		std::enable_if_t<
-			has_nullable_ctor_v<T> && !std::is_same_v<T, void*>,
-		T*>
+		std::enable_if_t<std::is_pointer_v<T> && std::is_void_v<std::remove_pointer_t<T>>, T>
 		index(const std::size_t idx) const {
 			if (idx < _len) {
 				const auto addr = reinterpret_cast<std::uintptr_t>(_addr);
-				return new (reinterpret_cast<void*>(addr + (idx * sizeof(T)))) T{nullptr};
-			}
-			throw std::out_of_range("mmap_t index out of range");
-		}
-
-		template<typename T>
-		[[nodiscard]]
-		std::enable_if_t<std::is_same_v<T, void*>, void*>
-		index(const std::size_t idx) const {
-			if (idx < _len) {
-				const auto addr = reinterpret_cast<std::uintptr_t>(_addr);
-				return reinterpret_cast<void*>(addr + idx );
+				return reinterpret_cast<T>(addr + idx );
 			}
 			throw std::out_of_range("mmap_t index out of range");
 		}
@@ -203,6 +192,38 @@ namespace Alfheim::Internal {
 		[[nodiscard]]
 		const T* at(const std::size_t idx) const { return index<const T>(idx); }
 
+		/* Returns a read-only byte view over the whole mapping */
+		[[nodiscard]]
+		byte_span_t view() const noexcept {
+			if (!_addr)
+				return {};
+			return {static_cast<const std::uint8_t*>(_addr), _len};
+		}
+
+		[[nodiscard]]
+		byte_span_t view(const std::size_t offset, const std::size_t len) const noexcept {
+			return view().subspan(offset, len);
+		}
+
+		/* Reinterprets count on-disk structures at offset, returning an empty span if they don't fit */
+		template<typename T>
+		[[nodiscard]]
+		span_t<const T> array(const std::size_t offset, const std::size_t count) const noexcept {
+			return view().array<T>(offset, count);
+		}
+
+		/* A read-only view of count integers at offset stored in the byte order E */
+		template<typename T, endian_t E>
+		[[nodiscard]]
+		endian_span_t<T, E> view_as(const std::size_t offset, const std::size_t count) const noexcept {
+			if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+				return {};
+			const auto data{view(offset, count * sizeof(T))};
+			if (data.size() != count * sizeof(T))
+				return {};
+			return {data};
+		}
+
 		[[nodiscard]]
 		std::uintptr_t numeric_address() const noexcept {
 			return reinterpret_cast<std::uintptr_t>(_addr);
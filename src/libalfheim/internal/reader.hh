@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* internal/reader.hh - Buffered input stream over fd_t */
+#pragma once
+#if !defined(libalfheim_internal_reader_hh)
+#define libalfheim_internal_reader_hh
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/fd.hh>
+#include <libalfheim/internal/span.hh>
+#include <libalfheim/internal/utility.hh>
+
+namespace Alfheim::Internal {
+	using namespace Alfheim::Internal::Units;
+
+	/*
+		A buffered reader over a file descriptor
+
+		Reads are served from a block sized buffer which is only refilled once it has been
+		consumed, so parsing a header field by field costs one syscall per block rather than
+		one per field. Reads at least as large as the block bypass the buffer entirely.
+
+		Seeking within the bytes currently buffered doesn't touch the descriptor, and on
+		descriptors that can't seek, such as pipes, seeking forwards reads and discards.
+		The descriptor's own file position is owned by the reader while it is in use.
+	*/
+	struct reader_t final {
+	private:
+		fd_t& _fd;
+		std::unique_ptr<std::uint8_t[]> _buffer;
+		std::size_t _block_size;
+		/* The file offset of the first byte in the buffer */
+		Types::off_t _base;
+		/* The read cursor, and how much of the buffer holds data */
+		std::size_t _pos{0};
+		std::size_t _fill{0};
+		bool _seekable;
+		bool _eof{false};
+
+		/* Reads straight from the descriptor until len bytes arrive or the stream ends */
+		[[nodiscard]]
+		std::size_t fetch(std::uint8_t* const buff, const std::size_t len) noexcept {
+			std::size_t done{0};
+			while (done < len && !_eof) {
+				const auto res{_fd.read(buff + done, len - done, nullptr)};
+				if (res <= 0) {
+					_eof = true;
+					break;
+				}
+				done += std::size_t(res);
+			}
+			return done;
+		}
+
+		/* Discards everything before the cursor and tops the buffer up to at least len bytes */
+		[[nodiscard]]
+		bool fill(const std::size_t len) noexcept {
+			if (len > _block_size || !_buffer)
+				return false;
+			const auto remaining{_fill - _pos};
+			if (_pos) {
+				std::memmove(_buffer.get(), _buffer.get() + _pos, remaining);
+				_base += Types::off_t(_pos);
+				_pos = 0;
+				_fill = remaining;
+			}
+
+			while (_fill < len && !_eof) {
+				const auto res{_fd.read(_buffer.get() + _fill, _block_size - _fill, nullptr)};
+				if (res <= 0)
+					_eof = true;
+				else
+					_fill += std::size_t(res);
+			}
+			return _fill >= len;
+		}
+
+		/* Drops the buffer, positioning it at offset */
+		void discard(const Types::off_t offset) noexcept {
+			_base = offset;
+			_pos = 0;
+			_fill = 0;
+		}
+	public:
+		reader_t(fd_t& fd, const std::size_t block_size = 64_KiB) noexcept :
+			_fd{fd}, _buffer{new (std::nothrow) std::uint8_t[std::max<std::size_t>(block_size, 16U)]},
+			_block_size{std::max<std::size_t>(block_size, 16U)}, _base{fd.tell()},
+			_seekable{_base != -1}
+		{
+			if (!_seekable)
+				_base = 0;
+		}
+
+		reader_t(const reader_t&) = delete;
+		reader_t(reader_t&&) = delete;
+		reader_t& operator=(const reader_t&) = delete;
+		reader_t& operator=(reader_t&&) = delete;
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _fd.valid() && _buffer; }
+		[[nodiscard]]
+		bool seekable() const noexcept { return _seekable; }
+		[[nodiscard]]
+		std::size_t block_size() const noexcept { return _block_size; }
+		/* How many bytes can be read without going back to the descriptor */
+		[[nodiscard]]
+		std::size_t buffered() const noexcept { return _fill - _pos; }
+		/* True once the stream has ended and everything buffered has been consumed */
+		[[nodiscard]]
+		bool is_eof() const noexcept { return _eof && _pos == _fill; }
+
+		[[nodiscard]]
+		Types::off_t tell() const noexcept { return _base + Types::off_t(_pos); }
+
+		[[nodiscard]]
+		bool seek(const Types::off_t offset) noexcept {
+			if (offset < 0)
+				return false;
+			/* Still in the buffer, nothing needs to be read */
+			if (offset >= _base && offset <= _base + Types::off_t(_fill)) {
+				_pos = std::size_t(offset - _base);
+				return true;
+			}
+
+			if (_seekable) {
+				if (_fd.seek(offset, SEEK_SET) != offset)
+					return false;
+				_eof = false;
+				discard(offset);
+				return true;
+			}
+
+			/* Can't go backwards on a pipe, but we can read our way forwards */
+			if (offset < _base)
+				return false;
+			auto skip{std::uint64_t(offset - (_base + Types::off_t(_fill)))};
+			_pos = _fill;
+			while (skip) {
+				if (!fill(std::min<std::uint64_t>(skip, _block_size)))
+					return false;
+				_pos = std::size_t(std::min<std::uint64_t>(skip, _fill));
+				skip -= _pos;
+			}
+			return true;
+		}
+
+		[[nodiscard]]
+		bool seek_rel(const Types::off_t offset) noexcept {
+			const auto pos{tell()};
+			if (pos + offset < 0)
+				return false;
+			return seek(pos + offset);
+		}
+
+		/*
+			Returns a view of the next len bytes without consuming them
+
+			The view is only valid until the next call that reads or seeks, and len can't be
+			more than the block size. Returns an empty view if the stream ends first.
+		*/
+		[[nodiscard]]
+		byte_span_t peek(const std::size_t len) noexcept {
+			if (buffered() < len && !fill(len))
+				return {};
+			return {_buffer.get() + _pos, len};
+		}
+
+		/* As peek() but consumes the bytes */
+		[[nodiscard]]
+		byte_span_t take(const std::size_t len) noexcept {
+			const auto data{peek(len)};
+			_pos += data.size();
+			return data;
+		}
+
+		/* Reads up to len bytes, returning how many were read */
+		[[nodiscard]]
+		std::size_t read(void* const buff, const std::size_t len, std::nullptr_t) noexcept {
+			auto* const data{static_cast<std::uint8_t*>(buff)};
+			const auto head{std::min(len, buffered())};
+			std::memcpy(data, _buffer.get() + _pos, head);
+			_pos += head;
+			if (head == len)
+				return len;
+
+			/* The buffer is now empty, large reads go straight to the caller's memory */
+			discard(tell());
+			const auto rest{len - head};
+			if (rest >= _block_size) {
+				const auto res{fetch(data + head, rest)};
+				_base += Types::off_t(res);
+				return head + res;
+			}
+
+			const auto avail{fill(rest) ? rest : _fill};
+			std::memcpy(data + head, _buffer.get(), avail);
+			_pos = avail;
+			return head + avail;
+		}
+
+		[[nodiscard]]
+		bool read(void* const buff, const std::size_t len) noexcept {
+			return read(buff, len, nullptr) == len;
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_trivially_copyable_v<T>, bool> read(T& val) noexcept {
+			/* The common case of a small value that's already buffered */
+			if (buffered() >= sizeof(T)) {
+				std::memcpy(&val, _buffer.get() + _pos, sizeof(T));
+				_pos += sizeof(T);
+				return true;
+			}
+			return read(&val, sizeof(T));
+		}
+
+		template<typename T, std::size_t N>
+		[[nodiscard]]
+		bool read(std::array<T, N>& val) noexcept {
+			return read(val.data(), sizeof(T) * N);
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		bool read(const std::unique_ptr<T[]>& val, const std::size_t len) noexcept {
+			return read(val.get(), sizeof(T) * len);
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool> read_le(T& val) noexcept {
+			if (!read(val))
+				return false;
+			val = to_endian<endian_t::little>(val);
+			return true;
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool> read_be(T& val) noexcept {
+			if (!read(val))
+				return false;
+			val = to_endian<endian_t::big>(val);
+			return true;
+		}
+
+		/* Reads an on-disk value in the given byte order */
+		template<endian_t E, typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool> read_as(T& val) noexcept {
+			if (!read(val))
+				return false;
+			val = to_endian<E>(val);
+			return true;
+		}
+	};
+}
+
+#endif /* libalfheim_internal_reader_hh */
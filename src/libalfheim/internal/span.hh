@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* internal/span.hh - Non-owning views over contiguous memory */
+#pragma once
+#if !defined(libalfheim_internal_span_hh)
+#define libalfheim_internal_span_hh
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <array>
+#include <limits>
+#include <vector>
+#include <string_view>
+
+#include <libalfheim/internal/defs.hh>
+
+namespace Alfheim::Internal {
+	/*
+		A minimal stand-in for C++20's std::span
+
+		All of the bounds-checked accessors return an empty span or a nullptr rather than
+		throwing, as the data being viewed is almost always untrusted file contents.
+	*/
+	template<typename T>
+	struct span_t final {
+		using element_type = T;
+		using value_type = std::remove_cv_t<T>;
+		using size_type = std::size_t;
+		using pointer = T*;
+		using reference = T&;
+		using iterator = T*;
+	private:
+		T* _data{nullptr};
+		std::size_t _len{0};
+	public:
+		constexpr span_t() noexcept = default;
+		constexpr span_t(T* const data, const std::size_t len) noexcept : _data{data}, _len{len} { /* NOP */ }
+		constexpr span_t(T* const begin, T* const end) noexcept :
+			_data{begin}, _len{static_cast<std::size_t>(end - begin)} { /* NOP */ }
+
+		template<std::size_t N>
+		constexpr span_t(T (&arr)[N]) noexcept : _data{arr}, _len{N} { /* NOP */ }
+
+		template<typename U, std::size_t N, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+		constexpr span_t(std::array<U, N>& arr) noexcept : _data{arr.data()}, _len{N} { /* NOP */ }
+
+		template<typename U, std::size_t N, typename = std::enable_if_t<std::is_convertible_v<const U(*)[], T(*)[]>>>
+		constexpr span_t(const std::array<U, N>& arr) noexcept : _data{arr.data()}, _len{N} { /* NOP */ }
+
+		template<typename U, typename A, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+		span_t(std::vector<U, A>& vec) noexcept : _data{vec.data()}, _len{vec.size()} { /* NOP */ }
+
+		template<typename U, typename A, typename = std::enable_if_t<std::is_convertible_v<const U(*)[], T(*)[]>>>
+		span_t(const std::vector<U, A>& vec) noexcept : _data{vec.data()}, _len{vec.size()} { /* NOP */ }
+
+		/* Allow span_t<T> -> span_t<const T> */
+		template<typename U, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+		constexpr span_t(const span_t<U>& other) noexcept : _data{other.data()}, _len{other.size()} { /* NOP */ }
+
+		[[nodiscard]]
+		constexpr T* data() const noexcept { return _data; }
+		[[nodiscard]]
+		constexpr std::size_t size() const noexcept { return _len; }
+		[[nodiscard]]
+		constexpr std::size_t size_bytes() const noexcept { return _len * sizeof(T); }
+		[[nodiscard]]
+		constexpr bool empty() const noexcept { return _len == 0; }
+
+		[[nodiscard]]
+		constexpr iterator begin() const noexcept { return _data; }
+		[[nodiscard]]
+		constexpr iterator end() const noexcept { return _data + _len; }
+
+		[[nodiscard]]
+		constexpr T& operator[](const std::size_t idx) const noexcept { return _data[idx]; }
+		[[nodiscard]]
+		constexpr T& front() const noexcept { return _data[0]; }
+		[[nodiscard]]
+		constexpr T& back() const noexcept { return _data[_len - 1]; }
+
+		/* Returns a pointer to the element at idx, or nullptr if it's out of range */
+		[[nodiscard]]
+		constexpr T* at(const std::size_t idx) const noexcept {
+			return (idx < _len) ? _data + idx : nullptr;
+		}
+
+		[[nodiscard]]
+		constexpr bool contains(const std::size_t offset, const std::size_t len) const noexcept {
+			return offset <= _len && len <= _len - offset;
+		}
+
+		[[nodiscard]]
+		constexpr span_t subspan(const std::size_t offset, const std::size_t len) const noexcept {
+			if (!contains(offset, len))
+				return {};
+			return {_data + offset, len};
+		}
+
+		[[nodiscard]]
+		constexpr span_t subspan(const std::size_t offset) const noexcept {
+			if (offset > _len)
+				return {};
+			return {_data + offset, _len - offset};
+		}
+
+		[[nodiscard]]
+		constexpr span_t first(const std::size_t len) const noexcept { return subspan(0, len); }
+
+		/*
+			Reinterpret the bytes at offset as an on-disk structure
+
+			These are only available on byte spans, and only for types that have an alignment
+			of 1, as there are no guarantees about the alignment of anything inside of a file.
+		*/
+		template<typename U>
+		[[nodiscard]]
+		const U* as(const std::size_t offset) const noexcept {
+			static_assert(sizeof(T) == 1, "span_t::as is only valid on byte spans");
+			static_assert(alignof(U) == 1, "on-disk types must be byte aligned");
+			static_assert(std::is_trivially_copyable_v<U>, "on-disk types must be trivially copyable");
+			if (!contains(offset, sizeof(U)))
+				return nullptr;
+			return reinterpret_cast<const U*>(_data + offset);
+		}
+
+		template<typename U>
+		[[nodiscard]]
+		span_t<const U> array(const std::size_t offset, const std::size_t count) const noexcept {
+			static_assert(sizeof(T) == 1, "span_t::array is only valid on byte spans");
+			static_assert(alignof(U) == 1, "on-disk types must be byte aligned");
+			static_assert(std::is_trivially_copyable_v<U>, "on-disk types must be trivially copyable");
+			if (offset > _len || count > (_len - offset) / sizeof(U))
+				return {};
+			return {reinterpret_cast<const U*>(_data + offset), count};
+		}
+
+		/* Returns the NUL terminated string starting at offset, or an empty view if it's unterminated */
+		[[nodiscard]]
+		std::string_view string(const std::size_t offset) const noexcept {
+			static_assert(sizeof(T) == 1, "span_t::string is only valid on byte spans");
+			if (offset >= _len)
+				return {};
+			const auto* const str{reinterpret_cast<const char*>(_data + offset)};
+			const auto* const end{static_cast<const char*>(std::memchr(str, 0, _len - offset))};
+			if (!end)
+				return {};
+			return {str, static_cast<std::size_t>(end - str)};
+		}
+	};
+
+	using byte_span_t = span_t<const std::uint8_t>;
+
+	/* Narrows a file offset or length to a size_t, saturating so that it fails any later bounds check */
+	template<typename T>
+	[[nodiscard]]
+	inline constexpr std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T>, std::size_t>
+	narrow_size(const T value) noexcept {
+		if constexpr (sizeof(T) > sizeof(std::size_t)) {
+			if (value > std::numeric_limits<std::size_t>::max())
+				return std::numeric_limits<std::size_t>::max();
+		}
+		return static_cast<std::size_t>(value);
+	}
+}
+
+#endif /* libalfheim_internal_span_hh */
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* internal/thread_pool.hh - Bounded worker thread pool */
+#pragma once
+#if !defined(libalfheim_internal_thread_pool_hh)
+#define libalfheim_internal_thread_pool_hh
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+
+namespace Alfheim::Internal {
+	/*
+		A fixed set of worker threads for data-parallel work
+
+		parallel_for() hands out indices from a shared counter, so workers that finish early
+		simply pick up more of the remaining items. The calling thread participates too, so
+		a pool with zero workers degrades to running everything inline. Each invocation is
+		given the index of the worker running it, in the range [0, concurrency()), which can
+		be used to index per-worker state such as compression contexts without locking.
+	*/
+	struct thread_pool_t final {
+	private:
+		using task_t = std::function<void(std::size_t, std::size_t)>;
+
+		std::vector<std::thread> _workers{};
+		std::mutex _lock{};
+		std::condition_variable _wake{};
+		std::condition_variable _idle{};
+		/* Serializes concurrent parallel_for() calls */
+		std::mutex _submit{};
+
+		const task_t* _task{nullptr};
+		std::size_t _count{0};
+		std::atomic<std::size_t> _next{0};
+		std::size_t _generation{0};
+		std::size_t _active{0};
+		bool _stop{false};
+
+		void drain(const task_t& task, const std::size_t count, const std::size_t worker) noexcept {
+			for (auto idx{_next.fetch_add(1U, std::memory_order_relaxed)}; idx < count;
+				idx = _next.fetch_add(1U, std::memory_order_relaxed))
+				task(worker, idx);
+		}
+
+		void run(const std::size_t worker) noexcept {
+			std::size_t seen{0};
+			while (true) {
+				const task_t* task{};
+				std::size_t count{};
+				{
+					std::unique_lock<std::mutex> lock{_lock};
+					_wake.wait(lock, [&]() noexcept { return _stop || _generation != seen; });
+					if (_stop)
+						return;
+					seen = _generation;
+					/* We woke up too late and the job has already been completed without us */
+					if (!_task)
+						continue;
+					task = _task;
+					count = _count;
+					++_active;
+				}
+
+				drain(*task, count, worker);
+
+				{
+					std::lock_guard<std::mutex> lock{_lock};
+					--_active;
+				}
+				_idle.notify_all();
+			}
+		}
+	public:
+		/* A pool of threads workers, plus the calling thread */
+		explicit thread_pool_t(const std::size_t threads) {
+			_workers.reserve(threads);
+			for (std::size_t idx{}; idx < threads; ++idx)
+				_workers.emplace_back([this, idx]() noexcept { run(idx + 1U); });
+		}
+
+		/* Sized so that the pool and the calling thread together fill the machine */
+		thread_pool_t() : thread_pool_t{std::max(std::thread::hardware_concurrency(), 1U) - 1U} { /* NOP */ }
+
+		thread_pool_t(const thread_pool_t&) = delete;
+		thread_pool_t(thread_pool_t&&) = delete;
+		thread_pool_t& operator=(const thread_pool_t&) = delete;
+		thread_pool_t& operator=(thread_pool_t&&) = delete;
+
+		~thread_pool_t() noexcept {
+			{
+				std::lock_guard<std::mutex> lock{_lock};
+				_stop = true;
+			}
+			_wake.notify_all();
+			for (auto& worker : _workers)
+				worker.join();
+		}
+
+		/* The number of distinct worker indices parallel_for() may pass */
+		[[nodiscard]]
+		std::size_t concurrency() const noexcept { return _workers.size() + 1U; }
+
+		/*
+			Calls fn(worker, idx) for every idx in [0, count), returning once all have completed
+
+			fn must not throw.
+		*/
+		template<typename F>
+		void parallel_for(const std::size_t count, F&& fn) {
+			if (!count)
+				return;
+
+			const task_t task{std::forward<F>(fn)};
+			std::lock_guard<std::mutex> submit{_submit};
+			if (_workers.empty() || count == 1U) {
+				for (std::size_t idx{}; idx < count; ++idx)
+					task(0U, idx);
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock{_lock};
+				_task = &task;
+				_count = count;
+				_next.store(0U, std::memory_order_relaxed);
+				++_generation;
+			}
+			_wake.notify_all();
+
+			drain(task, count, 0U);
+
+			/* Wait for any stragglers still working on their last item */
+			std::unique_lock<std::mutex> lock{_lock};
+			_idle.wait(lock, [&]() noexcept { return _active == 0U; });
+			_task = nullptr;
+			_count = 0U;
+		}
+	};
+}
+
+#endif /* libalfheim_internal_thread_pool_hh */
@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* internal/writer.hh - Write combining output stream over fd_t */
+#pragma once
+#if !defined(libalfheim_internal_writer_hh)
+#define libalfheim_internal_writer_hh
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if !defined(_WINDOWS)
+#	include <sys/uio.h>
+#endif
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/fd.hh>
+#include <libalfheim/internal/span.hh>
+#include <libalfheim/internal/utility.hh>
+
+namespace Alfheim::Internal {
+	using namespace Alfheim::Internal::Units;
+
+	/*
+		A write combining output stream over a file descriptor
+
+		Small writes are copied into a block sized buffer, while large ones and anything
+		handed over with write_ref() are queued by reference, and the whole lot goes out in
+		as few pwritev() calls as possible whenever the buffer fills or flush() is called.
+
+		write_at() overwrites bytes that have already been written, for backpatching offsets
+		and sizes once they're known. Patches that land in the buffer are applied in place,
+		anything else is deferred until the next flush, and either way overlapping patches
+		take effect in the order they were made. Descriptors that can't seek, such as pipes,
+		are written with writev() and can only be patched within the buffer.
+
+		Nothing here throws, running out of memory while queueing a write or a patch fails
+		the stream just as an I/O error does.
+	*/
+	struct writer_t final {
+	private:
+		struct segment_t final {
+			Types::off_t offset;
+			const std::uint8_t* data;
+			std::size_t len;
+			bool owned;
+		};
+
+		struct patch_t final {
+			Types::off_t offset;
+			std::size_t start;
+			std::size_t len;
+		};
+
+	#if defined(IOV_MAX)
+		static constexpr std::size_t max_segments{IOV_MAX};
+	#else
+		static constexpr std::size_t max_segments{1024U};
+	#endif
+
+		fd_t& _fd;
+		std::unique_ptr<std::uint8_t[]> _buffer;
+		std::size_t _block_size;
+		std::size_t _used{0};
+		std::vector<segment_t> _segments{};
+		std::vector<patch_t> _patches{};
+		std::vector<std::uint8_t> _patch_data{};
+		/* Where the pending segments start in the file, and where the stream ends */
+		Types::off_t _flushed;
+		Types::off_t _pos;
+		bool _seekable;
+		bool _failed{false};
+
+		/* Fails the stream rather than throwing if the segment list can't grow */
+		[[nodiscard]]
+		bool queue(const std::uint8_t* const data, const std::size_t len, const bool owned) noexcept {
+			try {
+				/* Merge with the previous segment where the memory is contiguous */
+				if (!_segments.empty() && _segments.back().owned == owned && _segments.back().data + _segments.back().len == data)
+					_segments.back().len += len;
+				else
+					_segments.push_back({_pos, data, len, owned});
+			} catch (const std::bad_alloc&) {
+				_failed = true;
+				return false;
+			}
+			_pos += Types::off_t(len);
+			return true;
+		}
+
+		[[nodiscard]]
+		bool write_segments(const segment_t* const segments, const std::size_t count) noexcept {
+		#if !defined(_WINDOWS)
+			std::array<iovec, max_segments> iov{};
+			for (std::size_t idx{}; idx < count; ++idx)
+				iov[idx] = {const_cast<std::uint8_t*>(segments[idx].data), segments[idx].len};
+
+			/* Short writes are resumed from wherever they stopped */
+			auto offset{segments[0].offset};
+			std::size_t first{0};
+			while (first < count) {
+				const auto res{_seekable ?
+					::pwritev(_fd, iov.data() + first, std::int32_t(count - first), offset) :
+					::writev(_fd, iov.data() + first, std::int32_t(count - first))};
+				if (res <= 0)
+					return false;
+				offset += res;
+				auto done{std::size_t(res)};
+				while (first < count && done >= iov[first].iov_len)
+					done -= iov[first++].iov_len;
+				if (first < count) {
+					iov[first].iov_base = static_cast<std::uint8_t*>(iov[first].iov_base) + done;
+					iov[first].iov_len -= done;
+				}
+			}
+			return true;
+		#else
+			for (std::size_t idx{}; idx < count; ++idx) {
+				if (!_fd.write_at(segments[idx].data, segments[idx].len, segments[idx].offset))
+					return false;
+			}
+			return true;
+		#endif
+		}
+
+		/* Tries to apply a patch directly to the buffered copy of the bytes it covers */
+		[[nodiscard]]
+		bool patch_buffer(const Types::off_t offset, const std::uint8_t* const data, const std::size_t len) noexcept {
+			const auto segment{std::upper_bound(_segments.begin(), _segments.end(), offset,
+				[](const Types::off_t off, const segment_t& seg) noexcept { return off < seg.offset; })};
+			if (segment == _segments.begin())
+				return false;
+			const auto& seg{*std::prev(segment)};
+			if (!seg.owned || offset + Types::off_t(len) > seg.offset + Types::off_t(seg.len))
+				return false;
+			std::memcpy(const_cast<std::uint8_t*>(seg.data) + (offset - seg.offset), data, len);
+			return true;
+		}
+
+		/* Whether a deferred patch touches any of the given bytes, which would be written over it if patched in place */
+		[[nodiscard]]
+		bool deferred_overlap(const Types::off_t offset, const std::size_t len) const noexcept {
+			return std::any_of(_patches.begin(), _patches.end(), [&](const patch_t& patch) noexcept {
+				return offset < patch.offset + Types::off_t(patch.len) && patch.offset < offset + Types::off_t(len);
+			});
+		}
+	public:
+		writer_t(fd_t& fd, const std::size_t block_size = 64_KiB) noexcept :
+			_fd{fd}, _buffer{new (std::nothrow) std::uint8_t[std::max<std::size_t>(block_size, 16U)]},
+			_block_size{std::max<std::size_t>(block_size, 16U)}, _flushed{fd.tell()}, _pos{_flushed},
+			_seekable{_flushed != -1}
+		{
+			if (!_seekable)
+				_flushed = _pos = 0;
+		}
+
+		writer_t(const writer_t&) = delete;
+		writer_t(writer_t&&) = delete;
+		writer_t& operator=(const writer_t&) = delete;
+		writer_t& operator=(writer_t&&) = delete;
+
+		/* Flushes and leaves the file position at the end of the stream */
+		~writer_t() noexcept {
+			if (flush() && _seekable) {
+				[[maybe_unused]]
+				const auto _ = _fd.seek(_pos, SEEK_SET);
+			}
+		}
+
+		/* False once any write has failed, the output should then be considered incomplete */
+		[[nodiscard]]
+		bool valid() const noexcept { return _fd.valid() && _buffer && !_failed; }
+		[[nodiscard]]
+		bool seekable() const noexcept { return _seekable; }
+		[[nodiscard]]
+		Types::off_t tell() const noexcept { return _pos; }
+		/* How many bytes are waiting to be written */
+		[[nodiscard]]
+		std::size_t pending() const noexcept { return std::size_t(_pos - _flushed); }
+
+		/* Writes everything queued so far, the descriptor's own file position is left where it was */
+		[[nodiscard]]
+		bool flush() noexcept {
+			if (_failed || !_buffer)
+				return false;
+
+			for (std::size_t idx{}; idx < _segments.size() && !_failed; idx += max_segments)
+				_failed = !write_segments(_segments.data() + idx, std::min(max_segments, _segments.size() - idx));
+			for (const auto& patch : _patches) {
+				if (_failed)
+					break;
+				_failed = !_fd.write_at(_patch_data.data() + patch.start, patch.len, patch.offset);
+			}
+
+			_segments.clear();
+			_patches.clear();
+			_patch_data.clear();
+			_used = 0;
+			_flushed = _pos;
+			return !_failed;
+		}
+
+		[[nodiscard]]
+		bool write(const void* const buff, const std::size_t len) noexcept {
+			if (_failed || !_buffer)
+				return false;
+			const auto* const data{static_cast<const std::uint8_t*>(buff)};
+			/* Too big to be worth copying, queue it alongside whatever is pending and send it all now */
+			if (len >= _block_size) {
+				return queue(data, len, false) && flush();
+			}
+
+			if (_used + len > _block_size && !flush())
+				return false;
+			std::memcpy(_buffer.get() + _used, data, len);
+			if (!queue(_buffer.get() + _used, len, true))
+				return false;
+			_used += len;
+			return true;
+		}
+
+		/*
+			Queues data without copying it
+
+			The memory must stay valid and unchanged until the next flush(), this is intended
+			for section payloads that already live in memory, such as a mapped input file.
+		*/
+		[[nodiscard]]
+		bool write_ref(const byte_span_t data) noexcept {
+			if (_failed || !_buffer)
+				return false;
+			if (data.empty())
+				return true;
+			return queue(data.data(), data.size(), false);
+		}
+
+		/*
+			Overwrites len bytes at offset, which must lie entirely before tell()
+
+			When the descriptor can't seek, the bytes must also lie entirely within a single
+			buffered write that hasn't been flushed yet.
+		*/
+		[[nodiscard]]
+		bool write_at(const Types::off_t offset, const void* const buff, const std::size_t len) noexcept {
+			if (_failed || offset < 0 || offset + Types::off_t(len) > _pos)
+				return false;
+			const auto* const data{static_cast<const std::uint8_t*>(buff)};
+			if (offset >= _flushed && !deferred_overlap(offset, len) && patch_buffer(offset, data, len))
+				return true;
+			if (!_seekable)
+				return false;
+
+			try {
+				_patch_data.insert(_patch_data.end(), data, data + len);
+				_patches.push_back({offset, _patch_data.size() - len, len});
+			} catch (const std::bad_alloc&) {
+				_failed = true;
+				return false;
+			}
+			return true;
+		}
+
+		/* Pads with zeros up to the next multiple of alignment, which must be a power of two */
+		[[nodiscard]]
+		bool align(const std::size_t alignment) noexcept {
+			static constexpr std::array<std::uint8_t, 64> zeros{};
+			auto padding{std::size_t(-_pos) & (alignment - 1U)};
+			while (padding) {
+				const auto len{std::min(padding, zeros.size())};
+				if (!write(zeros.data(), len))
+					return false;
+				padding -= len;
+			}
+			return true;
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_trivially_copyable_v<T>, bool> write(const T& val) noexcept {
+			/* The common case of a small value that fits in the buffer */
+			if (_used + sizeof(T) <= _block_size && !_failed && _buffer) {
+				std::memcpy(_buffer.get() + _used, &val, sizeof(T));
+				if (!queue(_buffer.get() + _used, sizeof(T), true))
+					return false;
+				_used += sizeof(T);
+				return true;
+			}
+			return write(&val, sizeof(T));
+		}
+
+		template<typename T, std::size_t N>
+		[[nodiscard]]
+		bool write(const std::array<T, N>& val) noexcept {
+			return write(val.data(), sizeof(T) * N);
+		}
+
+		[[nodiscard]]
+		bool write(const std::string_view& val) noexcept {
+			return write(val.data(), val.size());
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_trivially_copyable_v<T>, bool> write_at(const Types::off_t offset, const T& val) noexcept {
+			return write_at(offset, &val, sizeof(T));
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool> write_le(const T val) noexcept {
+			return write(to_endian<endian_t::little>(val));
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool> write_be(const T val) noexcept {
+			return write(to_endian<endian_t::big>(val));
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool>
+		write_le_at(const Types::off_t offset, const T val) noexcept {
+			return write_at(offset, to_endian<endian_t::little>(val));
+		}
+
+		template<typename T>
+		[[nodiscard]]
+		std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, bool>
+		write_be_at(const Types::off_t offset, const T val) noexcept {
+			return write_at(offset, to_endian<endian_t::big>(val));
+		}
+	};
+}
+
+#endif /* libalfheim_internal_writer_hh */
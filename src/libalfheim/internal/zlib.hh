@@ -10,14 +10,18 @@
 #include <optional>
 #include <string>
 #include <cstring>
+#include <algorithm>
 #include <type_traits>
 #include <functional>
+#include <limits>
+#include <new>
 
 #include <libalfheim/config.hh>
 
 #include <libalfheim/internal/bits.hh>
 #include <libalfheim/internal/defs.hh>
 #include <libalfheim/internal/fd.hh>
+#include <libalfheim/internal/span.hh>
 #include <libalfheim/internal/utility.hh>
 
 extern "C" {
@@ -30,6 +34,216 @@ extern "C" {
 namespace Alfheim::Internal {
 	using namespace Alfheim::Internal::Units;
 
+	enum struct zstatus_t : std::uint8_t {
+		/* Progress was made, but more input or more output space is needed */
+		ok         = 0x00U,
+		stream_end = 0x01U,
+		error      = 0x02U,
+	};
+
+	/*
+		A persistent inflate context that decompresses straight into caller provided memory
+
+		Unlike zlib_t this keeps its state between calls, so a stream can be fed and drained
+		in pieces of any size and nothing is buffered or copied internally. The z_stream
+		refers back to itself so this can be neither copied nor moved.
+	*/
+	struct inflater_t final {
+	private:
+		z_stream _stream{};
+		bool _valid{false};
+		bool _eos{false};
+	public:
+		inflater_t() noexcept : _valid{::inflateInit(&_stream) == Z_OK} { /* NOP */ }
+
+		inflater_t(const inflater_t&) = delete;
+		inflater_t(inflater_t&&) = delete;
+		inflater_t& operator=(const inflater_t&) = delete;
+		inflater_t& operator=(inflater_t&&) = delete;
+
+		~inflater_t() noexcept {
+			if (_valid)
+				::inflateEnd(&_stream);
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _valid; }
+		[[nodiscard]]
+		bool finished() const noexcept { return _eos; }
+		[[nodiscard]]
+		std::uint64_t total_in() const noexcept { return _stream.total_in; }
+		[[nodiscard]]
+		std::uint64_t total_out() const noexcept { return _stream.total_out; }
+
+		[[nodiscard]]
+		bool reset() noexcept {
+			_eos = false;
+			return _valid && ::inflateReset(&_stream) == Z_OK;
+		}
+
+		/* Inflates from input into output, advancing both past whatever was consumed and produced */
+		[[nodiscard]]
+		zstatus_t inflate(byte_span_t& input, span_t<std::uint8_t>& output) noexcept {
+			if (!_valid)
+				return zstatus_t::error;
+
+			constexpr std::size_t max_chunk{std::numeric_limits<uInt>::max()};
+			while (!_eos && !input.empty() && !output.empty()) {
+				_stream.next_in = input.data();
+				_stream.avail_in = static_cast<uInt>(std::min(input.size(), max_chunk));
+				_stream.next_out = output.data();
+				_stream.avail_out = static_cast<uInt>(std::min(output.size(), max_chunk));
+
+				const auto ret{::inflate(&_stream, Z_NO_FLUSH)};
+
+				input = input.subspan(static_cast<std::size_t>(_stream.next_in - input.data()));
+				output = output.subspan(static_cast<std::size_t>(_stream.next_out - output.data()));
+
+				if (ret == Z_STREAM_END)
+					_eos = true;
+				else if (ret == Z_BUF_ERROR)
+					break;
+				else if (ret != Z_OK)
+					return zstatus_t::error;
+			}
+			return _eos ? zstatus_t::stream_end : zstatus_t::ok;
+		}
+
+		/* Inflates a complete stream, succeeding only if it produces exactly output.size() bytes */
+		[[nodiscard]]
+		bool inflate_all(byte_span_t input, span_t<std::uint8_t> output) noexcept {
+			if (!reset())
+				return false;
+			const auto status{inflate(input, output)};
+			if (status == zstatus_t::stream_end || !output.empty())
+				return status == zstatus_t::stream_end && output.empty();
+			/* Output is full but the stream hasn't ended yet, which is fine only if it ends without producing more */
+			std::uint8_t spare{};
+			span_t<std::uint8_t> probe{&spare, 1U};
+			return inflate(input, probe) == zstatus_t::stream_end && probe.size() == 1U;
+		}
+	};
+
+	/*
+		A persistent deflate context that streams its output to a sink
+
+		Compressed output is gathered in a chunk sized buffer and handed to the sink each time
+		that fills, so arbitrarily large inputs can be compressed in bounded memory. Nothing
+		is implicitly flushed or finished, write() can be called any number of times with
+		inputs of any length, flush() forces out everything so far on a byte boundary, and
+		finish() terminates the stream. The z_stream refers back to itself so this can be
+		neither copied nor moved.
+	*/
+	struct deflater_t final {
+		/* Called with each filled chunk of output, returning false aborts the stream */
+		using sink_t = std::function<bool(byte_span_t)>;
+	private:
+		z_stream _stream{};
+		sink_t _sink;
+		std::unique_ptr<std::uint8_t[]> _chunk;
+		std::size_t _chunk_size;
+		bool _valid;
+		bool _eos{false};
+
+		[[nodiscard]]
+		bool pump(const std::int32_t flush) noexcept {
+			if (!_valid || _eos)
+				return false;
+
+			do {
+				_stream.next_out = _chunk.get();
+				_stream.avail_out = static_cast<uInt>(_chunk_size);
+
+				const auto ret{::deflate(&_stream, flush)};
+				if (ret == Z_STREAM_END)
+					_eos = true;
+				else if (ret != Z_OK && ret != Z_BUF_ERROR)
+					return false;
+
+				const auto produced{_chunk_size - _stream.avail_out};
+				if (produced && !_sink(byte_span_t{_chunk.get(), produced}))
+					return false;
+			} while (_stream.avail_out == 0 && !_eos);
+			return true;
+		}
+	public:
+		deflater_t(sink_t sink, const std::int32_t level = Z_DEFAULT_COMPRESSION, const std::size_t chunk_size = 64_KiB,
+			const std::int32_t window_bits = MAX_WBITS) noexcept :
+			_sink{std::move(sink)},
+			_chunk{new (std::nothrow) std::uint8_t[std::clamp<std::size_t>(chunk_size, 64U, std::numeric_limits<uInt>::max())]},
+			_chunk_size{std::clamp<std::size_t>(chunk_size, 64U, std::numeric_limits<uInt>::max())},
+			_valid{_chunk && ::deflateInit2(&_stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) == Z_OK}
+		{ /* NOP */ }
+
+		/* Writes the compressed stream into fd starting at offset, independent of the file position */
+		deflater_t(const fd_t& fd, const Types::off_t offset, const std::int32_t level = Z_DEFAULT_COMPRESSION,
+			const std::size_t chunk_size = 64_KiB) noexcept :
+			deflater_t{[&fd, pos = offset](const byte_span_t data) mutable noexcept {
+				const auto res{fd.write_at(data.data(), data.size(), pos)};
+				pos += Types::off_t(data.size());
+				return res;
+			}, level, chunk_size} { /* NOP */ }
+
+		deflater_t(const deflater_t&) = delete;
+		deflater_t(deflater_t&&) = delete;
+		deflater_t& operator=(const deflater_t&) = delete;
+		deflater_t& operator=(deflater_t&&) = delete;
+
+		~deflater_t() noexcept {
+			if (_valid)
+				::deflateEnd(&_stream);
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _valid; }
+		[[nodiscard]]
+		bool finished() const noexcept { return _eos; }
+		[[nodiscard]]
+		std::uint64_t total_in() const noexcept { return _stream.total_in; }
+		[[nodiscard]]
+		std::uint64_t total_out() const noexcept { return _stream.total_out; }
+
+		/* Changes the compression level, this takes effect from the next write */
+		[[nodiscard]]
+		bool level(const std::int32_t level) noexcept {
+			return _valid && !_eos && ::deflateParams(&_stream, level, Z_DEFAULT_STRATEGY) == Z_OK;
+		}
+
+		[[nodiscard]]
+		bool write(byte_span_t input) noexcept {
+			constexpr std::size_t max_chunk{std::numeric_limits<uInt>::max()};
+			while (!input.empty()) {
+				const auto len{std::min(input.size(), max_chunk)};
+				_stream.next_in = input.data();
+				_stream.avail_in = static_cast<uInt>(len);
+				if (!pump(Z_NO_FLUSH))
+					return false;
+				input = input.subspan(len);
+			}
+			return true;
+		}
+
+		/* Emits all pending output, aligned to a byte boundary, without ending the stream */
+		[[nodiscard]]
+		bool flush() noexcept {
+			_stream.avail_in = 0;
+			return pump(Z_SYNC_FLUSH);
+		}
+
+		/* Ends the stream, no more input can be written until reset() */
+		[[nodiscard]]
+		bool finish() noexcept {
+			_stream.avail_in = 0;
+			return pump(Z_FINISH) && _eos;
+		}
+
+		[[nodiscard]]
+		bool reset() noexcept {
+			_eos = false;
+			return _valid && ::deflateReset(&_stream) == Z_OK;
+		}
+	};
+
 	struct zlib_t final {
 	private:
 		enum struct zmode_t : std::uint8_t {
@@ -68,9 +282,10 @@ namespace Alfheim::Internal {
 
 			[[nodiscard]]
 			std::optional<std::vector<std::uint8_t>> process(const std::uint8_t* data, const std::size_t len) noexcept {
-				using processor_t = bool(zctx_t&, std::vector<std::uint8_t>&,const std::uint8_t*,const std::size_t);
+				using processor_t = bool(zctx_t&, std::vector<std::uint8_t>&,const std::uint8_t*,const std::size_t, const bool);
 
-				const auto n_chunks = (len + chunk_size - 1) / chunk_size;
+				/* An empty input still needs a single pass for deflate to emit a complete stream */
+				const auto n_chunks = std::max<std::size_t>((len + chunk_size - 1) / chunk_size, 1U);
 				const std::function<processor_t> processor{(_mode == zlib_t::zmode_t::inflate) ? &zctx_t::inflate : &zctx_t::deflate};
 
 				std::vector<std::uint8_t> _output{};
@@ -79,7 +294,7 @@ namespace Alfheim::Internal {
 					const auto *const buffer = data + (chunk_size * idx);
 					const auto buffer_len = (idx == n_chunks - 1) ? len - ((n_chunks - 1) * chunk_size) : chunk_size;
 
-					if (!processor(*this, _output, buffer, buffer_len)) {
+					if (!processor(*this, _output, buffer, buffer_len, idx == n_chunks - 1)) {
 						return std::nullopt;
 					}
 				}
@@ -102,7 +317,7 @@ namespace Alfheim::Internal {
 
 		private:
 			[[nodiscard]]
-			bool inflate(std::vector<std::uint8_t>& out, const std::uint8_t* buff, const std::size_t buff_size) noexcept {
+			bool inflate(std::vector<std::uint8_t>& out, const std::uint8_t* buff, const std::size_t buff_size, const bool) noexcept {
 				_stream.next_in = buff;
 				_stream.avail_in = buff_size;
 				_stream.avail_out = 0;
@@ -128,16 +343,16 @@ namespace Alfheim::Internal {
 			}
 
 			[[nodiscard]]
-			bool deflate(std::vector<std::uint8_t>& out, const std::uint8_t* buff, const std::size_t buff_size) noexcept {
+			bool deflate(std::vector<std::uint8_t>& out, const std::uint8_t* buff, const std::size_t buff_size, const bool last) noexcept {
 				_stream.next_in = buff;
 				_stream.avail_in = buff_size;
-				_stream.avail_out = 0;
 
-				while (_stream.avail_in && (_stream.avail_out == 0) && !_eos) {
+				/* Finishing is decided by the caller, a short chunk doesn't mean the input has ended */
+				do {
 					_stream.next_out = _buffer.data();
 					_stream.avail_out = _buffer.size();
 
-					const auto ret = ::deflate(&_stream, (buff_size < chunk_size) ? Z_FINISH : Z_NO_FLUSH);
+					const auto ret = ::deflate(&_stream, last ? Z_FINISH : Z_NO_FLUSH);
 
 					if (ret == Z_STREAM_ERROR || ret == Z_NEED_DICT || ret == Z_DATA_ERROR)
 						return false;
@@ -148,8 +363,7 @@ namespace Alfheim::Internal {
 					const auto offset = out.size();
 					out.resize(out.size() + copy_len);
 					std::memcpy(out.data() + offset, _buffer.data(), copy_len);
-
-				}
+				} while (_stream.avail_out == 0 && !_eos);
 				return true;
 			}
 
@@ -286,7 +500,7 @@ namespace Alfheim::Internal {
 		std::enable_if_t<std::is_pod_v<T>, std::optional<std::vector<std::uint8_t>>>
 		deflate(const std::array<T, len>& objs) noexcept {
 			std::array<std::uint8_t, len * sizeof(T)> buff{};
-			std::memcpy(buff.data(), objs.data(), len);
+			std::memcpy(buff.data(), objs.data(), len * sizeof(T));
 			return _deflate.process(buff);
 		}
 
@@ -294,7 +508,7 @@ namespace Alfheim::Internal {
 		[[nodiscard]]
 		std::enable_if_t<std::is_pod_v<T>, std::optional<std::vector<std::uint8_t>>>
 		deflate(const std::vector<T>& objs) noexcept {
-			std::vector<std::uint8_t> buff{sizeof(T) * objs.size()};
+			std::vector<std::uint8_t> buff(sizeof(T) * objs.size());
 			std::memcpy(buff.data(), objs.data(), sizeof(T) * objs.size());
 			return _deflate.process(buff);
 		}
@@ -0,0 +1,443 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* loader.cc - Batched loading of file headers */
+
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <fcntl.h>
+
+#if defined(LIBALFHEIM_IO_URING)
+#	include <linux/io_uring.h>
+#	include <sched.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+#include <libalfheim/internal/fd.hh>
+
+#include <libalfheim/loader.hh>
+
+namespace Alfheim {
+	using namespace Alfheim::Internal;
+
+	namespace {
+		/* Loads every path that isn't already marked as loaded */
+		void load_sync(const span_t<const fs::path> paths, const span_t<std::uint8_t> buffer, const header_sink_t& sink,
+			const std::vector<bool>& loaded) {
+			for (std::size_t idx{}; idx < paths.size(); ++idx) {
+				if (!loaded.empty() && loaded[idx])
+					continue;
+				loaded_header_t header{idx, 0U, {}, std::nullopt, 0};
+				fd_t file{paths[idx], O_RDONLY};
+				if (!file.valid())
+					header.error = errno;
+				else {
+					const auto length{file.length()};
+					if (length < 0)
+						header.error = errno;
+					else {
+						header.file_size = std::uint64_t(length);
+						std::size_t read{};
+						const auto want{std::min<std::uint64_t>(header.file_size, buffer.size())};
+						/* A short read leaves errno alone, so clear it first to tell that apart from a failed one */
+						errno = 0;
+						const auto complete{file.read(buffer.data(), std::size_t(want), read)};
+						const auto error{errno};
+						if (!complete && read != want)
+							header.error = error ? error : EIO;
+						header.data = {buffer.data(), read};
+						header.info = identify(header.data);
+					}
+				}
+				sink(header);
+			}
+		}
+
+	#if defined(LIBALFHEIM_IO_URING)
+		[[nodiscard]]
+		int io_uring_setup(const std::uint32_t entries, io_uring_params& params) noexcept {
+			return int(::syscall(__NR_io_uring_setup, entries, &params));
+		}
+
+		[[nodiscard]]
+		int io_uring_enter(const int ring, const std::uint32_t submit, const std::uint32_t wait, const std::uint32_t flags) noexcept {
+			return int(::syscall(__NR_io_uring_enter, ring, submit, wait, flags, nullptr, 0U));
+		}
+
+		[[nodiscard]]
+		int io_uring_register(const int ring, const std::uint32_t opcode, void* const arg, const std::uint32_t count) noexcept {
+			return int(::syscall(__NR_io_uring_register, ring, opcode, arg, count));
+		}
+
+		/* The submission and completion rings of an io_uring, mapped into our address space */
+		struct ring_t final {
+		private:
+			/* A region of the ring shared with the kernel */
+			struct region_t final {
+				void* addr{nullptr};
+				std::size_t len{0};
+
+				[[nodiscard]]
+				bool map(const int ring, const std::size_t size, const std::uint64_t offset) noexcept {
+					const auto ptr{::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, off_t(offset))};
+					if (ptr == MAP_FAILED)
+						return false;
+					addr = ptr;
+					len = size;
+					return true;
+				}
+
+				template<typename T>
+				[[nodiscard]]
+				T* at(const std::uint32_t offset) const noexcept {
+					return static_cast<T*>(static_cast<void*>(static_cast<std::uint8_t*>(addr) + offset));
+				}
+			};
+
+			fd_t _ring{};
+			region_t _sq{};
+			region_t _cq{};
+			region_t _sqe{};
+
+			std::uint32_t* _sq_head{nullptr};
+			std::uint32_t* _sq_tail{nullptr};
+			std::uint32_t _sq_mask{};
+			std::uint32_t _sq_entries{};
+			std::uint32_t* _sq_array{nullptr};
+			io_uring_sqe* _sqes{nullptr};
+
+			std::uint32_t* _cq_head{nullptr};
+			std::uint32_t* _cq_tail{nullptr};
+			std::uint32_t _cq_mask{};
+			io_uring_cqe* _cqes{nullptr};
+
+			std::uint32_t _queued{0};
+			std::uint32_t _reaped{0};
+
+			/* Waits for at least one completion without submitting anything */
+			[[nodiscard]]
+			bool wait() const noexcept {
+				while (true) {
+					if (io_uring_enter(_ring, 0U, 1U, IORING_ENTER_GETEVENTS) >= 0)
+						return true;
+					if (errno != EINTR)
+						return false;
+				}
+			}
+
+			[[nodiscard]]
+			bool ready() const noexcept { return *_cq_head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE); }
+		public:
+			explicit ring_t(const std::uint32_t entries) noexcept {
+				io_uring_params params{};
+				_ring = fd_t{io_uring_setup(entries, params)};
+				if (!_ring.valid())
+					return;
+
+				const auto sq_len{params.sq_off.array + params.sq_entries * sizeof(std::uint32_t)};
+				const auto cq_len{params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe)};
+				if (!_sq.map(_ring, sq_len, IORING_OFF_SQ_RING) || !_cq.map(_ring, cq_len, IORING_OFF_CQ_RING) ||
+					!_sqe.map(_ring, params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES)) {
+					_ring = fd_t{};
+					return;
+				}
+
+				_sq_head = _sq.at<std::uint32_t>(params.sq_off.head);
+				_sq_tail = _sq.at<std::uint32_t>(params.sq_off.tail);
+				_sq_mask = *_sq.at<std::uint32_t>(params.sq_off.ring_mask);
+				_sq_entries = params.sq_entries;
+				_sq_array = _sq.at<std::uint32_t>(params.sq_off.array);
+				_sqes = _sqe.at<io_uring_sqe>(0U);
+
+				_cq_head = _cq.at<std::uint32_t>(params.cq_off.head);
+				_cq_tail = _cq.at<std::uint32_t>(params.cq_off.tail);
+				_cq_mask = *_cq.at<std::uint32_t>(params.cq_off.ring_mask);
+				_cqes = _cq.at<io_uring_cqe>(params.cq_off.cqes);
+			}
+
+			ring_t(const ring_t&) = delete;
+			ring_t(ring_t&&) = delete;
+			ring_t& operator=(const ring_t&) = delete;
+			ring_t& operator=(ring_t&&) = delete;
+
+			~ring_t() noexcept {
+				for (const auto& region : {_sqe, _cq, _sq}) {
+					if (region.addr)
+						::munmap(region.addr, region.len);
+				}
+			}
+
+			[[nodiscard]]
+			bool valid() const noexcept { return _ring.valid(); }
+			[[nodiscard]]
+			std::uint32_t entries() const noexcept { return _sq_entries; }
+
+			/* Checks the kernel knows every opcode we need, rather than finding out one CQE at a time */
+			template<std::size_t N>
+			[[nodiscard]]
+			bool supports(const std::array<std::uint8_t, N>& opcodes) const noexcept {
+				constexpr std::size_t probe_ops{64U};
+				std::vector<std::uint8_t> storage(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op));
+				auto* const probe{static_cast<io_uring_probe*>(static_cast<void*>(storage.data()))};
+				if (io_uring_register(_ring, IORING_REGISTER_PROBE, probe, probe_ops) < 0)
+					return false;
+				return std::all_of(opcodes.begin(), opcodes.end(), [&](const std::uint8_t opcode) noexcept {
+					return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+				});
+			}
+
+			/* The caller must never have more than entries() submissions queued at once */
+			[[nodiscard]]
+			io_uring_sqe& next() noexcept {
+				const auto tail{*_sq_tail + _queued++};
+				const auto idx{tail & _sq_mask};
+				_sq_array[idx] = idx;
+				auto& sqe{_sqes[idx]};
+				std::memset(&sqe, 0, sizeof(sqe));
+				return sqe;
+			}
+
+			/* Submissions the kernel has taken but not yet completed, the ring is fresh so both counts start at 0 */
+			[[nodiscard]]
+			std::uint32_t outstanding() const noexcept { return __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) - _reaped; }
+
+			/*
+				Submits everything queued, including anything the kernel didn't take last time, and waits for a completion
+
+				EBUSY means the completion queue is full and EAGAIN that the kernel is short on
+				resources, so in either case what has already completed is left to be reaped
+				and whatever wasn't taken goes again on the next call.
+			*/
+			[[nodiscard]]
+			bool submit_and_wait() noexcept {
+				const auto tail{*_sq_tail + _queued};
+				__atomic_store_n(_sq_tail, tail, __ATOMIC_RELEASE);
+				_queued = 0U;
+				while (true) {
+					const auto submit{tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE)};
+					const auto res{io_uring_enter(_ring, submit, 1U, IORING_ENTER_GETEVENTS)};
+					if (res >= 0)
+						return true;
+					if (errno == EINTR)
+						continue;
+					if (errno != EAGAIN && errno != EBUSY)
+						return false;
+					if (ready())
+						return true;
+					if (!outstanding() || !wait())
+						return false;
+					return true;
+				}
+			}
+
+			template<typename F>
+			void reap(F&& fn) noexcept {
+				auto head{*_cq_head};
+				const auto tail{__atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)};
+				for (; head != tail; ++head, ++_reaped)
+					fn(_cqes[head & _cq_mask]);
+				__atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+			}
+
+			/*
+				Drops anything the kernel hasn't taken yet and reaps until everything it has is complete
+
+				Nothing is submitted without io_uring_enter() as the ring has no SQ polling thread,
+				so the unsubmitted entries can be taken back by rewinding the tail. Completions
+				still land in the ring if waiting on it fails, so that falls back to polling.
+			*/
+			template<typename F>
+			void drain(F&& fn) noexcept {
+				__atomic_store_n(_sq_tail, __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+				_queued = 0U;
+				while (true) {
+					reap(fn);
+					if (!outstanding())
+						return;
+					if (!wait())
+						::sched_yield();
+				}
+			}
+		};
+
+		enum struct op_t : std::uint64_t {
+			open  = 0U,
+			stat  = 1U,
+			read  = 2U,
+			close = 3U,
+		};
+
+		/* One file in flight, slot n reads into the n'th header_size block of the buffer */
+		struct slot_t final {
+			std::size_t index;
+			struct statx stat;
+			std::int32_t fd;
+			std::int32_t error;
+			std::uint32_t read;
+			std::uint32_t pending;
+			/* Set once the close lands, after which fd may already belong to another file */
+			bool closed;
+		};
+
+		constexpr std::array<std::uint8_t, 4> required_ops{{
+			IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE
+		}};
+
+		[[nodiscard]]
+		std::uint64_t user_data(const std::size_t slot, const op_t op) noexcept {
+			return (std::uint64_t(slot) << 2U) | std::uint64_t(op);
+		}
+
+		/*
+			Keeps up to depth files in flight until every path has been loaded
+
+			Each file starts as an openat and a statx on the path, and once the open completes
+			a read of the header and a close of the file are queued, hard linked so the close
+			runs even if the read fails. The slot is handed to the sink and reused as soon as
+			all four have completed.
+
+			Should the ring fail, nothing more is queued and everything the kernel already has
+			is waited out before returning, as it writes into the slots and buffer, and any file
+			opened whose close never made it to the kernel is closed here. Files that didn't
+			make it to the sink are left unmarked in loaded.
+		*/
+		[[nodiscard]]
+		bool load_io_uring(ring_t& ring, const span_t<const fs::path> paths, const span_t<std::uint8_t> buffer,
+			const std::size_t header_size, const header_sink_t& sink, std::vector<bool>& loaded) {
+			const auto depth{std::min<std::size_t>(ring.entries() / 2U, buffer.size() / header_size)};
+			std::vector<slot_t> slots(depth);
+			std::vector<std::size_t> free_slots(depth);
+			for (std::size_t idx{}; idx < depth; ++idx)
+				free_slots[idx] = depth - idx - 1U;
+
+			std::size_t next{0};
+			std::size_t in_flight{0};
+			bool draining{false};
+
+			const auto complete = [&](const io_uring_cqe& cqe) {
+				const auto slot_idx{std::size_t(cqe.user_data >> 2U)};
+				const auto op{op_t(cqe.user_data & 3U)};
+				auto& slot{slots[slot_idx]};
+
+				if (op == op_t::close)
+					slot.closed = true;
+				if (cqe.res < 0 && !slot.error && op != op_t::close)
+					slot.error = -cqe.res;
+				if (op == op_t::open && cqe.res >= 0) {
+					slot.fd = cqe.res;
+					/* The ring is being abandoned, so the file is closed directly once it's quiet */
+					if (draining)
+						return;
+					auto& read{ring.next()};
+					read.opcode = IORING_OP_READ;
+					read.fd = slot.fd;
+					read.addr = std::uint64_t(reinterpret_cast<std::uintptr_t>(buffer.data() + slot_idx * header_size));
+					read.len = std::uint32_t(header_size);
+					read.off = 0U;
+					read.flags = IOSQE_IO_HARDLINK;
+					read.user_data = user_data(slot_idx, op_t::read);
+
+					auto& close{ring.next()};
+					close.opcode = IORING_OP_CLOSE;
+					close.fd = slot.fd;
+					close.user_data = user_data(slot_idx, op_t::close);
+					slot.pending += 2U;
+				} else if (op == op_t::read && cqe.res >= 0)
+					slot.read = std::uint32_t(cqe.res);
+
+				if (--slot.pending || draining)
+					return;
+				const auto data{buffer.subspan(slot_idx * header_size, slot.read)};
+				const auto size{(slot.stat.stx_mask & STATX_SIZE) ? std::uint64_t{slot.stat.stx_size} : 0U};
+				sink(loaded_header_t{slot.index, size, data, identify(data), slot.error});
+				loaded[slot.index] = true;
+				free_slots.push_back(slot_idx);
+				--in_flight;
+			};
+
+			while (next < paths.size() || in_flight) {
+				for (; next < paths.size() && !free_slots.empty(); ++next, ++in_flight) {
+					const auto slot_idx{free_slots.back()};
+					free_slots.pop_back();
+					auto& slot{slots[slot_idx]};
+					slot = slot_t{next, {}, -1, 0, 0U, 2U, false};
+
+					auto& open{ring.next()};
+					open.opcode = IORING_OP_OPENAT;
+					open.fd = AT_FDCWD;
+					open.addr = std::uint64_t(reinterpret_cast<std::uintptr_t>(paths[next].c_str()));
+					open.open_flags = O_RDONLY | O_CLOEXEC;
+					open.user_data = user_data(slot_idx, op_t::open);
+
+					auto& stat{ring.next()};
+					stat.opcode = IORING_OP_STATX;
+					stat.fd = AT_FDCWD;
+					stat.addr = std::uint64_t(reinterpret_cast<std::uintptr_t>(paths[next].c_str()));
+					stat.len = STATX_SIZE;
+					stat.off = std::uint64_t(reinterpret_cast<std::uintptr_t>(&slot.stat));
+					stat.user_data = user_data(slot_idx, op_t::stat);
+				}
+
+				if (!ring.submit_and_wait()) {
+					draining = true;
+					break;
+				}
+				ring.reap(complete);
+			}
+			if (!draining)
+				return true;
+
+			ring.drain(complete);
+			for (const auto& slot : slots) {
+				if (slot.fd >= 0 && !slot.closed)
+					::close(slot.fd);
+			}
+			return false;
+		}
+	#endif
+	}
+
+	bool io_uring_available() noexcept {
+	#if defined(LIBALFHEIM_IO_URING)
+		static const bool available{[]() noexcept {
+			ring_t ring{4U};
+			return ring.valid() && ring.supports(required_ops);
+		}()};
+		return available;
+	#else
+		return false;
+	#endif
+	}
+
+	header_loader_t::header_loader_t(const std::size_t header_size, const std::size_t depth, const load_backend_t backend) :
+		_header_size{std::max<std::size_t>(header_size, 64U)}, _depth{std::max<std::size_t>(depth, 1U)}, _backend{backend} {
+		if (_backend != load_backend_t::sync)
+			_backend = io_uring_available() ? load_backend_t::io_uring : load_backend_t::sync;
+		/* The sync path only ever needs the one block */
+		_buffer.resize(_header_size * (_backend == load_backend_t::io_uring ? _depth : 1U));
+	}
+
+	void header_loader_t::load(const span_t<const fs::path> paths, const header_sink_t& sink) {
+		const span_t<std::uint8_t> buffer{_buffer};
+		std::vector<bool> loaded{};
+	#if defined(LIBALFHEIM_IO_URING)
+		if (_backend == load_backend_t::io_uring) {
+			/* Each file has at most two submissions queued at once */
+			ring_t ring{std::uint32_t(std::min<std::size_t>(_depth * 2U, 4096U))};
+			if (ring.valid()) {
+				loaded.resize(paths.size());
+				/* Should the ring fail part way through, whatever it didn't get to is loaded synchronously */
+				if (load_io_uring(ring, paths, buffer, _header_size, sink, loaded))
+					return;
+			}
+		}
+	#endif
+		load_sync(paths, buffer.first(_header_size), sink, loaded);
+	}
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* loader.hh - Batched loading of file headers */
+#pragma once
+#if !defined(libalfheim_loader_hh)
+#define libalfheim_loader_hh
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/span.hh>
+#include <libalfheim/internal/utility.hh>
+
+#include <libalfheim/format.hh>
+
+namespace Alfheim {
+	namespace fs = std::filesystem;
+	using namespace Alfheim::Internal::Units;
+
+	enum struct load_backend_t : std::uint8_t {
+		/* io_uring where the kernel supports it, otherwise sync */
+		automatic = 0x00U,
+		/* Batched openat/statx/read/close through a Linux io_uring */
+		io_uring  = 0x01U,
+		/* One blocking open, fstat, and read at a time, through Internal::fd_t */
+		sync      = 0x02U,
+	};
+
+	/* The leading bytes of one file, along with what identify() made of them */
+	struct loaded_header_t final {
+		/* The index of the file in the list passed to load() */
+		std::size_t index;
+		std::uint64_t file_size;
+		/* Only valid for the duration of the callback */
+		Internal::byte_span_t data;
+		std::optional<format_info_t> info;
+		/* The errno of whichever step failed, or 0 */
+		std::int32_t error;
+	};
+
+	using header_sink_t = std::function<void(const loaded_header_t& header)>;
+
+	/*
+		Reads the first few KiB of many files at once and classifies them
+
+		On a cold cache the cost of a scan is almost entirely storage latency, and a loop of
+		blocking open, fstat, and read calls only ever has one request in flight. With the
+		io_uring backend up to depth files are in flight at once, each as an openat and a
+		statx submitted together, followed by a read and a close as soon as the open lands,
+		so the device queue stays full from a single thread.
+
+		Files are handed to the sink as they complete, which for io_uring is not necessarily
+		the order they were given in. The backend can be forced so the two can be compared,
+		asking for io_uring on a kernel without it falls back to sync, see backend().
+	*/
+	struct LIBALFHEIM_CLS_API header_loader_t final {
+	private:
+		std::size_t _header_size;
+		std::size_t _depth;
+		load_backend_t _backend;
+		std::vector<std::uint8_t> _buffer{};
+	public:
+		header_loader_t(std::size_t header_size = 4_KiB, std::size_t depth = 64U,
+			load_backend_t backend = load_backend_t::automatic);
+
+		/* The backend actually in use, never automatic */
+		[[nodiscard]]
+		load_backend_t backend() const noexcept { return _backend; }
+		[[nodiscard]]
+		std::size_t header_size() const noexcept { return _header_size; }
+		[[nodiscard]]
+		std::size_t depth() const noexcept { return _depth; }
+
+		/* Loads the header of every path, calling sink once for each of them. The sink must not throw. */
+		void load(Internal::span_t<const fs::path> paths, const header_sink_t& sink);
+	};
+
+	/* Whether the running kernel supports everything the io_uring backend needs */
+	[[nodiscard]]
+	LIBALFHEIM_API bool io_uring_available() noexcept;
+}
+
+#endif /* libalfheim_loader_hh */
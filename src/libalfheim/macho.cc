@@ -2,3 +2,32 @@
 /* macho.cc - Mach-O support */
 
 #include <libalfheim/macho.hh>
+
+namespace Alfheim::MachO {
+	std::optional<macho_any_t> open(const byte_span_t image, const std::size_t header_offset) noexcept {
+		const auto* const magic{image.as<Internal::le_t<std::uint32_t>>(header_offset)};
+		if (!magic)
+			return std::nullopt;
+
+		const auto wrap = [](auto&& macho) -> std::optional<macho_any_t> {
+			if (!macho)
+				return std::nullopt;
+			return macho_any_t{*macho};
+		};
+
+		/* The magic is written in the image's byte order, so reading it as little-endian tells us which that is */
+		switch (magic->value()) {
+			case Types::mh_magic:
+				return wrap(macho32le_t::open(image, header_offset));
+			case Internal::bswap(Types::mh_magic):
+				return wrap(macho32be_t::open(image, header_offset));
+			case Types::mh_magic_64:
+				return wrap(macho64le_t::open(image, header_offset));
+			case Internal::bswap(Types::mh_magic_64):
+				return wrap(macho64be_t::open(image, header_offset));
+			default:
+				break;
+		}
+		return std::nullopt;
+	}
+}
@@ -4,10 +4,578 @@
 #if !defined(libalfheim_macho_hh)
 #define libalfheim_macho_hh
 
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/symbol_index.hh>
+
 #include <libalfheim/macho/types.hh>
 
 namespace Alfheim::MachO {
+	using Internal::span_t;
+	using Internal::byte_span_t;
+	using Internal::narrow_size;
+
+	/* One architecture's image within a universal binary */
+	struct slice_t final {
+		Types::cpu_type_t cpu_type;
+		/* Including the capability bits */
+		std::uint32_t cpu_subtype;
+		/* The alignment of the slice in the file, as a power of 2 */
+		std::uint32_t align;
+		/* A view of the slice's bytes within the universal binary, empty if it runs off the end */
+		byte_span_t data;
+
+		[[nodiscard]]
+		bool matches(const Types::cpu_type_t type, const std::uint32_t subtype = Types::cpu_subtype_any) const noexcept {
+			if (cpu_type != type)
+				return false;
+			return subtype == Types::cpu_subtype_any ||
+				(cpu_subtype & ~Types::cpu_subtype_mask) == (subtype & ~Types::cpu_subtype_mask);
+		}
+	};
+
+	/*
+		A universal (fat) binary
+
+		The arch table is the only thing that is read, each slice is handed back as a view of
+		its range of the parent image, so nothing is copied and a caller after one architecture
+		only ever touches that slice's pages. Both the original 32-bit arch table and the
+		fat_arch_64 table used for slices past 4 GiB are handled.
+	*/
+	struct fat_t final {
+		struct iterator final {
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = slice_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = slice_t;
+		private:
+			const fat_t* _fat{nullptr};
+			std::size_t _idx{0};
+		public:
+			constexpr iterator() noexcept = default;
+			constexpr iterator(const fat_t* const fat, const std::size_t idx) noexcept : _fat{fat}, _idx{idx} { /* NOP */ }
+
+			[[nodiscard]]
+			slice_t operator*() const noexcept { return *_fat->slice(_idx); }
+
+			iterator& operator++() noexcept {
+				++_idx;
+				return *this;
+			}
+
+			iterator operator++(int) noexcept {
+				auto prev{*this};
+				++_idx;
+				return prev;
+			}
+
+			[[nodiscard]]
+			bool operator==(const iterator& other) const noexcept { return _idx == other._idx; }
+			[[nodiscard]]
+			bool operator!=(const iterator& other) const noexcept { return _idx != other._idx; }
+		};
+	private:
+		byte_span_t _image{};
+		span_t<const Types::fat_arch_t> _arches{};
+		span_t<const Types::fat_arch_64_t> _arches_64{};
+
+		[[nodiscard]]
+		slice_t make_slice(const Types::cpu_type_t type, const std::uint32_t subtype, const std::uint64_t offset,
+			const std::uint64_t size, const std::uint32_t align) const noexcept {
+			return {type, subtype, align, _image.subspan(narrow_size(offset), narrow_size(size))};
+		}
+	public:
+		constexpr fat_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<fat_t> open(const byte_span_t image) noexcept {
+			const auto* const header{image.as<Types::fat_header_t>(0)};
+			if (!header)
+				return std::nullopt;
+
+			const std::size_t count{header->nfat_arch};
+			fat_t fat{};
+			fat._image = image;
+			if (header->magic == Types::fat_magic)
+				fat._arches = image.array<Types::fat_arch_t>(sizeof(Types::fat_header_t), count);
+			else if (header->magic == Types::fat_magic_64)
+				fat._arches_64 = image.array<Types::fat_arch_64_t>(sizeof(Types::fat_header_t), count);
+			else
+				return std::nullopt;
+
+			if (!count || fat.size() != count)
+				return std::nullopt;
+			return fat;
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return !_image.empty(); }
+		[[nodiscard]]
+		byte_span_t image() const noexcept { return _image; }
+		[[nodiscard]]
+		bool is_64() const noexcept { return !_arches_64.empty(); }
+		[[nodiscard]]
+		std::size_t size() const noexcept { return is_64() ? _arches_64.size() : _arches.size(); }
+
+		[[nodiscard]]
+		std::optional<slice_t> slice(const std::size_t idx) const noexcept {
+			if (idx >= size())
+				return std::nullopt;
+			if (is_64()) {
+				const auto& arch{_arches_64[idx]};
+				return make_slice(arch.cputype, arch.cpusubtype, arch.offset, arch.size, arch.align);
+			}
+			const auto& arch{_arches[idx]};
+			return make_slice(arch.cputype, arch.cpusubtype, arch.offset, arch.size, arch.align);
+		}
+
+		[[nodiscard]]
+		iterator begin() const noexcept { return {this, 0U}; }
+		[[nodiscard]]
+		iterator end() const noexcept { return {this, size()}; }
+
+		/*
+			Finds the slice for an architecture, only its arch table entry is read
+
+			Passing cpu_subtype_any takes the first slice of the CPU type, otherwise the subtype
+			is compared without its capability bits.
+		*/
+		[[nodiscard]]
+		std::optional<slice_t> find(const Types::cpu_type_t type,
+			const std::uint32_t subtype = Types::cpu_subtype_any) const noexcept {
+			for (std::size_t idx{}; idx < size(); ++idx) {
+				const auto candidate{slice(idx)};
+				if (candidate && candidate->matches(type, subtype))
+					return candidate;
+			}
+			return std::nullopt;
+		}
+	};
+
+	/* A single load command, of which only the type and size have been read */
+	struct load_command_t final {
+		Types::load_command_type_t type;
+		/* The whole command, including the type and size */
+		byte_span_t data;
+
+		/* Decodes the command as T, or returns nullptr if the command is too small to be one */
+		template<typename T>
+		[[nodiscard]]
+		const T* as() const noexcept { return data.template as<T>(0); }
+
+		/* Resolves an lc_str, an offset from the start of the command to a NUL terminated string */
+		[[nodiscard]]
+		std::string_view string(const std::uint32_t offset) const noexcept { return data.string(offset); }
+	};
+
+	/*
+		The load commands of an image
+
+		Iterating only ever reads the 8 byte type and size of each command, stepping over
+		the body by its cmdsize, so finding a single command only touches the headers of the
+		commands before it. A filtered range skips every command of any other type, and a
+		typed range additionally hands back the matching commands decoded as T. Iteration
+		stops at the first command that is malformed or runs past sizeofcmds.
+	*/
+	template<Types::endian_t E, typename T = void>
+	struct load_commands_t final {
+		using header_t = Types::load_command_t<E>;
+		/* Plain commands are handed out by value, typed ones by reference into the image */
+		using reference = std::conditional_t<std::is_void_v<T>, load_command_t, std::add_lvalue_reference_t<const T>>;
+
+		struct iterator final {
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = std::conditional_t<std::is_void_v<T>, load_command_t, T>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = load_commands_t::reference;
+		private:
+			byte_span_t _data{};
+			std::size_t _offset{0};
+			std::size_t _remaining{0};
+			std::optional<Types::load_command_type_t> _filter{};
+			load_command_t _command{};
+
+			/* Advances to the first acceptable command at or after _offset */
+			void settle() noexcept {
+				for (; _remaining; --_remaining) {
+					const auto* const header{_data.template as<header_t>(_offset)};
+					if (!header) {
+						_remaining = 0U;
+						return;
+					}
+					const std::size_t size{header->cmdsize};
+					const auto command{_data.subspan(_offset, size)};
+					if (size < sizeof(header_t) || command.empty()) {
+						_remaining = 0U;
+						return;
+					}
+
+					const auto type{header->cmd.value()};
+					if (!_filter || *_filter == type) {
+						if constexpr (std::is_void_v<T>) {
+							_command = {type, command};
+							return;
+						} else if (size >= sizeof(T)) {
+							_command = {type, command};
+							return;
+						}
+					}
+					_offset += size;
+				}
+			}
+		public:
+			constexpr iterator() noexcept = default;
+			iterator(const byte_span_t data, const std::size_t count,
+				const std::optional<Types::load_command_type_t> filter) noexcept :
+				_data{data}, _remaining{count}, _filter{filter} { settle(); }
+
+			[[nodiscard]]
+			reference operator*() const noexcept {
+				if constexpr (std::is_void_v<T>)
+					return _command;
+				else
+					/* settle() only stops on commands large enough to be a T */
+					return *reinterpret_cast<const T*>(_command.data.data());
+			}
+
+			[[nodiscard]]
+			const load_command_t& command() const noexcept { return _command; }
+
+			iterator& operator++() noexcept {
+				_offset += _command.data.size();
+				--_remaining;
+				settle();
+				return *this;
+			}
+
+			iterator operator++(int) noexcept {
+				auto prev{*this};
+				++*this;
+				return prev;
+			}
+
+			/* Every position has a distinct number of commands left after it */
+			[[nodiscard]]
+			bool operator==(const iterator& other) const noexcept { return _remaining == other._remaining; }
+			[[nodiscard]]
+			bool operator!=(const iterator& other) const noexcept { return _remaining != other._remaining; }
+		};
+	private:
+		byte_span_t _data{};
+		std::size_t _count{0};
+		std::optional<Types::load_command_type_t> _filter{};
+	public:
+		constexpr load_commands_t() noexcept = default;
+		constexpr load_commands_t(const byte_span_t data, const std::size_t count,
+			const std::optional<Types::load_command_type_t> filter = std::nullopt) noexcept :
+			_data{data}, _count{count}, _filter{filter} { /* NOP */ }
+
+		[[nodiscard]]
+		byte_span_t data() const noexcept { return _data; }
+
+		[[nodiscard]]
+		iterator begin() const noexcept { return {_data, _count, _filter}; }
+		[[nodiscard]]
+		iterator end() const noexcept { return {}; }
+	};
+
+	/* The nlist symbol table along with the string table that its names live in */
+	template<typename L>
+	struct symtab_t final {
+		using nlist_t = typename L::nlist_t;
+		using iterator = typename span_t<const nlist_t>::iterator;
+	private:
+		span_t<const nlist_t> _symbols{};
+		byte_span_t _strings{};
+	public:
+		constexpr symtab_t() noexcept = default;
+		constexpr symtab_t(const span_t<const nlist_t> symbols, const byte_span_t strings) noexcept :
+			_symbols{symbols}, _strings{strings} { /* NOP */ }
+
+		[[nodiscard]]
+		bool valid() const noexcept { return !_symbols.empty(); }
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _symbols.size(); }
+		[[nodiscard]]
+		span_t<const nlist_t> symbols() const noexcept { return _symbols; }
+
+		[[nodiscard]]
+		iterator begin() const noexcept { return _symbols.begin(); }
+		[[nodiscard]]
+		iterator end() const noexcept { return _symbols.end(); }
+		[[nodiscard]]
+		const nlist_t& operator[](const std::size_t idx) const noexcept { return _symbols[idx]; }
+
+		[[nodiscard]]
+		std::string_view name(const nlist_t& sym) const noexcept { return _strings.string(sym.n_strx); }
+
+		[[nodiscard]]
+		static bool is_debug(const nlist_t& sym) noexcept { return sym.n_type & Types::n_stab; }
+		[[nodiscard]]
+		static bool is_external(const nlist_t& sym) noexcept { return sym.n_type & Types::n_ext; }
+		/* Visible to the static linker, but made local to the image it was linked into */
+		[[nodiscard]]
+		static bool is_private_external(const nlist_t& sym) noexcept { return sym.n_type & Types::n_pext; }
+		[[nodiscard]]
+		static Types::nlist_type_t type(const nlist_t& sym) noexcept {
+			return static_cast<Types::nlist_type_t>(sym.n_type & Types::n_type);
+		}
+	};
+
+	/* Turns a fixed size, possibly unterminated, segment or section name into a string */
+	[[nodiscard]]
+	inline std::string_view fixed_name(const std::array<char, 16>& name) noexcept {
+		std::size_t len{0};
+		while (len < name.size() && name[len])
+			++len;
+		return {name.data(), len};
+	}
+
+	/*
+		A lazy, zero-copy reader for a thin Mach-O image
+
+		Like the ELF reader only the header is validated up front, and every load command,
+		segment, section, and table is a view into the image that is bounds checked on
+		access. The header need not be at the start of the image, images inside of a dyld
+		shared cache have file offsets relative to the cache, so those are opened over the
+		whole cache with the offset of their header.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	struct macho_t final {
+		using layout = Types::layout_t<C, E>;
+		using addr_t = typename layout::addr_t;
+		using header_t = typename layout::header_t;
+		using segment_t = typename layout::segment_t;
+		using section_t = typename layout::section_t;
+		using nlist_t = typename layout::nlist_t;
+		using symtab_t = MachO::symtab_t<layout>;
+
+		template<typename T = void>
+		using commands_t = load_commands_t<E, T>;
+		template<template<Types::endian_t> typename T>
+		using command_t = T<E>;
+
+		static constexpr Types::class_t macho_class{C};
+		static constexpr Types::endian_t endian{E};
+	private:
+		byte_span_t _image{};
+		const header_t* _header{nullptr};
+		std::size_t _header_offset{0};
+
+		constexpr macho_t(const byte_span_t image, const header_t* const header, const std::size_t offset) noexcept :
+			_image{image}, _header{header}, _header_offset{offset} { /* NOP */ }
+	public:
+		constexpr macho_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<macho_t> open(const byte_span_t image, const std::size_t header_offset = 0U) noexcept {
+			const auto* const header{image.template as<header_t>(header_offset)};
+			if (!header || header->magic != layout::magic)
+				return std::nullopt;
+			return macho_t{image, header, header_offset};
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _header; }
+		[[nodiscard]]
+		byte_span_t image() const noexcept { return _image; }
+		[[nodiscard]]
+		std::size_t header_offset() const noexcept { return _header_offset; }
+		[[nodiscard]]
+		const header_t& header() const noexcept { return *_header; }
+
+		[[nodiscard]]
+		Types::cpu_type_t cpu_type() const noexcept { return _header->cputype; }
+		[[nodiscard]]
+		std::uint32_t cpu_subtype() const noexcept { return _header->cpusubtype; }
+		[[nodiscard]]
+		Types::filetype_t file_type() const noexcept { return _header->filetype; }
+
+		/* Every load command, clamped to the image if sizeofcmds overruns it */
+		[[nodiscard]]
+		commands_t<> commands() const noexcept {
+			const auto start{_header_offset + sizeof(header_t)};
+			const auto region{_image.subspan(start)};
+			return {region.first(std::min<std::size_t>(_header->sizeofcmds, region.size())), _header->ncmds};
+		}
+
+		/* Only the load commands of the given type */
+		[[nodiscard]]
+		commands_t<> commands(const Types::load_command_type_t type) const noexcept {
+			const auto all{commands()};
+			return {all.data(), _header->ncmds, type};
+		}
+
+		/* The load commands of the given type decoded as T, skipping any too small to be one */
+		template<typename T>
+		[[nodiscard]]
+		commands_t<T> commands(const Types::load_command_type_t type) const noexcept {
+			const auto all{commands()};
+			return {all.data(), _header->ncmds, type};
+		}
+
+		/* The first load command of the given type decoded as T */
+		template<typename T>
+		[[nodiscard]]
+		const T* command(const Types::load_command_type_t type) const noexcept {
+			const auto matching{commands<T>(type)};
+			const auto first{matching.begin()};
+			return first != matching.end() ? &*first : nullptr;
+		}
+
+		[[nodiscard]]
+		commands_t<segment_t> segments() const noexcept { return commands<segment_t>(layout::segment_command); }
+
+		[[nodiscard]]
+		const segment_t* segment(const std::string_view name) const noexcept {
+			for (const auto& segment : segments()) {
+				if (fixed_name(segment.segname) == name)
+					return &segment;
+			}
+			return nullptr;
+		}
+
+		/* The section headers that directly follow a segment command, empty if they overrun the command */
+		[[nodiscard]]
+		span_t<const section_t> sections(const segment_t& segment) const noexcept {
+			const std::size_t count{segment.nsects};
+			if (count > (std::size_t{segment.cmdsize} - sizeof(segment_t)) / sizeof(section_t))
+				return {};
+			const auto offset{std::size_t(reinterpret_cast<const std::uint8_t*>(&segment) - _image.data())};
+			return _image.template array<section_t>(offset + sizeof(segment_t), count);
+		}
+
+		[[nodiscard]]
+		const section_t* section(const std::string_view segment_name, const std::string_view section_name) const noexcept {
+			const auto* const owner{segment(segment_name)};
+			if (!owner)
+				return nullptr;
+			for (const auto& sect : sections(*owner)) {
+				if (fixed_name(sect.sectname) == section_name)
+					return &sect;
+			}
+			return nullptr;
+		}
+
+		[[nodiscard]]
+		byte_span_t segment_data(const segment_t& segment) const noexcept {
+			return _image.subspan(narrow_size(addr_t{segment.fileoff}), narrow_size(addr_t{segment.filesize}));
+		}
+
+		/* Zero fill sections have no file contents, so these come back empty */
+		[[nodiscard]]
+		byte_span_t section_data(const section_t& sect) const noexcept {
+			/* S_ZEROFILL, S_GB_ZEROFILL, and S_THREAD_LOCAL_ZEROFILL */
+			const auto type{std::uint32_t{sect.flags} & 0xFFU};
+			if (type == 0x01U || type == 0x0CU || type == 0x12U)
+				return {};
+			return _image.subspan(std::size_t{sect.offset}, narrow_size(addr_t{sect.size}));
+		}
+
+		/* Translates a virtual address into a file offset by way of the segments */
+		[[nodiscard]]
+		std::optional<std::size_t> offset_of(const addr_t vmaddr) const noexcept {
+			for (const auto& segment : segments()) {
+				const addr_t base{segment.vmaddr};
+				if (vmaddr >= base && vmaddr - base < addr_t{segment.filesize})
+					return narrow_size(addr_t(addr_t{segment.fileoff} + (vmaddr - base)));
+			}
+			return std::nullopt;
+		}
+
+		[[nodiscard]]
+		std::optional<std::array<std::uint8_t, 16>> uuid() const noexcept {
+			if (const auto* const cmd{command<command_t<Types::uuid_command_t>>(Types::load_command_type_t::uuid)})
+				return cmd->uuid;
+			return std::nullopt;
+		}
+
+		[[nodiscard]]
+		symtab_t symbols() const noexcept {
+			const auto* const cmd{command<command_t<Types::symtab_command_t>>(Types::load_command_type_t::symtab)};
+			if (!cmd)
+				return {};
+			return {
+				_image.template array<nlist_t>(std::size_t{cmd->symoff}, std::size_t{cmd->nsyms}),
+				_image.subspan(std::size_t{cmd->stroff}, std::size_t{cmd->strsize})
+			};
+		}
+
+		/* The __LINKEDIT payload of a linkedit_data_command, such as LC_FUNCTION_STARTS or LC_CODE_SIGNATURE */
+		[[nodiscard]]
+		byte_span_t linkedit_data(const Types::load_command_type_t type) const noexcept {
+			const auto* const cmd{command<command_t<Types::linkedit_data_command_t>>(type)};
+			if (!cmd)
+				return {};
+			return _image.subspan(std::size_t{cmd->dataoff}, std::size_t{cmd->datasize});
+		}
+
+		[[nodiscard]]
+		byte_span_t chained_fixups() const noexcept { return linkedit_data(Types::load_command_type_t::dyld_chained_fixups); }
+
+		[[nodiscard]]
+		const command_t<Types::dyld_info_command_t>* dyld_info() const noexcept {
+			if (const auto* const cmd{command<command_t<Types::dyld_info_command_t>>(Types::load_command_type_t::dyld_info_only)})
+				return cmd;
+			return command<command_t<Types::dyld_info_command_t>>(Types::load_command_type_t::dyld_info);
+		}
+
+		/* The export trie, from LC_DYLD_EXPORTS_TRIE or failing that from LC_DYLD_INFO */
+		[[nodiscard]]
+		byte_span_t exports_trie() const noexcept {
+			if (const auto trie{linkedit_data(Types::load_command_type_t::dyld_exports_trie)}; !trie.empty())
+				return trie;
+			if (const auto* const info{dyld_info()})
+				return _image.subspan(std::size_t{info->export_off}, std::size_t{info->export_size});
+			return {};
+		}
+	};
+
+	/*
+		Adds the defined symbols of an image to an address index
+
+		nlist entries carry no size, so each symbol extends up to the next one. Debugger
+		(N_STAB) entries and anything not defined in a section are skipped.
+	*/
+	template<Types::class_t C, Types::endian_t E>
+	void index_symbols(const macho_t<C, E>& macho, symbol_index_t::builder_t& builder, const std::uint64_t bias = 0U) {
+		using symtab_t = typename macho_t<C, E>::symtab_t;
+
+		const auto symtab{macho.symbols()};
+		builder.reserve(builder.size() + symtab.size());
+		for (const auto& sym : symtab) {
+			if (symtab_t::is_debug(sym) || symtab_t::type(sym) != Types::nlist_type_t::sect)
+				continue;
+			const auto name{symtab.name(sym)};
+			if (name.empty())
+				continue;
+			builder.add(std::uint64_t{sym.n_value} + bias, 0U, name);
+		}
+	}
+
+	using macho32le_t = macho_t<Types::class_t::macho32, Types::endian_t::little>;
+	using macho32be_t = macho_t<Types::class_t::macho32, Types::endian_t::big>;
+	using macho64le_t = macho_t<Types::class_t::macho64, Types::endian_t::little>;
+	using macho64be_t = macho_t<Types::class_t::macho64, Types::endian_t::big>;
+
+	using macho_any_t = std::variant<macho32le_t, macho32be_t, macho64le_t, macho64be_t>;
 
+	/* Opens a thin image with whichever class and byte order its magic says it has */
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<macho_any_t> open(byte_span_t image, std::size_t header_offset = 0U) noexcept;
 }
 
 #endif /* libalfheim_macho_hh */
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* macho/dyld_cache.cc - dyld shared cache reader */
+
+#include <cstddef>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+
+#include <libalfheim/macho/dyld_cache.hh>
+
+namespace Alfheim::MachO {
+	namespace {
+		/* Headers at least this long have images_offset and images_count, the last fields we know about */
+		constexpr std::size_t images_header_size{sizeof(Types::dyld_cache_header_t)};
+		/* dyld shared caches only exist for little-endian targets, the magic is "dyld_v1" padded out with the arch name */
+		constexpr std::array<char, 7> dyld_cache_magic{{'d', 'y', 'l', 'd', '_', 'v', '1'}};
+
+		/*
+			Whether an image's symbol and string tables are in this file
+
+			The symtab offsets are file offsets into whichever sub-cache maps __LINKEDIT, which
+			in a split cache is a different file, so they are only trusted when this file maps
+			__LINKEDIT at the offset the segment claims and both tables lie inside it.
+		*/
+		template<typename M>
+		bool symbols_present(const dyld_cache_t& cache, const M& macho) noexcept {
+			using nlist_t = typename M::nlist_t;
+			using symtab_command_t = typename M::template command_t<Types::symtab_command_t>;
+			const auto* const symtab{macho.template command<symtab_command_t>(Types::load_command_type_t::symtab)};
+			const auto* const linkedit{macho.segment("__LINKEDIT")};
+			if (!symtab || !linkedit)
+				return false;
+			const std::uint64_t start{linkedit->fileoff};
+			const auto offset{cache.offset_of(linkedit->vmaddr)};
+			if (!offset || *offset != start || start > cache.data().size())
+				return false;
+			const std::uint64_t end{start + std::min<std::uint64_t>(linkedit->filesize, cache.data().size() - start)};
+			const auto contained{[&](const std::uint64_t table, const std::uint64_t len) noexcept {
+				return table >= start && table <= end && len <= end - table;
+			}};
+			return contained(symtab->symoff, std::uint64_t{symtab->nsyms} * sizeof(nlist_t)) &&
+				contained(symtab->stroff, symtab->strsize);
+		}
+	}
+
+	dyld_cache_t::dyld_cache_t(const dyld_cache_t&) = default;
+	dyld_cache_t::dyld_cache_t(dyld_cache_t&&) noexcept = default;
+	dyld_cache_t::~dyld_cache_t() noexcept = default;
+	dyld_cache_t& dyld_cache_t::operator=(const dyld_cache_t&) = default;
+	dyld_cache_t& dyld_cache_t::operator=(dyld_cache_t&&) noexcept = default;
+
+	std::optional<dyld_cache_t> dyld_cache_t::open(const byte_span_t data) {
+		const auto* const header{data.as<Types::dyld_cache_header_t>(0)};
+		if (!header || std::memcmp(header->magic.data(), dyld_cache_magic.data(), dyld_cache_magic.size()))
+			return std::nullopt;
+
+		dyld_cache_t cache{};
+		cache._data = data;
+		cache._header = header;
+		cache._mappings = data.array<Types::dyld_cache_mapping_info_t>(
+			std::size_t{header->mapping_offset}, std::size_t{header->mapping_count}
+		);
+		if (cache._mappings.empty())
+			return std::nullopt;
+
+		/* Newer caches moved the image table, leaving the original fields zeroed */
+		const bool relocated{header->mapping_offset >= images_header_size && header->images_offset};
+		const std::size_t images_offset{relocated ? header->images_offset : header->images_offset_old};
+		const std::size_t images_count{relocated ? header->images_count : header->images_count_old};
+		const auto infos{data.array<Types::dyld_cache_image_info_t>(images_offset, images_count)};
+		if (infos.size() != images_count)
+			return std::nullopt;
+
+		/* The __TEXT extents are only trusted if they line up one for one with the image table */
+		span_t<const Types::dyld_cache_image_text_info_t> texts{};
+		if (header->mapping_offset > offsetof(Types::dyld_cache_header_t, images_text_count) &&
+			header->images_text_count == images_count)
+			texts = data.array<Types::dyld_cache_image_text_info_t>(
+				narrow_size(header->images_text_offset.value()), narrow_size(header->images_text_count.value())
+			);
+
+		cache._images.reserve(infos.size());
+		for (std::size_t idx{}; idx < infos.size(); ++idx) {
+			const auto& info{infos[idx]};
+			const std::uint64_t address{info.address};
+			const auto offset{cache.offset_of(address)};
+			const auto text_size{
+				(texts.size() == infos.size() && texts[idx].load_address == address) ? texts[idx].text_segment_size.value() : 0U
+			};
+			cache._images.push_back({address, text_size, offset.value_or(npos), data.string(std::size_t{info.path_file_offset})});
+		}
+
+		const auto count{static_cast<std::uint32_t>(cache._images.size())};
+		const auto& images{cache._images};
+		cache._by_address.resize(count);
+		std::iota(cache._by_address.begin(), cache._by_address.end(), 0U);
+		cache._by_path = cache._by_address;
+		std::sort(cache._by_address.begin(), cache._by_address.end(),
+			[&](const std::uint32_t lhs, const std::uint32_t rhs) noexcept { return images[lhs].address < images[rhs].address; });
+		std::sort(cache._by_path.begin(), cache._by_path.end(),
+			[&](const std::uint32_t lhs, const std::uint32_t rhs) noexcept { return images[lhs].path < images[rhs].path; });
+		return cache;
+	}
+
+	std::string_view dyld_cache_t::arch() const noexcept {
+		const auto& magic{_header->magic};
+		std::string_view name{magic.data() + dyld_cache_magic.size(), magic.size() - dyld_cache_magic.size()};
+		name = name.substr(0U, name.find('\0'));
+		const auto start{name.find_first_not_of(' ')};
+		return start == std::string_view::npos ? std::string_view{} : name.substr(start);
+	}
+
+	/* There are only ever a handful of mappings, so a linear scan beats anything cleverer */
+	std::optional<std::size_t> dyld_cache_t::offset_of(const std::uint64_t address) const noexcept {
+		for (const auto& mapping : _mappings) {
+			const std::uint64_t base{mapping.address};
+			if (address >= base && address - base < mapping.size)
+				return narrow_size(std::uint64_t{mapping.file_offset} + (address - base));
+		}
+		return std::nullopt;
+	}
+
+	byte_span_t dyld_cache_t::address_data(const std::uint64_t address, const std::size_t len) const noexcept {
+		for (const auto& mapping : _mappings) {
+			const std::uint64_t base{mapping.address};
+			if (address < base || address - base >= mapping.size)
+				continue;
+			if (len > mapping.size - (address - base))
+				return {};
+			const auto data{_data.subspan(narrow_size(std::uint64_t{mapping.file_offset} + (address - base)), len)};
+			return data.size() == len ? data : byte_span_t{};
+		}
+		return {};
+	}
+
+	std::size_t dyld_cache_t::find(const std::string_view path) const noexcept {
+		const auto iter{std::lower_bound(_by_path.begin(), _by_path.end(), path,
+			[&](const std::uint32_t idx, const std::string_view value) noexcept { return _images[idx].path < value; })};
+		if (iter == _by_path.end() || _images[*iter].path != path)
+			return npos;
+		return *iter;
+	}
+
+	std::size_t dyld_cache_t::find(const std::uint64_t address) const noexcept {
+		const auto iter{std::upper_bound(_by_address.begin(), _by_address.end(), address,
+			[&](const std::uint64_t value, const std::uint32_t idx) noexcept { return value < _images[idx].address; })};
+		if (iter == _by_address.begin())
+			return npos;
+		const auto& image{_images[*std::prev(iter)]};
+		if (image.text_size && address - image.address >= image.text_size)
+			return npos;
+		return *std::prev(iter);
+	}
+
+	std::optional<macho_any_t> dyld_cache_t::macho(const std::size_t idx) const noexcept {
+		if (idx >= _images.size() || !_images[idx].present())
+			return std::nullopt;
+		return MachO::open(_data, _images[idx].header_offset);
+	}
+
+	std::size_t index_symbols(const dyld_cache_t& cache, symbol_index_t::builder_t& builder) {
+		/* Opening an image is only a header check, so it's cheaper to do twice than to keep them all */
+		std::size_t total{};
+		for (std::size_t idx{}; idx < cache.size(); ++idx) {
+			if (const auto image{cache.macho(idx)})
+				total += std::visit([&](const auto& macho) -> std::size_t {
+					return symbols_present(cache, macho) ? macho.symbols().size() : 0U;
+				}, *image);
+		}
+		builder.reserve(builder.size() + total);
+
+		std::size_t indexed{};
+		for (std::size_t idx{}; idx < cache.size(); ++idx) {
+			const auto image{cache.macho(idx)};
+			if (!image)
+				continue;
+			indexed += std::visit([&](const auto& macho) -> std::size_t {
+				if (!symbols_present(cache, macho))
+					return 0U;
+				index_symbols(macho, builder);
+				return 1U;
+			}, *image);
+		}
+		return indexed;
+	}
+}
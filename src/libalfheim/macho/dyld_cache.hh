@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* macho/dyld_cache.hh - dyld shared cache reader */
+#pragma once
+#if !defined(libalfheim_macho_dyld_cache_hh)
+#define libalfheim_macho_dyld_cache_hh
+
+#include <cstdint>
+#include <array>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/macho.hh>
+#include <libalfheim/symbol_index.hh>
+
+namespace Alfheim::MachO {
+	/* One image in a dyld shared cache */
+	struct cache_image_t final {
+		static constexpr std::size_t npos{std::numeric_limits<std::size_t>::max()};
+
+		std::uint64_t address;
+		/* The size of the image's __TEXT if the cache records it, otherwise 0 */
+		std::uint64_t text_size;
+		/* The offset of the mach header in the cache file, or npos if it lives in another sub-cache */
+		std::size_t header_offset;
+		std::string_view path;
+
+		[[nodiscard]]
+		bool present() const noexcept { return header_offset != npos; }
+	};
+
+	/*
+		A dyld shared cache, the single file holding every system dylib
+
+		The mappings and the image list are indexed once when the cache is opened, resolving
+		each image's header to a file offset and sorting the images by address and by path.
+		After that every image is handed out as a macho_t over the one cache mapping, as the
+		file offsets in a cached image's load commands are relative to the cache rather than
+		the image, so there is no per-image I/O or copying at all.
+
+		For a multi-GiB cache mapped with mmap_t, advising MADV_RANDOM keeps lookups from
+		dragging in readahead of neighbouring images.
+
+		Split caches are read one file at a time, images whose header is in a different
+		sub-cache are still listed, but aren't present() and can't be opened from this one.
+	*/
+	struct LIBALFHEIM_CLS_API dyld_cache_t final {
+		static constexpr std::size_t npos{cache_image_t::npos};
+	private:
+		byte_span_t _data{};
+		const Types::dyld_cache_header_t* _header{nullptr};
+		span_t<const Types::dyld_cache_mapping_info_t> _mappings{};
+		/* In the order of the cache's image table */
+		std::vector<cache_image_t> _images{};
+		std::vector<std::uint32_t> _by_address{};
+		std::vector<std::uint32_t> _by_path{};
+	public:
+		dyld_cache_t() noexcept = default;
+		dyld_cache_t(const dyld_cache_t&);
+		dyld_cache_t(dyld_cache_t&&) noexcept;
+		~dyld_cache_t() noexcept;
+		dyld_cache_t& operator=(const dyld_cache_t&);
+		dyld_cache_t& operator=(dyld_cache_t&&) noexcept;
+
+		[[nodiscard]]
+		static std::optional<dyld_cache_t> open(byte_span_t data);
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _header; }
+		[[nodiscard]]
+		byte_span_t data() const noexcept { return _data; }
+		[[nodiscard]]
+		const Types::dyld_cache_header_t& header() const noexcept { return *_header; }
+		[[nodiscard]]
+		const std::array<std::uint8_t, 16>& uuid() const noexcept { return _header->uuid; }
+		[[nodiscard]]
+		span_t<const Types::dyld_cache_mapping_info_t> mappings() const noexcept { return _mappings; }
+
+		/* The architecture named in the magic, such as "arm64e" or "x86_64h" */
+		[[nodiscard]]
+		std::string_view arch() const noexcept;
+
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _images.size(); }
+		[[nodiscard]]
+		span_t<const cache_image_t> images() const noexcept { return {_images.data(), _images.size()}; }
+		[[nodiscard]]
+		const cache_image_t& image(const std::size_t idx) const noexcept { return _images[idx]; }
+
+		/* Translates a cache virtual address into an offset in this file by way of the mappings */
+		[[nodiscard]]
+		std::optional<std::size_t> offset_of(std::uint64_t address) const noexcept;
+
+		/* The bytes at address, empty if they aren't all in one mapping of this file */
+		[[nodiscard]]
+		byte_span_t address_data(std::uint64_t address, std::size_t len) const noexcept;
+
+		/* The index of the image with the given install name, or npos */
+		[[nodiscard]]
+		std::size_t find(std::string_view path) const noexcept;
+
+		/*
+			The index of the image containing address, or npos
+
+			Where the cache has no __TEXT extents this is the nearest image starting at or
+			below address, so the caller should confirm it against the image's segments.
+		*/
+		[[nodiscard]]
+		std::size_t find(std::uint64_t address) const noexcept;
+
+		/* Opens an image as a view over the whole cache */
+		[[nodiscard]]
+		std::optional<macho_any_t> macho(std::size_t idx) const noexcept;
+	};
+
+	/*
+		Adds the symbols of every image present in the cache to one address index
+
+		As with index_symbols() on a single image, names are views into the cache. Images
+		whose symbol tables live in another sub-cache of a split cache are skipped. Returns
+		the number of images that were indexed.
+	*/
+	LIBALFHEIM_API std::size_t index_symbols(const dyld_cache_t& cache, symbol_index_t::builder_t& builder);
+}
+
+#endif /* libalfheim_macho_dyld_cache_hh */
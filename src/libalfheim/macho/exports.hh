@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* macho/exports.hh - Mach-O export trie lookup and enumeration */
+#pragma once
+#if !defined(libalfheim_macho_exports_hh)
+#define libalfheim_macho_exports_hh
+
+#include <cstdint>
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <libalfheim/internal/leb128.hh>
+
+#include <libalfheim/macho.hh>
+
+namespace Alfheim::MachO {
+	using Internal::leb128_cursor_t;
+
+	/* A single exported symbol, decoded from a terminal node of the trie */
+	struct export_t final {
+		std::string_view name;
+		Types::export_flags_t flags;
+		/* The offset of the symbol from the mach header, or its value for absolute symbols */
+		std::uint64_t address;
+		/* The offset of the resolver function, for stub_and_resolver */
+		std::uint64_t resolver;
+		/* For re-exports, the one-based ordinal of the dylib and the name there if it differs */
+		std::uint64_t ordinal;
+		std::string_view import_name;
+
+		[[nodiscard]]
+		Types::export_flags_t kind() const noexcept {
+			return Types::export_flags_t(std::uint64_t(flags) & std::uint64_t(Types::export_flags_t::kind_mask));
+		}
+		[[nodiscard]]
+		bool has_flag(const Types::export_flags_t flag) const noexcept {
+			return (std::uint64_t(flags) & std::uint64_t(flag)) != 0U;
+		}
+		[[nodiscard]]
+		bool is_reexport() const noexcept { return has_flag(Types::export_flags_t::reexport); }
+		[[nodiscard]]
+		bool is_weak() const noexcept { return has_flag(Types::export_flags_t::weak_definition); }
+		[[nodiscard]]
+		bool has_resolver() const noexcept { return has_flag(Types::export_flags_t::stub_and_resolver); }
+	};
+
+	/*
+		A view over an export trie, as found via LC_DYLD_EXPORTS_TRIE or LC_DYLD_INFO
+
+		Each node is a ULEB128 terminal size, the terminal info if that is non-zero, and then
+		a one byte child count followed by that many NUL terminated edge labels, each with
+		the ULEB128 offset of the node it leads to. Lookups follow a single path from the
+		root, decoding only the nodes along it straight from the mapped bytes, and allocate
+		nothing. Enumeration is a single depth first pass that visits each node once.
+	*/
+	struct export_trie_t final {
+	private:
+		struct node_t final {
+			std::size_t terminal;
+			std::size_t terminal_size;
+			std::size_t children;
+			std::size_t child_count;
+		};
+
+		struct frame_t final {
+			std::size_t offset;
+			std::size_t name_size;
+			std::string_view label;
+		};
+
+		byte_span_t _data{};
+
+		[[nodiscard]]
+		bool read_node(const std::size_t offset, node_t& node) const noexcept {
+			if (offset >= _data.size())
+				return false;
+			leb128_cursor_t cursor{_data, offset};
+			const auto terminal_size{cursor.read_uleb<std::size_t>()};
+			if (!terminal_size)
+				return false;
+			node.terminal = cursor.offset();
+			node.terminal_size = *terminal_size;
+			if (!cursor.skip(node.terminal_size))
+				return false;
+			const auto child_count{cursor.read_byte()};
+			if (!child_count)
+				return false;
+			node.children = cursor.offset();
+			node.child_count = *child_count;
+			return true;
+		}
+
+		[[nodiscard]]
+		std::optional<export_t> terminal(const node_t& node, const std::string_view name) const noexcept {
+			leb128_cursor_t cursor{_data.subspan(node.terminal, node.terminal_size)};
+			const auto flags{cursor.read_uleb()};
+			if (!flags)
+				return std::nullopt;
+
+			export_t entry{name, Types::export_flags_t(*flags), 0U, 0U, 0U, {}};
+			if (entry.is_reexport()) {
+				const auto ordinal{cursor.read_uleb()};
+				const auto import_name{ordinal ? cursor.read_string() : std::nullopt};
+				if (!import_name)
+					return std::nullopt;
+				entry.ordinal = *ordinal;
+				entry.import_name = *import_name;
+				return entry;
+			}
+
+			const auto address{cursor.read_uleb()};
+			if (!address)
+				return std::nullopt;
+			entry.address = *address;
+			if (entry.has_resolver()) {
+				const auto resolver{cursor.read_uleb()};
+				if (!resolver)
+					return std::nullopt;
+				entry.resolver = *resolver;
+			}
+			return entry;
+		}
+
+		/* Walks every terminal below the node at offset, name holds the path to it on entry */
+		template<typename F>
+		[[nodiscard]]
+		bool walk(const std::size_t offset, std::string& name, F& func) const {
+			std::vector<frame_t> stack{{offset, name.size(), {}}};
+			/* Every node is at least two bytes, so anything past this many has looped back on itself */
+			std::size_t budget{_data.size() / 2U};
+			while (!stack.empty()) {
+				const auto frame{stack.back()};
+				stack.pop_back();
+				if (!budget--)
+					return false;
+
+				name.resize(frame.name_size);
+				name.append(frame.label);
+				node_t node{};
+				if (!read_node(frame.offset, node))
+					return false;
+				if (node.terminal_size) {
+					const auto entry{terminal(node, name)};
+					if (!entry)
+						return false;
+					func(*entry);
+				}
+
+				leb128_cursor_t cursor{_data, node.children};
+				const auto first{stack.size()};
+				for (std::size_t idx{}; idx < node.child_count; ++idx) {
+					const auto label{cursor.read_string()};
+					const auto child{label ? cursor.read_uleb<std::size_t>() : std::nullopt};
+					if (!child || label->empty())
+						return false;
+					stack.push_back({*child, name.size(), *label});
+				}
+				/* Keep the children in the order they're stored in, which is how ld64 sorts them */
+				std::reverse(stack.begin() + std::ptrdiff_t(first), stack.end());
+			}
+			return true;
+		}
+	public:
+		constexpr export_trie_t() noexcept = default;
+		constexpr export_trie_t(const byte_span_t data) noexcept : _data{data} { /* NOP */ }
+
+		[[nodiscard]]
+		constexpr bool empty() const noexcept { return _data.empty(); }
+		[[nodiscard]]
+		constexpr byte_span_t data() const noexcept { return _data; }
+
+		/* Looks up a single symbol by its exact name, the result's name is a view of the argument */
+		[[nodiscard]]
+		std::optional<export_t> find(const std::string_view name) const noexcept {
+			std::size_t offset{};
+			auto rest{name};
+			while (true) {
+				node_t node{};
+				if (!read_node(offset, node))
+					return std::nullopt;
+				if (rest.empty()) {
+					if (!node.terminal_size)
+						return std::nullopt;
+					return terminal(node, name);
+				}
+
+				leb128_cursor_t cursor{_data, node.children};
+				bool matched{false};
+				for (std::size_t idx{}; idx < node.child_count && !matched; ++idx) {
+					const auto label{cursor.read_string()};
+					const auto child{label ? cursor.read_uleb<std::size_t>() : std::nullopt};
+					if (!child || label->empty())
+						return std::nullopt;
+					if (label->front() != rest.front())
+						continue;
+					/* No two edges out of a node share a first character, so this is the only candidate */
+					if (rest.substr(0U, label->size()) != *label)
+						return std::nullopt;
+					rest.remove_prefix(label->size());
+					offset = *child;
+					matched = true;
+				}
+				if (!matched)
+					return std::nullopt;
+			}
+		}
+
+		/*
+			Calls func with every export whose name starts with prefix
+
+			Only the subtree below the prefix is visited. Names are built up in a single
+			buffer as the walk descends, so each one is only valid for the duration of the
+			call. Returns false if the walk ran into a malformed node, after having reported
+			everything up to it.
+		*/
+		template<typename F>
+		bool for_each(const std::string_view prefix, F&& func) const {
+			std::string name{};
+			std::size_t offset{};
+			std::size_t matched{};
+			while (matched < prefix.size()) {
+				node_t node{};
+				if (!read_node(offset, node))
+					return false;
+
+				leb128_cursor_t cursor{_data, node.children};
+				bool found{false};
+				for (std::size_t idx{}; idx < node.child_count && !found; ++idx) {
+					const auto label{cursor.read_string()};
+					const auto child{label ? cursor.read_uleb<std::size_t>() : std::nullopt};
+					if (!child || label->empty())
+						return false;
+					if (label->front() != prefix[matched])
+						continue;
+
+					/* The prefix may well end part way along an edge */
+					const auto common{std::min(label->size(), prefix.size() - matched)};
+					if (label->substr(0U, common) != prefix.substr(matched, common))
+						return true;
+					name.append(*label);
+					matched += common;
+					offset = *child;
+					found = true;
+				}
+				if (!found)
+					return true;
+			}
+			return walk(offset, name, func);
+		}
+
+		/* Calls func with every export in the trie */
+		template<typename F>
+		bool for_each(F&& func) const { return for_each(std::string_view{}, func); }
+	};
+
+	template<Types::class_t C, Types::endian_t E>
+	[[nodiscard]]
+	export_trie_t exports(const macho_t<C, E>& macho) noexcept { return export_trie_t{macho.exports_trie()}; }
+}
+
+#endif /* libalfheim_macho_exports_hh */
@@ -4,8 +4,545 @@
 #if !defined(libalfheim_macho_types_hh)
 #define libalfheim_macho_types_hh
 
+#include <cstdint>
+#include <array>
+
+#include <libalfheim/internal/endian.hh>
+
 namespace Alfheim::MachO::Types {
+	using Alfheim::Internal::endian_t;
+	using Alfheim::Internal::endian_value_t;
+	using Alfheim::Internal::be_t;
+	using Alfheim::Internal::le_t;
+
+	/* Universal binaries are always big-endian */
+	constexpr std::uint32_t fat_magic{0xCAFEBABEU};
+	constexpr std::uint32_t fat_magic_64{0xCAFEBABFU};
+
+	/* Set on 64-bit variants of a CPU type */
+	constexpr std::int32_t cpu_arch_abi64{0x01000000};
+	/* Set on ILP32 variants of a 64-bit CPU type, such as arm64_32 */
+	constexpr std::int32_t cpu_arch_abi64_32{0x02000000};
+
+	enum struct cpu_type_t : std::int32_t {
+		any       = -1,
+		vax       = 1,
+		mc680x0   = 6,
+		x86       = 7,
+		x86_64    = x86 | cpu_arch_abi64,
+		mc98000   = 10,
+		hppa      = 11,
+		arm       = 12,
+		arm64     = arm | cpu_arch_abi64,
+		arm64_32  = arm | cpu_arch_abi64_32,
+		mc88000   = 13,
+		sparc     = 14,
+		i860      = 15,
+		powerpc   = 18,
+		powerpc64 = powerpc | cpu_arch_abi64,
+	};
+
+	/* The top byte of a CPU subtype holds capability bits rather than the subtype proper */
+	constexpr std::uint32_t cpu_subtype_mask{0xFF000000U};
+	constexpr std::uint32_t cpu_subtype_any{0xFFFFFFFFU};
+
+	/* The more common CPU subtypes, these are only meaningful alongside their CPU type */
+	enum struct cpu_subtype_t : std::uint32_t {
+		x86_all    = 3,
+		x86_64_all = 3,
+		x86_64_h   = 8,
+		arm_all    = 0,
+		arm_v7     = 9,
+		arm_v7s    = 11,
+		arm_v7k    = 12,
+		arm64_all  = 0,
+		arm64_v8   = 1,
+		arm64e     = 2,
+		ppc_all    = 0,
+	};
+
+	struct fat_header_t final {
+		be_t<std::uint32_t> magic;
+		be_t<std::uint32_t> nfat_arch;
+	};
+
+	struct fat_arch_t final {
+		be_t<cpu_type_t> cputype;
+		be_t<std::uint32_t> cpusubtype;
+		be_t<std::uint32_t> offset;
+		be_t<std::uint32_t> size;
+		/* As a power of 2 */
+		be_t<std::uint32_t> align;
+	};
+
+	/* Used when any slice would be past the 4 GiB limit of fat_arch_t */
+	struct fat_arch_64_t final {
+		be_t<cpu_type_t> cputype;
+		be_t<std::uint32_t> cpusubtype;
+		be_t<std::uint64_t> offset;
+		be_t<std::uint64_t> size;
+		be_t<std::uint32_t> align;
+		be_t<std::uint32_t> reserved;
+	};
+
+	/* The magic of a thin image, read in the image's own byte order */
+	constexpr std::uint32_t mh_magic{0xFEEDFACEU};
+	constexpr std::uint32_t mh_magic_64{0xFEEDFACFU};
+
+	enum struct class_t : std::uint8_t {
+		macho32 = 0x01U,
+		macho64 = 0x02U,
+	};
+
+	enum struct filetype_t : std::uint32_t {
+		object      = 0x00000001U,
+		execute     = 0x00000002U,
+		fvmlib      = 0x00000003U,
+		core        = 0x00000004U,
+		preload     = 0x00000005U,
+		dylib       = 0x00000006U,
+		dylinker    = 0x00000007U,
+		bundle      = 0x00000008U,
+		dylib_stub  = 0x00000009U,
+		dsym        = 0x0000000AU,
+		kext_bundle = 0x0000000BU,
+		fileset     = 0x0000000CU,
+	};
+
+	enum struct header_flags_t : std::uint32_t {
+		noundefs                = 0x00000001U,
+		incrlink                = 0x00000002U,
+		dyldlink                = 0x00000004U,
+		bindatload              = 0x00000008U,
+		prebound                = 0x00000010U,
+		split_segs              = 0x00000020U,
+		twolevel                = 0x00000080U,
+		force_flat              = 0x00000100U,
+		subsections_via_symbols = 0x00002000U,
+		weak_defines            = 0x00008000U,
+		binds_to_weak           = 0x00010000U,
+		pie                     = 0x00200000U,
+		has_tlv_descriptors     = 0x00800000U,
+		no_heap_execution       = 0x01000000U,
+		app_extension_safe      = 0x02000000U,
+		dylib_in_cache          = 0x80000000U,
+	};
+
+	/* Set on load commands that dyld must understand to load the image */
+	constexpr std::uint32_t lc_req_dyld{0x80000000U};
+
+	enum struct load_command_type_t : std::uint32_t {
+		segment                  = 0x00000001U,
+		symtab                   = 0x00000002U,
+		symseg                   = 0x00000003U,
+		thread                   = 0x00000004U,
+		unixthread               = 0x00000005U,
+		dysymtab                 = 0x0000000BU,
+		load_dylib               = 0x0000000CU,
+		id_dylib                 = 0x0000000DU,
+		load_dylinker            = 0x0000000EU,
+		id_dylinker              = 0x0000000FU,
+		prebound_dylib           = 0x00000010U,
+		routines                 = 0x00000011U,
+		sub_framework            = 0x00000012U,
+		sub_umbrella             = 0x00000013U,
+		sub_client               = 0x00000014U,
+		sub_library              = 0x00000015U,
+		twolevel_hints           = 0x00000016U,
+		prebind_cksum            = 0x00000017U,
+		load_weak_dylib          = 0x00000018U | lc_req_dyld,
+		segment_64               = 0x00000019U,
+		routines_64              = 0x0000001AU,
+		uuid                     = 0x0000001BU,
+		rpath                    = 0x0000001CU | lc_req_dyld,
+		code_signature           = 0x0000001DU,
+		segment_split_info       = 0x0000001EU,
+		reexport_dylib           = 0x0000001FU | lc_req_dyld,
+		lazy_load_dylib          = 0x00000020U,
+		encryption_info          = 0x00000021U,
+		dyld_info                = 0x00000022U,
+		dyld_info_only           = 0x00000022U | lc_req_dyld,
+		load_upward_dylib        = 0x00000023U | lc_req_dyld,
+		version_min_macosx       = 0x00000024U,
+		version_min_iphoneos     = 0x00000025U,
+		function_starts          = 0x00000026U,
+		dyld_environment         = 0x00000027U,
+		main                     = 0x00000028U | lc_req_dyld,
+		data_in_code             = 0x00000029U,
+		source_version           = 0x0000002AU,
+		dylib_code_sign_drs      = 0x0000002BU,
+		encryption_info_64       = 0x0000002CU,
+		linker_option            = 0x0000002DU,
+		linker_optimization_hint = 0x0000002EU,
+		version_min_tvos         = 0x0000002FU,
+		version_min_watchos      = 0x00000030U,
+		note                     = 0x00000031U,
+		build_version            = 0x00000032U,
+		dyld_exports_trie        = 0x00000033U | lc_req_dyld,
+		dyld_chained_fixups      = 0x00000034U | lc_req_dyld,
+		fileset_entry            = 0x00000035U | lc_req_dyld,
+	};
+
+	/* The low byte of n_type, the N_STAB bits mark debugger symbols */
+	enum struct nlist_type_t : std::uint8_t {
+		undf = 0x00U,
+		abs  = 0x02U,
+		indr = 0x0AU,
+		pbud = 0x0CU,
+		sect = 0x0EU,
+	};
+
+	constexpr std::uint8_t n_stab{0xE0U};
+	constexpr std::uint8_t n_pext{0x10U};
+	constexpr std::uint8_t n_type{0x0EU};
+	constexpr std::uint8_t n_ext{0x01U};
+
+	/* The flags of an export trie terminal, the low two bits are the symbol kind */
+	enum struct export_flags_t : std::uint64_t {
+		kind_regular      = 0x00U,
+		kind_thread_local = 0x01U,
+		kind_absolute     = 0x02U,
+		kind_mask         = 0x03U,
+		weak_definition   = 0x04U,
+		reexport          = 0x08U,
+		stub_and_resolver = 0x10U,
+		static_resolver   = 0x20U,
+	};
+
+	template<endian_t E>
+	struct mach_header_t final {
+		endian_value_t<std::uint32_t, E> magic;
+		endian_value_t<cpu_type_t, E> cputype;
+		endian_value_t<std::uint32_t, E> cpusubtype;
+		endian_value_t<filetype_t, E> filetype;
+		endian_value_t<std::uint32_t, E> ncmds;
+		endian_value_t<std::uint32_t, E> sizeofcmds;
+		endian_value_t<std::uint32_t, E> flags;
+	};
+
+	template<endian_t E>
+	struct mach_header_64_t final {
+		endian_value_t<std::uint32_t, E> magic;
+		endian_value_t<cpu_type_t, E> cputype;
+		endian_value_t<std::uint32_t, E> cpusubtype;
+		endian_value_t<filetype_t, E> filetype;
+		endian_value_t<std::uint32_t, E> ncmds;
+		endian_value_t<std::uint32_t, E> sizeofcmds;
+		endian_value_t<std::uint32_t, E> flags;
+		endian_value_t<std::uint32_t, E> reserved;
+	};
+
+	/* The common prefix of every load command */
+	template<endian_t E>
+	struct load_command_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+	};
+
+	template<endian_t E>
+	struct segment_command_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+		std::array<char, 16> segname;
+		endian_value_t<std::uint32_t, E> vmaddr;
+		endian_value_t<std::uint32_t, E> vmsize;
+		endian_value_t<std::uint32_t, E> fileoff;
+		endian_value_t<std::uint32_t, E> filesize;
+		endian_value_t<std::int32_t, E> maxprot;
+		endian_value_t<std::int32_t, E> initprot;
+		endian_value_t<std::uint32_t, E> nsects;
+		endian_value_t<std::uint32_t, E> flags;
+	};
+
+	template<endian_t E>
+	struct segment_command_64_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+		std::array<char, 16> segname;
+		endian_value_t<std::uint64_t, E> vmaddr;
+		endian_value_t<std::uint64_t, E> vmsize;
+		endian_value_t<std::uint64_t, E> fileoff;
+		endian_value_t<std::uint64_t, E> filesize;
+		endian_value_t<std::int32_t, E> maxprot;
+		endian_value_t<std::int32_t, E> initprot;
+		endian_value_t<std::uint32_t, E> nsects;
+		endian_value_t<std::uint32_t, E> flags;
+	};
+
+	/* Section headers directly follow their segment command */
+	template<endian_t E>
+	struct section_t final {
+		std::array<char, 16> sectname;
+		std::array<char, 16> segname;
+		endian_value_t<std::uint32_t, E> addr;
+		endian_value_t<std::uint32_t, E> size;
+		endian_value_t<std::uint32_t, E> offset;
+		endian_value_t<std::uint32_t, E> align;
+		endian_value_t<std::uint32_t, E> reloff;
+		endian_value_t<std::uint32_t, E> nreloc;
+		endian_value_t<std::uint32_t, E> flags;
+		endian_value_t<std::uint32_t, E> reserved1;
+		endian_value_t<std::uint32_t, E> reserved2;
+	};
+
+	template<endian_t E>
+	struct section_64_t final {
+		std::array<char, 16> sectname;
+		std::array<char, 16> segname;
+		endian_value_t<std::uint64_t, E> addr;
+		endian_value_t<std::uint64_t, E> size;
+		endian_value_t<std::uint32_t, E> offset;
+		endian_value_t<std::uint32_t, E> align;
+		endian_value_t<std::uint32_t, E> reloff;
+		endian_value_t<std::uint32_t, E> nreloc;
+		endian_value_t<std::uint32_t, E> flags;
+		endian_value_t<std::uint32_t, E> reserved1;
+		endian_value_t<std::uint32_t, E> reserved2;
+		endian_value_t<std::uint32_t, E> reserved3;
+	};
+
+	template<endian_t E>
+	struct symtab_command_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+		endian_value_t<std::uint32_t, E> symoff;
+		endian_value_t<std::uint32_t, E> nsyms;
+		endian_value_t<std::uint32_t, E> stroff;
+		endian_value_t<std::uint32_t, E> strsize;
+	};
+
+	template<endian_t E>
+	struct uuid_command_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+		std::array<std::uint8_t, 16> uuid;
+	};
+
+	/* LC_CODE_SIGNATURE, LC_FUNCTION_STARTS, LC_DYLD_EXPORTS_TRIE, LC_DYLD_CHAINED_FIXUPS, and friends */
+	template<endian_t E>
+	struct linkedit_data_command_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+		endian_value_t<std::uint32_t, E> dataoff;
+		endian_value_t<std::uint32_t, E> datasize;
+	};
+
+	template<endian_t E>
+	struct dyld_info_command_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+		endian_value_t<std::uint32_t, E> rebase_off;
+		endian_value_t<std::uint32_t, E> rebase_size;
+		endian_value_t<std::uint32_t, E> bind_off;
+		endian_value_t<std::uint32_t, E> bind_size;
+		endian_value_t<std::uint32_t, E> weak_bind_off;
+		endian_value_t<std::uint32_t, E> weak_bind_size;
+		endian_value_t<std::uint32_t, E> lazy_bind_off;
+		endian_value_t<std::uint32_t, E> lazy_bind_size;
+		endian_value_t<std::uint32_t, E> export_off;
+		endian_value_t<std::uint32_t, E> export_size;
+	};
+
+	/* LC_LOAD_DYLIB, LC_ID_DYLIB, and the other dylib references, the name is at an offset from the command */
+	template<endian_t E>
+	struct dylib_command_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+		endian_value_t<std::uint32_t, E> name;
+		endian_value_t<std::uint32_t, E> timestamp;
+		endian_value_t<std::uint32_t, E> current_version;
+		endian_value_t<std::uint32_t, E> compatibility_version;
+	};
+
+	/* LC_MAIN */
+	template<endian_t E>
+	struct entry_point_command_t final {
+		endian_value_t<load_command_type_t, E> cmd;
+		endian_value_t<std::uint32_t, E> cmdsize;
+		endian_value_t<std::uint64_t, E> entryoff;
+		endian_value_t<std::uint64_t, E> stacksize;
+	};
+
+	/* The start of the LC_DYLD_CHAINED_FIXUPS payload */
+	template<endian_t E>
+	struct dyld_chained_fixups_header_t final {
+		endian_value_t<std::uint32_t, E> fixups_version;
+		endian_value_t<std::uint32_t, E> starts_offset;
+		endian_value_t<std::uint32_t, E> imports_offset;
+		endian_value_t<std::uint32_t, E> symbols_offset;
+		endian_value_t<std::uint32_t, E> imports_count;
+		endian_value_t<std::uint32_t, E> imports_format;
+		endian_value_t<std::uint32_t, E> symbols_format;
+	};
+
+	template<endian_t E>
+	struct nlist_t final {
+		endian_value_t<std::uint32_t, E> n_strx;
+		std::uint8_t n_type;
+		std::uint8_t n_sect;
+		endian_value_t<std::uint16_t, E> n_desc;
+		endian_value_t<std::uint32_t, E> n_value;
+	};
+
+	template<endian_t E>
+	struct nlist_64_t final {
+		endian_value_t<std::uint32_t, E> n_strx;
+		std::uint8_t n_type;
+		std::uint8_t n_sect;
+		endian_value_t<std::uint16_t, E> n_desc;
+		endian_value_t<std::uint64_t, E> n_value;
+	};
+
+	/*
+		The dyld_cache_header, up to the relocated image table
+
+		The header has grown over time, and mapping_offset doubles as its length, so any
+		field at or past mapping_offset belongs to an older, shorter header and is not valid.
+	*/
+	struct dyld_cache_header_t final {
+		std::array<char, 16> magic;
+		le_t<std::uint32_t> mapping_offset;
+		le_t<std::uint32_t> mapping_count;
+		/* Zero on caches new enough to use images_offset and images_count instead */
+		le_t<std::uint32_t> images_offset_old;
+		le_t<std::uint32_t> images_count_old;
+		le_t<std::uint64_t> dyld_base_address;
+		le_t<std::uint64_t> code_signature_offset;
+		le_t<std::uint64_t> code_signature_size;
+		le_t<std::uint64_t> slide_info_offset_unused;
+		le_t<std::uint64_t> slide_info_size_unused;
+		le_t<std::uint64_t> local_symbols_offset;
+		le_t<std::uint64_t> local_symbols_size;
+		std::array<std::uint8_t, 16> uuid;
+		le_t<std::uint64_t> cache_type;
+		le_t<std::uint32_t> branch_pools_offset;
+		le_t<std::uint32_t> branch_pools_count;
+		le_t<std::uint64_t> dyld_in_memory_address;
+		le_t<std::uint64_t> dyld_in_memory_entry;
+		le_t<std::uint64_t> images_text_offset;
+		le_t<std::uint64_t> images_text_count;
+		le_t<std::uint64_t> patch_info_address;
+		le_t<std::uint64_t> patch_info_size;
+		le_t<std::uint64_t> other_image_group_address_unused;
+		le_t<std::uint64_t> other_image_group_size_unused;
+		le_t<std::uint64_t> prog_closures_address;
+		le_t<std::uint64_t> prog_closures_size;
+		le_t<std::uint64_t> prog_closures_trie_address;
+		le_t<std::uint64_t> prog_closures_trie_size;
+		le_t<std::uint32_t> platform;
+		le_t<std::uint32_t> format_flags;
+		le_t<std::uint64_t> shared_region_start;
+		le_t<std::uint64_t> shared_region_size;
+		le_t<std::uint64_t> max_slide;
+		le_t<std::uint64_t> dylibs_image_array_address;
+		le_t<std::uint64_t> dylibs_image_array_size;
+		le_t<std::uint64_t> dylibs_trie_address;
+		le_t<std::uint64_t> dylibs_trie_size;
+		le_t<std::uint64_t> other_image_array_address;
+		le_t<std::uint64_t> other_image_array_size;
+		le_t<std::uint64_t> other_trie_address;
+		le_t<std::uint64_t> other_trie_size;
+		le_t<std::uint32_t> mapping_with_slide_offset;
+		le_t<std::uint32_t> mapping_with_slide_count;
+		le_t<std::uint64_t> dylibs_pbl_state_array_address_unused;
+		le_t<std::uint64_t> dylibs_pbl_set_address;
+		le_t<std::uint64_t> programs_pbl_set_pool_address;
+		le_t<std::uint64_t> programs_pbl_set_pool_size;
+		le_t<std::uint64_t> program_trie_address;
+		le_t<std::uint32_t> program_trie_size;
+		le_t<std::uint32_t> os_version;
+		le_t<std::uint32_t> alt_platform;
+		le_t<std::uint32_t> alt_os_version;
+		le_t<std::uint64_t> swift_opts_offset;
+		le_t<std::uint64_t> swift_opts_size;
+		le_t<std::uint32_t> sub_cache_array_offset;
+		le_t<std::uint32_t> sub_cache_array_count;
+		std::array<std::uint8_t, 16> symbol_file_uuid;
+		le_t<std::uint64_t> rosetta_read_only_address;
+		le_t<std::uint64_t> rosetta_read_only_size;
+		le_t<std::uint64_t> rosetta_read_write_address;
+		le_t<std::uint64_t> rosetta_read_write_size;
+		le_t<std::uint32_t> images_offset;
+		le_t<std::uint32_t> images_count;
+	};
+
+	struct dyld_cache_mapping_info_t final {
+		le_t<std::uint64_t> address;
+		le_t<std::uint64_t> size;
+		le_t<std::uint64_t> file_offset;
+		le_t<std::uint32_t> max_prot;
+		le_t<std::uint32_t> init_prot;
+	};
+
+	struct dyld_cache_image_info_t final {
+		le_t<std::uint64_t> address;
+		le_t<std::uint64_t> mod_time;
+		le_t<std::uint64_t> inode;
+		le_t<std::uint32_t> path_file_offset;
+		le_t<std::uint32_t> pad;
+	};
+
+	/* The extent of each image's __TEXT, so addresses can be attributed without touching the images */
+	struct dyld_cache_image_text_info_t final {
+		std::array<std::uint8_t, 16> uuid;
+		le_t<std::uint64_t> load_address;
+		le_t<std::uint32_t> text_segment_size;
+		le_t<std::uint32_t> path_offset;
+	};
+
+	/* Maps a Mach-O class and byte order to the concrete on-disk structures */
+	template<class_t C, endian_t E>
+	struct layout_t;
+
+	template<endian_t E>
+	struct layout_t<class_t::macho32, E> final {
+		static constexpr class_t macho_class{class_t::macho32};
+		static constexpr endian_t endian{E};
+		static constexpr std::uint32_t magic{mh_magic};
+		static constexpr load_command_type_t segment_command{load_command_type_t::segment};
+
+		using addr_t    = std::uint32_t;
+		using header_t  = mach_header_t<E>;
+		using segment_t = segment_command_t<E>;
+		using section_t = Types::section_t<E>;
+		using nlist_t   = Types::nlist_t<E>;
+	};
+
+	template<endian_t E>
+	struct layout_t<class_t::macho64, E> final {
+		static constexpr class_t macho_class{class_t::macho64};
+		static constexpr endian_t endian{E};
+		static constexpr std::uint32_t magic{mh_magic_64};
+		static constexpr load_command_type_t segment_command{load_command_type_t::segment_64};
+
+		using addr_t    = std::uint64_t;
+		using header_t  = mach_header_64_t<E>;
+		using segment_t = segment_command_64_t<E>;
+		using section_t = section_64_t<E>;
+		using nlist_t   = nlist_64_t<E>;
+	};
 
+	static_assert(sizeof(fat_header_t) == 8, "fat_header_t must be 8 bytes");
+	static_assert(sizeof(fat_arch_t) == 20, "fat_arch_t must be 20 bytes");
+	static_assert(sizeof(fat_arch_64_t) == 32, "fat_arch_64_t must be 32 bytes");
+	static_assert(sizeof(mach_header_t<endian_t::little>) == 28, "mach_header_t must be 28 bytes");
+	static_assert(sizeof(mach_header_64_t<endian_t::little>) == 32, "mach_header_64_t must be 32 bytes");
+	static_assert(sizeof(segment_command_t<endian_t::little>) == 56, "segment_command_t must be 56 bytes");
+	static_assert(sizeof(segment_command_64_t<endian_t::little>) == 72, "segment_command_64_t must be 72 bytes");
+	static_assert(sizeof(section_t<endian_t::little>) == 68, "section_t must be 68 bytes");
+	static_assert(sizeof(section_64_t<endian_t::little>) == 80, "section_64_t must be 80 bytes");
+	static_assert(sizeof(symtab_command_t<endian_t::little>) == 24, "symtab_command_t must be 24 bytes");
+	static_assert(sizeof(uuid_command_t<endian_t::little>) == 24, "uuid_command_t must be 24 bytes");
+	static_assert(sizeof(dyld_info_command_t<endian_t::little>) == 48, "dyld_info_command_t must be 48 bytes");
+	static_assert(sizeof(dylib_command_t<endian_t::little>) == 24, "dylib_command_t must be 24 bytes");
+	static_assert(sizeof(entry_point_command_t<endian_t::little>) == 24, "entry_point_command_t must be 24 bytes");
+	static_assert(sizeof(dyld_chained_fixups_header_t<endian_t::little>) == 28, "dyld_chained_fixups_header_t must be 28 bytes");
+	static_assert(sizeof(nlist_t<endian_t::little>) == 12, "nlist_t must be 12 bytes");
+	static_assert(sizeof(nlist_64_t<endian_t::little>) == 16, "nlist_64_t must be 16 bytes");
+	static_assert(sizeof(dyld_cache_header_t) == 0x1C8, "dyld_cache_header_t must be 456 bytes");
+	static_assert(sizeof(dyld_cache_mapping_info_t) == 32, "dyld_cache_mapping_info_t must be 32 bytes");
+	static_assert(sizeof(dyld_cache_image_info_t) == 32, "dyld_cache_image_info_t must be 32 bytes");
+	static_assert(sizeof(dyld_cache_image_text_info_t) == 32, "dyld_cache_image_text_info_t must be 32 bytes");
 }
 
 #endif /* libalfheim_macho_types_hh */
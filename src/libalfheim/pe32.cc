@@ -2,3 +2,29 @@
 /* pe32.cc - PE32/PE32+ support */
 
 #include <libalfheim/pe32.hh>
+
+namespace Alfheim::PE32 {
+	std::optional<pe_any_t> open(const byte_span_t image) noexcept {
+		const auto* const dos{image.as<Types::dos_header_t>(0)};
+		if (!dos || dos->e_magic != Types::dos_magic)
+			return std::nullopt;
+
+		/* The optional header magic sits straight after the signature and the file header */
+		const auto magic_offset{std::size_t{dos->e_lfanew} + sizeof(std::uint32_t) + sizeof(Types::file_header_t)};
+		const auto* const magic{image.as<Internal::le_t<Types::class_t>>(magic_offset)};
+		if (!magic)
+			return std::nullopt;
+
+		switch (magic->value()) {
+			case Types::class_t::pe32:
+				if (auto pe{pe32_t::open(image)})
+					return pe_any_t{*pe};
+				break;
+			case Types::class_t::pe32plus:
+				if (auto pe{pe32plus_t::open(image)})
+					return pe_any_t{*pe};
+				break;
+		}
+		return std::nullopt;
+	}
+}
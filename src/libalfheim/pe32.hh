@@ -4,10 +4,608 @@
 #if !defined(libalfheim_pe32_hh)
 #define libalfheim_pe32_hh
 
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/span.hh>
+
 #include <libalfheim/pe32/types.hh>
 
 namespace Alfheim::PE32 {
+	using Internal::span_t;
+	using Internal::byte_span_t;
+	using Internal::narrow_size;
+
+	/* Section names are padded with NULs, but aren't terminated when all 8 bytes are used */
+	[[nodiscard]]
+	inline std::string_view section_name(const Types::section_header_t& section) noexcept {
+		std::size_t len{};
+		while (len < section.name.size() && section.name[len])
+			++len;
+		return {section.name.data(), len};
+	}
+
+	/* The PDB 7.0 CodeView record a debugger matches the image's PDB with */
+	struct codeview_t final {
+		std::array<std::uint8_t, 16> guid;
+		std::uint32_t age;
+		std::string_view path;
+	};
+
+	/* One function pulled in by an import, either by ordinal or by name with a hint into the export name table */
+	struct import_t final {
+		std::string_view name;
+		std::uint16_t hint;
+		std::uint16_t ordinal;
+		bool by_ordinal;
+	};
+
+	/* A single page worth of base relocations, each entry is a 4-bit type over a 12-bit page offset */
+	struct relocation_block_t final {
+		std::uint32_t page_rva;
+		span_t<const Internal::le_t<std::uint16_t>> entries;
+	};
+
+	/* The base relocation directory as a sequence of blocks, stopping at the first malformed one */
+	struct relocations_t final {
+		struct iterator final {
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = relocation_block_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const relocation_block_t*;
+			using reference = const relocation_block_t&;
+		private:
+			byte_span_t _data{};
+			std::size_t _offset{0};
+			std::size_t _next{0};
+			relocation_block_t _block{};
+
+			void decode() noexcept {
+				const auto* const block{_data.template as<Types::base_relocation_t>(_offset)};
+				const std::size_t size{block ? block->size_of_block.value() : 0U};
+				if (!block || size < sizeof(Types::base_relocation_t) || size > _data.size() - _offset) {
+					_offset = _data.size();
+					return;
+				}
+				const auto count{(size - sizeof(Types::base_relocation_t)) / 2U};
+				_block = relocation_block_t{
+					block->virtual_address,
+					_data.template array<Internal::le_t<std::uint16_t>>(_offset + sizeof(Types::base_relocation_t), count)
+				};
+				/* Blocks start on a 32-bit boundary */
+				_next = std::min((_offset + size + 3U) & ~std::size_t{3U}, _data.size());
+			}
+		public:
+			constexpr iterator() noexcept = default;
+			iterator(const byte_span_t data, const std::size_t offset) noexcept : _data{data}, _offset{offset} {
+				if (_offset < _data.size())
+					decode();
+			}
+
+			[[nodiscard]]
+			reference operator*() const noexcept { return _block; }
+			[[nodiscard]]
+			pointer operator->() const noexcept { return &_block; }
+
+			iterator& operator++() noexcept {
+				_offset = _next;
+				if (_offset < _data.size())
+					decode();
+				return *this;
+			}
+
+			iterator operator++(int) noexcept {
+				auto prev{*this};
+				++*this;
+				return prev;
+			}
+
+			[[nodiscard]]
+			bool operator==(const iterator& other) const noexcept { return _offset == other._offset; }
+			[[nodiscard]]
+			bool operator!=(const iterator& other) const noexcept { return _offset != other._offset; }
+		};
+	private:
+		byte_span_t _data{};
+	public:
+		constexpr relocations_t() noexcept = default;
+		constexpr relocations_t(const byte_span_t data) noexcept : _data{data} { /* NOP */ }
+
+		[[nodiscard]]
+		byte_span_t data() const noexcept { return _data; }
+		[[nodiscard]]
+		bool empty() const noexcept { return _data.empty(); }
+
+		[[nodiscard]]
+		iterator begin() const noexcept { return {_data, 0U}; }
+		[[nodiscard]]
+		iterator end() const noexcept { return {_data, _data.size()}; }
+	};
+
+	/*
+		A view over the resource tree
+
+		Offsets in the tree are all relative to the start of the resource directory, apart
+		from the data entries, which point at their contents by RVA.
+	*/
+	struct resources_t final {
+		using entry_t = Types::resource_directory_entry_t;
+	private:
+		byte_span_t _data{};
+	public:
+		constexpr resources_t() noexcept = default;
+		constexpr resources_t(const byte_span_t data) noexcept : _data{data} { /* NOP */ }
+
+		[[nodiscard]]
+		bool empty() const noexcept { return _data.empty(); }
+		[[nodiscard]]
+		byte_span_t data() const noexcept { return _data; }
+
+		[[nodiscard]]
+		const Types::resource_directory_t* directory(const std::size_t offset = 0U) const noexcept {
+			return _data.template as<Types::resource_directory_t>(offset);
+		}
+
+		/* The named entries of a directory, followed by those with integer IDs */
+		[[nodiscard]]
+		span_t<const entry_t> entries(const std::size_t offset = 0U) const noexcept {
+			const auto* const dir{directory(offset)};
+			if (!dir)
+				return {};
+			const std::size_t count{std::size_t{dir->number_of_named_entries} + dir->number_of_id_entries};
+			return _data.template array<entry_t>(offset + sizeof(Types::resource_directory_t), count);
+		}
+
+		[[nodiscard]]
+		static bool is_directory(const entry_t& entry) noexcept { return entry.offset & Types::resource_high_bit; }
+		[[nodiscard]]
+		static bool is_named(const entry_t& entry) noexcept { return entry.name & Types::resource_high_bit; }
+		[[nodiscard]]
+		static std::uint32_t id(const entry_t& entry) noexcept { return entry.name & 0xFFFFU; }
+		[[nodiscard]]
+		static std::size_t child(const entry_t& entry) noexcept { return entry.offset & ~Types::resource_high_bit; }
+
+		/* A string name is a length followed by that many UTF-16LE code units */
+		[[nodiscard]]
+		span_t<const Internal::le_t<std::uint16_t>> name(const entry_t& entry) const noexcept {
+			if (!is_named(entry))
+				return {};
+			const std::size_t offset{entry.name & ~Types::resource_high_bit};
+			const auto* const len{_data.template as<Internal::le_t<std::uint16_t>>(offset)};
+			if (!len)
+				return {};
+			return _data.template array<Internal::le_t<std::uint16_t>>(offset + 2U, len->value());
+		}
+
+		[[nodiscard]]
+		const Types::resource_data_entry_t* data_entry(const entry_t& entry) const noexcept {
+			if (is_directory(entry))
+				return nullptr;
+			return _data.template as<Types::resource_data_entry_t>(child(entry));
+		}
+	};
+
+	template<Types::class_t C>
+	struct pe_t;
+
+	/* The functions pulled in from one DLL, walking its import lookup table up to the terminating entry */
+	template<Types::class_t C>
+	struct import_thunks_t final {
+		using layout = Types::layout_t<C>;
+		using thunk_t = typename layout::thunk_t;
+
+		struct iterator final {
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = import_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = import_t;
+		private:
+			const pe_t<C>* _pe{nullptr};
+			span_t<const thunk_t> _thunks{};
+			std::size_t _idx{0};
+		public:
+			constexpr iterator() noexcept = default;
+			constexpr iterator(const pe_t<C>* const pe, const span_t<const thunk_t> thunks, const std::size_t idx) noexcept :
+				_pe{pe}, _thunks{thunks}, _idx{idx} { /* NOP */ }
+
+			[[nodiscard]]
+			import_t operator*() const noexcept {
+				const typename layout::addr_t value{_thunks[_idx]};
+				if (value & layout::ordinal_flag)
+					return {{}, 0U, static_cast<std::uint16_t>(value & 0xFFFFU), true};
+				const auto hint_name{_pe->rva_data(static_cast<std::uint32_t>(value & 0x7FFFFFFFU))};
+				const auto* const hint{hint_name.template as<Internal::le_t<std::uint16_t>>(0)};
+				return {hint_name.string(2U), hint ? hint->value() : std::uint16_t{}, 0U, false};
+			}
+
+			iterator& operator++() noexcept {
+				++_idx;
+				return *this;
+			}
+
+			iterator operator++(int) noexcept {
+				auto prev{*this};
+				++_idx;
+				return prev;
+			}
+
+			[[nodiscard]]
+			bool operator==(const iterator& other) const noexcept { return _idx == other._idx; }
+			[[nodiscard]]
+			bool operator!=(const iterator& other) const noexcept { return _idx != other._idx; }
+		};
+	private:
+		const pe_t<C>* _pe{nullptr};
+		span_t<const thunk_t> _thunks{};
+	public:
+		constexpr import_thunks_t() noexcept = default;
+		import_thunks_t(const pe_t<C>* const pe, const span_t<const thunk_t> thunks) noexcept : _pe{pe} {
+			/* The table has no length, just a zero entry to end it */
+			std::size_t count{};
+			while (count < thunks.size() && thunks[count].value())
+				++count;
+			_thunks = thunks.first(count);
+		}
+
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _thunks.size(); }
+		[[nodiscard]]
+		iterator begin() const noexcept { return {_pe, _thunks, 0U}; }
+		[[nodiscard]]
+		iterator end() const noexcept { return {_pe, _thunks, _thunks.size()}; }
+	};
+
+	/* One DLL in the import directory */
+	template<Types::class_t C>
+	struct import_module_t final {
+		const Types::import_descriptor_t* descriptor;
+		std::string_view name;
+		import_thunks_t<C> functions;
+	};
+
+	/* The import directory, decoding each descriptor's name and lookup table as it's reached */
+	template<Types::class_t C>
+	struct imports_t final {
+		struct iterator final {
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = import_module_t<C>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = import_module_t<C>;
+		private:
+			const pe_t<C>* _pe{nullptr};
+			span_t<const Types::import_descriptor_t> _descriptors{};
+			std::size_t _idx{0};
+		public:
+			constexpr iterator() noexcept = default;
+			constexpr iterator(const pe_t<C>* const pe, const span_t<const Types::import_descriptor_t> descriptors,
+				const std::size_t idx) noexcept : _pe{pe}, _descriptors{descriptors}, _idx{idx} { /* NOP */ }
+
+			[[nodiscard]]
+			import_module_t<C> operator*() const noexcept { return _pe->import_module(_descriptors[_idx]); }
+
+			iterator& operator++() noexcept {
+				++_idx;
+				return *this;
+			}
+
+			iterator operator++(int) noexcept {
+				auto prev{*this};
+				++_idx;
+				return prev;
+			}
+
+			[[nodiscard]]
+			bool operator==(const iterator& other) const noexcept { return _idx == other._idx; }
+			[[nodiscard]]
+			bool operator!=(const iterator& other) const noexcept { return _idx != other._idx; }
+		};
+	private:
+		const pe_t<C>* _pe{nullptr};
+		span_t<const Types::import_descriptor_t> _descriptors{};
+	public:
+		constexpr imports_t() noexcept = default;
+		imports_t(const pe_t<C>* const pe, const span_t<const Types::import_descriptor_t> descriptors) noexcept : _pe{pe} {
+			std::size_t count{};
+			while (count < descriptors.size() && (descriptors[count].name || descriptors[count].first_thunk))
+				++count;
+			_descriptors = descriptors.first(count);
+		}
+
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _descriptors.size(); }
+		[[nodiscard]]
+		iterator begin() const noexcept { return {_pe, _descriptors, 0U}; }
+		[[nodiscard]]
+		iterator end() const noexcept { return {_pe, _descriptors, _descriptors.size()}; }
+	};
+
+	/*
+		A lazy, zero-copy reader for a PE32 or PE32+ image
+
+		Opening an image only validates the DOS header, the NT headers, and that the section
+		table fits. The data directories are just RVAs until something asks for one, at which
+		point only that directory is located and viewed, so pulling the CodeView record out of
+		the debug directory never touches the imports, exports, or resources.
+
+		RVAs are translated through the section table. Images are required to have their
+		sections in ascending address order, so when the table is sorted, which is checked
+		when the image is opened, translation is a binary search over it, and only images
+		that break the rule fall back to a linear scan.
+	*/
+	template<Types::class_t C>
+	struct pe_t final {
+		using layout = Types::layout_t<C>;
+		using addr_t = typename layout::addr_t;
+		using optional_t = typename layout::optional_t;
+		using section_t = Types::section_header_t;
+
+		static constexpr Types::class_t pe_class{C};
+	private:
+		byte_span_t _image{};
+		const Types::dos_header_t* _dos{nullptr};
+		const Types::file_header_t* _file{nullptr};
+		const optional_t* _optional{nullptr};
+		span_t<const Types::data_directory_t> _directories{};
+		span_t<const section_t> _sections{};
+		bool _sorted{false};
+
+		[[nodiscard]]
+		static bool contains(const section_t& section, const std::uint32_t rva) noexcept {
+			const std::uint32_t base{section.virtual_address};
+			const auto size{std::max<std::uint32_t>(section.virtual_size, section.size_of_raw_data)};
+			return rva >= base && rva - base < size;
+		}
+	public:
+		constexpr pe_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<pe_t> open(const byte_span_t image) noexcept {
+			pe_t pe{};
+			pe._image = image;
+			pe._dos = image.template as<Types::dos_header_t>(0);
+			if (!pe._dos || pe._dos->e_magic != Types::dos_magic)
+				return std::nullopt;
+
+			const std::size_t nt_offset{pe._dos->e_lfanew};
+			const auto* const signature{image.template as<Internal::le_t<std::uint32_t>>(nt_offset)};
+			if (!signature || *signature != Types::nt_signature)
+				return std::nullopt;
+
+			const auto file_offset{nt_offset + sizeof(std::uint32_t)};
+			pe._file = image.template as<Types::file_header_t>(file_offset);
+			if (!pe._file)
+				return std::nullopt;
+			const auto optional_offset{file_offset + sizeof(Types::file_header_t)};
+			const std::size_t optional_size{pe._file->size_of_optional_header};
+			pe._optional = image.template as<optional_t>(optional_offset);
+			if (!pe._optional || optional_size < sizeof(optional_t) || pe._optional->magic != C)
+				return std::nullopt;
+
+			/* The directory count is only a hint, it can't run past the optional header */
+			const auto directories{std::min<std::size_t>({
+				pe._optional->number_of_rva_and_sizes, Types::directory_count, (optional_size - sizeof(optional_t)) / sizeof(Types::data_directory_t)
+			})};
+			pe._directories = image.template array<Types::data_directory_t>(optional_offset + sizeof(optional_t), directories);
+
+			const std::size_t section_count{pe._file->number_of_sections};
+			pe._sections = image.template array<section_t>(optional_offset + optional_size, section_count);
+			if (pe._sections.size() != section_count)
+				return std::nullopt;
+			pe._sorted = std::is_sorted(pe._sections.begin(), pe._sections.end(),
+				[](const section_t& lhs, const section_t& rhs) noexcept { return lhs.virtual_address < rhs.virtual_address; });
+			return pe;
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _file; }
+		[[nodiscard]]
+		byte_span_t image() const noexcept { return _image; }
+		[[nodiscard]]
+		const Types::dos_header_t& dos_header() const noexcept { return *_dos; }
+		[[nodiscard]]
+		const Types::file_header_t& file_header() const noexcept { return *_file; }
+		[[nodiscard]]
+		const optional_t& optional_header() const noexcept { return *_optional; }
+
+		[[nodiscard]]
+		Types::machine_t machine() const noexcept { return _file->machine; }
+		[[nodiscard]]
+		addr_t image_base() const noexcept { return _optional->image_base; }
+		[[nodiscard]]
+		std::uint32_t image_size() const noexcept { return _optional->size_of_image; }
+		[[nodiscard]]
+		std::uint32_t entry_point() const noexcept { return _optional->address_of_entry_point; }
+		[[nodiscard]]
+		bool is_dll() const noexcept {
+			return _file->characteristics & std::uint16_t(Types::characteristics_t::dll);
+		}
+
+		/* The DOS stub program between the DOS header and the NT headers */
+		[[nodiscard]]
+		byte_span_t dos_stub() const noexcept {
+			const std::size_t nt_offset{_dos->e_lfanew};
+			if (nt_offset < sizeof(Types::dos_header_t))
+				return {};
+			return _image.subspan(sizeof(Types::dos_header_t), nt_offset - sizeof(Types::dos_header_t));
+		}
+
+		[[nodiscard]]
+		span_t<const section_t> sections() const noexcept { return _sections; }
+
+		[[nodiscard]]
+		const section_t* section(const std::string_view name) const noexcept {
+			for (const auto& sect : _sections) {
+				if (section_name(sect) == name)
+					return &sect;
+			}
+			return nullptr;
+		}
+
+		[[nodiscard]]
+		byte_span_t section_data(const section_t& section) const noexcept {
+			const auto len{std::min<std::uint32_t>(section.size_of_raw_data,
+				section.virtual_size ? section.virtual_size.value() : section.size_of_raw_data.value())};
+			return _image.subspan(std::size_t{section.pointer_to_raw_data}, len);
+		}
+
+		/* The section an RVA falls in, or nullptr if it's in the headers or unmapped */
+		[[nodiscard]]
+		const section_t* section_for(const std::uint32_t rva) const noexcept {
+			if (!_sorted) {
+				for (const auto& sect : _sections) {
+					if (contains(sect, rva))
+						return &sect;
+				}
+				return nullptr;
+			}
+
+			const auto iter{std::upper_bound(_sections.begin(), _sections.end(), rva,
+				[](const std::uint32_t value, const section_t& sect) noexcept { return value < sect.virtual_address; })};
+			if (iter == _sections.begin())
+				return nullptr;
+			const auto& sect{*std::prev(iter)};
+			return contains(sect, rva) ? &sect : nullptr;
+		}
+
+		/* Translates an RVA to a file offset, RVAs in the zero filled tail of a section have none */
+		[[nodiscard]]
+		std::optional<std::size_t> offset_of(const std::uint32_t rva) const noexcept {
+			if (const auto* const sect{section_for(rva)}) {
+				const auto delta{rva - sect->virtual_address};
+				if (delta >= sect->size_of_raw_data)
+					return std::nullopt;
+				return std::size_t{sect->pointer_to_raw_data} + delta;
+			}
+			/* The headers are mapped at the image base as-is */
+			if (rva < _optional->size_of_headers)
+				return rva;
+			return std::nullopt;
+		}
+
+		/* The file contents from an RVA up to the end of whatever holds it */
+		[[nodiscard]]
+		byte_span_t rva_data(const std::uint32_t rva) const noexcept {
+			const auto offset{offset_of(rva)};
+			if (!offset)
+				return {};
+			if (const auto* const sect{section_for(rva)})
+				return _image.subspan(*offset, sect->size_of_raw_data - (rva - sect->virtual_address));
+			return _image.subspan(*offset, _optional->size_of_headers - rva);
+		}
+
+		/* Exactly len bytes at an RVA, or nothing if they aren't all there */
+		[[nodiscard]]
+		byte_span_t rva_data(const std::uint32_t rva, const std::size_t len) const noexcept {
+			const auto data{rva_data(rva)};
+			return data.size() >= len ? data.first(len) : byte_span_t{};
+		}
+
+		[[nodiscard]]
+		std::string_view rva_string(const std::uint32_t rva) const noexcept { return rva_data(rva).string(0U); }
+
+		/* Every data directory entry present in the optional header, including empty ones */
+		[[nodiscard]]
+		span_t<const Types::data_directory_t> directories() const noexcept { return _directories; }
+
+		[[nodiscard]]
+		const Types::data_directory_t* directory(const Types::directory_t entry) const noexcept {
+			const auto idx{static_cast<std::size_t>(entry)};
+			if (idx >= _directories.size() || !_directories[idx].virtual_address)
+				return nullptr;
+			return &_directories[idx];
+		}
+
+		/* The contents of a data directory, the certificate table is the odd one out and is addressed by file offset */
+		[[nodiscard]]
+		byte_span_t directory_data(const Types::directory_t entry) const noexcept {
+			const auto* const dir{directory(entry)};
+			if (!dir)
+				return {};
+			if (entry == Types::directory_t::security)
+				return _image.subspan(std::size_t{dir->virtual_address}, std::size_t{dir->size});
+			return rva_data(dir->virtual_address, dir->size);
+		}
+
+		[[nodiscard]]
+		const Types::export_directory_t* export_directory() const noexcept {
+			return directory_data(Types::directory_t::exports).template as<Types::export_directory_t>(0);
+		}
+
+		[[nodiscard]]
+		imports_t<C> imports() const noexcept {
+			const auto* const dir{directory(Types::directory_t::imports)};
+			if (!dir)
+				return {};
+			/* Plenty of linkers get the size wrong, the table is really bounded by its terminator */
+			const auto data{rva_data(dir->virtual_address)};
+			return {this, data.template array<Types::import_descriptor_t>(0U, data.size() / sizeof(Types::import_descriptor_t))};
+		}
+
+		[[nodiscard]]
+		import_module_t<C> import_module(const Types::import_descriptor_t& descriptor) const noexcept {
+			/* Without an import lookup table the IAT still holds the unbound thunks on disk */
+			const std::uint32_t lookup{descriptor.original_first_thunk ? descriptor.original_first_thunk : descriptor.first_thunk};
+			const auto thunks{rva_data(lookup)};
+			return {
+				&descriptor, rva_string(descriptor.name),
+				{this, thunks.template array<typename layout::thunk_t>(0U, thunks.size() / sizeof(typename layout::thunk_t))}
+			};
+		}
+
+		[[nodiscard]]
+		resources_t resources() const noexcept { return {directory_data(Types::directory_t::resources)}; }
+
+		[[nodiscard]]
+		relocations_t relocations() const noexcept { return {directory_data(Types::directory_t::basereloc)}; }
+
+		[[nodiscard]]
+		span_t<const Types::debug_directory_t> debug_directories() const noexcept {
+			const auto data{directory_data(Types::directory_t::debug)};
+			return data.template array<Types::debug_directory_t>(0U, data.size() / sizeof(Types::debug_directory_t));
+		}
+
+		/* The contents of a debug directory entry, which need not be mapped, so this goes by file offset */
+		[[nodiscard]]
+		byte_span_t debug_data(const Types::debug_directory_t& entry) const noexcept {
+			const auto data{_image.subspan(std::size_t{entry.pointer_to_raw_data}, std::size_t{entry.size_of_data})};
+			if (data.size() == entry.size_of_data)
+				return data;
+			return rva_data(entry.address_of_raw_data, entry.size_of_data);
+		}
+
+		/* The RSDS CodeView record, this is all that's needed to find the matching PDB */
+		[[nodiscard]]
+		std::optional<codeview_t> codeview() const noexcept {
+			for (const auto& entry : debug_directories()) {
+				if (entry.type != Types::debug_type_t::codeview)
+					continue;
+				const auto data{debug_data(entry)};
+				const auto* const record{data.template as<Types::codeview_pdb70_t>(0)};
+				if (!record || record->signature != Types::codeview_pdb70)
+					continue;
+				return codeview_t{record->guid, record->age, data.string(sizeof(Types::codeview_pdb70_t))};
+			}
+			return std::nullopt;
+		}
+	};
+
+	using pe32_t = pe_t<Types::class_t::pe32>;
+	using pe32plus_t = pe_t<Types::class_t::pe32plus>;
+
+	using pe_any_t = std::variant<pe32_t, pe32plus_t>;
 
+	/* Opens an image as PE32 or PE32+ depending on the magic of its optional header */
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<pe_any_t> open(byte_span_t image) noexcept;
 }
 
 #endif /* libalfheim_pe32_hh */
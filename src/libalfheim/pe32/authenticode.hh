@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* pe32/authenticode.hh - Authenticode image digest */
+#pragma once
+#if !defined(libalfheim_pe32_authenticode_hh)
+#define libalfheim_pe32_authenticode_hh
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/mmap.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/pe32.hh>
+
+namespace Alfheim::PE32 {
+	/* A run of the file that goes into the Authenticode digest */
+	struct digest_range_t final {
+		std::size_t offset;
+		std::size_t length;
+	};
+
+	/*
+		The parts of the file hashed for its Authenticode digest, in file order
+
+		That is the headers less the checksum and the certificate table's directory entry,
+		each section's raw data in file order, and whatever follows the last section other
+		than the certificate table itself. Adjacent ranges are merged, so a typical image is
+		only three or four. Returns an empty list if the layout doesn't fit in the file.
+	*/
+	template<Types::class_t C>
+	[[nodiscard]]
+	std::vector<digest_range_t> authenticode_ranges(const pe_t<C>& pe) {
+		using optional_t = typename pe_t<C>::optional_t;
+		const auto image{pe.image()};
+		const auto offset_of = [&](const void* const ptr) noexcept {
+			return std::size_t(static_cast<const std::uint8_t*>(ptr) - image.data());
+		};
+
+		const auto checksum{offset_of(&pe.optional_header()) + offsetof(optional_t, checksum)};
+		const auto directories{pe.directories()};
+		const auto security{static_cast<std::size_t>(Types::directory_t::security)};
+		/* Without an entry for it there can't be a certificate table, but the checksum still goes */
+		const auto cert_entry{directories.size() > security ? offset_of(&directories[security]) : std::size_t{0U}};
+		const std::size_t cert_offset{cert_entry ? directories[security].virtual_address.value() : 0U};
+		const std::size_t cert_size{cert_entry && cert_offset ? directories[security].size.value() : 0U};
+		const std::size_t headers{pe.optional_header().size_of_headers};
+		if (headers > image.size() || headers < checksum + 4U || cert_offset > image.size() ||
+			cert_size > image.size() - cert_offset || (cert_entry && headers < cert_entry + sizeof(Types::data_directory_t)))
+			return {};
+
+		std::vector<digest_range_t> ranges{};
+		const auto add = [&](const std::size_t begin, const std::size_t end) {
+			if (begin >= end)
+				return;
+			if (!ranges.empty() && ranges.back().offset + ranges.back().length == begin)
+				ranges.back().length += end - begin;
+			else
+				ranges.push_back({begin, end - begin});
+		};
+
+		add(0U, checksum);
+		if (cert_entry) {
+			add(checksum + 4U, cert_entry);
+			add(cert_entry + sizeof(Types::data_directory_t), headers);
+		} else
+			add(checksum + 4U, headers);
+
+		/* Sections are hashed in file order, which is almost always already the order of the table */
+		std::vector<const typename pe_t<C>::section_t*> sections{};
+		sections.reserve(pe.sections().size());
+		for (const auto& sect : pe.sections()) {
+			if (sect.size_of_raw_data)
+				sections.push_back(&sect);
+		}
+		std::stable_sort(sections.begin(), sections.end(), [](const auto* const lhs, const auto* const rhs) noexcept {
+			return lhs->pointer_to_raw_data < rhs->pointer_to_raw_data;
+		});
+
+		std::size_t end{headers};
+		for (const auto* const sect : sections) {
+			const std::size_t offset{sect->pointer_to_raw_data};
+			const std::size_t size{sect->size_of_raw_data};
+			if (offset > image.size() || size > image.size() - offset)
+				return {};
+			add(offset, offset + size);
+			end = std::max(end, offset + size);
+		}
+
+		/* Trailing data, such as an installer payload, with the certificate table cut out of it */
+		if (cert_size && cert_offset >= end) {
+			add(end, cert_offset);
+			add(cert_offset + cert_size, image.size());
+		} else
+			add(end, image.size());
+		return ranges;
+	}
+
+	/*
+		Feeds the Authenticode digest of an image to one or more hash functions
+
+		Each update is called as update(const std::uint8_t* data, std::size_t len) with the
+		hashed bytes in order, straight from the image with no copying. Where more than one
+		digest is wanted, say both SHA-1 and SHA-256 for dual-signed files, the data is handed
+		out in chunks small enough to stay in cache between each, so the file is still only
+		read once. Returns false if the image's layout doesn't fit in the file.
+	*/
+	template<Types::class_t C, typename... F>
+	bool authenticode_digest(const pe_t<C>& pe, F&&... update) {
+		static_assert(sizeof...(F) > 0U, "authenticode_digest() needs at least one hash to update");
+		constexpr std::size_t chunk_size{sizeof...(F) > 1U ? 64U * 1024U : ~std::size_t{0U}};
+
+		const auto ranges{authenticode_ranges(pe)};
+		if (ranges.empty())
+			return false;
+		const auto* const image{pe.image().data()};
+		for (const auto& range : ranges) {
+			for (std::size_t done{}; done < range.length;) {
+				const auto len{std::min(chunk_size, range.length - done)};
+				const auto* const data{image + range.offset + done};
+				(update(data, len), ...);
+				done += len;
+			}
+		}
+		return true;
+	}
+
+	/*
+		As above, for an image opened over file
+
+		The file is advised as being read sequentially first, so the kernel reads ahead
+		aggressively and drops the pages behind the hash rather than keeping them around.
+	*/
+	template<Types::class_t C, typename... F>
+	bool authenticode_digest(const Internal::mmap_t& file, const pe_t<C>& pe, F&&... update) {
+	#if !defined(_WINDOWS)
+		if (!file.valid())
+			return false;
+		static_cast<void>(file.advise(MADV_SEQUENTIAL));
+	#else
+		static_cast<void>(file);
+	#endif
+		return authenticode_digest(pe, std::forward<F>(update)...);
+	}
+}
+
+#endif /* libalfheim_pe32_authenticode_hh */
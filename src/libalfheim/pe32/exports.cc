@@ -0,0 +1,12 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* pe32/exports.cc - PE export table lookup */
+
+#include <libalfheim/pe32/exports.hh>
+
+namespace Alfheim::PE32 {
+	export_index_t::export_index_t(const export_index_t&) = default;
+	export_index_t::export_index_t(export_index_t&&) noexcept = default;
+	export_index_t::~export_index_t() noexcept = default;
+	export_index_t& export_index_t::operator=(const export_index_t&) = default;
+	export_index_t& export_index_t::operator=(export_index_t&&) noexcept = default;
+}
@@ -0,0 +1,353 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* pe32/exports.hh - PE export table lookup */
+#pragma once
+#if !defined(libalfheim_pe32_exports_hh)
+#define libalfheim_pe32_exports_hh
+
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+
+#include <libalfheim/pe32.hh>
+#include <libalfheim/symbol_index.hh>
+
+namespace Alfheim::PE32 {
+	/* Where a forwarded export really lives, as "MODULE.Function" or "MODULE.#ordinal" */
+	struct forwarder_t final {
+		/* Without the ".dll", as that's how forwarders spell it */
+		std::string_view module;
+		std::string_view name;
+		std::optional<std::uint32_t> ordinal;
+
+		[[nodiscard]]
+		static std::optional<forwarder_t> parse(const std::string_view target) noexcept {
+			const auto dot{target.rfind('.')};
+			if (dot == std::string_view::npos || !dot || dot + 1U == target.size())
+				return std::nullopt;
+			forwarder_t result{target.substr(0U, dot), target.substr(dot + 1U), std::nullopt};
+			if (result.name.front() != '#')
+				return result;
+
+			std::uint32_t ordinal{};
+			for (const auto chr : result.name.substr(1U)) {
+				if (chr < '0' || chr > '9' || ordinal > 0xFFFFU)
+					return std::nullopt;
+				ordinal = (ordinal * 10U) + std::uint32_t(chr - '0');
+			}
+			if (result.name.size() == 1U)
+				return std::nullopt;
+			result.name = {};
+			result.ordinal = ordinal;
+			return result;
+		}
+	};
+
+	struct export_t final {
+		/* Empty for functions only exported by ordinal */
+		std::string_view name;
+		/* The biased ordinal, as imports refer to it */
+		std::uint32_t ordinal;
+		std::uint32_t rva;
+		/* Set instead of the RVA pointing at code when the export forwards to another DLL */
+		std::string_view forwarder;
+
+		[[nodiscard]]
+		bool is_forwarded() const noexcept { return !forwarder.empty(); }
+	};
+
+	/*
+		A view over the export directory
+
+		Name lookups are a binary search straight over AddressOfNames, which the linker
+		emits in sorted order for exactly this purpose, and ordinal lookups index the
+		function table directly. Names are compared in place in the mapping and nothing is
+		allocated. The strings usually all live in the same section as the directory, so
+		that section is resolved once up front rather than translating each probe's RVA.
+	*/
+	template<Types::class_t C>
+	struct exports_t final {
+		using word_t = Internal::le_t<std::uint32_t>;
+		using half_t = Internal::le_t<std::uint16_t>;
+	private:
+		const pe_t<C>* _pe{nullptr};
+		const Types::export_directory_t* _directory{nullptr};
+		std::uint32_t _directory_rva{};
+		std::uint32_t _directory_size{};
+		span_t<const word_t> _functions{};
+		span_t<const word_t> _names{};
+		span_t<const half_t> _name_ordinals{};
+		/* The section holding the directory, and the RVA it starts at */
+		byte_span_t _strings{};
+		std::uint32_t _strings_rva{};
+
+		template<typename T>
+		[[nodiscard]]
+		span_t<const T> table(const std::uint32_t rva, const std::size_t count) const noexcept {
+			const auto data{_pe->rva_data(rva)};
+			const auto result{data.template array<T>(0U, count)};
+			return result.size() == count ? result : span_t<const T>{};
+		}
+
+		[[nodiscard]]
+		std::string_view string(const std::uint32_t rva) const noexcept {
+			if (rva >= _strings_rva && rva - _strings_rva < _strings.size())
+				return _strings.string(rva - _strings_rva);
+			return _pe->rva_string(rva);
+		}
+	public:
+		constexpr exports_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<exports_t> open(const pe_t<C>& pe) noexcept {
+			const auto* const dir{pe.directory(Types::directory_t::exports)};
+			const auto* const directory{pe.export_directory()};
+			if (!dir || !directory)
+				return std::nullopt;
+
+			exports_t result{};
+			result._pe = &pe;
+			result._directory = directory;
+			result._directory_rva = dir->virtual_address;
+			result._directory_size = dir->size;
+			if (const auto* const sect{pe.section_for(result._directory_rva)}) {
+				result._strings = pe.section_data(*sect);
+				result._strings_rva = sect->virtual_address;
+			}
+
+			const std::size_t functions{directory->number_of_functions};
+			const std::size_t names{directory->number_of_names};
+			result._functions = result.template table<word_t>(directory->address_of_functions, functions);
+			result._names = result.template table<word_t>(directory->address_of_names, names);
+			result._name_ordinals = result.template table<half_t>(directory->address_of_name_ordinals, names);
+			if (result._functions.size() != functions || result._names.size() != names || result._name_ordinals.size() != names)
+				return std::nullopt;
+			return result;
+		}
+
+		[[nodiscard]]
+		const Types::export_directory_t& directory() const noexcept { return *_directory; }
+		/* The DLL's own idea of its name */
+		[[nodiscard]]
+		std::string_view module_name() const noexcept { return string(_directory->name); }
+		[[nodiscard]]
+		std::uint32_t base() const noexcept { return _directory->base; }
+		/* The number of slots in the function table, some of which may be empty */
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _functions.size(); }
+		[[nodiscard]]
+		std::size_t name_count() const noexcept { return _names.size(); }
+
+		/* The name at a position in the sorted name table */
+		[[nodiscard]]
+		std::string_view name(const std::size_t idx) const noexcept { return string(_names[idx]); }
+
+		/* Forwarders are the one case of an export RVA pointing back inside the export directory */
+		[[nodiscard]]
+		bool is_forwarder(const std::uint32_t rva) const noexcept {
+			return rva >= _directory_rva && rva - _directory_rva < _directory_size;
+		}
+
+		/* The export in a slot of the function table, without its name, which would need a scan to find */
+		[[nodiscard]]
+		std::optional<export_t> at(const std::size_t idx, const std::string_view name = {}) const noexcept {
+			if (idx >= _functions.size() || !_functions[idx])
+				return std::nullopt;
+			const std::uint32_t rva{_functions[idx]};
+			const auto ordinal{static_cast<std::uint32_t>(base() + idx)};
+			if (is_forwarder(rva))
+				return export_t{name, ordinal, rva, string(rva)};
+			return export_t{name, ordinal, rva, {}};
+		}
+
+		/* Looks up a biased ordinal, this is a single index into the function table */
+		[[nodiscard]]
+		std::optional<export_t> by_ordinal(const std::uint32_t ordinal) const noexcept {
+			if (ordinal < base())
+				return std::nullopt;
+			return at(ordinal - base());
+		}
+
+		/* The position of a name in the name table, found by binary search */
+		[[nodiscard]]
+		std::optional<std::size_t> name_index(const std::string_view name) const noexcept {
+			std::size_t low{};
+			std::size_t high{_names.size()};
+			while (low < high) {
+				const auto mid{low + ((high - low) / 2U)};
+				const auto probe{string(_names[mid])};
+				const auto order{probe.compare(name)};
+				if (!order)
+					return mid;
+				if (order < 0)
+					low = mid + 1U;
+				else
+					high = mid;
+			}
+			return std::nullopt;
+		}
+
+		[[nodiscard]]
+		std::optional<export_t> find(const std::string_view name) const noexcept {
+			const auto idx{name_index(name)};
+			if (!idx)
+				return std::nullopt;
+			return at(_name_ordinals[*idx], name);
+		}
+
+		/* As find(), but taking the hint from an import, which is the name's expected position in the table */
+		[[nodiscard]]
+		std::optional<export_t> find(const std::string_view name, const std::uint16_t hint) const noexcept {
+			if (hint < _names.size() && string(_names[hint]) == name)
+				return at(_name_ordinals[hint], name);
+			return find(name);
+		}
+
+		/* Calls func with every named export, in name order */
+		template<typename F>
+		void for_each_named(F&& func) const {
+			for (std::size_t idx{}; idx < _names.size(); ++idx) {
+				if (const auto entry{at(_name_ordinals[idx], string(_names[idx]))})
+					func(*entry);
+			}
+		}
+	};
+
+	template<Types::class_t C>
+	[[nodiscard]]
+	std::optional<exports_t<C>> exports(const pe_t<C>& pe) noexcept { return exports_t<C>::open(pe); }
+
+	/*
+		Follows a chain of forwarded exports to where the code really is
+
+		lookup is called with the module name from each forwarder, without its extension, and
+		returns a pointer to the exports of that module or nullptr if it isn't loaded. The
+		chain is bounded, so forwarders that loop back on themselves give up rather than spin.
+	*/
+	template<Types::class_t C, typename F>
+	[[nodiscard]]
+	std::optional<export_t> resolve_forwarder(export_t entry, F&& lookup) {
+		for (std::size_t depth{}; entry.is_forwarded(); ++depth) {
+			const auto target{forwarder_t::parse(entry.forwarder)};
+			if (!target || depth == 16U)
+				return std::nullopt;
+			const exports_t<C>* const module{lookup(target->module)};
+			if (!module)
+				return std::nullopt;
+			const auto next{target->ordinal ? module->by_ordinal(*target->ordinal) : module->find(target->name)};
+			if (!next)
+				return std::nullopt;
+			entry = *next;
+		}
+		return entry;
+	}
+
+	/*
+		Every exported function of an image, sorted by RVA for reverse lookups
+
+		Built once from the export table, after which finding the export an RVA falls in is
+		a binary search over a flat array of RVAs, with the ordinal and name of each kept
+		alongside. Forwarders and empty slots aren't code in this image and are left out.
+	*/
+	struct LIBALFHEIM_CLS_API export_index_t final {
+		static constexpr std::size_t npos{std::numeric_limits<std::size_t>::max()};
+	private:
+		std::vector<std::uint32_t> _rvas{};
+		std::vector<std::uint32_t> _ordinals{};
+		std::vector<std::string_view> _names{};
+	public:
+		export_index_t() noexcept = default;
+		export_index_t(const export_index_t&);
+		export_index_t(export_index_t&&) noexcept;
+		~export_index_t() noexcept;
+		export_index_t& operator=(const export_index_t&);
+		export_index_t& operator=(export_index_t&&) noexcept;
+
+		template<Types::class_t C>
+		[[nodiscard]]
+		static export_index_t build(const exports_t<C>& exports) {
+			/* Invert the name table first so each slot can pick up its name as it's added */
+			std::vector<std::string_view> names(exports.size());
+			exports.for_each_named([&](const export_t& entry) {
+				auto& slot{names[entry.ordinal - exports.base()]};
+				if (slot.empty())
+					slot = entry.name;
+			});
+
+			struct entry_t final {
+				std::uint32_t rva;
+				std::uint32_t ordinal;
+				std::string_view name;
+			};
+			std::vector<entry_t> entries{};
+			entries.reserve(exports.size());
+			for (std::size_t idx{}; idx < exports.size(); ++idx) {
+				const auto entry{exports.at(idx)};
+				if (entry && !entry->is_forwarded())
+					entries.push_back({entry->rva, entry->ordinal, names[idx]});
+			}
+			std::sort(entries.begin(), entries.end(),
+				[](const entry_t& lhs, const entry_t& rhs) noexcept { return lhs.rva < rhs.rva; });
+
+			export_index_t index{};
+			index._rvas.reserve(entries.size());
+			index._ordinals.reserve(entries.size());
+			index._names.reserve(entries.size());
+			for (const auto& entry : entries) {
+				index._rvas.push_back(entry.rva);
+				index._ordinals.push_back(entry.ordinal);
+				index._names.push_back(entry.name);
+			}
+			return index;
+		}
+
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _rvas.size(); }
+		[[nodiscard]]
+		bool empty() const noexcept { return _rvas.empty(); }
+		[[nodiscard]]
+		export_t entry(const std::size_t idx) const noexcept { return {_names[idx], _ordinals[idx], _rvas[idx], {}}; }
+
+		/* The index of the nearest export at or below rva, or npos */
+		[[nodiscard]]
+		std::size_t find(const std::uint32_t rva) const noexcept {
+			const auto iter{std::upper_bound(_rvas.begin(), _rvas.end(), rva)};
+			if (iter == _rvas.begin())
+				return npos;
+			return std::size_t(std::prev(iter) - _rvas.begin());
+		}
+
+		[[nodiscard]]
+		std::optional<export_t> lookup(const std::uint32_t rva) const noexcept {
+			const auto idx{find(rva)};
+			if (idx == npos)
+				return std::nullopt;
+			return entry(idx);
+		}
+	};
+
+	/*
+		Adds the named exports of an image to an address index
+
+		Exports carry no size, so each extends up to the next one. Addresses are the preferred
+		image base plus the RVA, bias moves them to where the image was actually loaded.
+	*/
+	template<Types::class_t C>
+	void index_symbols(const pe_t<C>& pe, symbol_index_t::builder_t& builder, const std::uint64_t bias = 0U) {
+		const auto table{exports(pe)};
+		if (!table)
+			return;
+		const auto base{std::uint64_t{pe.image_base()} + bias};
+		builder.reserve(builder.size() + table->name_count());
+		table->for_each_named([&](const export_t& entry) {
+			if (!entry.is_forwarded())
+				builder.add(base + entry.rva, 0U, entry.name);
+		});
+	}
+}
+
+#endif /* libalfheim_pe32_exports_hh */
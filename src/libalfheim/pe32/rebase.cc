@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* pe32/rebase.cc - PE base relocation application */
+
+#include <cstdint>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(_MSC_VER)
+#	include <immintrin.h>
+#	define LIBALFHEIM_REBASE_X86 1
+#endif
+
+#include <libalfheim/pe32/rebase.hh>
+
+namespace Alfheim::PE32 {
+	namespace {
+		using Types::reloc_type_t;
+
+		template<typename T>
+		[[nodiscard]]
+		Internal::le_t<T>& field(std::uint8_t* const ptr) noexcept { return *reinterpret_cast<Internal::le_t<T>*>(ptr); }
+
+		template<typename T>
+		void add_scalar(std::uint8_t* const data, const std::size_t count, const T delta) noexcept {
+			for (std::size_t idx{}; idx < count; ++idx) {
+				auto& value{field<T>(data + (idx * sizeof(T)))};
+				value = static_cast<T>(value + delta);
+			}
+		}
+
+	#if defined(LIBALFHEIM_REBASE_X86)
+		/* The unaligned load/store intrinsics still take vector pointers, go via void to say that's intended */
+		template<typename V, typename T>
+		[[nodiscard]]
+		V* vector_ptr(T* const ptr) noexcept { return static_cast<V*>(static_cast<void*>(ptr)); }
+		template<typename V, typename T>
+		[[nodiscard]]
+		const V* vector_ptr(const T* const ptr) noexcept { return static_cast<const V*>(static_cast<const void*>(ptr)); }
+
+		/* Adds delta to every 4 or 8 byte lane of len bytes, returning how many it did, the tail is left for the scalar loop */
+		__attribute__((target("avx2")))
+		std::size_t add_avx2(std::uint8_t* const data, const std::size_t len, const std::uint64_t delta,
+			const std::size_t width) noexcept {
+			const auto addend{width == 8U ? _mm256_set1_epi64x(std::int64_t(delta)) : _mm256_set1_epi32(std::int32_t(delta))};
+			std::size_t offset{0};
+			for (; offset + 32U <= len; offset += 32U) {
+				auto* const ptr{vector_ptr<__m256i>(data + offset)};
+				const auto block{_mm256_loadu_si256(ptr)};
+				_mm256_storeu_si256(ptr, width == 8U ? _mm256_add_epi64(block, addend) : _mm256_add_epi32(block, addend));
+			}
+			return offset;
+		}
+
+		/*
+			Counts how many of the count entries at entries step on from first by width each,
+			16 at a time, returning early on the first block that doesn't. The caller finishes
+			off the remainder, and has already bounded count so the offsets can't carry.
+		*/
+		__attribute__((target("avx2")))
+		std::size_t run_avx2(const Internal::le_t<std::uint16_t>* const entries, const std::size_t count,
+			const std::uint16_t first, const std::size_t width) noexcept {
+			const auto stride{static_cast<std::int16_t>(width)};
+			auto expected{_mm256_add_epi16(_mm256_set1_epi16(static_cast<std::int16_t>(first)),
+				_mm256_mullo_epi16(_mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm256_set1_epi16(stride)))};
+			const auto step{_mm256_set1_epi16(static_cast<std::int16_t>(stride * 16))};
+			std::size_t done{0};
+			for (; done + 16U <= count; done += 16U) {
+				const auto block{_mm256_loadu_si256(vector_ptr<__m256i>(entries + done))};
+				if (std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi16(block, expected))) != 0xFFFFFFFFU)
+					break;
+				expected = _mm256_add_epi16(expected, step);
+			}
+			return done;
+		}
+
+		struct kernels_t final {
+			std::size_t (*add)(std::uint8_t*, std::size_t, std::uint64_t, std::size_t) noexcept;
+			std::size_t (*run)(const Internal::le_t<std::uint16_t>*, std::size_t, std::uint16_t, std::size_t) noexcept;
+		};
+
+		[[nodiscard]]
+		kernels_t select_kernels() noexcept {
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2"))
+				return {add_avx2, run_avx2};
+			return {nullptr, nullptr};
+		}
+
+		[[nodiscard]]
+		const kernels_t& kernels() noexcept {
+			static const kernels_t selected{select_kernels()};
+			return selected;
+		}
+	#endif
+
+		/* Adds delta to count adjacent fields of type T, which must all lie in bounds */
+		template<typename T>
+		void add_run(std::uint8_t* data, std::size_t count, const std::uint64_t delta) noexcept {
+		#if defined(LIBALFHEIM_REBASE_X86)
+			if (const auto kernel{kernels().add}) {
+				const auto done{kernel(data, count * sizeof(T), delta, sizeof(T))};
+				data += done;
+				count -= done / sizeof(T);
+			}
+		#endif
+			add_scalar<T>(data, count, static_cast<T>(delta));
+		}
+
+		/* Shorter runs aren't worth the call, a single vector holds 4 DIR64 or 8 HIGHLOW fixups */
+		constexpr std::size_t min_run{4U};
+
+		/*
+			Counts the entries from idx onwards that continue the run of fixups starting at
+			idx, each of the same type and exactly width bytes after the last
+		*/
+		[[nodiscard]]
+		std::size_t run_length(const span_t<const Internal::le_t<std::uint16_t>> entries, const std::size_t idx,
+			const std::size_t width) noexcept {
+			const std::uint16_t first{entries[idx]};
+			/* Stop before the offset would carry into the type nibble */
+			const auto limit{std::min(entries.size() - idx, ((0x0FFFU - (first & 0x0FFFU)) / width) + 1U)};
+			std::size_t count{1U};
+		#if defined(LIBALFHEIM_REBASE_X86)
+			const auto kernel{kernels().run};
+			if (kernel && limit > 16U)
+				count += kernel(entries.data() + idx + 1U, limit - 1U, static_cast<std::uint16_t>(first + width), width);
+		#endif
+			while (count < limit && entries[idx + count] == first + (count * width))
+				++count;
+			return count;
+		}
+	}
+
+	rebase_result_t apply_relocations(std::uint8_t* const page, const std::size_t limit,
+		const span_t<const Internal::le_t<std::uint16_t>> entries, const std::uint64_t delta) noexcept {
+		rebase_result_t result{};
+		const auto fits = [&](const std::size_t offset, const std::size_t width) noexcept {
+			return page && offset + width <= limit;
+		};
+
+		for (std::size_t idx{}; idx < entries.size(); ++idx) {
+			const std::uint16_t entry{entries[idx]};
+			const auto type{static_cast<reloc_type_t>(entry >> 12U)};
+			const std::size_t offset{entry & 0x0FFFU};
+			switch (type) {
+				case reloc_type_t::absolute:
+					break;
+				case reloc_type_t::highlow:
+				case reloc_type_t::dir64: {
+					const std::size_t width{type == reloc_type_t::dir64 ? 8U : 4U};
+					const auto run{run_length(entries, idx, width)};
+					if (run >= min_run && fits(offset, run * width)) {
+						if (width == 8U)
+							add_run<std::uint64_t>(page + offset, run, delta);
+						else
+							add_run<std::uint32_t>(page + offset, run, delta);
+						result.applied += run;
+						idx += run - 1U;
+					} else if (!fits(offset, width))
+						++result.skipped;
+					else {
+						if (width == 8U)
+							add_scalar<std::uint64_t>(page + offset, 1U, delta);
+						else
+							add_scalar<std::uint32_t>(page + offset, 1U, static_cast<std::uint32_t>(delta));
+						++result.applied;
+					}
+					break;
+				}
+				case reloc_type_t::high:
+				case reloc_type_t::low: {
+					if (!fits(offset, 2U)) {
+						++result.skipped;
+						break;
+					}
+					const auto shift{type == reloc_type_t::high ? 16U : 0U};
+					add_scalar<std::uint16_t>(page + offset, 1U, static_cast<std::uint16_t>(delta >> shift));
+					++result.applied;
+					break;
+				}
+				case reloc_type_t::highadj: {
+					/* The low half needed to round the high half correctly rides along in the next entry */
+					if (idx + 1U == entries.size() || !fits(offset, 2U)) {
+						++result.skipped;
+						++idx;
+						break;
+					}
+					const auto low{static_cast<std::int16_t>(entries[++idx].value())};
+					auto& value{field<std::uint16_t>(page + offset)};
+					auto full{static_cast<std::uint32_t>((std::uint32_t{value} << 16U) + std::uint32_t(std::int32_t{low}))};
+					full += static_cast<std::uint32_t>(delta) + 0x8000U;
+					value = static_cast<std::uint16_t>(full >> 16U);
+					++result.applied;
+					break;
+				}
+				default:
+					++result.skipped;
+					break;
+			}
+		}
+		return result;
+	}
+}
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* pe32/rebase.hh - PE base relocation application */
+#pragma once
+#if !defined(libalfheim_pe32_rebase_hh)
+#define libalfheim_pe32_rebase_hh
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/mmap.hh>
+#include <libalfheim/internal/span.hh>
+#include <libalfheim/internal/thread_pool.hh>
+
+#include <libalfheim/pe32.hh>
+
+namespace Alfheim::PE32 {
+	/* How the image being rebased is laid out in memory */
+	enum struct layout_t : std::uint8_t {
+		/* As on disk, RVAs are translated through the section table */
+		file   = 0x00U,
+		/* As loaded, with every section at its RVA */
+		mapped = 0x01U,
+	};
+
+	struct rebase_result_t final {
+		std::size_t applied;
+		/* Fixups of a type that isn't handled, or that land outside the image */
+		std::size_t skipped;
+
+		rebase_result_t& operator+=(const rebase_result_t& other) noexcept {
+			applied += other.applied;
+			skipped += other.skipped;
+			return *this;
+		}
+	};
+
+	/*
+		Applies one relocation block's fixups to the page at page by delta
+
+		limit is how many bytes are writable from page, which may be more than a page as
+		fixups are allowed to straddle the end of it. ABSOLUTE padding is ignored, HIGH,
+		LOW, HIGHLOW, HIGHADJ and DIR64 are applied, and anything else is skipped. Runs of
+		adjacent HIGHLOW or DIR64 fixups, as in pointer tables and vtables, are applied with
+		vector adds where the CPU has them rather than one at a time.
+	*/
+	LIBALFHEIM_API rebase_result_t apply_relocations(std::uint8_t* page, std::size_t limit,
+		span_t<const Internal::le_t<std::uint16_t>> entries, std::uint64_t delta) noexcept;
+
+	/* A relocation block resolved to where its page lives in the image being rebased */
+	struct relocation_job_t final {
+		/* nullptr if the page isn't backed by the image, which skips every fixup in it */
+		std::uint8_t* page;
+		std::size_t limit;
+		span_t<const Internal::le_t<std::uint16_t>> entries;
+	};
+
+	/*
+		Resolves every relocation block of pe to the page it patches in image
+
+		pe describes the image, and must be opened over the file, while image is the memory
+		being rebased in the given layout. That is usually the same file mapped again with
+		PROT_READ | PROT_WRITE and MAP_PRIVATE, so only the pages that are patched are ever
+		copied, but can equally be an image already loaded section by section.
+	*/
+	template<Types::class_t C>
+	[[nodiscard]]
+	std::vector<relocation_job_t> relocation_jobs(const pe_t<C>& pe, Internal::mmap_t& image, const layout_t layout) {
+		auto* const base{image.address<std::uint8_t>()};
+		const auto length{image.length()};
+		const std::size_t image_size{std::min<std::size_t>(pe.image_size(), length)};
+
+		std::vector<relocation_job_t> jobs{};
+		for (const auto& block : pe.relocations()) {
+			relocation_job_t job{nullptr, 0U, block.entries};
+			if (layout == layout_t::mapped) {
+				if (block.page_rva < image_size) {
+					job.page = base + block.page_rva;
+					job.limit = image_size - block.page_rva;
+				}
+			} else if (const auto* const sect{pe.section_for(block.page_rva)}) {
+				/* Only the part of the section that is on disk can be patched, the rest is zero fill */
+				const auto data{pe.section_data(*sect)};
+				const auto start{std::size_t(data.data() - pe.image().data())};
+				const std::size_t offset{block.page_rva - sect->virtual_address};
+				if (offset < data.size() && start + data.size() <= length) {
+					job.page = base + start + offset;
+					job.limit = data.size() - offset;
+				}
+			}
+			jobs.push_back(job);
+		}
+		return jobs;
+	}
+
+	namespace {
+		/* Moves the image base in the optional header as well, so the image is self-consistent afterwards */
+		template<Types::class_t C>
+		[[nodiscard]]
+		std::optional<std::uint64_t> rebase_header(const pe_t<C>& pe, Internal::mmap_t& image, const std::uint64_t new_base) noexcept {
+			using optional_t = typename pe_t<C>::optional_t;
+			using addr_t = typename pe_t<C>::addr_t;
+
+			const auto* const header{reinterpret_cast<const std::uint8_t*>(&pe.optional_header())};
+			const auto offset{std::size_t(header - pe.image().data()) + offsetof(optional_t, image_base)};
+			if (offset + sizeof(Internal::le_t<addr_t>) > image.length())
+				return std::nullopt;
+			/* A PE32 image can't be moved above 4GiB */
+			if (new_base > std::numeric_limits<addr_t>::max())
+				return std::nullopt;
+
+			const std::uint64_t delta{new_base - std::uint64_t{pe.image_base()}};
+			auto* const field{reinterpret_cast<Internal::le_t<addr_t>*>(image.address<std::uint8_t>() + offset)};
+			*field = static_cast<addr_t>(new_base);
+			return delta;
+		}
+	}
+
+	/*
+		Rebases image, as described by pe, so it can be loaded at new_base
+
+		Returns std::nullopt if the image can't be moved, because its relocations have been
+		stripped or the new base doesn't fit, and otherwise how many fixups were applied.
+	*/
+	template<Types::class_t C>
+	[[nodiscard]]
+	std::optional<rebase_result_t> rebase(const pe_t<C>& pe, Internal::mmap_t& image, const std::uint64_t new_base,
+		const layout_t layout = layout_t::file) {
+		if (!image.valid() || !pe.directory(Types::directory_t::basereloc))
+			return std::nullopt;
+		const auto delta{rebase_header(pe, image, new_base)};
+		if (!delta)
+			return std::nullopt;
+
+		rebase_result_t result{};
+		if (*delta) {
+			for (const auto& job : relocation_jobs(pe, image, layout))
+				result += apply_relocations(job.page, job.limit, job.entries, *delta);
+		}
+		return result;
+	}
+
+	/*
+		As rebase(), but with the relocation blocks shared out across a thread pool
+
+		Each block only patches its own page, bar the odd fixup straddling into the next, so
+		blocks can be applied in any order. They are handed out in small batches to keep
+		the pool's shared counter off the hot path.
+	*/
+	template<Types::class_t C>
+	[[nodiscard]]
+	std::optional<rebase_result_t> rebase(const pe_t<C>& pe, Internal::mmap_t& image, const std::uint64_t new_base,
+		Internal::thread_pool_t& pool, const layout_t layout = layout_t::file) {
+		if (!image.valid() || !pe.directory(Types::directory_t::basereloc))
+			return std::nullopt;
+		const auto delta{rebase_header(pe, image, new_base)};
+		if (!delta)
+			return std::nullopt;
+
+		rebase_result_t result{};
+		if (!*delta)
+			return result;
+
+		constexpr std::size_t batch{32U};
+		const auto jobs{relocation_jobs(pe, image, layout)};
+		std::vector<rebase_result_t> results(pool.concurrency());
+		pool.parallel_for((jobs.size() + batch - 1U) / batch, [&](const std::size_t worker, const std::size_t idx) noexcept {
+			rebase_result_t local{};
+			const auto end{std::min(jobs.size(), (idx + 1U) * batch)};
+			for (auto job{idx * batch}; job < end; ++job)
+				local += apply_relocations(jobs[job].page, jobs[job].limit, jobs[job].entries, *delta);
+			results[worker] += local;
+		});
+		for (const auto& partial : results)
+			result += partial;
+		return result;
+	}
+}
+
+#endif /* libalfheim_pe32_rebase_hh */
@@ -4,8 +4,401 @@
 #if !defined(libalfheim_pe32_types_hh)
 #define libalfheim_pe32_types_hh
 
+#include <cstdint>
+#include <array>
+
+#include <libalfheim/internal/endian.hh>
+
 namespace Alfheim::PE32::Types {
+	using Alfheim::Internal::le_t;
+
+	/* "MZ" */
+	constexpr std::uint16_t dos_magic{0x5A4DU};
+	/* "PE\0\0" */
+	constexpr std::uint32_t nt_signature{0x00004550U};
+
+	enum struct class_t : std::uint16_t {
+		pe32     = 0x010BU,
+		pe32plus = 0x020BU,
+	};
+
+	enum struct machine_t : std::uint16_t {
+		unknown     = 0x0000U,
+		i386        = 0x014CU,
+		r3000       = 0x0162U,
+		r4000       = 0x0166U,
+		r10000      = 0x0168U,
+		wcemipsv2   = 0x0169U,
+		alpha       = 0x0184U,
+		sh3         = 0x01A2U,
+		sh3dsp      = 0x01A3U,
+		sh4         = 0x01A6U,
+		sh5         = 0x01A8U,
+		arm         = 0x01C0U,
+		thumb       = 0x01C2U,
+		armnt       = 0x01C4U,
+		am33        = 0x01D3U,
+		powerpc     = 0x01F0U,
+		powerpcfp   = 0x01F1U,
+		ia64        = 0x0200U,
+		mips16      = 0x0266U,
+		alpha64     = 0x0284U,
+		mipsfpu     = 0x0366U,
+		mipsfpu16   = 0x0466U,
+		tricore     = 0x0520U,
+		ebc         = 0x0EBCU,
+		riscv32     = 0x5032U,
+		riscv64     = 0x5064U,
+		riscv128    = 0x5128U,
+		loongarch32 = 0x6232U,
+		loongarch64 = 0x6264U,
+		amd64       = 0x8664U,
+		m32r        = 0x9041U,
+		arm64ec     = 0xA641U,
+		arm64       = 0xAA64U,
+	};
+
+	enum struct characteristics_t : std::uint16_t {
+		relocs_stripped         = 0x0001U,
+		executable_image        = 0x0002U,
+		line_nums_stripped      = 0x0004U,
+		local_syms_stripped     = 0x0008U,
+		aggressive_ws_trim      = 0x0010U,
+		large_address_aware     = 0x0020U,
+		bytes_reversed_lo       = 0x0080U,
+		machine_32bit           = 0x0100U,
+		debug_stripped          = 0x0200U,
+		removable_run_from_swap = 0x0400U,
+		net_run_from_swap       = 0x0800U,
+		system                  = 0x1000U,
+		dll                     = 0x2000U,
+		up_system_only          = 0x4000U,
+		bytes_reversed_hi       = 0x8000U,
+	};
+
+	enum struct subsystem_t : std::uint16_t {
+		unknown                  = 0x0000U,
+		native                   = 0x0001U,
+		windows_gui              = 0x0002U,
+		windows_cui              = 0x0003U,
+		os2_cui                  = 0x0005U,
+		posix_cui                = 0x0007U,
+		native_windows           = 0x0008U,
+		windows_ce_gui           = 0x0009U,
+		efi_application          = 0x000AU,
+		efi_boot_service_driver  = 0x000BU,
+		efi_runtime_driver       = 0x000CU,
+		efi_rom                  = 0x000DU,
+		xbox                     = 0x000EU,
+		windows_boot_application = 0x0010U,
+	};
+
+	/* The index of each entry in the optional header's data directory */
+	enum struct directory_t : std::uint8_t {
+		exports        = 0x00U,
+		imports        = 0x01U,
+		resources      = 0x02U,
+		exceptions     = 0x03U,
+		security       = 0x04U,
+		basereloc      = 0x05U,
+		debug          = 0x06U,
+		architecture   = 0x07U,
+		globalptr      = 0x08U,
+		tls            = 0x09U,
+		load_config    = 0x0AU,
+		bound_import   = 0x0BU,
+		iat            = 0x0CU,
+		delay_import   = 0x0DU,
+		com_descriptor = 0x0EU,
+	};
+
+	constexpr std::size_t directory_count{16U};
+
+	enum struct section_flags_t : std::uint32_t {
+		type_no_pad            = 0x00000008U,
+		cnt_code               = 0x00000020U,
+		cnt_initialized_data   = 0x00000040U,
+		cnt_uninitialized_data = 0x00000080U,
+		lnk_info               = 0x00000200U,
+		lnk_remove             = 0x00000800U,
+		lnk_comdat             = 0x00001000U,
+		gprel                  = 0x00008000U,
+		align_mask             = 0x00F00000U,
+		lnk_nreloc_ovfl        = 0x01000000U,
+		mem_discardable        = 0x02000000U,
+		mem_not_cached         = 0x04000000U,
+		mem_not_paged          = 0x08000000U,
+		mem_shared             = 0x10000000U,
+		mem_execute            = 0x20000000U,
+		mem_read               = 0x40000000U,
+		mem_write              = 0x80000000U,
+	};
+
+	enum struct debug_type_t : std::uint32_t {
+		unknown               = 0x00U,
+		coff                  = 0x01U,
+		codeview              = 0x02U,
+		fpo                   = 0x03U,
+		misc                  = 0x04U,
+		exception             = 0x05U,
+		fixup                 = 0x06U,
+		omap_to_src           = 0x07U,
+		omap_from_src         = 0x08U,
+		borland               = 0x09U,
+		reserved10            = 0x0AU,
+		clsid                 = 0x0BU,
+		vc_feature            = 0x0CU,
+		pogo                  = 0x0DU,
+		iltcg                 = 0x0EU,
+		mpx                   = 0x0FU,
+		repro                 = 0x10U,
+		embedded_portable_pdb = 0x11U,
+		pdb_checksum          = 0x13U,
+		ex_dllcharacteristics = 0x14U,
+	};
+
+	/* "RSDS", the signature of a PDB 7.0 CodeView record */
+	constexpr std::uint32_t codeview_pdb70{0x53445352U};
+
+	/* The type in the top four bits of each base relocation entry */
+	enum struct reloc_type_t : std::uint8_t {
+		absolute = 0x00U,
+		high     = 0x01U,
+		low      = 0x02U,
+		highlow  = 0x03U,
+		highadj  = 0x04U,
+		dir64    = 0x0AU,
+	};
+
+	struct dos_header_t final {
+		le_t<std::uint16_t> e_magic;
+		le_t<std::uint16_t> e_cblp;
+		le_t<std::uint16_t> e_cp;
+		le_t<std::uint16_t> e_crlc;
+		le_t<std::uint16_t> e_cparhdr;
+		le_t<std::uint16_t> e_minalloc;
+		le_t<std::uint16_t> e_maxalloc;
+		le_t<std::uint16_t> e_ss;
+		le_t<std::uint16_t> e_sp;
+		le_t<std::uint16_t> e_csum;
+		le_t<std::uint16_t> e_ip;
+		le_t<std::uint16_t> e_cs;
+		le_t<std::uint16_t> e_lfarlc;
+		le_t<std::uint16_t> e_ovno;
+		std::array<le_t<std::uint16_t>, 4> e_res;
+		le_t<std::uint16_t> e_oemid;
+		le_t<std::uint16_t> e_oeminfo;
+		std::array<le_t<std::uint16_t>, 10> e_res2;
+		/* The file offset of the NT headers */
+		le_t<std::uint32_t> e_lfanew;
+	};
+
+	/* IMAGE_FILE_HEADER, which is also the header of a COFF object */
+	struct file_header_t final {
+		le_t<machine_t> machine;
+		le_t<std::uint16_t> number_of_sections;
+		le_t<std::uint32_t> time_date_stamp;
+		le_t<std::uint32_t> pointer_to_symbol_table;
+		le_t<std::uint32_t> number_of_symbols;
+		le_t<std::uint16_t> size_of_optional_header;
+		le_t<std::uint16_t> characteristics;
+	};
+
+	struct data_directory_t final {
+		le_t<std::uint32_t> virtual_address;
+		le_t<std::uint32_t> size;
+	};
+
+	/* IMAGE_OPTIONAL_HEADER32, up to the data directory that follows it */
+	struct optional_header32_t final {
+		le_t<class_t> magic;
+		std::uint8_t major_linker_version;
+		std::uint8_t minor_linker_version;
+		le_t<std::uint32_t> size_of_code;
+		le_t<std::uint32_t> size_of_initialized_data;
+		le_t<std::uint32_t> size_of_uninitialized_data;
+		le_t<std::uint32_t> address_of_entry_point;
+		le_t<std::uint32_t> base_of_code;
+		le_t<std::uint32_t> base_of_data;
+		le_t<std::uint32_t> image_base;
+		le_t<std::uint32_t> section_alignment;
+		le_t<std::uint32_t> file_alignment;
+		le_t<std::uint16_t> major_operating_system_version;
+		le_t<std::uint16_t> minor_operating_system_version;
+		le_t<std::uint16_t> major_image_version;
+		le_t<std::uint16_t> minor_image_version;
+		le_t<std::uint16_t> major_subsystem_version;
+		le_t<std::uint16_t> minor_subsystem_version;
+		le_t<std::uint32_t> win32_version_value;
+		le_t<std::uint32_t> size_of_image;
+		le_t<std::uint32_t> size_of_headers;
+		le_t<std::uint32_t> checksum;
+		le_t<subsystem_t> subsystem;
+		le_t<std::uint16_t> dll_characteristics;
+		le_t<std::uint32_t> size_of_stack_reserve;
+		le_t<std::uint32_t> size_of_stack_commit;
+		le_t<std::uint32_t> size_of_heap_reserve;
+		le_t<std::uint32_t> size_of_heap_commit;
+		le_t<std::uint32_t> loader_flags;
+		le_t<std::uint32_t> number_of_rva_and_sizes;
+	};
+
+	/* IMAGE_OPTIONAL_HEADER64, which drops base_of_data and widens the image base and sizes */
+	struct optional_header64_t final {
+		le_t<class_t> magic;
+		std::uint8_t major_linker_version;
+		std::uint8_t minor_linker_version;
+		le_t<std::uint32_t> size_of_code;
+		le_t<std::uint32_t> size_of_initialized_data;
+		le_t<std::uint32_t> size_of_uninitialized_data;
+		le_t<std::uint32_t> address_of_entry_point;
+		le_t<std::uint32_t> base_of_code;
+		le_t<std::uint64_t> image_base;
+		le_t<std::uint32_t> section_alignment;
+		le_t<std::uint32_t> file_alignment;
+		le_t<std::uint16_t> major_operating_system_version;
+		le_t<std::uint16_t> minor_operating_system_version;
+		le_t<std::uint16_t> major_image_version;
+		le_t<std::uint16_t> minor_image_version;
+		le_t<std::uint16_t> major_subsystem_version;
+		le_t<std::uint16_t> minor_subsystem_version;
+		le_t<std::uint32_t> win32_version_value;
+		le_t<std::uint32_t> size_of_image;
+		le_t<std::uint32_t> size_of_headers;
+		le_t<std::uint32_t> checksum;
+		le_t<subsystem_t> subsystem;
+		le_t<std::uint16_t> dll_characteristics;
+		le_t<std::uint64_t> size_of_stack_reserve;
+		le_t<std::uint64_t> size_of_stack_commit;
+		le_t<std::uint64_t> size_of_heap_reserve;
+		le_t<std::uint64_t> size_of_heap_commit;
+		le_t<std::uint32_t> loader_flags;
+		le_t<std::uint32_t> number_of_rva_and_sizes;
+	};
+
+	struct section_header_t final {
+		std::array<char, 8> name;
+		le_t<std::uint32_t> virtual_size;
+		le_t<std::uint32_t> virtual_address;
+		le_t<std::uint32_t> size_of_raw_data;
+		le_t<std::uint32_t> pointer_to_raw_data;
+		le_t<std::uint32_t> pointer_to_relocations;
+		le_t<std::uint32_t> pointer_to_linenumbers;
+		le_t<std::uint16_t> number_of_relocations;
+		le_t<std::uint16_t> number_of_linenumbers;
+		le_t<std::uint32_t> characteristics;
+	};
+
+	struct export_directory_t final {
+		le_t<std::uint32_t> characteristics;
+		le_t<std::uint32_t> time_date_stamp;
+		le_t<std::uint16_t> major_version;
+		le_t<std::uint16_t> minor_version;
+		le_t<std::uint32_t> name;
+		le_t<std::uint32_t> base;
+		le_t<std::uint32_t> number_of_functions;
+		le_t<std::uint32_t> number_of_names;
+		le_t<std::uint32_t> address_of_functions;
+		le_t<std::uint32_t> address_of_names;
+		le_t<std::uint32_t> address_of_name_ordinals;
+	};
+
+	/* The import directory is an array of these, terminated by an all zero entry */
+	struct import_descriptor_t final {
+		/* The RVA of the import lookup table, or 0 for some old binders that only have the IAT */
+		le_t<std::uint32_t> original_first_thunk;
+		le_t<std::uint32_t> time_date_stamp;
+		le_t<std::uint32_t> forwarder_chain;
+		le_t<std::uint32_t> name;
+		le_t<std::uint32_t> first_thunk;
+	};
+
+	/* One page of base relocations, followed by (size_of_block - 8) / 2 entries */
+	struct base_relocation_t final {
+		le_t<std::uint32_t> virtual_address;
+		le_t<std::uint32_t> size_of_block;
+	};
+
+	struct debug_directory_t final {
+		le_t<std::uint32_t> characteristics;
+		le_t<std::uint32_t> time_date_stamp;
+		le_t<std::uint16_t> major_version;
+		le_t<std::uint16_t> minor_version;
+		le_t<debug_type_t> type;
+		le_t<std::uint32_t> size_of_data;
+		le_t<std::uint32_t> address_of_raw_data;
+		le_t<std::uint32_t> pointer_to_raw_data;
+	};
+
+	/* The fixed part of an RSDS record, the NUL terminated PDB path follows */
+	struct codeview_pdb70_t final {
+		le_t<std::uint32_t> signature;
+		std::array<std::uint8_t, 16> guid;
+		le_t<std::uint32_t> age;
+	};
+
+	struct resource_directory_t final {
+		le_t<std::uint32_t> characteristics;
+		le_t<std::uint32_t> time_date_stamp;
+		le_t<std::uint16_t> major_version;
+		le_t<std::uint16_t> minor_version;
+		le_t<std::uint16_t> number_of_named_entries;
+		le_t<std::uint16_t> number_of_id_entries;
+	};
+
+	/* The top bit of name marks a string name and of offset a subdirectory, both relative to the section */
+	struct resource_directory_entry_t final {
+		le_t<std::uint32_t> name;
+		le_t<std::uint32_t> offset;
+	};
+
+	struct resource_data_entry_t final {
+		le_t<std::uint32_t> offset_to_data;
+		le_t<std::uint32_t> size;
+		le_t<std::uint32_t> code_page;
+		le_t<std::uint32_t> reserved;
+	};
+
+	constexpr std::uint32_t resource_high_bit{0x80000000U};
+
+	/* Maps a PE class to the optional header and thunk width */
+	template<class_t C>
+	struct layout_t;
+
+	template<>
+	struct layout_t<class_t::pe32> final {
+		static constexpr class_t pe_class{class_t::pe32};
+		static constexpr std::uint32_t ordinal_flag{0x80000000U};
+
+		using addr_t     = std::uint32_t;
+		using optional_t = optional_header32_t;
+		using thunk_t    = le_t<std::uint32_t>;
+	};
+
+	template<>
+	struct layout_t<class_t::pe32plus> final {
+		static constexpr class_t pe_class{class_t::pe32plus};
+		static constexpr std::uint64_t ordinal_flag{0x8000000000000000U};
+
+		using addr_t     = std::uint64_t;
+		using optional_t = optional_header64_t;
+		using thunk_t    = le_t<std::uint64_t>;
+	};
 
+	static_assert(sizeof(dos_header_t) == 64, "dos_header_t must be 64 bytes");
+	static_assert(sizeof(file_header_t) == 20, "file_header_t must be 20 bytes");
+	static_assert(sizeof(data_directory_t) == 8, "data_directory_t must be 8 bytes");
+	static_assert(sizeof(optional_header32_t) == 96, "optional_header32_t must be 96 bytes");
+	static_assert(sizeof(optional_header64_t) == 112, "optional_header64_t must be 112 bytes");
+	static_assert(sizeof(section_header_t) == 40, "section_header_t must be 40 bytes");
+	static_assert(sizeof(export_directory_t) == 40, "export_directory_t must be 40 bytes");
+	static_assert(sizeof(import_descriptor_t) == 20, "import_descriptor_t must be 20 bytes");
+	static_assert(sizeof(base_relocation_t) == 8, "base_relocation_t must be 8 bytes");
+	static_assert(sizeof(debug_directory_t) == 28, "debug_directory_t must be 28 bytes");
+	static_assert(sizeof(codeview_pdb70_t) == 24, "codeview_pdb70_t must be 24 bytes");
+	static_assert(sizeof(resource_directory_t) == 16, "resource_directory_t must be 16 bytes");
+	static_assert(sizeof(resource_directory_entry_t) == 8, "resource_directory_entry_t must be 8 bytes");
+	static_assert(sizeof(resource_data_entry_t) == 16, "resource_data_entry_t must be 16 bytes");
 }
 
 #endif /* libalfheim_pe32_types_hh */
@@ -0,0 +1,336 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* scanner.cc - Parallel directory tree classification */
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <libalfheim/internal/fd.hh>
+#include <libalfheim/internal/mmap.hh>
+
+#include <libalfheim/scanner.hh>
+
+namespace Alfheim {
+	using namespace Alfheim::Internal;
+
+	namespace {
+		template<typename elf_t>
+		void describe_elf(const elf_t& elf, scan_record_t& record) noexcept {
+			record.machine = static_cast<std::uint16_t>(elf.header().e_machine.value());
+
+			const auto build_id{elf.build_id()};
+			record.build_id_len = static_cast<std::uint8_t>(std::min(build_id.size(), record.build_id.size()));
+			std::copy_n(build_id.data(), record.build_id_len, record.build_id.begin());
+
+			auto low{std::numeric_limits<std::uint64_t>::max()};
+			std::uint64_t high{};
+			for (const auto& phdr : elf.segments()) {
+				if (phdr.p_type != ELF::Types::segment_type_t::load)
+					continue;
+				const std::uint64_t vaddr{phdr.p_vaddr};
+				low = std::min(low, vaddr);
+				high = std::max(high, vaddr + std::uint64_t{phdr.p_memsz});
+			}
+			record.image_size = high > low ? high - low : 0U;
+		}
+
+		template<typename macho_t>
+		void describe_macho(const macho_t& macho, scan_record_t& record) noexcept {
+			record.machine = static_cast<std::uint32_t>(macho.cpu_type());
+			if (const auto uuid{macho.uuid()}) {
+				record.build_id_len = static_cast<std::uint8_t>(uuid->size());
+				std::copy(uuid->begin(), uuid->end(), record.build_id.begin());
+			}
+
+			auto low{std::numeric_limits<std::uint64_t>::max()};
+			std::uint64_t high{};
+			for (const auto& segment : macho.segments()) {
+				/* __PAGEZERO reserves address space but is never mapped */
+				if (!std::uint64_t{segment.vmsize} || (!std::uint64_t{segment.filesize} && !segment.initprot.value()))
+					continue;
+				const std::uint64_t vmaddr{segment.vmaddr};
+				low = std::min(low, vmaddr);
+				high = std::max(high, vmaddr + std::uint64_t{segment.vmsize});
+			}
+			record.image_size = high > low ? high - low : 0U;
+		}
+
+		/* The CodeView GUID and age are what tie an image to its PDB, so together they stand in for the build-id */
+		template<typename pe_t>
+		void describe_pe(const pe_t& pe, scan_record_t& record) noexcept {
+			record.machine = static_cast<std::uint16_t>(pe.machine());
+			record.image_size = pe.image_size();
+			if (const auto codeview{pe.codeview()}) {
+				const auto end{std::copy(codeview->guid.begin(), codeview->guid.end(), record.build_id.begin())};
+				for (std::size_t byte{}; byte < sizeof(std::uint32_t); ++byte)
+					end[std::ptrdiff_t(byte)] = static_cast<std::uint8_t>(codeview->age >> (byte * 8U));
+				record.build_id_len = static_cast<std::uint8_t>(codeview->guid.size() + sizeof(std::uint32_t));
+			}
+		}
+
+		/* A worker's share of the queued paths, the owner takes from the front and thieves from the back */
+		struct work_queue_t final {
+			std::mutex lock{};
+			std::deque<fs::path> paths{};
+		};
+
+		struct worker_stats_t final {
+			std::uint64_t objects{};
+			std::uint64_t errors{};
+			std::uint64_t bytes{};
+		};
+
+		/*
+			The state shared between the walk and the workers
+
+			queued is the total number of paths across every queue, and is what both the
+			backpressure on the walk and the workers going to sleep are keyed on. Sleepers are
+			counted so that the common case of nobody waiting never touches the shared lock.
+		*/
+		struct scheduler_t final {
+			std::vector<work_queue_t> queues;
+			std::size_t capacity;
+
+			std::atomic<std::size_t> queued{0};
+			std::atomic<std::size_t> sleepers{0};
+			std::atomic<bool> walk_waiting{false};
+			std::atomic<bool> done{false};
+
+			std::mutex lock{};
+			std::condition_variable work{};
+			std::condition_variable space{};
+
+			scheduler_t(const std::size_t workers, const std::size_t depth) :
+				queues(workers), capacity{std::max<std::size_t>(depth, 1U)} { /* NOP */ }
+
+			void push(const std::size_t queue, fs::path&& path) {
+				if (queued.load() >= capacity) {
+					std::unique_lock<std::mutex> guard{lock};
+					walk_waiting.store(true);
+					space.wait(guard, [&]() noexcept { return queued.load() < capacity; });
+					walk_waiting.store(false);
+				}
+
+				{
+					auto& target{queues[queue]};
+					std::lock_guard<std::mutex> guard{target.lock};
+					target.paths.emplace_back(std::move(path));
+				}
+				queued.fetch_add(1U);
+				if (sleepers.load()) {
+					/* Taking the lock orders this against a worker between checking queued and sleeping */
+					{ std::lock_guard<std::mutex> guard{lock}; }
+					work.notify_one();
+				}
+			}
+
+			void finish() noexcept {
+				{
+					std::lock_guard<std::mutex> guard{lock};
+					done.store(true);
+				}
+				work.notify_all();
+			}
+
+			[[nodiscard]]
+			bool try_pop(const std::size_t worker, fs::path& path) {
+				{
+					auto& own{queues[worker]};
+					std::lock_guard<std::mutex> guard{own.lock};
+					if (!own.paths.empty()) {
+						path = std::move(own.paths.front());
+						own.paths.pop_front();
+						return true;
+					}
+				}
+				for (std::size_t offset{1U}; offset < queues.size(); ++offset) {
+					auto& victim{queues[(worker + offset) % queues.size()]};
+					std::lock_guard<std::mutex> guard{victim.lock};
+					if (!victim.paths.empty()) {
+						path = std::move(victim.paths.back());
+						victim.paths.pop_back();
+						return true;
+					}
+				}
+				return false;
+			}
+
+			/* Blocks until there is a path to work on, returning false once the walk is done and everything is drained */
+			[[nodiscard]]
+			bool pop(const std::size_t worker, fs::path& path) {
+				while (true) {
+					if (try_pop(worker, path)) {
+						queued.fetch_sub(1U);
+						if (walk_waiting.load()) {
+							{ std::lock_guard<std::mutex> guard{lock}; }
+							space.notify_one();
+						}
+						return true;
+					}
+
+					std::unique_lock<std::mutex> guard{lock};
+					sleepers.fetch_add(1U);
+					work.wait(guard, [&]() noexcept { return queued.load() || done.load(); });
+					sleepers.fetch_sub(1U);
+					if (!queued.load() && done.load())
+						return false;
+				}
+			}
+		};
+
+		[[nodiscard]]
+		std::size_t worker_count(const scan_options_t& options) noexcept {
+			if (options.threads)
+				return options.threads;
+			return std::max(std::thread::hardware_concurrency(), 1U);
+		}
+
+		[[nodiscard]]
+		bool reportable(const scan_record_t& record, const scan_options_t& options) noexcept {
+			if (!options.skip_unknown)
+				return true;
+			return record.status == scan_status_t::ok || record.status == scan_status_t::malformed;
+		}
+	}
+
+	scan_record_t scan_file(fs::path path) {
+		scan_record_t record{
+			std::move(path), 0U, 0U, {format_t::unknown, endian_t::little, 0U}, scan_status_t::unreadable, 0U, 0U, {}
+		};
+
+		fd_t file{record.path, O_RDONLY};
+		if (!file.valid())
+			return record;
+		const auto length{file.length()};
+		if (length < 0)
+			return record;
+		record.file_size = std::uint64_t(length);
+		record.status = scan_status_t::unrecognised;
+		if (!length)
+			return record;
+
+		const auto map{file.map(PROT_READ, MAP_PRIVATE)};
+		if (!map.valid()) {
+			record.status = scan_status_t::unreadable;
+			return record;
+		}
+
+		const auto info{identify(map.view())};
+		if (!info)
+			return record;
+		record.info = *info;
+
+		const auto image{open(map)};
+		if (!image) {
+			record.status = scan_status_t::malformed;
+			return record;
+		}
+		record.status = scan_status_t::ok;
+
+		if (const auto* const elf{image->as<ELF::elf_any_t>()})
+			std::visit([&](const auto& inner) noexcept { describe_elf(inner, record); }, *elf);
+		else if (const auto* const macho{image->as<MachO::macho_any_t>()})
+			std::visit([&](const auto& inner) noexcept { describe_macho(inner, record); }, *macho);
+		else if (const auto* const pe{image->as<PE32::pe_any_t>()})
+			std::visit([&](const auto& inner) noexcept { describe_pe(inner, record); }, *pe);
+		else if (const auto* const xcoff{image->as<XCOFF::xcoff_any_t>()})
+			record.machine = std::visit([](const auto& inner) noexcept { return inner.magic(); }, *xcoff);
+		else if (const auto* const ecoff{image->as<ECOFF::ecoff_any_t>()})
+			record.machine = std::visit([](const auto& inner) noexcept { return std::uint16_t(inner.magic()); }, *ecoff);
+		else if (const auto* const aout{image->as<aout::aout_any_t>()})
+			record.machine = std::visit([](const auto& inner) noexcept { return std::uint16_t(inner.machine()); }, *aout);
+		else if (const auto* const coff{image->as<COFF::coff_any_t>()})
+			record.machine = std::visit([](const auto& inner) noexcept { return inner.machine(); }, *coff);
+		else if (const auto* const cache{image->as<MachO::dyld_cache_t>()}) {
+			/* The images have their own UUIDs, the one in the header identifies the cache as a whole */
+			record.build_id_len = static_cast<std::uint8_t>(cache->uuid().size());
+			std::copy(cache->uuid().begin(), cache->uuid().end(), record.build_id.begin());
+		}
+		return record;
+	}
+
+	scan_stats_t scan(const fs::path& root, const scan_options_t& options, const scan_sink_t& sink) {
+		const auto workers{worker_count(options)};
+		scheduler_t scheduler{workers, options.queue_depth};
+		std::vector<worker_stats_t> stats(workers);
+
+		std::vector<std::thread> threads{};
+		threads.reserve(workers);
+		for (std::size_t worker{}; worker < workers; ++worker) {
+			threads.emplace_back([&, worker]() {
+				auto& local{stats[worker]};
+				fs::path path{};
+				while (scheduler.pop(worker, path)) {
+					auto record{scan_file(std::move(path))};
+					local.bytes += record.file_size;
+					if (record.status == scan_status_t::ok || record.status == scan_status_t::malformed)
+						++local.objects;
+					else if (record.status == scan_status_t::unreadable)
+						++local.errors;
+					if (reportable(record, options))
+						sink(worker, std::move(record));
+				}
+			});
+		}
+
+		scan_stats_t result{};
+		std::error_code error{};
+		const auto enqueue = [&](const fs::directory_entry& entry) {
+			std::error_code status_error{};
+			if (!options.follow_symlinks && entry.is_symlink(status_error))
+				return;
+			if (!entry.is_regular_file(status_error))
+				return;
+			++result.files;
+			const auto size{entry.file_size(status_error)};
+			if (status_error) {
+				++result.errors;
+				return;
+			}
+			if (size < options.min_size)
+				return;
+			/* Spread the paths round robin, stealing evens out whatever imbalance that leaves */
+			scheduler.push(std::size_t(result.files % workers), fs::path{entry.path()});
+		};
+
+		const fs::directory_entry root_entry{root, error};
+		if (!error && root_entry.is_directory(error)) {
+			auto walk_options{fs::directory_options::skip_permission_denied};
+			if (options.follow_symlinks)
+				walk_options |= fs::directory_options::follow_directory_symlink;
+
+			fs::recursive_directory_iterator iter{root, walk_options, error};
+			for (; !error && iter != fs::recursive_directory_iterator{}; iter.increment(error))
+				enqueue(*iter);
+			/* Carry on past whatever we couldn't read, rather than abandoning the rest of the tree */
+			while (error && iter != fs::recursive_directory_iterator{}) {
+				++result.errors;
+				error.clear();
+				iter.pop(error);
+				for (; !error && iter != fs::recursive_directory_iterator{}; iter.increment(error))
+					enqueue(*iter);
+			}
+		} else if (!error)
+			enqueue(root_entry);
+		if (error)
+			++result.errors;
+
+		scheduler.finish();
+		for (auto& thread : threads)
+			thread.join();
+
+		for (const auto& local : stats) {
+			result.objects += local.objects;
+			result.errors += local.errors;
+			result.bytes += local.bytes;
+		}
+		return result;
+	}
+}
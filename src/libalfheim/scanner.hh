@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* scanner.hh - Parallel directory tree classification */
+#pragma once
+#if !defined(libalfheim_scanner_hh)
+#define libalfheim_scanner_hh
+
+#include <cstdint>
+#include <array>
+#include <filesystem>
+#include <functional>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/format.hh>
+
+namespace Alfheim {
+	namespace fs = std::filesystem;
+
+	enum struct scan_status_t : std::uint8_t {
+		/* Recognised, and parsed if there is a backend for the format */
+		ok           = 0x00U,
+		/* Readable, but not an object in any format we know of */
+		unrecognised = 0x01U,
+		/* Recognised, but the backend rejected it */
+		malformed    = 0x02U,
+		/* Couldn't be opened or mapped */
+		unreadable   = 0x03U,
+	};
+
+	/* What the scanner learned about a single file */
+	struct scan_record_t final {
+		fs::path path;
+		std::uint64_t file_size;
+		/* The extent of the loadable segments once mapped, or 0 if that isn't known */
+		std::uint64_t image_size;
+		format_info_t info;
+		scan_status_t status;
+		std::uint8_t build_id_len;
+		/* The native machine number, e_machine for ELF, the CPU type including its ABI bits for Mach-O, the magic for ECOFF and XCOFF, or the machine ID for a.out */
+		std::uint32_t machine;
+		std::array<std::uint8_t, 32> build_id;
+
+		[[nodiscard]]
+		Internal::byte_span_t build_id_view() const noexcept { return {build_id.data(), build_id_len}; }
+	};
+
+	struct scan_options_t final {
+		/* The number of worker threads, 0 for one per hardware thread */
+		std::size_t threads{0};
+		/* The most paths that can be queued up ahead of the workers at once */
+		std::size_t queue_depth{4096};
+		/* Files smaller than this are skipped without being opened */
+		std::uint64_t min_size{4};
+		bool follow_symlinks{false};
+		/* Don't emit records for files that are unreadable or unrecognised */
+		bool skip_unknown{true};
+	};
+
+	struct scan_stats_t final {
+		/* Regular files found by the walk, including those skipped by size */
+		std::uint64_t files;
+		/* Files that were recognised as objects */
+		std::uint64_t objects;
+		/* Files that couldn't be read, and directories that couldn't be walked */
+		std::uint64_t errors;
+		/* The total size of the files that were opened */
+		std::uint64_t bytes;
+	};
+
+	/*
+		Called with each record as it's produced, from whichever worker produced it
+
+		The worker index is in the range [0, threads) and can be used to index per-worker
+		state without locking. The sink must not throw.
+	*/
+	using scan_sink_t = std::function<void(std::size_t worker, scan_record_t&& record)>;
+
+	/*
+		Walks root and classifies every regular file below it
+
+		The calling thread walks the tree and feeds the paths to a set of workers, each of
+		which opens, maps, and classifies its files and then hands the records to the sink.
+		Each worker has its own queue, taking from the front of its own and stealing from
+		the back of the others when it runs dry, so no one lock is shared by every file. The
+		walk blocks once queue_depth paths are waiting, so memory use is bounded no matter
+		the size of the tree, and a slow sink throttles the walk rather than piling up work.
+	*/
+	LIBALFHEIM_API scan_stats_t scan(const fs::path& root, const scan_options_t& options, const scan_sink_t& sink);
+
+	/* Classifies a single file, as each worker does during a scan() */
+	[[nodiscard]]
+	LIBALFHEIM_API scan_record_t scan_file(fs::path path);
+}
+
+#endif /* libalfheim_scanner_hh */
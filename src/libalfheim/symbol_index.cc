@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* symbol_index.cc - Address to symbol interval index */
+
+#include <algorithm>
+
+#include <libalfheim/symbol_index.hh>
+
+namespace Alfheim {
+	symbol_index_t::symbol_index_t(symbol_index_t&&) noexcept = default;
+	symbol_index_t& symbol_index_t::operator=(symbol_index_t&&) noexcept = default;
+	symbol_index_t::~symbol_index_t() noexcept = default;
+
+	symbol_index_t symbol_index_t::builder_t::build(const std::uint64_t limit) {
+		std::sort(_symbols.begin(), _symbols.end(), [](const symbol_t& a, const symbol_t& b) noexcept {
+			if (a.address != b.address)
+				return a.address < b.address;
+			return a.size > b.size;
+		});
+		_symbols.erase(std::unique(_symbols.begin(), _symbols.end(), [](const symbol_t& a, const symbol_t& b) noexcept {
+			return a.address == b.address;
+		}), _symbols.end());
+
+		symbol_index_t index{};
+		const auto count{_symbols.size()};
+		index._starts.reserve(count);
+		index._ends.reserve(count);
+		index._names.reserve(count);
+		index._parents.reserve(count);
+
+		/* The symbols that might still cover a later start, innermost on top */
+		std::vector<std::size_t> open{};
+		for (std::size_t idx{}; idx < count; ++idx) {
+			const auto& sym{_symbols[idx]};
+			const auto next{(idx + 1U < count) ? _symbols[idx + 1U].address : limit};
+			auto end{sym.address + sym.size};
+			/* Zero sized symbols run up to the next one, and sizes that wrap are clamped */
+			if (!sym.size || end < sym.address)
+				end = std::max(next, sym.address + 1U);
+
+			/* Anything ending at or before this start can't cover it or any later one either */
+			while (!open.empty() && index._ends[open.back()] <= sym.address)
+				open.pop_back();
+			index._parents.push_back(open.empty() ? npos : open.back());
+			open.push_back(idx);
+
+			index._starts.push_back(sym.address);
+			index._ends.push_back(end);
+			index._names.push_back(sym.name);
+		}
+
+		std::vector<symbol_t>{}.swap(_symbols);
+		index.layout_eytzinger();
+		return index;
+	}
+
+	void symbol_index_t::layout_eytzinger() noexcept {
+		const auto count{_starts.size()};
+		_eytzinger.assign(count + 1U, 0U);
+		_ranks.assign(count + 1U, 0U);
+
+		/* An in-order walk of the implicit tree visits the nodes in sorted order */
+		std::size_t rank{};
+		std::size_t pos{1U};
+		bool descend{true};
+		while (rank < count) {
+			if (descend) {
+				while (pos * 2U <= count)
+					pos *= 2U;
+			}
+			_eytzinger[pos] = _starts[rank];
+			_ranks[pos] = static_cast<std::uint32_t>(rank);
+			++rank;
+
+			if (pos * 2U + 1U <= count) {
+				pos = pos * 2U + 1U;
+				descend = true;
+			} else {
+				/* Climb while we're a right child, then once more to the parent */
+				while (pos & 1U)
+					pos >>= 1U;
+				pos >>= 1U;
+				descend = false;
+			}
+		}
+	}
+
+	bool symbol_index_t::find(const Internal::span_t<const std::uint64_t> addresses, const Internal::span_t<std::size_t> results) const noexcept {
+		if (results.size() < addresses.size())
+			return false;
+
+		const auto count{_starts.size()};
+		const auto* const starts{_starts.data()};
+		/* Number of starts <= the previous address */
+		std::size_t cursor{};
+		std::uint64_t previous{};
+
+		for (std::size_t idx{}; idx < addresses.size(); ++idx) {
+			const auto address{addresses[idx]};
+			/* Out of order, so start over from the beginning */
+			if (address < previous)
+				cursor = 0U;
+			previous = address;
+
+			/* Gallop forward from the last position, then binary search the final step */
+			std::size_t step{1U};
+			std::size_t low{cursor};
+			while (low + step <= count && starts[low + step - 1U] <= address) {
+				low += step;
+				step *= 2U;
+			}
+			const auto high{std::min(low + step, count + 1U)};
+			cursor = std::size_t(std::upper_bound(starts + low, starts + high - 1U, address) - starts);
+
+			results[idx] = cursor ? enclosing(cursor - 1U, address) : npos;
+		}
+		return true;
+	}
+}
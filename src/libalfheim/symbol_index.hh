@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* symbol_index.hh - Address to symbol interval index */
+#pragma once
+#if !defined(libalfheim_symbol_index_hh)
+#define libalfheim_symbol_index_hh
+
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <libalfheim/internal/bits.hh>
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/span.hh>
+
+namespace Alfheim {
+	/*
+		A read-only index mapping addresses to the symbol whose range contains them
+
+		The ranges are stored as a struct-of-arrays sorted by start address, with a copy of
+		the start addresses in Eytzinger (BFS) order for single lookups, so that each step
+		of the search prefetches the next four levels in a single cache line. Batched
+		lookups of sorted addresses instead sweep the sorted starts with a galloping search
+		from the previous hit.
+
+		Each symbol also records the closest earlier symbol whose range covers its start, so
+		an address past the end of a nested symbol falls back to the one enclosing it. When
+		ranges overlap the one starting latest wins.
+
+		Names are views into whatever the symbols were built from, so the backing image must
+		outlive the index. Once built the index is never mutated, so a single instance can be
+		shared between any number of threads without synchronization.
+	*/
+	struct LIBALFHEIM_CLS_API symbol_index_t final {
+		static constexpr std::size_t npos{std::numeric_limits<std::size_t>::max()};
+
+		struct symbol_t final {
+			std::uint64_t address;
+			std::uint64_t size;
+			std::string_view name;
+		};
+
+		struct builder_t final {
+		private:
+			std::vector<symbol_t> _symbols{};
+		public:
+			builder_t() noexcept = default;
+
+			/* Grows at least geometrically, so reserving ahead of each of many images stays linear overall */
+			void reserve(const std::size_t count) {
+				if (count > _symbols.capacity())
+					_symbols.reserve(std::max(count, _symbols.capacity() * 2U));
+			}
+			[[nodiscard]]
+			std::size_t size() const noexcept { return _symbols.size(); }
+
+			/* A size of 0 means the symbol extends up to the next one */
+			void add(const std::uint64_t address, const std::uint64_t size, const std::string_view name) {
+				_symbols.push_back({address, size, name});
+			}
+
+			/*
+				Builds the index, any zero sized symbol that is last extends up to limit
+
+				When symbols share a start address the largest one is kept.
+			*/
+			[[nodiscard]]
+			symbol_index_t build(std::uint64_t limit = std::numeric_limits<std::uint64_t>::max());
+		};
+	private:
+		std::vector<std::uint64_t> _starts{};
+		std::vector<std::uint64_t> _ends{};
+		std::vector<std::string_view> _names{};
+		/* One-based, _eytzinger[0] is unused */
+		std::vector<std::uint64_t> _eytzinger{};
+		std::vector<std::uint32_t> _ranks{};
+		/* The closest earlier symbol whose range covers each one's start, or npos */
+		std::vector<std::size_t> _parents{};
+
+		void layout_eytzinger() noexcept;
+
+		/* Walks out from the last symbol starting at or before address to the first one containing it */
+		[[nodiscard]]
+		std::size_t enclosing(std::size_t idx, const std::uint64_t address) const noexcept {
+			while (idx != npos && address >= _ends[idx])
+				idx = _parents[idx];
+			return idx;
+		}
+	public:
+		symbol_index_t() noexcept = default;
+		symbol_index_t(symbol_index_t&&) noexcept;
+		symbol_index_t& operator=(symbol_index_t&&) noexcept;
+		~symbol_index_t() noexcept;
+
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _starts.size(); }
+		[[nodiscard]]
+		bool empty() const noexcept { return _starts.empty(); }
+
+		[[nodiscard]]
+		symbol_t symbol(const std::size_t idx) const noexcept {
+			return {_starts[idx], _ends[idx] - _starts[idx], _names[idx]};
+		}
+
+		[[nodiscard]]
+		std::uint64_t start(const std::size_t idx) const noexcept { return _starts[idx]; }
+		[[nodiscard]]
+		std::uint64_t end(const std::size_t idx) const noexcept { return _ends[idx]; }
+		[[nodiscard]]
+		std::string_view name(const std::size_t idx) const noexcept { return _names[idx]; }
+
+		/* Returns the index of the symbol containing address, or npos */
+		[[nodiscard]]
+		std::size_t find(const std::uint64_t address) const noexcept {
+			const auto count{_starts.size()};
+			std::size_t pos{1U};
+			while (pos <= count) {
+			#if defined(__GNUC__)
+				__builtin_prefetch(_eytzinger.data() + (pos * 16U));
+			#endif
+				pos = (pos * 2U) + std::size_t(_eytzinger[pos] <= address);
+			}
+			/* Strip the trailing right turns to land on the first start past address */
+			pos >>= Internal::countr_zero(~pos) + 1U;
+
+			const std::size_t upper{pos ? std::size_t{_ranks[pos]} : count};
+			if (!upper)
+				return npos;
+			return enclosing(upper - 1U, address);
+		}
+
+		[[nodiscard]]
+		std::optional<symbol_t> lookup(const std::uint64_t address) const noexcept {
+			const auto idx{find(address)};
+			if (idx == npos)
+				return std::nullopt;
+			return symbol(idx);
+		}
+
+		/*
+			Resolves a batch of addresses, writing the symbol index or npos for each into results
+
+			This is fastest when addresses are sorted, but any order is handled correctly.
+			Returns false if results is smaller than addresses.
+		*/
+		[[nodiscard]]
+		bool find(Internal::span_t<const std::uint64_t> addresses, Internal::span_t<std::size_t> results) const noexcept;
+	};
+}
+
+#endif /* libalfheim_symbol_index_hh */
@@ -2,3 +2,20 @@
 /* xcoff.cc - XCOFF support */
 
 #include <libalfheim/xcoff.hh>
+
+namespace Alfheim::XCOFF {
+	std::optional<xcoff_any_t> open(const byte_span_t image) noexcept {
+		const auto* const magic{image.as<Types::be_t<std::uint16_t>>(0U)};
+		if (!magic)
+			return std::nullopt;
+
+		if (*magic == Types::magic32) {
+			if (auto xcoff{xcoff32_t::open(image)})
+				return xcoff_any_t{*xcoff};
+		} else if (*magic == Types::magic64 || *magic == Types::magic64_old) {
+			if (auto xcoff{xcoff64_t::open(image)})
+				return xcoff_any_t{*xcoff};
+		}
+		return std::nullopt;
+	}
+}
@@ -4,10 +4,466 @@
 #if !defined(libalfheim_xcoff_hh)
 #define libalfheim_xcoff_hh
 
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <string_view>
+#include <variant>
+
+#include <libalfheim/internal/defs.hh>
+#include <libalfheim/internal/endian.hh>
+#include <libalfheim/internal/span.hh>
+
+#include <libalfheim/symbol_index.hh>
+
 #include <libalfheim/xcoff/types.hh>
 
 namespace Alfheim::XCOFF {
+	using Internal::span_t;
+	using Internal::byte_span_t;
+	using Internal::narrow_size;
+
+	/* Turns a fixed size, possibly unterminated, section or symbol name into a string */
+	[[nodiscard]]
+	inline std::string_view fixed_name(const std::array<char, 8>& name) noexcept {
+		std::size_t len{0};
+		while (len < name.size() && name[len])
+			++len;
+		return {name.data(), len};
+	}
+
+	/*
+		The symbol table along with the string table that follows it
+
+		As with COFF, entries are followed by their auxiliary records in the same array. Every
+		external, hidden external, and weak external symbol has a csect auxiliary record last,
+		which says whether it's a csect or a label within one, and the csect's size and
+		storage mapping class.
+	*/
+	template<typename L>
+	struct symtab_t final {
+		using symbol_t = typename L::symbol_t;
+		using csect_aux_t = typename L::csect_aux_t;
+	private:
+		span_t<const symbol_t> _symbols{};
+		byte_span_t _strings{};
+	public:
+		constexpr symtab_t() noexcept = default;
+		constexpr symtab_t(const span_t<const symbol_t> symbols, const byte_span_t strings) noexcept :
+			_symbols{symbols}, _strings{strings} { /* NOP */ }
+
+		[[nodiscard]]
+		bool valid() const noexcept { return !_symbols.empty(); }
+		/* The number of records, auxiliary ones included */
+		[[nodiscard]]
+		std::size_t size() const noexcept { return _symbols.size(); }
+		[[nodiscard]]
+		span_t<const symbol_t> symbols() const noexcept { return _symbols; }
+		[[nodiscard]]
+		byte_span_t strings() const noexcept { return _strings; }
+		[[nodiscard]]
+		const symbol_t& operator[](const std::size_t idx) const noexcept { return _symbols[idx]; }
+
+		/* The index of the symbol after the one at idx, skipping its auxiliary records */
+		[[nodiscard]]
+		std::size_t next(const std::size_t idx) const noexcept {
+			return std::min(_symbols.size(), idx + 1U + _symbols[idx].n_numaux);
+		}
+
+		/* The auxiliary records of the symbol at idx, these need reinterpreting according to the symbol */
+		[[nodiscard]]
+		span_t<const symbol_t> aux(const std::size_t idx) const noexcept {
+			return _symbols.subspan(idx + 1U, next(idx) - idx - 1U);
+		}
+
+		/* Calls func(idx, symbol) for every symbol, skipping auxiliary records */
+		template<typename F>
+		void for_each(F&& func) const {
+			for (std::size_t idx{}; idx < _symbols.size(); idx = next(idx))
+				func(idx, _symbols[idx]);
+		}
+
+		/* Stabs are named from the .debug section rather than the string table, and come back empty */
+		[[nodiscard]]
+		std::string_view name(const symbol_t& sym) const noexcept {
+			if (std::uint8_t(sym.n_sclass) & Types::debug_class_mask)
+				return {};
+			if constexpr (L::xcoff_class == Types::class_t::xcoff64)
+				return _strings.string(std::size_t{sym.n_offset});
+			else {
+				/* Long names have the first 4 bytes zeroed, the rest is their offset in the string table */
+				if (sym.n_name[0] || sym.n_name[1] || sym.n_name[2] || sym.n_name[3])
+					return fixed_name(sym.n_name);
+				const auto* const offset{byte_span_t{
+					reinterpret_cast<const std::uint8_t*>(sym.n_name.data()), sym.n_name.size()
+				}.template as<Types::be_t<std::uint32_t>>(4U)};
+				return _strings.string(std::size_t{offset->value()});
+			}
+		}
+
+		/* The csect auxiliary record of the symbol at idx, or nullptr if it doesn't have one */
+		[[nodiscard]]
+		const csect_aux_t* csect(const std::size_t idx) const noexcept {
+			const auto& sym{_symbols[idx]};
+			if (sym.n_sclass != Types::storage_class_t::external && sym.n_sclass != Types::storage_class_t::hidden_ext &&
+				sym.n_sclass != Types::storage_class_t::weak_ext)
+				return nullptr;
+			const auto records{aux(idx)};
+			if (records.empty())
+				return nullptr;
+			/* XCOFF64 may put a function auxiliary record alongside, but the csect one is still last */
+			const auto* const csect{reinterpret_cast<const csect_aux_t*>(&records[records.size() - 1U])};
+			if constexpr (L::xcoff_class == Types::class_t::xcoff64) {
+				if (csect->x_auxtype != Types::aux_type_t::csect)
+					return nullptr;
+			}
+			return csect;
+		}
+
+		[[nodiscard]]
+		static std::int16_t section_number(const symbol_t& sym) noexcept { return sym.n_scnum; }
+		[[nodiscard]]
+		static bool is_external(const symbol_t& sym) noexcept {
+			return sym.n_sclass == Types::storage_class_t::external || sym.n_sclass == Types::storage_class_t::weak_ext;
+		}
+		/* Defined in a section of this object, or absolute */
+		[[nodiscard]]
+		static bool is_defined(const symbol_t& sym) noexcept {
+			return section_number(sym) > 0 || section_number(sym) == std::int16_t(Types::section_number_t::absolute);
+		}
+
+		[[nodiscard]]
+		static Types::csect_type_t csect_type(const csect_aux_t& csect) noexcept {
+			return static_cast<Types::csect_type_t>(csect.x_smtyp & 0x07U);
+		}
+		/* For csect definitions, labels have their csect's symbol index in its place */
+		[[nodiscard]]
+		static std::uint64_t csect_length(const csect_aux_t& csect) noexcept {
+			if constexpr (L::xcoff_class == Types::class_t::xcoff64)
+				return (std::uint64_t{csect.x_scnlen_hi} << 32U) | std::uint64_t{csect.x_scnlen_lo};
+			else
+				return csect.x_scnlen;
+		}
+		[[nodiscard]]
+		static std::uint64_t csect_alignment(const csect_aux_t& csect) noexcept {
+			return std::uint64_t{1U} << ((csect.x_smtyp >> 3U) & 0x1FU);
+		}
+	};
+
+	/* An entry in the loader section's import file ID table, a library path, base name, and archive member */
+	struct import_file_t final {
+		std::string_view path;
+		std::string_view base;
+		std::string_view member;
+	};
+
+	/*
+		The loader section, which is all the system loader looks at
+
+		This holds the symbols a module imports and exports, the libraries they're imported
+		from, and the relocations applied at load time, so it's everything needed to work out
+		the dependencies and dynamic symbols of an executable or shared object.
+	*/
+	template<typename L>
+	struct loader_t final {
+		using header_t = typename L::loader_header_t;
+		using symbol_t = typename L::loader_symbol_t;
+		using relocation_t = typename L::loader_relocation_t;
+	private:
+		const header_t* _header{nullptr};
+		span_t<const symbol_t> _symbols{};
+		span_t<const relocation_t> _relocations{};
+		byte_span_t _imports{};
+		byte_span_t _strings{};
+
+		constexpr loader_t(const header_t* const header) noexcept : _header{header} { /* NOP */ }
+	public:
+		constexpr loader_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<loader_t> open(const byte_span_t section) noexcept {
+			const auto* const header{section.template as<header_t>(0U)};
+			if (!header)
+				return std::nullopt;
+
+			loader_t loader{header};
+			std::size_t symbols_offset{sizeof(header_t)};
+			std::size_t relocations_offset{sizeof(header_t) + (std::size_t{header->l_nsyms} * sizeof(symbol_t))};
+			if constexpr (L::xcoff_class == Types::class_t::xcoff64) {
+				symbols_offset = narrow_size(std::uint64_t{header->l_symoff});
+				relocations_offset = narrow_size(std::uint64_t{header->l_rldoff});
+			}
+			loader._symbols = section.template array<symbol_t>(symbols_offset, header->l_nsyms);
+			loader._relocations = section.template array<relocation_t>(relocations_offset, header->l_nreloc);
+			if (loader._symbols.size() != header->l_nsyms || loader._relocations.size() != header->l_nreloc)
+				return std::nullopt;
+			loader._imports = section.subspan(narrow_size(typename L::addr_t{header->l_impoff}), header->l_istlen);
+			loader._strings = section.subspan(narrow_size(typename L::addr_t{header->l_stoff}), header->l_stlen);
+			return loader;
+		}
+
+		[[nodiscard]]
+		const header_t& header() const noexcept { return *_header; }
+		[[nodiscard]]
+		span_t<const symbol_t> symbols() const noexcept { return _symbols; }
+		[[nodiscard]]
+		span_t<const relocation_t> relocations() const noexcept { return _relocations; }
+
+		/* Loader strings are prefixed by a 2 byte length rather than terminated, offsets point past the length */
+		[[nodiscard]]
+		std::string_view name(const symbol_t& sym) const noexcept {
+			std::size_t offset{};
+			if constexpr (L::xcoff_class == Types::class_t::xcoff64)
+				offset = sym.l_offset;
+			else {
+				if (sym.l_name[0] || sym.l_name[1] || sym.l_name[2] || sym.l_name[3])
+					return fixed_name(sym.l_name);
+				offset = byte_span_t{
+					reinterpret_cast<const std::uint8_t*>(sym.l_name.data()), sym.l_name.size()
+				}.template as<Types::be_t<std::uint32_t>>(4U)->value();
+			}
+			if (offset < sizeof(std::uint16_t))
+				return {};
+			const auto* const length{_strings.template as<Types::be_t<std::uint16_t>>(offset - sizeof(std::uint16_t))};
+			if (!length)
+				return {};
+			const auto value{_strings.subspan(offset, *length)};
+			const std::string_view result{reinterpret_cast<const char*>(value.data()), value.size()};
+			return result.substr(0U, result.find('\0'));
+		}
+
+		[[nodiscard]]
+		static bool is_imported(const symbol_t& sym) noexcept {
+			return sym.l_smtype & std::uint8_t(Types::loader_symbol_flags_t::imported);
+		}
+		[[nodiscard]]
+		static bool is_exported(const symbol_t& sym) noexcept {
+			return sym.l_smtype & std::uint8_t(Types::loader_symbol_flags_t::exported);
+		}
+		[[nodiscard]]
+		static bool is_entry(const symbol_t& sym) noexcept {
+			return sym.l_smtype & std::uint8_t(Types::loader_symbol_flags_t::entry);
+		}
+
+		/*
+			Calls func(idx, file) for each import file ID, which is what l_ifile indexes
+
+			The first is not an import but the default library search path.
+		*/
+		template<typename F>
+		void for_each_import(F&& func) const {
+			std::size_t offset{};
+			for (std::size_t idx{}; idx < _header->l_nimpid && offset < _imports.size(); ++idx) {
+				std::array<std::string_view, 3> parts{};
+				for (auto& part : parts) {
+					part = _imports.string(offset);
+					if (part.empty() && offset >= _imports.size())
+						return;
+					offset += part.size() + 1U;
+				}
+				func(idx, import_file_t{parts[0], parts[1], parts[2]});
+			}
+		}
+	};
+
+	/*
+		A lazy, zero-copy reader for AIX XCOFF objects, executables, and shared objects
+
+		XCOFF is always big-endian, and every field is stored as such and only swapped when
+		it's read, which compiles down to a single byte swapping load. Uniform tables that are
+		going to be read in full, such as a TOC, are better off going through
+		section_array(), whose copy() converts the whole table at once with the vectorized
+		bswap_copy(). As with the other readers only the file header and section table are
+		validated up front, everything else is located on access.
+	*/
+	template<Types::class_t C>
+	struct xcoff_t final {
+		using layout = Types::layout_t<C>;
+		using header_t = typename layout::header_t;
+		using aux_header_t = typename layout::aux_header_t;
+		using section_t = typename layout::section_t;
+		using symbol_t = typename layout::symbol_t;
+		using relocation_t = typename layout::relocation_t;
+		using symtab_t = XCOFF::symtab_t<layout>;
+		using loader_t = XCOFF::loader_t<layout>;
+
+		static constexpr Types::class_t xcoff_class{C};
+	private:
+		byte_span_t _image{};
+		const header_t* _header{nullptr};
+		span_t<const section_t> _sections{};
+
+		constexpr xcoff_t(const byte_span_t image, const header_t* const header) noexcept :
+			_image{image}, _header{header} { /* NOP */ }
+	public:
+		constexpr xcoff_t() noexcept = default;
+
+		[[nodiscard]]
+		static std::optional<xcoff_t> open(const byte_span_t image) noexcept {
+			const auto* const header{image.template as<header_t>(0)};
+			if (!header)
+				return std::nullopt;
+			const std::uint16_t magic{header->f_magic};
+			if constexpr (C == Types::class_t::xcoff64) {
+				if (magic != Types::magic64 && magic != Types::magic64_old)
+					return std::nullopt;
+			} else if (magic != Types::magic32)
+				return std::nullopt;
+
+			xcoff_t xcoff{image, header};
+			const std::size_t count{header->f_nscns};
+			xcoff._sections = image.template array<section_t>(sizeof(header_t) + header->f_opthdr, count);
+			if (xcoff._sections.size() != count)
+				return std::nullopt;
+			return xcoff;
+		}
+
+		[[nodiscard]]
+		bool valid() const noexcept { return _header; }
+		[[nodiscard]]
+		byte_span_t image() const noexcept { return _image; }
+		[[nodiscard]]
+		const header_t& header() const noexcept { return *_header; }
+		[[nodiscard]]
+		std::uint16_t magic() const noexcept { return _header->f_magic; }
+		[[nodiscard]]
+		bool is_shared_object() const noexcept {
+			return _header->f_flags & std::uint16_t(Types::file_flags_t::shared_object);
+		}
+
+		/* Objects usually have a short auxiliary header or none, in which case this is nullptr, as it is if o_mflag is wrong */
+		[[nodiscard]]
+		const aux_header_t* aux_header() const noexcept {
+			if (_header->f_opthdr < sizeof(aux_header_t))
+				return nullptr;
+			const auto* const aux{_image.template as<aux_header_t>(sizeof(header_t))};
+			if (!aux || aux->o_mflag != Types::aux_magic)
+				return nullptr;
+			return aux;
+		}
+
+		[[nodiscard]]
+		span_t<const section_t> sections() const noexcept { return _sections; }
+
+		/* A section by its 1-based number, as symbols refer to them */
+		[[nodiscard]]
+		const section_t* section(const std::int32_t number) const noexcept {
+			if (number <= 0 || std::size_t(number) > _sections.size())
+				return nullptr;
+			return &_sections[std::size_t(number) - 1U];
+		}
+
+		/* The first section of the given type, XCOFF has at most one of most types */
+		[[nodiscard]]
+		const section_t* find_section(const Types::section_flags_t type) const noexcept {
+			for (const auto& sect : _sections) {
+				if ((sect.s_flags & std::uint32_t(Types::section_flags_t::type_mask)) == std::uint32_t(type))
+					return &sect;
+			}
+			return nullptr;
+		}
+
+		[[nodiscard]]
+		static std::string_view section_name(const section_t& section) noexcept { return fixed_name(section.s_name); }
+
+		[[nodiscard]]
+		byte_span_t section_data(const section_t& section) const noexcept {
+			const std::uint32_t type{section.s_flags & std::uint32_t(Types::section_flags_t::type_mask)};
+			if (type == std::uint32_t(Types::section_flags_t::bss) || type == std::uint32_t(Types::section_flags_t::tbss))
+				return {};
+			return _image.subspan(narrow_size(typename layout::addr_t{section.s_scnptr}),
+				narrow_size(typename layout::addr_t{section.s_size}));
+		}
+
+		/* A section's contents as a table of big-endian integers, to be read one by one or converted in bulk */
+		template<typename T>
+		[[nodiscard]]
+		Internal::be_span_t<T> section_array(const section_t& section) const noexcept { return {section_data(section)}; }
+
+		[[nodiscard]]
+		span_t<const relocation_t> relocations(const section_t& section) const noexcept {
+			std::size_t count{section.s_nreloc};
+			if constexpr (C == Types::class_t::xcoff32) {
+				/* Counts that don't fit in 16 bits are in the s_paddr of an overflow section pointing back at this one */
+				if (count == 0xFFFFU) {
+					const auto number{std::size_t(&section - _sections.data()) + 1U};
+					count = 0U;
+					for (const auto& sect : _sections) {
+						if ((sect.s_flags & std::uint32_t(Types::section_flags_t::type_mask)) ==
+							std::uint32_t(Types::section_flags_t::overflow) && sect.s_nreloc == number) {
+							count = sect.s_paddr;
+							break;
+						}
+					}
+				}
+			}
+			const auto result{_image.template array<relocation_t>(narrow_size(typename layout::addr_t{section.s_relptr}), count)};
+			return result.size() == count ? result : span_t<const relocation_t>{};
+		}
+
+		[[nodiscard]]
+		symtab_t symbols() const noexcept {
+			const auto offset{narrow_size(typename layout::addr_t{_header->f_symptr})};
+			const std::size_t count{_header->f_nsyms};
+			if (!offset || !count)
+				return {};
+			const auto symbols{_image.template array<symbol_t>(offset, count)};
+			if (symbols.size() != count)
+				return {};
+			/* The string table's leading size counts itself, so offsets into it can be used as is */
+			const auto strings_offset{offset + (count * sizeof(symbol_t))};
+			const auto* const size{_image.template as<Types::be_t<std::uint32_t>>(strings_offset)};
+			return {symbols, size ? _image.subspan(strings_offset, std::size_t{size->value()}) : byte_span_t{}};
+		}
+
+		/* The loader section of an executable or shared object, objects don't have one */
+		[[nodiscard]]
+		std::optional<loader_t> loader() const noexcept {
+			const auto* const sect{find_section(Types::section_flags_t::loader)};
+			if (!sect)
+				return std::nullopt;
+			return loader_t::open(section_data(*sect));
+		}
+	};
+
+	/*
+		Adds the defined external symbols of an image to an address index
+
+		Only csects and labels in a section are added, which covers functions (both the
+		descriptor and the "." entry point) and data. Csects have their length as their
+		size, labels within one have no size.
+	*/
+	template<Types::class_t C>
+	void index_symbols(const xcoff_t<C>& xcoff, symbol_index_t::builder_t& builder, const std::uint64_t bias = 0U) {
+		using symtab_t = typename xcoff_t<C>::symtab_t;
+
+		const auto symtab{xcoff.symbols()};
+		builder.reserve(builder.size() + symtab.size());
+		symtab.for_each([&](const std::size_t idx, const typename xcoff_t<C>::symbol_t& sym) {
+			if (!symtab_t::is_external(sym) || symtab_t::section_number(sym) <= 0)
+				return;
+			const auto* const csect{symtab.csect(idx)};
+			if (!csect)
+				return;
+			const auto type{symtab_t::csect_type(*csect)};
+			if (type != Types::csect_type_t::sd && type != Types::csect_type_t::ld)
+				return;
+			const auto name{symtab.name(sym)};
+			if (name.empty())
+				return;
+			builder.add(std::uint64_t{sym.n_value} + bias, type == Types::csect_type_t::sd ? symtab_t::csect_length(*csect) : 0U, name);
+		});
+	}
+
+	using xcoff32_t = xcoff_t<Types::class_t::xcoff32>;
+	using xcoff64_t = xcoff_t<Types::class_t::xcoff64>;
+
+	using xcoff_any_t = std::variant<xcoff32_t, xcoff64_t>;
 
+	/* Opens an image as whichever class its magic says it is */
+	[[nodiscard]]
+	LIBALFHEIM_API std::optional<xcoff_any_t> open(byte_span_t image) noexcept;
 }
 
 #endif /* libalfheim_xcoff_hh */
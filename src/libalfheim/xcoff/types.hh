@@ -4,8 +4,437 @@
 #if !defined(libalfheim_xcoff_types_hh)
 #define libalfheim_xcoff_types_hh
 
+#include <cstdint>
+#include <array>
+
+#include <libalfheim/internal/endian.hh>
+
+/* XCOFF only ever exists on big-endian POWER, so unlike the other formats everything here is fixed big-endian */
 namespace Alfheim::XCOFF::Types {
+	using Alfheim::Internal::endian_t;
+	using Alfheim::Internal::be_t;
+
+	enum struct class_t : std::uint8_t {
+		xcoff32 = 0x01U,
+		xcoff64 = 0x02U,
+	};
+
+	constexpr std::uint16_t magic32{0x01DFU};
+	/* The original AIX 4.1 64-bit magic, the layout is the same as the current one */
+	constexpr std::uint16_t magic64_old{0x01EFU};
+	constexpr std::uint16_t magic64{0x01F7U};
+
+	/* The o_mflag of a full auxiliary header */
+	constexpr std::uint16_t aux_magic{0x010BU};
+
+	enum struct file_flags_t : std::uint16_t {
+		relocs_stripped = 0x0001U,
+		executable      = 0x0002U,
+		lnno_stripped   = 0x0004U,
+		fdpr_prof       = 0x0010U,
+		fdpr_opti       = 0x0020U,
+		dsa             = 0x0040U,
+		var_pg          = 0x0100U,
+		dynload         = 0x1000U,
+		shared_object   = 0x2000U,
+		load_only       = 0x4000U,
+	};
+
+	/* The low 16 bits are the section type, DWARF sections have their subtype above that */
+	enum struct section_flags_t : std::uint32_t {
+		dwarf     = 0x00000010U,
+		text      = 0x00000020U,
+		data      = 0x00000040U,
+		bss       = 0x00000080U,
+		except    = 0x00000100U,
+		info      = 0x00000200U,
+		tdata     = 0x00000400U,
+		tbss      = 0x00000800U,
+		loader    = 0x00001000U,
+		debug     = 0x00002000U,
+		typchk    = 0x00004000U,
+		overflow  = 0x00008000U,
+		type_mask = 0x0000FFFFU,
+	};
+
+	/* Special section numbers, anything above 0 is a 1-based index into the section table */
+	enum struct section_number_t : std::int16_t {
+		undefined = 0,
+		absolute  = -1,
+		debug     = -2,
+	};
+
+	enum struct storage_class_t : std::uint8_t {
+		null          = 0U,
+		external      = 2U,
+		static_       = 3U,
+		block         = 100U,
+		function      = 101U,
+		file          = 103U,
+		/* Unnamed external, a csect that's not visible outside the object */
+		hidden_ext    = 107U,
+		begin_incl    = 108U,
+		end_incl      = 109U,
+		weak_ext      = 111U,
+		dwarf         = 112U,
+		/* Storage classes from here on are stabs, whose names are in the .debug section */
+		global_sym    = 128U,
+		local_sym     = 129U,
+		param_sym     = 130U,
+		register_sym  = 131U,
+		register_parm = 132U,
+		static_sym    = 133U,
+		begin_common  = 135U,
+		common_local  = 136U,
+		end_common    = 137U,
+		decl          = 140U,
+		entry         = 141U,
+		fun           = 142U,
+		begin_static  = 143U,
+		end_static    = 144U,
+		global_tls    = 145U,
+		static_tls    = 146U,
+	};
+
+	/* The low 3 bits of x_smtyp in a csect auxiliary entry, the rest is the log2 alignment */
+	enum struct csect_type_t : std::uint8_t {
+		/* An external reference */
+		er = 0U,
+		/* A csect definition, the length is the size of the csect */
+		sd = 1U,
+		/* A label within a csect, the length is the symbol index of the containing csect */
+		ld = 2U,
+		/* A common csect */
+		cm = 3U,
+	};
+
+	/* x_smclas, what a csect holds */
+	enum struct mapping_class_t : std::uint8_t {
+		pr     = 0U,
+		ro     = 1U,
+		db     = 2U,
+		tc     = 3U,
+		ua     = 4U,
+		rw     = 5U,
+		gl     = 6U,
+		xo     = 7U,
+		sv     = 8U,
+		bs     = 9U,
+		ds     = 10U,
+		uc     = 11U,
+		tc0    = 15U,
+		td     = 16U,
+		sv64   = 17U,
+		sv3264 = 18U,
+		tl     = 20U,
+		ul     = 21U,
+		te     = 22U,
+	};
+
+	/* Storage classes with this bit set are stabs */
+	constexpr std::uint8_t debug_class_mask{0x80U};
+
+	/* XCOFF64 auxiliary entries say what they are in their last byte */
+	enum struct aux_type_t : std::uint8_t {
+		section = 250U,
+		csect   = 251U,
+		file    = 252U,
+		sym     = 253U,
+		fcn     = 254U,
+		except  = 255U,
+	};
+
+	/* l_smtype in a loader symbol, the low 3 bits are a csect_type_t */
+	enum struct loader_symbol_flags_t : std::uint8_t {
+		exported = 0x10U,
+		entry    = 0x20U,
+		imported = 0x40U,
+	};
+
+	struct file_header32_t final {
+		be_t<std::uint16_t> f_magic;
+		be_t<std::uint16_t> f_nscns;
+		be_t<std::uint32_t> f_timdat;
+		be_t<std::uint32_t> f_symptr;
+		be_t<std::uint32_t> f_nsyms;
+		be_t<std::uint16_t> f_opthdr;
+		be_t<std::uint16_t> f_flags;
+	};
+
+	struct file_header64_t final {
+		be_t<std::uint16_t> f_magic;
+		be_t<std::uint16_t> f_nscns;
+		be_t<std::uint32_t> f_timdat;
+		be_t<std::uint64_t> f_symptr;
+		be_t<std::uint16_t> f_opthdr;
+		be_t<std::uint16_t> f_flags;
+		be_t<std::uint32_t> f_nsyms;
+	};
+
+	/* The full auxiliary header of a loadable module, objects may have a shorter one or none */
+	struct aux_header32_t final {
+		be_t<std::uint16_t> o_mflag;
+		be_t<std::uint16_t> o_vstamp;
+		be_t<std::uint32_t> o_tsize;
+		be_t<std::uint32_t> o_dsize;
+		be_t<std::uint32_t> o_bsize;
+		be_t<std::uint32_t> o_entry;
+		be_t<std::uint32_t> o_text_start;
+		be_t<std::uint32_t> o_data_start;
+		be_t<std::uint32_t> o_toc;
+		be_t<std::int16_t> o_snentry;
+		be_t<std::int16_t> o_sntext;
+		be_t<std::int16_t> o_sndata;
+		be_t<std::int16_t> o_sntoc;
+		be_t<std::int16_t> o_snloader;
+		be_t<std::int16_t> o_snbss;
+		be_t<std::uint16_t> o_algntext;
+		be_t<std::uint16_t> o_algndata;
+		std::array<char, 2> o_modtype;
+		std::uint8_t o_cpuflag;
+		std::uint8_t o_cputype;
+		be_t<std::uint32_t> o_maxstack;
+		be_t<std::uint32_t> o_maxdata;
+		be_t<std::uint32_t> o_debugger;
+		std::uint8_t o_textpsize;
+		std::uint8_t o_datapsize;
+		std::uint8_t o_stackpsize;
+		std::uint8_t o_flags;
+		be_t<std::int16_t> o_sntdata;
+		be_t<std::int16_t> o_sntbss;
+	};
+
+	struct aux_header64_t final {
+		be_t<std::uint16_t> o_mflag;
+		be_t<std::uint16_t> o_vstamp;
+		be_t<std::uint32_t> o_debugger;
+		be_t<std::uint64_t> o_text_start;
+		be_t<std::uint64_t> o_data_start;
+		be_t<std::uint64_t> o_toc;
+		be_t<std::int16_t> o_snentry;
+		be_t<std::int16_t> o_sntext;
+		be_t<std::int16_t> o_sndata;
+		be_t<std::int16_t> o_sntoc;
+		be_t<std::int16_t> o_snloader;
+		be_t<std::int16_t> o_snbss;
+		be_t<std::uint16_t> o_algntext;
+		be_t<std::uint16_t> o_algndata;
+		std::array<char, 2> o_modtype;
+		std::uint8_t o_cpuflag;
+		std::uint8_t o_cputype;
+		std::uint8_t o_textpsize;
+		std::uint8_t o_datapsize;
+		std::uint8_t o_stackpsize;
+		std::uint8_t o_flags;
+		be_t<std::uint64_t> o_tsize;
+		be_t<std::uint64_t> o_dsize;
+		be_t<std::uint64_t> o_bsize;
+		be_t<std::uint64_t> o_entry;
+		be_t<std::uint64_t> o_maxstack;
+		be_t<std::uint64_t> o_maxdata;
+		be_t<std::int16_t> o_sntdata;
+		be_t<std::int16_t> o_sntbss;
+		be_t<std::uint16_t> o_x64flags;
+		be_t<std::int16_t> o_resv3a;
+		std::array<be_t<std::uint32_t>, 2> o_resv3;
+	};
+
+	struct section_header32_t final {
+		std::array<char, 8> s_name;
+		be_t<std::uint32_t> s_paddr;
+		be_t<std::uint32_t> s_vaddr;
+		be_t<std::uint32_t> s_size;
+		be_t<std::uint32_t> s_scnptr;
+		be_t<std::uint32_t> s_relptr;
+		be_t<std::uint32_t> s_lnnoptr;
+		be_t<std::uint16_t> s_nreloc;
+		be_t<std::uint16_t> s_nlnno;
+		be_t<std::uint32_t> s_flags;
+	};
+
+	struct section_header64_t final {
+		std::array<char, 8> s_name;
+		be_t<std::uint64_t> s_paddr;
+		be_t<std::uint64_t> s_vaddr;
+		be_t<std::uint64_t> s_size;
+		be_t<std::uint64_t> s_scnptr;
+		be_t<std::uint64_t> s_relptr;
+		be_t<std::uint64_t> s_lnnoptr;
+		be_t<std::uint32_t> s_nreloc;
+		be_t<std::uint32_t> s_nlnno;
+		be_t<std::uint32_t> s_flags;
+		be_t<std::uint32_t> s_pad;
+	};
+
+	/* The name is inline if it fits in 8 bytes, otherwise the first 4 are zero and the rest is a string table offset */
+	struct symbol32_t final {
+		std::array<char, 8> n_name;
+		be_t<std::uint32_t> n_value;
+		be_t<std::int16_t> n_scnum;
+		be_t<std::uint16_t> n_type;
+		storage_class_t n_sclass;
+		std::uint8_t n_numaux;
+	};
+
+	/* XCOFF64 names always live in the string table */
+	struct symbol64_t final {
+		be_t<std::uint64_t> n_value;
+		be_t<std::uint32_t> n_offset;
+		be_t<std::int16_t> n_scnum;
+		be_t<std::uint16_t> n_type;
+		storage_class_t n_sclass;
+		std::uint8_t n_numaux;
+	};
+
+	/* The last auxiliary entry of every external, hidden external, and weak external symbol */
+	struct csect_aux32_t final {
+		be_t<std::uint32_t> x_scnlen;
+		be_t<std::uint32_t> x_parmhash;
+		be_t<std::uint16_t> x_snhash;
+		std::uint8_t x_smtyp;
+		mapping_class_t x_smclas;
+		be_t<std::uint32_t> x_stab;
+		be_t<std::uint16_t> x_snstab;
+	};
+
+	struct csect_aux64_t final {
+		be_t<std::uint32_t> x_scnlen_lo;
+		be_t<std::uint32_t> x_parmhash;
+		be_t<std::uint16_t> x_snhash;
+		std::uint8_t x_smtyp;
+		mapping_class_t x_smclas;
+		be_t<std::uint32_t> x_scnlen_hi;
+		std::uint8_t x_pad;
+		aux_type_t x_auxtype;
+	};
+
+	struct relocation32_t final {
+		be_t<std::uint32_t> r_vaddr;
+		be_t<std::uint32_t> r_symndx;
+		/* The top bit is set for signed fields, the low 6 bits are the field length minus one */
+		std::uint8_t r_rsize;
+		std::uint8_t r_rtype;
+	};
+
+	struct relocation64_t final {
+		be_t<std::uint64_t> r_vaddr;
+		be_t<std::uint32_t> r_symndx;
+		std::uint8_t r_rsize;
+		std::uint8_t r_rtype;
+	};
+
+	/* The loader section is what the system loader reads, the imports, exports, and load-time relocations */
+	struct loader_header32_t final {
+		be_t<std::uint32_t> l_version;
+		be_t<std::uint32_t> l_nsyms;
+		be_t<std::uint32_t> l_nreloc;
+		be_t<std::uint32_t> l_istlen;
+		be_t<std::uint32_t> l_nimpid;
+		be_t<std::uint32_t> l_impoff;
+		be_t<std::uint32_t> l_stlen;
+		be_t<std::uint32_t> l_stoff;
+	};
+
+	struct loader_header64_t final {
+		be_t<std::uint32_t> l_version;
+		be_t<std::uint32_t> l_nsyms;
+		be_t<std::uint32_t> l_nreloc;
+		be_t<std::uint32_t> l_istlen;
+		be_t<std::uint32_t> l_nimpid;
+		be_t<std::uint32_t> l_stlen;
+		be_t<std::uint64_t> l_impoff;
+		be_t<std::uint64_t> l_stoff;
+		be_t<std::uint64_t> l_symoff;
+		be_t<std::uint64_t> l_rldoff;
+	};
+
+	struct loader_symbol32_t final {
+		std::array<char, 8> l_name;
+		be_t<std::uint32_t> l_value;
+		be_t<std::int16_t> l_scnum;
+		std::uint8_t l_smtype;
+		mapping_class_t l_smclas;
+		be_t<std::uint32_t> l_ifile;
+		be_t<std::uint32_t> l_parm;
+	};
+
+	struct loader_symbol64_t final {
+		be_t<std::uint64_t> l_value;
+		be_t<std::uint32_t> l_offset;
+		be_t<std::int16_t> l_scnum;
+		std::uint8_t l_smtype;
+		mapping_class_t l_smclas;
+		be_t<std::uint32_t> l_ifile;
+		be_t<std::uint32_t> l_parm;
+	};
+
+	struct loader_relocation32_t final {
+		be_t<std::uint32_t> l_vaddr;
+		be_t<std::uint32_t> l_symndx;
+		be_t<std::uint16_t> l_rtype;
+		be_t<std::int16_t> l_rsecnm;
+	};
+
+	struct loader_relocation64_t final {
+		be_t<std::uint64_t> l_vaddr;
+		be_t<std::uint16_t> l_rtype;
+		be_t<std::int16_t> l_rsecnm;
+		be_t<std::uint32_t> l_symndx;
+	};
+
+	template<class_t C>
+	struct layout_t;
+
+	template<>
+	struct layout_t<class_t::xcoff32> final {
+		static constexpr class_t xcoff_class{class_t::xcoff32};
+
+		using header_t            = file_header32_t;
+		using aux_header_t        = aux_header32_t;
+		using section_t           = section_header32_t;
+		using symbol_t            = symbol32_t;
+		using csect_aux_t         = csect_aux32_t;
+		using relocation_t        = relocation32_t;
+		using loader_header_t     = loader_header32_t;
+		using loader_symbol_t     = loader_symbol32_t;
+		using loader_relocation_t = loader_relocation32_t;
+		using addr_t              = std::uint32_t;
+	};
+
+	template<>
+	struct layout_t<class_t::xcoff64> final {
+		static constexpr class_t xcoff_class{class_t::xcoff64};
+
+		using header_t            = file_header64_t;
+		using aux_header_t        = aux_header64_t;
+		using section_t           = section_header64_t;
+		using symbol_t            = symbol64_t;
+		using csect_aux_t         = csect_aux64_t;
+		using relocation_t        = relocation64_t;
+		using loader_header_t     = loader_header64_t;
+		using loader_symbol_t     = loader_symbol64_t;
+		using loader_relocation_t = loader_relocation64_t;
+		using addr_t              = std::uint64_t;
+	};
 
+	static_assert(sizeof(file_header32_t) == 20, "file_header32_t must be 20 bytes");
+	static_assert(sizeof(file_header64_t) == 24, "file_header64_t must be 24 bytes");
+	static_assert(sizeof(aux_header32_t) == 72, "aux_header32_t must be 72 bytes");
+	static_assert(sizeof(aux_header64_t) == 120, "aux_header64_t must be 120 bytes");
+	static_assert(sizeof(section_header32_t) == 40, "section_header32_t must be 40 bytes");
+	static_assert(sizeof(section_header64_t) == 72, "section_header64_t must be 72 bytes");
+	static_assert(sizeof(symbol32_t) == 18, "symbol32_t must be 18 bytes");
+	static_assert(sizeof(symbol64_t) == 18, "symbol64_t must be 18 bytes");
+	static_assert(sizeof(csect_aux32_t) == 18, "csect_aux32_t must be 18 bytes");
+	static_assert(sizeof(csect_aux64_t) == 18, "csect_aux64_t must be 18 bytes");
+	static_assert(sizeof(relocation32_t) == 10, "relocation32_t must be 10 bytes");
+	static_assert(sizeof(relocation64_t) == 14, "relocation64_t must be 14 bytes");
+	static_assert(sizeof(loader_header32_t) == 32, "loader_header32_t must be 32 bytes");
+	static_assert(sizeof(loader_header64_t) == 56, "loader_header64_t must be 56 bytes");
+	static_assert(sizeof(loader_symbol32_t) == 24, "loader_symbol32_t must be 24 bytes");
+	static_assert(sizeof(loader_symbol64_t) == 24, "loader_symbol64_t must be 24 bytes");
+	static_assert(sizeof(loader_relocation32_t) == 12, "loader_relocation32_t must be 12 bytes");
+	static_assert(sizeof(loader_relocation64_t) == 16, "loader_relocation64_t must be 16 bytes");
 }
 
 #endif /* libalfheim_xcoff_types_hh */